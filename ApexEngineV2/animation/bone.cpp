@@ -5,6 +5,8 @@ namespace apex {
 Bone::Bone(const std::string &name)
     : Entity(name)
 {
+    // bone matrices depend on the parent bone, so the transform system defers to UpdateTransform()
+    SetCustomTransformUpdate(true);
 }
 
 void Bone::ClearPose()
@@ -39,8 +41,8 @@ void Bone::StoreBindingPose()
 
 void Bone::SetToBindingPose()
 {
-    m_local_rotation = bind_rot;
-    m_local_translation = bind_pos;
+    SetLocalRotation(bind_rot);
+    SetLocalTranslation(bind_pos);
 
     pose_pos = bind_pos;
     pose_rot = bind_rot;
@@ -101,7 +103,7 @@ void Bone::UpdateTransform()
         scale_matrix *= tmp_scale;
     }
 
-    MatrixUtil::ToScaling(tmp_scale, m_local_scale);
+    MatrixUtil::ToScaling(tmp_scale, GetLocalScale());
     scale_matrix *= tmp_scale;
  
     Vector3 tmp_pos = (global_bone_pos) * -1;
@@ -151,15 +153,15 @@ std::shared_ptr<Bone> Bone::CloneImpl()
     new_bone->bind_pos = bind_pos;
     new_bone->inv_bind_pos = inv_bind_pos;
     new_bone->pose_pos = pose_pos;
-    new_bone->m_local_translation = m_local_translation;
+    new_bone->SetLocalTranslation(GetLocalTranslation());
 
     new_bone->global_bone_rot = global_bone_rot;
     new_bone->bind_rot = bind_rot;
     new_bone->inv_bind_rot = inv_bind_rot;
     new_bone->pose_rot = pose_rot;
-    new_bone->m_local_rotation = m_local_rotation;
+    new_bone->SetLocalRotation(GetLocalRotation());
 
-    new_bone->m_local_scale = m_local_scale;
+    new_bone->SetLocalScale(GetLocalScale());
 
     new_bone->bone_matrix = bone_matrix;
     new_bone->current_pose = current_pose;
@@ -60,12 +60,12 @@ private:
 
     std::shared_ptr<Bone> CloneImpl();
 
-    inline Vector3 GetOffsetTranslation() const { return m_local_translation - bind_pos; }
+    inline Vector3 GetOffsetTranslation() const { return GetLocalTranslation() - bind_pos; }
     inline Quaternion GetOffsetRotation() const
     {
         Quaternion inv_bind_rot_local(bind_rot);
         inv_bind_rot_local.Invert();
-        return m_local_rotation * inv_bind_rot_local;
+        return GetLocalRotation() * inv_bind_rot_local;
     }
 };
 }
@@ -1,8 +1,13 @@
 #include "skeleton_control.h"
 
+#include <mutex>
+
 namespace apex {
+// skinning shaders are shared between every skeleton with the same properties
+static std::mutex skinning_shader_mutex;
+
 SkeletonControl::SkeletonControl(std::shared_ptr<Shader> skinning_shader)
-    : EntityControl(60.0), skinning_shader(skinning_shader),
+    : EntityControl(60.0, true), skinning_shader(skinning_shader),
     play_state(STOPPED), loop_mode(PLAY_ONCE),
     current_anim(nullptr), time(0.0)
 {
@@ -122,6 +127,8 @@ void SkeletonControl::OnUpdate(double dt)
         current_anim->ApplyBlended(time, 0.5);
     }
 
+    std::lock_guard<std::mutex> lock(skinning_shader_mutex);
+
     for (size_t i = 0; i < bones.size(); i++) {
         skinning_shader->SetUniform(bone_names[i], bones[i]->GetBoneMatrix());
     }
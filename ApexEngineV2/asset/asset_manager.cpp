@@ -7,6 +7,7 @@
 #include "texture_loader.h"
 #include "../audio/wav_loader.h"
 #include "../util/string_util.h"
+#include "../profiler.h"
 
 #include <iostream>
 
@@ -46,16 +47,30 @@ AssetManager::AssetManager()
 
 std::shared_ptr<Loadable> AssetManager::LoadFromFile(const std::string &path, bool use_caching)
 {
+    APEX_PROFILE_SCOPE("AssetManager::LoadFromFile");
+
     const std::string new_path = StringUtil::Trim(StringUtil::ReplaceAll(path, "\\", "/"));
     
     if (use_caching) {
-        auto it = loaded_assets.find(new_path);
-        if (it != loaded_assets.end() && it->second != nullptr) {
+        std::shared_ptr<Loadable> cached;
+
+        {
+            // shader sources are loaded from worker threads during warm-up
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            auto it = loaded_assets.find(new_path);
+
+            if (it != loaded_assets.end()) {
+                cached = it->second;
+            }
+        }
+
+        if (cached != nullptr) {
             // reuse already loaded asset
-            const auto clone = it->second->Clone();
+            const auto clone = cached->Clone();
 
             if (clone == nullptr) { // no implementation; return shared ptr
-                return it->second;
+                return cached;
             }
         }
     }
@@ -71,6 +86,8 @@ std::shared_ptr<Loadable> AssetManager::LoadFromFile(const std::string &path, bo
             } else {
                 loaded->SetFilePath(new_path);
                 if (use_caching) {
+                    // two threads loading the same file both load it, the last one is kept
+                    std::lock_guard<std::mutex> lock(m_mutex);
                     loaded_assets[new_path] = loaded;
                 }
             }
@@ -7,6 +7,7 @@
 #include <string>
 #include <map>
 #include <algorithm>
+#include <mutex>
 
 namespace apex {
 class AssetManager {
@@ -43,6 +44,9 @@ private:
 
     std::map<std::string, std::unique_ptr<AssetLoader>> loaders;
     std::map<std::string, std::shared_ptr<Loadable>> loaded_assets;
+    // guards loaded_assets only. loaders run unlocked, as they load other assets
+    // (materials of a model) and create shaders, which take locks of their own.
+    std::mutex m_mutex;
 };
 }
 
@@ -6,6 +6,7 @@
 #include "../../rendering/mesh.h"
 #include "../../math/vertex.h"
 #include "../../util/string_util.h"
+#include "../../util/mesh_factory.h"
 #include "../../entity.h"
 #include "mtl_loader.h"
 
@@ -172,6 +173,8 @@ std::shared_ptr<Loadable> ObjLoader::LoadFromFile(const std::string &path)
             .Define("NORMAL_MAPPING", true)
         ));
 
+        MeshFactory::PrepareImportedMesh(mesh, path + ":" + model.mesh_names[i]);
+
         auto geom = std::make_shared<Entity>();
         geom->SetName(model.mesh_names[i]);
         geom->SetRenderable(mesh);
@@ -14,6 +14,7 @@
 #include "../../animation/skeleton_control.h"
 #include "../../util.h"
 #include "../../util/string_util.h"
+#include "../../util/mesh_factory.h"
 
 #include <vector>
 #include <map>
@@ -246,6 +247,8 @@ std::shared_ptr<Loadable> OgreLoader::LoadFromFile(const std::string &path)
             mesh->SetAttribute(Mesh::ATTR_TEXCOORDS0, Mesh::MeshAttribute::TexCoords0);
         }
 
+        MeshFactory::PrepareImportedMesh(mesh, path);
+
         auto ent = std::make_shared<Entity>();
         ent->SetRenderable(mesh);
         final_node->AddChild(ent);
@@ -272,6 +275,8 @@ std::shared_ptr<Loadable> OgreLoader::LoadFromFile(const std::string &path)
 
             mesh->CalculateTangents();
 
+            MeshFactory::PrepareImportedMesh(mesh, path);
+
             auto ent = std::make_shared<Entity>();
             ent->SetRenderable(mesh);
             final_node->AddChild(ent);
@@ -2,8 +2,9 @@
 
 namespace apex {
 
-EntityControl::EntityControl(const double tps)
+EntityControl::EntityControl(const double tps, const bool thread_safe)
     : tps(tps), 
+      thread_safe(thread_safe),
       tick(0.0)
 {
 }
@@ -8,9 +8,13 @@ class Entity;
 class EntityControl {
     friend class Entity;
 public:
-    EntityControl(const double tps = 30.0);
+    // thread_safe controls only touch their parent entity's subtree (and their own state)
+    // in OnUpdate(), so they may be updated on a worker thread alongside other subtrees.
+    EntityControl(const double tps = 30.0, const bool thread_safe = false);
     virtual ~EntityControl();
 
+    inline bool IsThreadSafe() const { return thread_safe; }
+
     virtual void OnAdded() = 0;
     virtual void OnRemoved() = 0;
     virtual void OnUpdate(double dt) = 0;
@@ -20,6 +24,7 @@ protected:
 
 private:
     const double tps;
+    const bool thread_safe;
     double tick;
 };
 
@@ -2,7 +2,7 @@
 
 namespace apex {
 BoundingBoxControl::BoundingBoxControl()
-    : EntityControl()
+    : EntityControl(30.0, true)
 {
     m_bounding_box_renderer.reset(new BoundingBoxRenderer());
 
@@ -1,7 +1,10 @@
 #ifndef CORE_ENGINE_H
 #define CORE_ENGINE_H
 
+#include "render_state.h"
+
 #include <stddef.h>
+#include <stdint.h>
 
 #define APEX_MULTITHREADING 1
 
@@ -20,6 +23,14 @@ public:
         double fps = 0;
     } stats;
 
+    // shadow state of the context. engines that issue real calls skip those
+    // that would not change it, and call NextFrame() once per frame.
+    inline RenderState &GetRenderState() { return m_render_state; }
+    inline const RenderState &GetRenderState() const { return m_render_state; }
+
+    // returned by GetUniformBlockIndex() for blocks the program does not declare
+    static const unsigned int INVALID_INDEX = 0xFFFFFFFF;
+
     enum GLEnums {
         DEPTH_BUFFER_BIT = 0x00000100,
         STENCIL_BUFFER_BIT = 0x00000400,
@@ -49,7 +60,9 @@ public:
         INT = 0x1404,
         UNSIGNED_INT = 0x1405,
         FLOAT = 0x1406,
+        HALF_FLOAT = 0x140B,
         FIXED = 0x140C,
+        INT_2_10_10_10_REV = 0x8D9F,
 
         DEPTH_COMPONENT = 0x1902,
         ALPHA = 0x1906,
@@ -87,6 +100,7 @@ public:
         TEXTURE_CUBE_MAP_POSITIVE_Z = 0x8519,
         TEXTURE_CUBE_MAP_NEGATIVE_Z = 0x851A,
         MAX_CUBE_MAP_TEXTURE_SIZE = 0x851C,
+        TEXTURE_2D_ARRAY = 0x8C1A,
 
         TEXTURE0 = 0x84C0,
         ACTIVE_TEXTURE = 0x84E0,
@@ -96,10 +110,24 @@ public:
 
         ARRAY_BUFFER = 0x8892,
         ELEMENT_ARRAY_BUFFER = 0x8893,
+        UNIFORM_BUFFER = 0x8A11,
+        PIXEL_PACK_BUFFER = 0x88EB,
+        PIXEL_UNPACK_BUFFER = 0x88EC,
 
         STREAM_DRAW = 0x88E0,
         STATIC_DRAW = 0x88E4,
         DYNAMIC_DRAW = 0x88E8,
+        STREAM_COPY = 0x88E2,
+
+        MAP_WRITE_BIT = 0x0002,
+        MAP_PERSISTENT_BIT = 0x0040,
+        MAP_COHERENT_BIT = 0x0080,
+        DYNAMIC_STORAGE_BIT = 0x0100,
+
+        ALREADY_SIGNALED = 0x911A,
+        TIMEOUT_EXPIRED = 0x911B,
+        CONDITION_SATISFIED = 0x911C,
+        WAIT_FAILED = 0x911D,
         FRONT = 0x0404,
         BACK = 0x0405,
         FRONT_AND_BACK = 0x0408,
@@ -113,6 +141,12 @@ public:
         LINK_STATUS = 0x8B82,
         VALIDATE_STATUS = 0x8B83,
         INFO_LOG_LENGTH = 0x8B84,
+        PROGRAM_BINARY_LENGTH = 0x8741,
+        PROGRAM_BINARY_RETRIEVABLE_HINT = 0x8257,
+
+        VENDOR = 0x1F00,
+        RENDERER = 0x1F01,
+        VERSION = 0x1F02,
 
         FRAMEBUFFER = 0x8D40,
         RENDERBUFFER = 0x8D41,
@@ -132,31 +166,57 @@ public:
     virtual void Disable(int cap) = 0;
     virtual void DepthMask(bool mask) = 0;
     virtual void BlendFunc(int src, int dst) = 0;
+    virtual void CullFace(int mode) = 0;
+    virtual unsigned int GetError() = 0;
     virtual void GenBuffers(size_t count, unsigned int *buffers) = 0;
     virtual void DeleteBuffers(size_t count, unsigned int *buffers) = 0;
     virtual void BindBuffer(int target, unsigned int buffer) = 0;
     virtual void BufferData(int target, size_t size, const void *data, int usage) = 0;
     virtual void BufferSubData(int target, size_t offset, size_t size, const void *data) = 0;
+    // immutable storage and persistent mapping need GL 4.4 or ARB_buffer_storage.
+    // when this returns false, BufferStorage() and MapBufferRange() must not be called.
+    virtual bool SupportsBufferStorage() = 0;
+    virtual void BufferStorage(int target, size_t size, const void *data, unsigned int flags) = 0;
+    virtual void *MapBufferRange(int target, size_t offset, size_t size, unsigned int access) = 0;
+    virtual bool UnmapBuffer(int target) = 0;
+    // sync objects are opaque handles. returns null if fences are not supported.
+    virtual void *FenceSync() = 0;
+    // returns one of ALREADY_SIGNALED, TIMEOUT_EXPIRED, CONDITION_SATISFIED or WAIT_FAILED
+    virtual unsigned int ClientWaitSync(void *sync, bool flush, uint64_t timeout_ns) = 0;
+    virtual void DeleteSync(void *sync) = 0;
     virtual void BindVertexArray(unsigned int target) = 0;
     virtual void GenVertexArrays(size_t size, unsigned int *arrays) = 0;
+    virtual void DeleteVertexArrays(size_t size, const unsigned int *arrays) = 0;
     virtual void EnableVertexAttribArray(unsigned int index) = 0;
     virtual void DisableVertexAttribArray(unsigned int index) = 0;
     virtual void VertexAttribPointer(unsigned int index, int size, int type, bool normalized, size_t stride, void *ptr) = 0;
     virtual void DrawElements(int mode, size_t count, int type, const void *indices) = 0;
+    // one DrawElements() per range, in a single call
+    virtual void MultiDrawElements(int mode, const int *counts, int type, const void *const *indices, size_t drawcount) = 0;
     virtual void GenTextures(size_t n, unsigned int *textures) = 0;
     virtual void DeleteTextures(size_t n, const unsigned int *textures) = 0;
     virtual void TexParameteri(int target, int pname, int param) = 0;
     virtual void TexParameterf(int target, int pname, float param) = 0;
     virtual void TexImage2D(int target, int level, int ifmt, size_t width, size_t height,
         int border, int fmt, int type, const void *data) = 0;
+    virtual void CopyTexImage2D(int target, int level, int ifmt, int x, int y,
+        size_t width, size_t height, int border) = 0;
+    virtual void TexImage3D(int target, int level, int ifmt, size_t width, size_t height, size_t depth,
+        int border, int fmt, int type, const void *data) = 0;
+    virtual void TexSubImage3D(int target, int level, int x, int y, int z, size_t width, size_t height, size_t depth,
+        int fmt, int type, const void *data) = 0;
+    // with a PIXEL_PACK_BUFFER bound, pixels is an offset into it
+    virtual void GetTexImage(int target, int level, int fmt, int type, void *pixels) = 0;
     virtual void BindTexture(int target, unsigned int texture) = 0;
     virtual void ActiveTexture(int i) = 0;
     virtual void GenerateMipmap(int target) = 0;
     virtual void GenFramebuffers(size_t n, unsigned int *ids) = 0;
     virtual void DeleteFramebuffers(size_t n, const unsigned int *ids) = 0;
     virtual void BindFramebuffer(int target, unsigned int framebuffer) = 0;
-    virtual void FramebufferTexture(int target, int attachment, unsigned int texture, unsigned int texture_target, int level) = 0;
+    virtual void FramebufferTexture(int target, int attachment, unsigned int texture, int level) = 0;
+    virtual void FramebufferTexture2D(int target, int attachment, int texture_target, unsigned int texture, int level) = 0;
     virtual void DrawBuffers(size_t n, const unsigned int *bufs) = 0;
+    virtual void ReadBuffer(int mode) = 0;
     virtual unsigned int CheckFramebufferStatus(int target) = 0;
     virtual unsigned int CreateProgram() = 0;
     virtual unsigned int CreateShader(int type) = 0;
@@ -166,14 +226,22 @@ public:
     virtual void GetShaderiv(unsigned int shader, int pname, int *params) = 0;
     virtual void GetShaderInfoLog(unsigned int shader, int max, int *len, char *info) = 0;
     virtual void BindAttribLocation(unsigned int program, unsigned int index, const char *name) = 0;
+    virtual void BindFragDataLocation(unsigned int program, unsigned int color, const char *name) = 0;
     virtual void LinkProgram(unsigned int program) = 0;
     virtual void ValidateProgram(unsigned int program) = 0;
     virtual void GetProgramiv(unsigned int program, int pname, int *params) = 0;
     virtual void GetProgramInfoLog(unsigned int program, int max, int *len, char *log) = 0;
+    virtual void ProgramParameteri(unsigned int program, int pname, int value) = 0;
+    virtual void GetProgramBinary(unsigned int program, size_t max, size_t *len, unsigned int *format, void *binary) = 0;
+    virtual void ProgramBinary(unsigned int program, unsigned int format, const void *binary, size_t len) = 0;
+    virtual const char *GetString(int name) = 0;
     virtual void DeleteProgram(unsigned int program) = 0;
     virtual void DeleteShader(unsigned int shader) = 0;
     virtual void UseProgram(unsigned int program) = 0;
     virtual int GetUniformLocation(unsigned int program, const char *name) = 0;
+    virtual unsigned int GetUniformBlockIndex(unsigned int program, const char *name) = 0;
+    virtual void UniformBlockBinding(unsigned int program, unsigned int index, unsigned int binding) = 0;
+    virtual void BindBufferBase(int target, unsigned int index, unsigned int buffer) = 0;
     virtual void Uniform1f(int location, float v0) = 0;
     virtual void Uniform2f(int location, float v0, float v1) = 0;
     virtual void Uniform3f(int location, float v0, float v1, float v2) = 0;
@@ -185,8 +253,12 @@ public:
     virtual void UniformMatrix4fv(int location, int count, bool transpose, const float *value) = 0;
     virtual void VertexAttribDivisor(unsigned int index, unsigned int divisor) = 0;
     virtual void DrawArraysInstanced(int mode, int first, size_t count, size_t primcount) = 0;
+    virtual void DrawElementsInstanced(int mode, size_t count, int type, const void *indices, size_t primcount) = 0;
     virtual void BindImageTexture(unsigned int unit, unsigned int texture, int level, bool layered, int layer, unsigned int access, unsigned int format) = 0;
 
+protected:
+    RenderState m_render_state;
+
 private:
     static CoreEngine *instance;
 };
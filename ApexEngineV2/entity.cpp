@@ -1,18 +1,24 @@
 #include "entity.h"
+#include "worker_pool.h"
+#include "profiler.h"
 
 #include <algorithm>
 
 namespace apex {
 
+// 0 is never used, so a walk that has not run yet visits everything
+std::atomic<uint32_t> Entity::change_epoch(1);
+
 Entity::Entity(const std::string &name)
     : m_name(name),
       m_aabb_affects_parent(true),
       m_flags(0),
+      m_revision(0),
       m_parent(nullptr),
-      m_local_translation(Vector3::Zero()),
-      m_local_scale(Vector3::One()),
-      m_local_rotation(Quaternion::Identity())
+      m_subtree_change_epoch(change_epoch.load(std::memory_order_relaxed)),
+      m_transform_change_epoch(change_epoch.load(std::memory_order_relaxed))
 {
+    m_transform_handle = TransformSystem::GetInstance()->Register(this);
 }
 
 Entity::~Entity()
@@ -24,6 +30,8 @@ Entity::~Entity()
 
     m_controls.clear();
     m_children.clear();
+
+    TransformSystem::GetInstance()->Unregister(m_transform_handle);
 }
 
 void Entity::SetGlobalTranslation(const Vector3 &translation)
@@ -34,10 +42,7 @@ void Entity::SetGlobalTranslation(const Vector3 &translation)
         return;
     }
 
-    m_local_translation = translation - m_parent->GetGlobalTransform().GetTranslation();
-
-    SetTransformUpdateFlag();
-    SetAABBUpdateFlag();
+    SetLocalTranslation(translation - m_parent->GetGlobalTransform().GetTranslation());
 }
 
 void Entity::SetGlobalRotation(const Quaternion &rotation)
@@ -51,10 +56,7 @@ void Entity::SetGlobalRotation(const Quaternion &rotation)
     Quaternion tmp = m_parent->GetGlobalTransform().GetRotation();
     tmp.Invert();
 
-    m_local_rotation = rotation * tmp;
-
-    SetTransformUpdateFlag();
-    SetAABBUpdateFlag();
+    SetLocalRotation(rotation * tmp);
 }
 
 void Entity::SetGlobalScale(const Vector3 &scale)
@@ -65,21 +67,14 @@ void Entity::SetGlobalScale(const Vector3 &scale)
         return;
     }
 
-    m_local_scale = scale / m_parent->GetGlobalTransform().GetScale();
-
-    SetTransformUpdateFlag();
-    SetAABBUpdateFlag();
+    SetLocalScale(scale / m_parent->GetGlobalTransform().GetScale());
 }
 
 void Entity::UpdateTransform()
 {
-    if (m_parent != nullptr) {
-        m_global_transform.SetTranslation(m_local_translation + m_parent->GetGlobalTransform().GetTranslation());
-        m_global_transform.SetScale(m_local_scale * m_parent->GetGlobalTransform().GetScale());
-        m_global_transform.SetRotation(m_local_rotation * m_parent->GetGlobalTransform().GetRotation());
-    } else {
-        m_global_transform = Transform(m_local_translation, m_local_scale, m_local_rotation);
-    }
+    // the revision of the transform slot is bumped by the transform system
+    TransformSystem::GetInstance()->UpdateTransform(m_transform_handle);
+    MarkTransformChanged();
 }
 
 void Entity::UpdateAABB()
@@ -96,7 +91,7 @@ void Entity::UpdateAABB()
             std::array<Vector3, 8> corners = renderable_aabb.GetCorners();
 
             for (Vector3 &corner : corners) {
-                corner *= m_global_transform.GetMatrix();
+                corner *= GetGlobalTransform().GetMatrix();
 
                 renderable_aabb_transformed.Extend(corner);
             }
@@ -108,20 +103,27 @@ void Entity::UpdateAABB()
     if (m_aabb_affects_parent && m_parent != nullptr) {
         // multiply parent's bounding box by this one
         m_parent->m_aabb.Extend(m_aabb);
+        m_parent->Invalidate();
     }
+
+    Invalidate();
 }
 
 float Entity::CalculateCameraDistance(Camera *camera) const
 {
-    return m_global_transform.GetTranslation().Distance(camera->GetTranslation());
+    return GetGlobalTransform().GetTranslation().Distance(camera->GetTranslation());
 }
 
 void Entity::AddChild(std::shared_ptr<Entity> entity)
 {
     m_children.push_back(entity);
     entity->m_parent = this;
+    TransformSystem::GetInstance()->SetParent(entity->m_transform_handle, m_transform_handle);
     entity->SetTransformUpdateFlag();
 
+    // a child already stamped this epoch stops its walk before reaching this one
+    MarkSubtreeChanged();
+
     if (entity->GetAABBAffectsParent()) {
         SetAABBUpdateFlag();
     }
@@ -132,9 +134,13 @@ void Entity::RemoveChild(const std::shared_ptr<Entity> &entity)
     m_children_pending_removal.push_back(entity);
     m_children.erase(std::find(m_children.begin(), m_children.end(), entity));
     entity->m_parent = nullptr;
+    TransformSystem::GetInstance()->SetParent(entity->m_transform_handle, TransformSystem::invalid_handle);
     entity->SetPendingRemovalFlag();
     entity->SetTransformUpdateFlag();
 
+    // the removed entity no longer stamps this one, which lists it as pending removal
+    MarkSubtreeChanged();
+
     if (entity->GetAABBAffectsParent()) {
         SetAABBUpdateFlag();
     }
@@ -177,39 +183,122 @@ void Entity::RemoveControl(const std::shared_ptr<EntityControl> &control)
 
 void Entity::Update(double dt)
 {
-    if (m_flags & UPDATE_TRANSFORM) {
-        UpdateTransform();
-        m_flags &= ~UPDATE_TRANSFORM;
+    APEX_PROFILE_SCOPE("Entity::Update");
+
+    TransformSystem::GetInstance()->Update();
+
+#if ENTITY_PARALLEL_UPDATE
+    UpdateControlsParallel(dt);
+#else
+    UpdateControls(dt, nullptr);
+#endif
+
+    // pick up any transforms changed by controls this frame
+    TransformSystem::GetInstance()->Update();
+
+    UpdateBounds();
+}
+
+void Entity::UpdateControlsParallel(double dt)
+{
+    WorkerPool *pool = WorkerPool::GetInstance();
+
+    // split the top of the tree until there are enough subtrees to keep every
+    // thread busy. controls on the nodes that get split run here, first.
+    const size_t min_subtrees = (pool->NumWorkers() + 1) * 4;
+
+    std::vector<Entity*> subtrees = { this };
+    bool split = pool->NumWorkers() != 0;
+
+    while (split && subtrees.size() < min_subtrees) {
+        split = false;
+
+        std::vector<Entity*> next;
+        next.reserve(subtrees.size());
+
+        for (Entity *entity : subtrees) {
+            if (entity->m_children.empty()) {
+                next.push_back(entity);
+
+                continue;
+            }
+
+            entity->UpdateOwnControls(dt, nullptr);
+
+            for (auto &child : entity->m_children) {
+                next.push_back(child.get());
+            }
+
+            split = true;
+        }
+
+        subtrees.swap(next);
     }
-    if (m_flags & UPDATE_AABB) {
-        UpdateAABB();
-        m_flags &= ~UPDATE_AABB;
+
+    std::vector<std::vector<EntityControl*>> deferred(subtrees.size());
+
+    pool->ParallelFor(subtrees.size(), [&subtrees, &deferred, dt](size_t index) {
+        subtrees[index]->UpdateControls(dt, &deferred[index]);
+    });
+
+    // serialized phase, in scene order
+    for (auto &controls : deferred) {
+        for (EntityControl *control : controls) {
+            control->OnUpdate(dt);
+        }
     }
+}
+
+void Entity::UpdateControls(double dt, std::vector<EntityControl*> *deferred)
+{
+    UpdateOwnControls(dt, deferred);
+
+    for (auto &child : m_children) {
+        child->UpdateControls(dt, deferred);
+    }
+}
 
+void Entity::UpdateOwnControls(double dt, std::vector<EntityControl*> *deferred)
+{
     for (auto &control : m_controls) {
         control->tick += dt * 1000;
         if ((control->tick / 1000 * control->tps) >= 1) {
-            control->OnUpdate(dt);
             control->tick = 0;
+
+            if (deferred != nullptr && !control->thread_safe) {
+                deferred->push_back(control.get());
+            } else {
+                control->OnUpdate(dt);
+            }
         }
     }
+}
+
+void Entity::UpdateBounds()
+{
+    if (m_flags & UPDATE_AABB) {
+        UpdateAABB();
+        m_flags &= ~UPDATE_AABB;
+    }
 
     for (auto &child : m_children) {
-        child->Update(dt);
+        child->UpdateBounds();
     }
 }
 
 void Entity::SetTransformUpdateFlag()
 {
-    m_flags |= UPDATE_TRANSFORM;
-    for (auto &child : m_children) {
-        child->SetTransformUpdateFlag();
-    }
+    // children are picked up by the transform system's update pass
+    TransformSystem::GetInstance()->MarkDirty(m_transform_handle);
+    Invalidate();
+    MarkTransformChanged();
 }
 
 void Entity::SetAABBUpdateFlag()
 {
     m_flags |= UPDATE_AABB;
+    Invalidate();
+
     for (auto &child : m_children) {
         child->SetAABBUpdateFlag();
     }
@@ -218,11 +307,41 @@ void Entity::SetAABBUpdateFlag()
 void Entity::SetPendingRemovalFlag()
 {
     m_flags |= PENDING_REMOVAL;
+    Invalidate();
+
     for (auto &child : m_children) {
         child->SetPendingRemovalFlag();
     }
 }
 
+uint32_t Entity::AdvanceChangeEpoch()
+{
+    return change_epoch.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Entity::MarkTransformChanged()
+{
+    m_transform_change_epoch.store(change_epoch.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    MarkSubtreeChanged();
+}
+
+void Entity::MarkSubtreeChanged()
+{
+    const uint32_t epoch = change_epoch.load(std::memory_order_relaxed);
+
+    for (Entity *entity = this; entity != nullptr; entity = entity->m_parent) {
+        // whoever stamped it first carries on up the tree
+        if (entity->m_subtree_change_epoch.exchange(epoch, std::memory_order_relaxed) == epoch) {
+            break;
+        }
+    }
+}
+
+void Entity::SetCustomTransformUpdate(bool custom_update)
+{
+    TransformSystem::GetInstance()->SetCustomUpdate(m_transform_handle, custom_update);
+}
+
 std::shared_ptr<Loadable> Entity::Clone()
 {
     return CloneImpl();
@@ -239,9 +358,9 @@ std::shared_ptr<Entity> Entity::CloneImpl()
     // reference copy
     new_entity->m_renderable = m_renderable;
 
-    new_entity->m_local_translation = m_local_translation;
-    new_entity->m_local_scale = m_local_scale;
-    new_entity->m_local_rotation = m_local_rotation;
+    new_entity->SetLocalTranslation(GetLocalTranslation());
+    new_entity->SetLocalScale(GetLocalScale());
+    new_entity->SetLocalRotation(GetLocalRotation());
 
     // clone all child entities
     for (auto &child : m_children) {
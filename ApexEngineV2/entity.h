@@ -5,6 +5,8 @@
 #include <vector>
 #include <deque>
 #include <memory>
+#include <atomic>
+#include <cstdint>
 
 #include "control.h"
 #include "hash_code.h"
@@ -12,18 +14,23 @@
 #include "math/transform.h"
 #include "rendering/renderable.h"
 #include "rendering/material.h"
+#include "transform_system.h"
+
+// update independent subtrees on the worker pool. controls that are not
+// thread safe are deferred and run on the calling thread afterwards.
+#define ENTITY_PARALLEL_UPDATE 1
 
 namespace apex {
 class Camera;
 class Entity : public Loadable {
 public:
     enum UpdateFlags {
-        UPDATE_TRANSFORM = 0x01,
         UPDATE_AABB = 0x02,
         PENDING_REMOVAL = 0x04
     };
 
     Entity(const std::string &name = "entity");
+    Entity(const Entity &other) = delete;
     virtual ~Entity();
 
     inline const std::string &GetName() const { return m_name; }
@@ -32,44 +39,48 @@ public:
     inline bool GetAABBAffectsParent() const { return m_aabb_affects_parent; }
     inline void SetAABBAffectsParent(bool value) { m_aabb_affects_parent = value; }
 
-    inline const Vector3 &GetLocalTranslation() const { return m_local_translation; }
+    inline const Vector3 &GetLocalTranslation() const
+        { return TransformSystem::GetInstance()->GetLocalTranslation(m_transform_handle); }
     inline void SetLocalTranslation(const Vector3 &translation) 
     { 
-        m_local_translation = translation;
+        TransformSystem::GetInstance()->SetLocalTranslation(m_transform_handle, translation);
         SetTransformUpdateFlag();
         SetAABBUpdateFlag();
     }
 
-    inline const Vector3 &GetGlobalTranslation() const { return m_global_transform.GetTranslation(); }
+    inline const Vector3 &GetGlobalTranslation() const { return GetGlobalTransform().GetTranslation(); }
     void SetGlobalTranslation(const Vector3 &translation);
 
-    inline const Quaternion &GetLocalRotation() const { return m_local_rotation; }
+    inline const Quaternion &GetLocalRotation() const
+        { return TransformSystem::GetInstance()->GetLocalRotation(m_transform_handle); }
     inline void SetLocalRotation(const Quaternion &rotation) 
     { 
-        m_local_rotation = rotation;
+        TransformSystem::GetInstance()->SetLocalRotation(m_transform_handle, rotation);
         SetTransformUpdateFlag();
         SetAABBUpdateFlag();
     }
 
-    inline const Quaternion &GetGlobalRotation() const { return m_global_transform.GetRotation(); }
+    inline const Quaternion &GetGlobalRotation() const { return GetGlobalTransform().GetRotation(); }
     void SetGlobalRotation(const Quaternion &rotation);
 
-    inline const Vector3 &GetLocalScale() const { return m_local_scale; }
+    inline const Vector3 &GetLocalScale() const
+        { return TransformSystem::GetInstance()->GetLocalScale(m_transform_handle); }
     inline void SetLocalScale(const Vector3 &scale) 
     { 
-        m_local_scale = scale;
+        TransformSystem::GetInstance()->SetLocalScale(m_transform_handle, scale);
         SetTransformUpdateFlag();
         SetAABBUpdateFlag();
     }
 
-    inline const Vector3 &GetGlobalScale() const { return m_global_transform.GetScale(); }
+    inline const Vector3 &GetGlobalScale() const { return GetGlobalTransform().GetScale(); }
     void SetGlobalScale(const Vector3 &scale);
 
-    inline const Transform &GetGlobalTransform() const { return m_global_transform; }
+    inline const Transform &GetGlobalTransform() const
+        { return TransformSystem::GetInstance()->GetGlobalTransform(m_transform_handle); }
 
-    inline void Move(const Vector3 &vec) { SetLocalTranslation(m_local_translation + vec); }
-    inline void Scale(const Vector3 &vec) { SetLocalScale(m_local_scale * vec); }
-    inline void Rotate(const Quaternion &rot) { SetLocalRotation(m_local_rotation * rot); }
+    inline void Move(const Vector3 &vec) { SetLocalTranslation(GetLocalTranslation() + vec); }
+    inline void Scale(const Vector3 &vec) { SetLocalScale(GetLocalScale() * vec); }
+    inline void Rotate(const Quaternion &rot) { SetLocalRotation(GetLocalRotation() * rot); }
 
     virtual void UpdateTransform();
     virtual void UpdateAABB();
@@ -80,9 +91,10 @@ public:
 
     inline Entity *GetParent() const { return m_parent; }
 
-    inline Material &GetMaterial() { return m_material; }
+    // non-const access may modify the material, so it counts as a change
+    inline Material &GetMaterial() { Invalidate(); return m_material; }
     inline const Material &GetMaterial() const { return m_material; }
-    inline void SetMaterial(const Material &material) { m_material = material; }
+    inline void SetMaterial(const Material &material) { m_material = material; Invalidate(); }
 
     void AddChild(std::shared_ptr<Entity> entity);
     void RemoveChild(const std::shared_ptr<Entity> &entity);
@@ -131,10 +143,24 @@ public:
     }
 
     inline std::shared_ptr<Renderable> GetRenderable() const { return m_renderable; }
-    inline void SetRenderable(const std::shared_ptr<Renderable> &renderable) { m_renderable = renderable; }
+    inline void SetRenderable(const std::shared_ptr<Renderable> &renderable) { m_renderable = renderable; Invalidate(); }
 
     inline bool PendingRemoval() const { return m_flags & PENDING_REMOVAL; }
 
+    /** incremented whenever anything that affects how this entity is rendered changes
+        (transform, aabb, material, renderable, parent). Cheap alternative to GetHashCode(). */
+    inline size_t GetRevision() const
+        { return m_revision + TransformSystem::GetInstance()->GetRevision(m_transform_handle); }
+
+    /** the change epoch in which this entity, or any entity beneath it, was last invalidated.
+        Lets a walk of the scene skip subtrees unchanged since it last ran. */
+    inline uint32_t GetSubtreeChangeEpoch() const { return m_subtree_change_epoch.load(std::memory_order_relaxed); }
+    /** the change epoch in which the transform of this entity was last set. The transforms
+        beneath it change too, without being stamped themselves. */
+    inline uint32_t GetTransformChangeEpoch() const { return m_transform_change_epoch.load(std::memory_order_relaxed); }
+    // starts a new change epoch and returns the one that ended
+    static uint32_t AdvanceChangeEpoch();
+
     virtual void Update(double dt);
 
     virtual std::shared_ptr<Loadable> Clone();
@@ -146,7 +172,7 @@ public:
         hc.Add(m_name);
         hc.Add(m_flags);
         hc.Add(m_material.GetHashCode());
-        hc.Add(m_global_transform.GetHashCode());
+        hc.Add(GetGlobalTransform().GetHashCode());
         hc.Add(intptr_t(m_renderable.get())); // TODO: maybe make this calc hash code
 
         for (const auto &child : m_children) {
@@ -168,20 +194,37 @@ protected:
     std::vector<std::shared_ptr<EntityControl>> m_controls;
 
     int m_flags;
+    size_t m_revision;
     bool m_aabb_affects_parent;
-    Vector3 m_local_translation;
-    Vector3 m_local_scale;
-    Quaternion m_local_rotation;
-    Transform m_global_transform;
+    TransformSystem::Handle_t m_transform_handle;
     BoundingBox m_aabb;
     Entity *m_parent;
     Material m_material;
 
+    inline void Invalidate() { ++m_revision; MarkSubtreeChanged(); }
+
     void SetTransformUpdateFlag();
     void SetAABBUpdateFlag();
     void SetPendingRemovalFlag();
+    // have the transform system call UpdateTransform() rather than calculating this entity itself
+    void SetCustomTransformUpdate(bool custom_update);
 
     std::shared_ptr<Entity> CloneImpl();
+
+private:
+    static std::atomic<uint32_t> change_epoch;
+
+    std::atomic<uint32_t> m_subtree_change_epoch;
+    std::atomic<uint32_t> m_transform_change_epoch;
+
+    void MarkTransformChanged();
+    // stamps this entity and its ancestors, stopping at one already stamped this epoch
+    void MarkSubtreeChanged();
+    void UpdateControlsParallel(double dt);
+    // when deferred is not null, controls that are not thread safe are appended to it instead of being run
+    void UpdateControls(double dt, std::vector<EntityControl*> *deferred);
+    void UpdateOwnControls(double dt, std::vector<EntityControl*> *deferred);
+    void UpdateBounds();
 };
 } // namespace apex
 
@@ -1,4 +1,5 @@
 #include "game.h"
+#include "profiler.h"
 
 namespace apex {
 
@@ -18,6 +19,8 @@ Game::~Game()
 
 void Game::Update(double dt)
 {
+    APEX_PROFILE_SCOPE("Game::Update");
+
     m_ui_manager->Update(dt);
 
     Logic(dt);
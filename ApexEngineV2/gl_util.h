@@ -2,6 +2,7 @@
 #define GL_UTIL_H
 
 #include "./opengl.h"
+#include "./core_engine.h"
 
 #include <iostream>
 
@@ -12,7 +13,7 @@ namespace apex {
             error = GL_NO_ERROR,
             counter = 0;
 
-        while ((error = glGetError()) != GL_NO_ERROR) {
+        while ((error = CoreEngine::GetInstance()->GetError()) != GL_NO_ERROR) {
             errors[counter++] = error;
 
             if (!recursive) {
@@ -2,6 +2,7 @@
 #include "game.h"
 #include "input_manager.h"
 #include "util.h"
+#include "profiler.h"
 #include "math/math_util.h"
 
 #include <iostream>
@@ -90,6 +91,7 @@ bool GlfwEngine::InitializeGame(Game *game)
     glEnable(GL_DEPTH_TEST);
     glCullFace(GL_BACK);
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    m_render_state.Invalidate();
 
 
     if (!glfwWindowShouldClose(window)) {
@@ -133,6 +135,9 @@ bool GlfwEngine::InitializeGame(Game *game)
         double delta = current - last;
 #endif
 
+        APEX_PROFILE_BEGIN_FRAME();
+        m_render_state.NextFrame();
+
         num_frames++;
 
         if ((current - fps_last) >= 1.0) {
@@ -176,6 +181,8 @@ bool GlfwEngine::InitializeGame(Game *game)
         game->Update(delta);
         game->Render();
 
+        APEX_PROFILE_END_FRAME();
+
         glfwSwapBuffers(window);
         glfwPollEvents();
 
@@ -198,7 +205,9 @@ void GlfwEngine::SetCursorLocked(bool locked)
 
 void GlfwEngine::Viewport(int x, int y, size_t width, size_t height)
 {
-    glViewport(x, y, width, height);
+    if (m_render_state.SetViewport(x, y, width, height)) {
+        glViewport(x, y, width, height);
+    }
 }
 
 void GlfwEngine::Clear(int mask)
@@ -215,22 +224,42 @@ void GlfwEngine::SetMousePosition(double x, double y)
 
 void GlfwEngine::Enable(int cap)
 {
-    glEnable(cap);
+    if (m_render_state.SetCapability(cap, true)) {
+        glEnable(cap);
+    }
 }
 
 void GlfwEngine::Disable(int cap)
 {
-    glDisable(cap);
+    if (m_render_state.SetCapability(cap, false)) {
+        glDisable(cap);
+    }
 }
 
 void GlfwEngine::DepthMask(bool mask)
 {
-    glDepthMask(mask);
+    if (m_render_state.SetDepthMask(mask)) {
+        glDepthMask(mask);
+    }
 }
 
 void GlfwEngine::BlendFunc(int src, int dst)
 {
-    glBlendFunc(src, dst);
+    if (m_render_state.SetBlendFunc(src, dst)) {
+        glBlendFunc(src, dst);
+    }
+}
+
+void GlfwEngine::CullFace(int mode)
+{
+    if (m_render_state.SetCullFace(mode)) {
+        glCullFace(mode);
+    }
+}
+
+unsigned int GlfwEngine::GetError()
+{
+    return glGetError();
 }
 
 void GlfwEngine::GenBuffers(size_t count, unsigned int *buffers)
@@ -241,11 +270,14 @@ void GlfwEngine::GenBuffers(size_t count, unsigned int *buffers)
 void GlfwEngine::DeleteBuffers(size_t count, unsigned int *buffers)
 {
     glDeleteBuffers(count, buffers);
+    m_render_state.OnDeleteBuffers(count, buffers);
 }
 
 void GlfwEngine::BindBuffer(int target, unsigned int buffer)
 {
-    glBindBuffer(target, buffer);
+    if (m_render_state.SetBuffer(target, buffer)) {
+        glBindBuffer(target, buffer);
+    }
 }
 
 void GlfwEngine::BufferData(int target, size_t size, const void *data, int usage)
@@ -258,9 +290,50 @@ void GlfwEngine::BufferSubData(int target, size_t offset, size_t size, const voi
     glBufferSubData(target, offset, size, data);
 }
 
+bool GlfwEngine::SupportsBufferStorage()
+{
+#ifdef USE_GLEW
+    return GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+#else
+    return false;
+#endif
+}
+
+void GlfwEngine::BufferStorage(int target, size_t size, const void *data, unsigned int flags)
+{
+    glBufferStorage(target, size, data, flags);
+}
+
+void *GlfwEngine::MapBufferRange(int target, size_t offset, size_t size, unsigned int access)
+{
+    return glMapBufferRange(target, offset, size, access);
+}
+
+bool GlfwEngine::UnmapBuffer(int target)
+{
+    return glUnmapBuffer(target) == GL_TRUE;
+}
+
+void *GlfwEngine::FenceSync()
+{
+    return glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+unsigned int GlfwEngine::ClientWaitSync(void *sync, bool flush, uint64_t timeout_ns)
+{
+    return glClientWaitSync(GLsync(sync), flush ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, timeout_ns);
+}
+
+void GlfwEngine::DeleteSync(void *sync)
+{
+    glDeleteSync(GLsync(sync));
+}
+
 void GlfwEngine::BindVertexArray(unsigned int target)
 {
-    glBindVertexArray(target);
+    if (m_render_state.SetVertexArray(target)) {
+        glBindVertexArray(target);
+    }
 }
 
 void GlfwEngine::GenVertexArrays(size_t size, unsigned int *arrays)
@@ -268,6 +341,12 @@ void GlfwEngine::GenVertexArrays(size_t size, unsigned int *arrays)
     glGenVertexArrays(size, arrays);
 }
 
+void GlfwEngine::DeleteVertexArrays(size_t size, const unsigned int *arrays)
+{
+    glDeleteVertexArrays(size, arrays);
+    m_render_state.OnDeleteVertexArrays(size, arrays);
+}
+
 void GlfwEngine::EnableVertexAttribArray(unsigned int index)
 {
     glEnableVertexAttribArray(index);
@@ -288,6 +367,11 @@ void GlfwEngine::DrawElements(int mode, size_t count, int type, const void *indi
     glDrawElements(mode, count, type, indices);
 }
 
+void GlfwEngine::MultiDrawElements(int mode, const int *counts, int type, const void *const *indices, size_t drawcount)
+{
+    glMultiDrawElements(mode, counts, type, indices, drawcount);
+}
+
 void GlfwEngine::GenTextures(size_t n, unsigned int *textures)
 {
     glGenTextures(n, textures);
@@ -296,6 +380,7 @@ void GlfwEngine::GenTextures(size_t n, unsigned int *textures)
 void GlfwEngine::DeleteTextures(size_t n, const unsigned int *textures)
 {
     glDeleteTextures(n, textures);
+    m_render_state.OnDeleteTextures(n, textures);
 }
 
 void GlfwEngine::TexParameteri(int target, int pname, int param)
@@ -314,14 +399,41 @@ void GlfwEngine::TexImage2D(int target, int level, int ifmt, size_t width, size_
     glTexImage2D(target, level, ifmt, width, height, border, fmt, type, data);
 }
 
+void GlfwEngine::CopyTexImage2D(int target, int level, int ifmt, int x, int y,
+    size_t width, size_t height, int border)
+{
+    glCopyTexImage2D(target, level, ifmt, x, y, width, height, border);
+}
+
+void GlfwEngine::TexImage3D(int target, int level, int ifmt, size_t width, size_t height, size_t depth,
+    int border, int fmt, int type, const void *data)
+{
+    glTexImage3D(target, level, ifmt, width, height, depth, border, fmt, type, data);
+}
+
+void GlfwEngine::TexSubImage3D(int target, int level, int x, int y, int z, size_t width, size_t height, size_t depth,
+    int fmt, int type, const void *data)
+{
+    glTexSubImage3D(target, level, x, y, z, width, height, depth, fmt, type, data);
+}
+
+void GlfwEngine::GetTexImage(int target, int level, int fmt, int type, void *pixels)
+{
+    glGetTexImage(target, level, fmt, type, pixels);
+}
+
 void GlfwEngine::BindTexture(int target, unsigned int texture)
 {
-    glBindTexture(target, texture);
+    if (m_render_state.SetTexture(target, texture)) {
+        glBindTexture(target, texture);
+    }
 }
 
 void GlfwEngine::ActiveTexture(int i)
 {
-    glActiveTexture(i);
+    if (m_render_state.SetActiveTexture(i)) {
+        glActiveTexture(i);
+    }
 }
 
 void GlfwEngine::GenerateMipmap(int target)
@@ -344,7 +456,12 @@ void GlfwEngine::BindFramebuffer(int target, unsigned int framebuffer)
     glBindFramebuffer(target, framebuffer);
 }
 
-void GlfwEngine::FramebufferTexture(int target, int attachment, unsigned int texture_target, unsigned int texture, int level)
+void GlfwEngine::FramebufferTexture(int target, int attachment, unsigned int texture, int level)
+{
+    glFramebufferTexture(target, attachment, texture, level);
+}
+
+void GlfwEngine::FramebufferTexture2D(int target, int attachment, int texture_target, unsigned int texture, int level)
 {
     glFramebufferTexture2D(target, attachment, texture_target, texture, level);
 }
@@ -354,6 +471,11 @@ void GlfwEngine::DrawBuffers(size_t n, const unsigned int *bufs)
     glDrawBuffers(n, bufs);
 }
 
+void GlfwEngine::ReadBuffer(int mode)
+{
+    glReadBuffer(mode);
+}
+
 unsigned int GlfwEngine::CheckFramebufferStatus(int target)
 {
     return glCheckFramebufferStatus(target);
@@ -399,6 +521,11 @@ void GlfwEngine::BindAttribLocation(unsigned int program, unsigned int index, co
     glBindAttribLocation(program, index, name);
 }
 
+void GlfwEngine::BindFragDataLocation(unsigned int program, unsigned int color, const char *name)
+{
+    glBindFragDataLocation(program, color, name);
+}
+
 void GlfwEngine::LinkProgram(unsigned int program)
 {
     glLinkProgram(program);
@@ -419,9 +546,37 @@ void GlfwEngine::GetProgramInfoLog(unsigned int program, int max, int *len, char
     glGetProgramInfoLog(program, max, len, log);
 }
 
+void GlfwEngine::ProgramParameteri(unsigned int program, int pname, int value)
+{
+    glProgramParameteri(program, pname, value);
+}
+
+void GlfwEngine::GetProgramBinary(unsigned int program, size_t max, size_t *len, unsigned int *format, void *binary)
+{
+    GLsizei length = 0;
+    glGetProgramBinary(program, GLsizei(max), &length, format, binary);
+
+    if (len != nullptr) {
+        *len = size_t(length);
+    }
+}
+
+void GlfwEngine::ProgramBinary(unsigned int program, unsigned int format, const void *binary, size_t len)
+{
+    glProgramBinary(program, format, binary, GLsizei(len));
+}
+
+const char *GlfwEngine::GetString(int name)
+{
+    const GLubyte *str = glGetString(name);
+
+    return str != nullptr ? reinterpret_cast<const char*>(str) : "";
+}
+
 void GlfwEngine::DeleteProgram(unsigned int program)
 {
     glDeleteProgram(program);
+    m_render_state.OnDeleteProgram(program);
 }
 
 void GlfwEngine::DeleteShader(unsigned int shader)
@@ -431,7 +586,9 @@ void GlfwEngine::DeleteShader(unsigned int shader)
 
 void GlfwEngine::UseProgram(unsigned int program)
 {
-    glUseProgram(program);
+    if (m_render_state.SetProgram(program)) {
+        glUseProgram(program);
+    }
 }
 
 int GlfwEngine::GetUniformLocation(unsigned int program, const char *name)
@@ -439,6 +596,22 @@ int GlfwEngine::GetUniformLocation(unsigned int program, const char *name)
     return glGetUniformLocation(program, name);
 }
 
+unsigned int GlfwEngine::GetUniformBlockIndex(unsigned int program, const char *name)
+{
+    return glGetUniformBlockIndex(program, name);
+}
+
+void GlfwEngine::UniformBlockBinding(unsigned int program, unsigned int index, unsigned int binding)
+{
+    glUniformBlockBinding(program, index, binding);
+}
+
+void GlfwEngine::BindBufferBase(int target, unsigned int index, unsigned int buffer)
+{
+    glBindBufferBase(target, index, buffer);
+    m_render_state.OnBindBufferBase(target, buffer);
+}
+
 void GlfwEngine::Uniform1f(int location, float v0)
 {
     glUniform1f(location, v0);
@@ -494,6 +667,11 @@ void GlfwEngine::DrawArraysInstanced(int mode, int first, size_t count, size_t p
     glDrawArraysInstanced(mode, first, count, primcount);
 }
 
+void GlfwEngine::DrawElementsInstanced(int mode, size_t count, int type, const void *indices, size_t primcount)
+{
+    glDrawElementsInstanced(mode, count, type, indices, primcount);
+}
+
 void GlfwEngine::BindImageTexture(unsigned int unit, unsigned int texture, int level, bool layered, int layer, unsigned int access, unsigned int format)
 {
     glBindImageTexture(unit, texture, level, layered, layer, access, format);
@@ -17,31 +17,51 @@ public:
     void Disable(int cap);
     void DepthMask(bool mask);
     void BlendFunc(int src, int dst);
+    void CullFace(int mode);
+    unsigned int GetError();
     void GenBuffers(size_t count, unsigned int *buffers);
     void DeleteBuffers(size_t count, unsigned int *buffers);
     void BindBuffer(int target, unsigned int buffer);
     void BufferData(int target, size_t size, const void *data, int usage);
     void BufferSubData(int target, size_t offset, size_t size, const void *data);
+    bool SupportsBufferStorage();
+    void BufferStorage(int target, size_t size, const void *data, unsigned int flags);
+    void *MapBufferRange(int target, size_t offset, size_t size, unsigned int access);
+    bool UnmapBuffer(int target);
+    void *FenceSync();
+    unsigned int ClientWaitSync(void *sync, bool flush, uint64_t timeout_ns);
+    void DeleteSync(void *sync);
     void BindVertexArray(unsigned int target);
     void GenVertexArrays(size_t size, unsigned int *arrays);
+    void DeleteVertexArrays(size_t size, const unsigned int *arrays);
     void EnableVertexAttribArray(unsigned int index);
     void DisableVertexAttribArray(unsigned int index);
     void VertexAttribPointer(unsigned int index, int size, int type, bool normalized, size_t stride, void *ptr);
     void DrawElements(int mode, size_t count, int type, const void *indices);
+    void MultiDrawElements(int mode, const int *counts, int type, const void *const *indices, size_t drawcount);
     void GenTextures(size_t n, unsigned int *textures);
     void DeleteTextures(size_t n, const unsigned int *textures);
     void TexParameteri(int target, int pname, int param);
     void TexParameterf(int target, int pname, float param);
     void TexImage2D(int target, int level, int ifmt, size_t width, size_t height,
         int border, int fmt, int type, const void *data);
+    void CopyTexImage2D(int target, int level, int ifmt, int x, int y,
+        size_t width, size_t height, int border);
+    void TexImage3D(int target, int level, int ifmt, size_t width, size_t height, size_t depth,
+        int border, int fmt, int type, const void *data);
+    void TexSubImage3D(int target, int level, int x, int y, int z, size_t width, size_t height, size_t depth,
+        int fmt, int type, const void *data);
+    void GetTexImage(int target, int level, int fmt, int type, void *pixels);
     void BindTexture(int target, unsigned int texture);
     void ActiveTexture(int i);
     void GenerateMipmap(int target);
     void GenFramebuffers(size_t n, unsigned int *ids);
     void DeleteFramebuffers(size_t n, const unsigned int *ids);
     void BindFramebuffer(int target, unsigned int framebuffer);
-    void FramebufferTexture(int target, int attachment, unsigned int texture, unsigned int texture_target, int level);
+    void FramebufferTexture(int target, int attachment, unsigned int texture, int level);
+    void FramebufferTexture2D(int target, int attachment, int texture_target, unsigned int texture, int level);
     void DrawBuffers(size_t n, const unsigned int *bufs);
+    void ReadBuffer(int mode);
     unsigned int CheckFramebufferStatus(int target);
     unsigned int CreateProgram();
     unsigned int CreateShader(int type);
@@ -51,14 +71,22 @@ public:
     void GetShaderiv(unsigned int shader, int pname, int *params);
     void GetShaderInfoLog(unsigned int shader, int max, int *len, char *info);
     void BindAttribLocation(unsigned int program, unsigned int index, const char *name);
+    void BindFragDataLocation(unsigned int program, unsigned int color, const char *name);
     void LinkProgram(unsigned int program);
     void ValidateProgram(unsigned int program);
     void GetProgramiv(unsigned int program, int pname, int *params);
     void GetProgramInfoLog(unsigned int program, int max, int *len, char *log);
+    void ProgramParameteri(unsigned int program, int pname, int value);
+    void GetProgramBinary(unsigned int program, size_t max, size_t *len, unsigned int *format, void *binary);
+    void ProgramBinary(unsigned int program, unsigned int format, const void *binary, size_t len);
+    const char *GetString(int name);
     void DeleteProgram(unsigned int program);
     void DeleteShader(unsigned int shader);
     void UseProgram(unsigned int program);
     int GetUniformLocation(unsigned int program, const char *name);
+    unsigned int GetUniformBlockIndex(unsigned int program, const char *name);
+    void UniformBlockBinding(unsigned int program, unsigned int index, unsigned int binding);
+    void BindBufferBase(int target, unsigned int index, unsigned int buffer);
     void Uniform1f(int location, float v0);
     void Uniform2f(int location, float v0, float v1);
     void Uniform3f(int location, float v0, float v1, float v2);
@@ -70,6 +98,7 @@ public:
     void UniformMatrix4fv(int location, int count, bool transpose, const float *value);
     void VertexAttribDivisor(unsigned int index, unsigned int divisor);
     void DrawArraysInstanced(int mode, int first, size_t count, size_t primcount);
+    void DrawElementsInstanced(int mode, size_t count, int type, const void *indices, size_t primcount);
     void BindImageTexture(unsigned int unit, unsigned int texture, int level, bool layered, int layer, unsigned int access, unsigned int format);
 
 private:
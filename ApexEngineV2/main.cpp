@@ -1,4 +1,6 @@
 #include "glfw_engine.h"
+#include "recording_engine.h"
+#include "profiler.h"
 #include "gl_util.h"
 #include "game.h"
 #include "entity.h"
@@ -6,6 +8,7 @@
 #include "asset/asset_manager.h"
 #include "asset/text_loader.h"
 #include "rendering/mesh.h"
+#include "rendering/meshlet.h"
 #include "rendering/shader.h"
 #include "rendering/environment.h"
 #include "rendering/camera/ortho_camera.h"
@@ -18,6 +21,8 @@
 #include "rendering/shaders/fur_shader.h"
 #include "rendering/shaders/post_shader.h"
 #include "rendering/shader_manager.h"
+#include "rendering/shader_cache.h"
+#include "rendering/shader_warmup.h"
 #include "rendering/shadow/shadow_mapping.h"
 #include "rendering/shadow/pssm_shadow_mapping.h"
 #include "util/shader_preprocessor.h"
@@ -72,7 +77,11 @@
 /* Standard library */
 #include <cstdlib>
 #include <ctime>
+#include <chrono>
+#include <filesystem>
+#include <functional>
 #include <iostream>
+#include <set>
 #include <string>
 #include <math.h>
 
@@ -84,7 +93,7 @@ public:
     Framebuffer *fbo, *env_fbo;
     PssmShadowMapping *shadows;
 
-    std::vector<std::shared_ptr<Entity>> m_raytested_entities;
+    std::vector<Entity*> m_raytested_entities;
 
     std::shared_ptr<Entity> top;
     std::shared_ptr<Entity> test_object_0, test_object_1, test_object_2;
@@ -231,6 +240,47 @@ public:
         PhysicsManager::GetInstance()->RegisterBody(rb3);*/
     }
 
+    // the raytest picks triangles, so meshes keep their positions after upload
+    void KeepPositionsForPicking(Entity *entity)
+    {
+        if (auto mesh = std::dynamic_pointer_cast<Mesh>(entity->GetRenderable())) {
+            mesh->SetResidency(std::max(mesh->GetResidency(), Mesh::RESIDENCY_POSITIONS));
+        }
+
+        for (size_t i = 0; i < entity->NumChildren(); i++) {
+            KeepPositionsForPicking(entity->GetChild(i).get());
+        }
+    }
+
+    // sums each mesh in the scene once, along with its levels of detail
+    void AddMeshMemoryUsage(Entity *entity, std::set<const Mesh*> &counted, Mesh::MemoryUsage &memory) const
+    {
+        if (auto renderable = entity->GetRenderable()) {
+            for (size_t level = 0; level <= renderable->NumLods(); level++) {
+                auto *mesh = dynamic_cast<const Mesh*>(renderable->GetLod(level));
+
+                if (mesh != nullptr && counted.insert(mesh).second) {
+                    const Mesh::MemoryUsage mesh_memory = mesh->GetMemoryUsage();
+                    memory.cpu_bytes += mesh_memory.cpu_bytes;
+                    memory.gpu_bytes += mesh_memory.gpu_bytes;
+                }
+            }
+        }
+
+        for (size_t i = 0; i < entity->NumChildren(); i++) {
+            AddMeshMemoryUsage(entity->GetChild(i).get(), counted, memory);
+        }
+    }
+
+    Mesh::MemoryUsage GetMeshMemoryUsage() const
+    {
+        std::set<const Mesh*> counted;
+        Mesh::MemoryUsage memory = { 0, 0 };
+        AddMeshMemoryUsage(top.get(), counted, memory);
+
+        return memory;
+    }
+
     void Initialize()
     {
         ShaderManager::GetInstance()->SetBaseShaderProperties(ShaderProperties()
@@ -373,45 +423,23 @@ public:
                 ray.m_position = cam->GetTranslation();
 
 
-                using Intersection_t = std::pair<std::shared_ptr<Entity>, RaytestHit>;
+                // candidates come from the renderer's spatial index, which uses padded bounds
+                std::vector<Entity*> candidates;
+                m_renderer->QueryRay(ray, candidates);
 
                 RaytestHit intersection;
-                std::vector<Intersection_t> intersections = { { top, intersection } };
-
-                while (true) {
-                    std::vector<Intersection_t> new_intersections;
-
-                    for (auto &it : intersections) {
-                        for (size_t i = 0; i < it.first->NumChildren(); i++) {
-                            const auto &child = it.first->GetChild(i);
-
-                            BoundingBox aabb = child->GetAABB();
-
-                            if (aabb.IntersectRay(ray, intersection)) {
-                                new_intersections.push_back({ child, intersection });
-                            }
-                        }
-                    }
+                RaytestHitList_t mesh_intersections;
 
-                    if (new_intersections.empty()) {
-                        break;
+                for (Entity *entity : candidates) {
+                    if (!entity->GetAABB().IntersectRay(ray, intersection)) {
+                        continue;
                     }
 
-                    intersections = new_intersections;
-                }
-
-                if (intersections.empty()) {
-                    return;
-                }
-    
-                RaytestHitList_t mesh_intersections;
-
-                for (Intersection_t &it : intersections) {
-                    // it.first->AddControl(std::make_shared<BoundingBoxControl>());
-                    m_raytested_entities.push_back(it.first);
+                    // entity->AddControl(std::make_shared<BoundingBoxControl>());
+                    m_raytested_entities.push_back(entity);
 
-                    if (auto renderable = it.first->GetRenderable()) {
-                        renderable->IntersectRay(ray, it.first->GetGlobalTransform(), mesh_intersections);
+                    if (auto renderable = entity->GetRenderable()) {
+                        renderable->IntersectRay(ray, entity->GetGlobalTransform(), mesh_intersections);
                     }
                 }
 
@@ -817,6 +845,12 @@ public:
         top->AddControl(std::make_shared<SkydomeControl>(cam));
         // top->AddControl(std::make_shared<SkyboxControl>(cam, cubemap));
         top->AddControl(std::make_shared<NoiseTerrainControl>(cam, 223));
+
+        // before the first upload, which is when the vertex data is released
+        KeepPositionsForPicking(top.get());
+
+        // link the variants recorded in earlier runs now, rather than on their first draw
+        ShaderWarmup::GetInstance()->CompileVariants();
     }
 
     void Logic(double dt)
@@ -904,15 +938,362 @@ public:
     }
 };
 
-int main()
+// loads a model and looks around from the center of its bounds, comparing the
+// triangles submitted when each mesh is only culled by its aabb with those left
+// once its meshlets are culled against the frustum and their normal cones
+static void RunMeshletBenchmark(const std::string &path, size_t num_views)
+{
+    auto model = AssetManager::GetInstance()->LoadFromFile<Entity>(path);
+
+    if (model == nullptr) {
+        std::cout << "could not load " << path << "\n";
+        return;
+    }
+
+    model->Update(0.0);
+
+    std::vector<const Entity*> entities;
+    std::function<void(Entity*)> find_meshes = [&](Entity *entity) {
+        if (std::dynamic_pointer_cast<Mesh>(entity->GetRenderable()) != nullptr) {
+            entities.push_back(entity);
+        }
+
+        for (size_t i = 0; i < entity->NumChildren(); i++) {
+            find_meshes(entity->GetChild(i).get());
+        }
+    };
+
+    find_meshes(model.get());
+
+    const BoundingBox &bounds = model->GetAABB();
+    PerspectiveCamera cam(60.0f, 1480, 1200, 0.05f, std::max((bounds.GetMax() - bounds.GetMin()).Length(), 1.0f));
+    cam.SetTranslation(bounds.GetCenter());
+
+    size_t total_triangles = 0, aabb_triangles = 0, meshlet_triangles = 0, num_ranges = 0;
+    MeshletCuller::Stats stats;
+    std::vector<IndexRange> ranges;
+    double cull_ms = 0.0;
+
+    for (const Entity *entity : entities) {
+        total_triangles += std::static_pointer_cast<Mesh>(entity->GetRenderable())->NumIndices() / 3;
+    }
+
+    for (size_t view = 0; view < num_views; view++) {
+        const float angle = float(view) / float(num_views) * float(MathUtil::PI) * 2.0f;
+
+        cam.SetDirection(Vector3(std::cos(angle), 0.0f, std::sin(angle)));
+        cam.Update(0.0);
+
+        const auto start = std::chrono::high_resolution_clock::now();
+        const MeshletCuller::View meshlet_view(&cam);
+
+        for (const Entity *entity : entities) {
+            const Mesh *mesh = static_cast<const Mesh*>(entity->GetRenderable().get());
+
+            if (!cam.GetFrustum().BoundingBoxInFrustum(entity->GetAABB())) {
+                continue;
+            }
+
+            aabb_triangles += mesh->NumIndices() / 3;
+
+            if (mesh->GetMeshlets().empty()) {
+                meshlet_triangles += mesh->NumIndices() / 3;
+                continue;
+            }
+
+            ranges.clear();
+            num_ranges += MeshletCuller::Cull(meshlet_view, mesh->GetMeshlets(), entity->GetGlobalTransform(),
+                true, entity->GetMaterial().cull_faces == MaterialFace_Back, ranges, &stats);
+
+            for (const IndexRange &range : ranges) {
+                meshlet_triangles += range.count / 3;
+            }
+        }
+
+        cull_ms += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+
+    const double views = double(num_views);
+
+    std::cout << path << ": " << entities.size() << " meshes, " << total_triangles << " triangles\n";
+    std::cout << "per view, over " << num_views << " views:\n";
+    std::cout << "\ttriangles after aabb culling: " << aabb_triangles / views << "\n";
+    std::cout << "\ttriangles after meshlet culling: " << meshlet_triangles / views << "\n";
+    std::cout << "\tmeshlets drawn: " << stats.meshlets_drawn / views
+        << ", culled: " << stats.meshlets_culled / views << "\n";
+    std::cout << "\tindex ranges: " << num_ranges / views << "\n";
+    std::cout << "\tculling: " << cull_ms / views << " ms\n";
+}
+
+// builds a static scene of num_entities meshes in groups of 100, and times the
+// renderer syncing its buckets with it: the first sync, frames where nothing
+// changed and frames where one group moved. hashing the whole scene, which
+// FindRenderables used to do every frame, is timed for comparison.
+static void RunSceneBenchmark(size_t num_entities, size_t num_frames)
 {
-    CoreEngine *engine = new GlfwEngine();
+    const size_t group_size = 100;
+
+    auto mesh = MeshFactory::CreateCube();
+    auto top = std::make_shared<Entity>("top");
+    std::vector<std::shared_ptr<Entity>> groups;
+
+    for (size_t i = 0; i < num_entities; i += group_size) {
+        auto group = std::make_shared<Entity>("group");
+        group->SetLocalTranslation(Vector3(float(groups.size()) * 3.0f, 0.0f, 0.0f));
+
+        for (size_t j = i; j < std::min(i + group_size, num_entities); j++) {
+            auto entity = std::make_shared<Entity>("entity");
+            entity->SetRenderable(mesh);
+            entity->SetLocalTranslation(Vector3(0.0f, 0.0f, float(j - i) * 3.0f));
+            group->AddChild(entity);
+        }
+
+        top->AddChild(group);
+        groups.push_back(group);
+    }
+
+    top->Update(0.0);
+
+    Renderer renderer(RenderWindow(1480, 1200, "benchmark"));
+    PerspectiveCamera cam(60.0f, 1480, 1200, 0.05f, 1000.0f);
+
+    auto time_ms = [](const std::function<void()> &fn) {
+        const auto start = std::chrono::high_resolution_clock::now();
+        fn();
+
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    };
+
+    const double first_ms = time_ms([&] { renderer.Begin(&cam, top.get()); });
+
+    double static_ms = 0.0, moved_ms = 0.0, hash_ms = 0.0;
+    size_t hash = 0;
+
+    for (size_t frame = 0; frame < num_frames; frame++) {
+        top->Update(0.0);
+        static_ms += time_ms([&] { renderer.Begin(&cam, top.get()); });
+        hash_ms += time_ms([&] { hash += top->GetHashCode().Value(); });
+    }
+
+    for (size_t frame = 0; frame < num_frames; frame++) {
+        groups[frame % groups.size()]->Move(Vector3(0.0f, 0.01f, 0.0f));
+        top->Update(0.0);
+        moved_ms += time_ms([&] { renderer.Begin(&cam, top.get()); });
+    }
+
+    const double frames = double(num_frames);
+
+    std::cout << num_entities << " entities, " << groups.size() << " groups, over " << num_frames << " frames\n";
+    std::cout << "\tfirst sync: " << first_ms << " ms\n";
+    std::cout << "\tRenderer::Begin, nothing changed: " << static_ms / frames << " ms\n";
+    std::cout << "\tRenderer::Begin, one group moved: " << moved_ms / frames << " ms\n";
+    std::cout << "\thashing the scene: " << hash_ms / frames << " ms (" << (hash & 0xff) << ")\n";
+}
+
+// preprocesses every shader in res/shaders under each combination of the
+// properties the shaders branch on most. the first pass also parses each file,
+// later passes only evaluate the cached parse.
+static void RunPreprocessorBenchmark(size_t num_passes)
+{
+    const std::vector<std::string> property_names = {
+        "SHADOWS", "PROBE_ENABLED", "DEFERRED", "INSTANCING", "SKINNING", "NORMAL_MAPPING"
+    };
+
+    std::vector<std::pair<std::string, std::string>> sources;
+
+    for (const auto &entry : std::filesystem::recursive_directory_iterator("res/shaders")) {
+        // includes are only processed as part of the shaders that include them
+        if (!entry.is_regular_file() || entry.path().extension() == ".inc") {
+            continue;
+        }
+
+        const std::string path = entry.path().generic_string();
+        auto text = AssetManager::GetInstance()->LoadFromFile<TextLoader::LoadedText>(path);
+
+        if (text != nullptr) {
+            sources.push_back({ path, text->GetText() });
+        }
+    }
+
+    std::sort(sources.begin(), sources.end());
+
+    std::vector<ShaderProperties> combinations;
+
+    for (size_t bits = 0; bits < (size_t(1) << property_names.size()); bits++) {
+        ShaderProperties properties;
+
+        for (size_t i = 0; i < property_names.size(); i++) {
+            properties.Define(property_names[i], (bits & (size_t(1) << i)) != 0);
+        }
+
+        combinations.push_back(properties);
+    }
+
+    double first_ms = 0.0, warm_ms = 0.0;
+    size_t num_bytes = 0;
+
+    for (size_t pass = 0; pass < num_passes + 1; pass++) {
+        const auto start = std::chrono::high_resolution_clock::now();
+
+        for (const auto &source : sources) {
+            for (const ShaderProperties &properties : combinations) {
+                num_bytes += ShaderPreprocessor::ProcessShader(source.second, properties, source.first).size();
+            }
+        }
+
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+        if (pass == 0) {
+            first_ms = ms;
+        } else {
+            warm_ms += ms;
+        }
+    }
+
+    std::cout << sources.size() << " shaders, " << combinations.size() << " property combinations, "
+        << num_bytes / (num_passes + 1) << " bytes of output per pass\n";
+    std::cout << "\tfirst pass: " << first_ms << " ms\n";
+    std::cout << "\tlater passes, over " << num_passes << ": " << warm_ms / double(num_passes) << " ms\n";
+}
+
+int main(int argc, char *argv[])
+{
+    // --headless [frames]: run without a window, and print what would have been submitted
+    // --trace <path>: write the profiled scopes to a chrome://tracing file on exit
+    // --record-shaders: add the shaders used in this run to the warm-up manifest
+    // --meshlet-benchmark <model>: compare aabb and meshlet culling on a model, then exit
+    // --scene-benchmark [entities]: time syncing the renderer with a static scene, then exit
+    // --preprocessor-benchmark: time preprocessing every shader in res/shaders, then exit
+    RecordingEngine *recording_engine = nullptr;
+    std::string trace_path;
+    std::string meshlet_benchmark_path;
+    size_t scene_benchmark_entities = 0;
+    bool preprocessor_benchmark = false;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string arg(argv[i]);
+
+        if (arg == "--headless") {
+            size_t num_frames = 100;
+
+            if (i + 1 < argc && std::isdigit(argv[i + 1][0])) {
+                num_frames = size_t(std::atoi(argv[++i]));
+            }
+
+            recording_engine = new RecordingEngine(num_frames, 1.0 / 60.0, false);
+        } else if (arg == "--trace" && i + 1 < argc) {
+            trace_path = argv[++i];
+        } else if (arg == "--record-shaders") {
+            ShaderWarmup::GetInstance()->SetRecording(true);
+        } else if (arg == "--meshlet-benchmark" && i + 1 < argc) {
+            meshlet_benchmark_path = argv[++i];
+        } else if (arg == "--scene-benchmark") {
+            scene_benchmark_entities = 100000;
+
+            if (i + 1 < argc && std::isdigit(argv[i + 1][0])) {
+                scene_benchmark_entities = size_t(std::atoi(argv[++i]));
+            }
+        } else if (arg == "--preprocessor-benchmark") {
+            preprocessor_benchmark = true;
+        }
+    }
+
+    if (!meshlet_benchmark_path.empty()) {
+        // loading only, nothing is drawn
+        CoreEngine::SetInstance(new NullEngine());
+        RunMeshletBenchmark(meshlet_benchmark_path, 64);
+
+        return 0;
+    }
+
+    if (scene_benchmark_entities != 0) {
+        // nothing is drawn, Begin() only syncs the buckets and picks lods
+        CoreEngine::SetInstance(new NullEngine());
+        RunSceneBenchmark(scene_benchmark_entities, 100);
+
+        return 0;
+    }
+
+    if (preprocessor_benchmark) {
+        CoreEngine::SetInstance(new NullEngine());
+        RunPreprocessorBenchmark(10);
+
+        return 0;
+    }
+
+    CoreEngine *engine = recording_engine != nullptr
+        ? static_cast<CoreEngine*>(recording_engine)
+        : new GlfwEngine();
     CoreEngine::SetInstance(engine);
 
+    // preprocess the shaders of earlier runs while the game loads
+    ShaderWarmup::GetInstance()->Load();
+    ShaderWarmup::GetInstance()->PreprocessAsync();
+
     auto *game = new MyGame(RenderWindow(1480, 1200, "AEngine Demo"));
 
     engine->InitializeGame(game);
 
+    if (recording_engine != nullptr && recording_engine->NumRecordedFrames() != 0) {
+        const RecordingEngine::FrameCounts &total = recording_engine->GetTotalCounts();
+        const double num_frames = double(recording_engine->NumRecordedFrames());
+
+        std::cout << "frames: " << recording_engine->NumRecordedFrames() << "\n";
+        std::cout << "per frame:\n";
+        std::cout << "\tdraw calls: " << total.draw_calls / num_frames << "\n";
+        std::cout << "\tinstances: " << total.instances / num_frames << "\n";
+        std::cout << "\tindices: " << total.indices / num_frames << "\n";
+        std::cout << "\tprogram binds: " << total.program_binds / num_frames << "\n";
+        std::cout << "\ttexture binds: " << total.texture_binds / num_frames << "\n";
+        std::cout << "\tbuffer binds: " << total.buffer_binds / num_frames << "\n";
+        std::cout << "\tvertex array binds: " << total.vertex_array_binds / num_frames << "\n";
+        std::cout << "\tframebuffer binds: " << total.framebuffer_binds / num_frames << "\n";
+        std::cout << "\tstate changes: " << total.state_changes / num_frames << "\n";
+        std::cout << "\tuniform uploads: " << total.uniform_uploads / num_frames << "\n";
+        std::cout << "\tbuffer uploads: " << total.buffer_uploads / num_frames << "\n";
+        std::cout << "\ttexture uploads: " << total.texture_uploads / num_frames << "\n";
+        std::cout << "\tbytes uploaded: " << total.bytes_uploaded / num_frames << "\n";
+        std::cout << "\tcommands: " << total.commands / num_frames << "\n";
+
+        const Mesh::MemoryUsage mesh_memory = game->GetMeshMemoryUsage();
+        std::cout << "mesh memory: " << mesh_memory.cpu_bytes / 1024 << " KiB on the CPU, "
+            << mesh_memory.gpu_bytes / 1024 << " KiB on the GPU\n";
+
+#if APEX_PROFILING
+        std::cout << "last frame: " << Profiler::GetInstance()->GetFrameTime() << " ms\n";
+
+        for (const Profiler::Aggregate &aggregate : Profiler::GetInstance()->GetFrameAggregates()) {
+            std::cout << "\t" << std::string(aggregate.depth * 2, ' ')
+                << aggregate.name << ": " << aggregate.total_ms << " ms (" << aggregate.calls << " calls)\n";
+        }
+#endif
+    }
+
+    ShaderWarmup::GetInstance()->Wait();
+
+#if SHADER_CACHE_ENABLED
+    const ShaderCache::Stats &shader_cache_stats = ShaderCache::GetInstance()->GetStats();
+
+    std::cout << "shader cache: sources " << shader_cache_stats.source_hits << " hits / "
+        << shader_cache_stats.source_misses << " misses, programs "
+        << shader_cache_stats.program_hits << " hits / "
+        << shader_cache_stats.program_misses << " misses\n";
+
+    if (!ShaderCache::GetInstance()->Save()) {
+        std::cout << "could not write shader cache to " << SHADER_CACHE_PATH << "\n";
+    }
+#endif
+
+    if (ShaderWarmup::GetInstance()->IsRecording() && !ShaderWarmup::GetInstance()->Save()) {
+        std::cout << "could not write shader warm-up manifest to " << SHADER_WARMUP_PATH << "\n";
+    }
+
+#if APEX_PROFILING
+    if (!trace_path.empty() && !Profiler::GetInstance()->WriteChromeTrace(trace_path)) {
+        std::cout << "could not write trace to " << trace_path << "\n";
+    }
+#endif
+
     delete game;
     delete engine;
 
@@ -191,4 +191,34 @@ double BoundingBox::Area() const
     return dimensions.x * dimensions.y * dimensions.z;
 }
 
+void BoundingBoxBatch::Clear()
+{
+    min_x.clear();
+    min_y.clear();
+    min_z.clear();
+    max_x.clear();
+    max_y.clear();
+    max_z.clear();
+}
+
+void BoundingBoxBatch::Reserve(size_t count)
+{
+    min_x.reserve(count);
+    min_y.reserve(count);
+    min_z.reserve(count);
+    max_x.reserve(count);
+    max_y.reserve(count);
+    max_z.reserve(count);
+}
+
+void BoundingBoxBatch::Add(const BoundingBox &aabb)
+{
+    min_x.push_back(aabb.GetMin().x);
+    min_y.push_back(aabb.GetMin().y);
+    min_z.push_back(aabb.GetMin().z);
+    max_x.push_back(aabb.GetMax().x);
+    max_y.push_back(aabb.GetMax().y);
+    max_z.push_back(aabb.GetMax().z);
+}
+
 } // namespace apex
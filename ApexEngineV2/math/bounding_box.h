@@ -6,6 +6,7 @@
 #include "transform.h"
 #include "ray.h"
 #include <array>
+#include <vector>
 #include <limits>
 
 namespace apex {
@@ -44,11 +45,43 @@ public:
     bool ContainsPoint(const Vector3 &vec) const;
     double Area() const;
 
+    inline bool Intersects(const BoundingBox &other) const
+    {
+        return m_min.x <= other.m_max.x && m_max.x >= other.m_min.x &&
+               m_min.y <= other.m_max.y && m_max.y >= other.m_min.y &&
+               m_min.z <= other.m_max.z && m_max.z >= other.m_min.z;
+    }
+
+    inline bool Contains(const BoundingBox &other) const
+    {
+        return m_min.x <= other.m_min.x && m_max.x >= other.m_max.x &&
+               m_min.y <= other.m_min.y && m_max.y >= other.m_max.y &&
+               m_min.z <= other.m_min.z && m_max.z >= other.m_max.z;
+    }
+
+    inline float SurfaceArea() const
+    {
+        const Vector3 dimensions(m_max - m_min);
+        return 2.0f * (dimensions.x * dimensions.y + dimensions.y * dimensions.z + dimensions.z * dimensions.x);
+    }
+
 private:
     Vector3 m_min;
     Vector3 m_max;
 };
 
+// The bounds of many boxes, one array per coordinate, for testing in batches.
+struct BoundingBoxBatch {
+    std::vector<float> min_x, min_y, min_z;
+    std::vector<float> max_x, max_y, max_z;
+
+    inline size_t Size() const { return min_x.size(); }
+
+    void Clear();
+    void Reserve(size_t count);
+    void Add(const BoundingBox &aabb);
+};
+
 } // namespace apex
 
 #endif
@@ -0,0 +1,323 @@
+#include "dynamic_bvh.h"
+#include "../util.h"
+
+namespace apex {
+
+const DynamicBVH::ProxyId_t DynamicBVH::null_proxy;
+
+static inline BoundingBox Combine(const BoundingBox &a, const BoundingBox &b)
+{
+    return BoundingBox(Vector3::Min(a.GetMin(), b.GetMin()), Vector3::Max(a.GetMax(), b.GetMax()));
+}
+
+DynamicBVH::DynamicBVH(float margin)
+    : m_root(null_proxy),
+      m_free_list(null_proxy),
+      m_num_proxies(0),
+      m_margin(margin)
+{
+}
+
+DynamicBVH::ProxyId_t DynamicBVH::CreateProxy(const BoundingBox &aabb, uint64_t user_data)
+{
+    ex_assert(!aabb.Empty());
+
+    const int32_t leaf = AllocateNode();
+
+    m_nodes[leaf].aabb = BoundingBox(aabb.GetMin() - Vector3(m_margin), aabb.GetMax() + Vector3(m_margin));
+    m_nodes[leaf].user_data = user_data;
+    m_nodes[leaf].height = 0;
+
+    InsertLeaf(leaf);
+    m_num_proxies++;
+
+    return leaf;
+}
+
+void DynamicBVH::DestroyProxy(ProxyId_t proxy)
+{
+    ex_assert(proxy >= 0 && size_t(proxy) < m_nodes.size() && m_nodes[proxy].IsLeaf());
+
+    RemoveLeaf(proxy);
+    FreeNode(proxy);
+    m_num_proxies--;
+}
+
+bool DynamicBVH::MoveProxy(ProxyId_t proxy, const BoundingBox &aabb)
+{
+    ex_assert(proxy >= 0 && size_t(proxy) < m_nodes.size() && m_nodes[proxy].IsLeaf());
+
+    const BoundingBox &fat_aabb = m_nodes[proxy].aabb;
+
+    // still inside the enlarged box, and the box has not become much too large for it
+    const BoundingBox loose_aabb(aabb.GetMin() - Vector3(m_margin * 4.0f), aabb.GetMax() + Vector3(m_margin * 4.0f));
+
+    if (fat_aabb.Contains(aabb) && loose_aabb.Contains(fat_aabb)) {
+        return false;
+    }
+
+    RemoveLeaf(proxy);
+
+    m_nodes[proxy].aabb = BoundingBox(aabb.GetMin() - Vector3(m_margin), aabb.GetMax() + Vector3(m_margin));
+
+    InsertLeaf(proxy);
+
+    return true;
+}
+
+void DynamicBVH::Clear()
+{
+    m_nodes.clear();
+    m_root = null_proxy;
+    m_free_list = null_proxy;
+    m_num_proxies = 0;
+}
+
+int32_t DynamicBVH::AllocateNode()
+{
+    int32_t index;
+
+    if (m_free_list != null_proxy) {
+        index = m_free_list;
+        m_free_list = m_nodes[index].parent;
+    } else {
+        index = int32_t(m_nodes.size());
+        m_nodes.push_back(Node());
+    }
+
+    Node &node = m_nodes[index];
+    node.user_data = 0;
+    node.parent = null_proxy;
+    node.child1 = null_proxy;
+    node.child2 = null_proxy;
+    node.height = 0;
+
+    return index;
+}
+
+void DynamicBVH::FreeNode(int32_t index)
+{
+    m_nodes[index].parent = m_free_list;
+    m_nodes[index].height = -1;
+    m_free_list = index;
+}
+
+void DynamicBVH::InsertLeaf(int32_t leaf)
+{
+    if (m_root == null_proxy) {
+        m_root = leaf;
+        m_nodes[leaf].parent = null_proxy;
+
+        return;
+    }
+
+    const BoundingBox leaf_aabb = m_nodes[leaf].aabb;
+
+    // descend towards the sibling that adds the least surface area to the tree
+    int32_t index = m_root;
+
+    while (!m_nodes[index].IsLeaf()) {
+        const Node &node = m_nodes[index];
+
+        const float area = node.aabb.SurfaceArea();
+        const float combined_area = Combine(node.aabb, leaf_aabb).SurfaceArea();
+
+        // cost of pairing the leaf with this node
+        const float cost = 2.0f * combined_area;
+        // minimum cost of pushing the leaf further down
+        const float inheritance_cost = 2.0f * (combined_area - area);
+
+        float child_costs[2];
+        const int32_t children[2] = { node.child1, node.child2 };
+
+        for (int i = 0; i < 2; i++) {
+            const Node &child = m_nodes[children[i]];
+            const float enlarged_area = Combine(child.aabb, leaf_aabb).SurfaceArea();
+
+            child_costs[i] = (child.IsLeaf() ? enlarged_area : enlarged_area - child.aabb.SurfaceArea())
+                + inheritance_cost;
+        }
+
+        if (cost < child_costs[0] && cost < child_costs[1]) {
+            break;
+        }
+
+        index = child_costs[0] < child_costs[1] ? children[0] : children[1];
+    }
+
+    const int32_t sibling = index;
+    const int32_t old_parent = m_nodes[sibling].parent;
+    const int32_t new_parent = AllocateNode();
+
+    m_nodes[new_parent].parent = old_parent;
+    m_nodes[new_parent].aabb = Combine(leaf_aabb, m_nodes[sibling].aabb);
+    m_nodes[new_parent].height = m_nodes[sibling].height + 1;
+    m_nodes[new_parent].child1 = sibling;
+    m_nodes[new_parent].child2 = leaf;
+
+    if (old_parent != null_proxy) {
+        if (m_nodes[old_parent].child1 == sibling) {
+            m_nodes[old_parent].child1 = new_parent;
+        } else {
+            m_nodes[old_parent].child2 = new_parent;
+        }
+    } else {
+        m_root = new_parent;
+    }
+
+    m_nodes[sibling].parent = new_parent;
+    m_nodes[leaf].parent = new_parent;
+
+    Refit(new_parent);
+}
+
+void DynamicBVH::RemoveLeaf(int32_t leaf)
+{
+    if (leaf == m_root) {
+        m_root = null_proxy;
+
+        return;
+    }
+
+    const int32_t parent = m_nodes[leaf].parent;
+    const int32_t grand_parent = m_nodes[parent].parent;
+    const int32_t sibling = m_nodes[parent].child1 == leaf ? m_nodes[parent].child2 : m_nodes[parent].child1;
+
+    // the sibling takes the place of the parent
+    if (grand_parent != null_proxy) {
+        if (m_nodes[grand_parent].child1 == parent) {
+            m_nodes[grand_parent].child1 = sibling;
+        } else {
+            m_nodes[grand_parent].child2 = sibling;
+        }
+
+        m_nodes[sibling].parent = grand_parent;
+        FreeNode(parent);
+
+        Refit(grand_parent);
+    } else {
+        m_root = sibling;
+        m_nodes[sibling].parent = null_proxy;
+        FreeNode(parent);
+    }
+}
+
+void DynamicBVH::Refit(int32_t index)
+{
+    while (index != null_proxy) {
+        index = Balance(index);
+
+        Node &node = m_nodes[index];
+        const Node &child1 = m_nodes[node.child1];
+        const Node &child2 = m_nodes[node.child2];
+
+        node.height = 1 + std::max(child1.height, child2.height);
+        node.aabb = Combine(child1.aabb, child2.aabb);
+
+        index = node.parent;
+    }
+}
+
+int32_t DynamicBVH::Balance(int32_t a_index)
+{
+    Node &a = m_nodes[a_index];
+
+    if (a.IsLeaf() || a.height < 2) {
+        return a_index;
+    }
+
+    const int32_t b_index = a.child1;
+    const int32_t c_index = a.child2;
+    Node &b = m_nodes[b_index];
+    Node &c = m_nodes[c_index];
+
+    const int32_t balance = c.height - b.height;
+
+    if (balance > 1) {
+        // rotate c up
+        const int32_t f_index = c.child1;
+        const int32_t g_index = c.child2;
+        Node &f = m_nodes[f_index];
+        Node &g = m_nodes[g_index];
+
+        c.child1 = a_index;
+        c.parent = a.parent;
+        a.parent = c_index;
+
+        if (c.parent != null_proxy) {
+            if (m_nodes[c.parent].child1 == a_index) {
+                m_nodes[c.parent].child1 = c_index;
+            } else {
+                m_nodes[c.parent].child2 = c_index;
+            }
+        } else {
+            m_root = c_index;
+        }
+
+        if (f.height > g.height) {
+            c.child2 = f_index;
+            a.child2 = g_index;
+            g.parent = a_index;
+            a.aabb = Combine(b.aabb, g.aabb);
+            c.aabb = Combine(a.aabb, f.aabb);
+            a.height = 1 + std::max(b.height, g.height);
+            c.height = 1 + std::max(a.height, f.height);
+        } else {
+            c.child2 = g_index;
+            a.child2 = f_index;
+            f.parent = a_index;
+            a.aabb = Combine(b.aabb, f.aabb);
+            c.aabb = Combine(a.aabb, g.aabb);
+            a.height = 1 + std::max(b.height, f.height);
+            c.height = 1 + std::max(a.height, g.height);
+        }
+
+        return c_index;
+    }
+
+    if (balance < -1) {
+        // rotate b up
+        const int32_t d_index = b.child1;
+        const int32_t e_index = b.child2;
+        Node &d = m_nodes[d_index];
+        Node &e = m_nodes[e_index];
+
+        b.child1 = a_index;
+        b.parent = a.parent;
+        a.parent = b_index;
+
+        if (b.parent != null_proxy) {
+            if (m_nodes[b.parent].child1 == a_index) {
+                m_nodes[b.parent].child1 = b_index;
+            } else {
+                m_nodes[b.parent].child2 = b_index;
+            }
+        } else {
+            m_root = b_index;
+        }
+
+        if (d.height > e.height) {
+            b.child2 = d_index;
+            a.child1 = e_index;
+            e.parent = a_index;
+            a.aabb = Combine(c.aabb, e.aabb);
+            b.aabb = Combine(a.aabb, d.aabb);
+            a.height = 1 + std::max(c.height, e.height);
+            b.height = 1 + std::max(a.height, d.height);
+        } else {
+            b.child2 = e_index;
+            a.child1 = d_index;
+            d.parent = a_index;
+            a.aabb = Combine(c.aabb, d.aabb);
+            b.aabb = Combine(a.aabb, e.aabb);
+            a.height = 1 + std::max(c.height, d.height);
+            b.height = 1 + std::max(a.height, e.height);
+        }
+
+        return b_index;
+    }
+
+    return a_index;
+}
+
+} // namespace apex
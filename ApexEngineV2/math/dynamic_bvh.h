@@ -0,0 +1,203 @@
+#ifndef DYNAMIC_BVH_H
+#define DYNAMIC_BVH_H
+
+#include "bounding_box.h"
+#include "frustum.h"
+#include "vector3.h"
+#include "ray.h"
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <limits>
+#include <cstdint>
+#include <cstddef>
+
+namespace apex {
+
+// Incrementally updated bounding volume hierarchy over axis aligned boxes.
+// Leaves store a box enlarged by a small margin, so objects that only move a
+// little do not need to be reinserted. Insertion picks the sibling that adds the
+// least surface area, and the tree is rebalanced with rotations on the way up.
+// Queries report the user data of every leaf whose (enlarged) box passes the test.
+class DynamicBVH {
+public:
+    using ProxyId_t = int32_t;
+
+    static const ProxyId_t null_proxy = -1;
+
+    DynamicBVH(float margin = 0.1f);
+
+    ProxyId_t CreateProxy(const BoundingBox &aabb, uint64_t user_data);
+    void DestroyProxy(ProxyId_t proxy);
+    // returns true if the proxy had to be reinserted
+    bool MoveProxy(ProxyId_t proxy, const BoundingBox &aabb);
+    void Clear();
+
+    inline uint64_t GetUserData(ProxyId_t proxy) const { return m_nodes[proxy].user_data; }
+    inline void SetUserData(ProxyId_t proxy, uint64_t user_data) { m_nodes[proxy].user_data = user_data; }
+    inline const BoundingBox &GetFatAABB(ProxyId_t proxy) const { return m_nodes[proxy].aabb; }
+    inline size_t NumProxies() const { return m_num_proxies; }
+    inline int GetHeight() const { return m_root == null_proxy ? 0 : m_nodes[m_root].height; }
+
+    // callback(uint64_t user_data, bool inside). inside is set when the leaf's
+    // box lies entirely within the frustum, otherwise it only intersects it.
+    template <class Callback>
+    void QueryFrustum(const Frustum &frustum, Callback callback) const
+    {
+        if (m_root == null_proxy) {
+            return;
+        }
+
+        // second member is set when the node is known to be entirely inside
+        std::vector<std::pair<int32_t, bool>> stack;
+        stack.reserve(64);
+        stack.push_back({ m_root, false });
+
+        while (!stack.empty()) {
+            const std::pair<int32_t, bool> entry = stack.back();
+            stack.pop_back();
+
+            const Node &node = m_nodes[entry.first];
+            bool inside = entry.second;
+
+            if (!inside) {
+                const Frustum::BoundingBoxFrustumResult result = frustum.TestBoundingBox(node.aabb);
+
+                if (result == Frustum::OUTSIDE) {
+                    continue;
+                }
+
+                inside = (result == Frustum::INSIDE);
+            }
+
+            if (node.IsLeaf()) {
+                callback(node.user_data, inside);
+            } else {
+                stack.push_back({ node.child2, inside });
+                stack.push_back({ node.child1, inside });
+            }
+        }
+    }
+
+    // callback(uint64_t user_data)
+    template <class Callback>
+    void QueryAABB(const BoundingBox &aabb, Callback callback) const
+    {
+        Traverse([&aabb](const BoundingBox &node_aabb) {
+            return node_aabb.Intersects(aabb);
+        }, callback);
+    }
+
+    template <class Callback>
+    void QuerySphere(const Vector3 &center, float radius, Callback callback) const
+    {
+        const float radius_squared = radius * radius;
+
+        Traverse([&center, radius_squared](const BoundingBox &node_aabb) {
+            // squared distance from the center to the closest point on the box
+            const Vector3 closest = Vector3::Max(node_aabb.GetMin(), Vector3::Min(center, node_aabb.GetMax()));
+
+            return (closest - center).LengthSquared() <= radius_squared;
+        }, callback);
+    }
+
+    template <class Callback>
+    void QueryRay(const Ray &ray, Callback callback) const
+    {
+        const float origin[3] = { ray.m_position.x, ray.m_position.y, ray.m_position.z };
+        const float direction[3] = { ray.m_direction.x, ray.m_direction.y, ray.m_direction.z };
+        float inv_direction[3];
+
+        for (int i = 0; i < 3; i++) {
+            inv_direction[i] = direction[i] != 0.0f
+                ? 1.0f / direction[i]
+                : std::numeric_limits<float>::infinity();
+        }
+
+        Traverse([&origin, &inv_direction](const BoundingBox &node_aabb) {
+            const float min[3] = { node_aabb.GetMin().x, node_aabb.GetMin().y, node_aabb.GetMin().z };
+            const float max[3] = { node_aabb.GetMax().x, node_aabb.GetMax().y, node_aabb.GetMax().z };
+
+            // slab test, only hits in front of the origin count
+            float t_min = 0.0f;
+            float t_max = std::numeric_limits<float>::max();
+
+            for (int i = 0; i < 3; i++) {
+                float t1 = (min[i] - origin[i]) * inv_direction[i];
+                float t2 = (max[i] - origin[i]) * inv_direction[i];
+
+                if (t1 > t2) {
+                    std::swap(t1, t2);
+                }
+
+                // NaN (origin on a slab plane of a parallel axis) leaves the interval unchanged
+                t_min = t1 > t_min ? t1 : t_min;
+                t_max = t2 < t_max ? t2 : t_max;
+
+                if (t_min > t_max) {
+                    return false;
+                }
+            }
+
+            return true;
+        }, callback);
+    }
+
+private:
+    struct Node {
+        BoundingBox aabb;
+        uint64_t user_data;
+        int32_t parent; // next free node while on the free list
+        int32_t child1;
+        int32_t child2;
+        int32_t height; // leaves are 0, free nodes -1
+
+        inline bool IsLeaf() const { return child1 == null_proxy; }
+    };
+
+    std::vector<Node> m_nodes;
+    int32_t m_root;
+    int32_t m_free_list;
+    size_t m_num_proxies;
+    float m_margin;
+
+    int32_t AllocateNode();
+    void FreeNode(int32_t index);
+    void InsertLeaf(int32_t leaf);
+    void RemoveLeaf(int32_t leaf);
+    int32_t Balance(int32_t index);
+    void Refit(int32_t index);
+
+    template <class Test, class Callback>
+    void Traverse(Test test, Callback callback) const
+    {
+        if (m_root == null_proxy) {
+            return;
+        }
+
+        std::vector<int32_t> stack;
+        stack.reserve(64);
+        stack.push_back(m_root);
+
+        while (!stack.empty()) {
+            const Node &node = m_nodes[stack.back()];
+            stack.pop_back();
+
+            if (!test(node.aabb)) {
+                continue;
+            }
+
+            if (node.IsLeaf()) {
+                callback(node.user_data);
+            } else {
+                stack.push_back(node.child2);
+                stack.push_back(node.child1);
+            }
+        }
+    }
+};
+
+} // namespace apex
+
+#endif
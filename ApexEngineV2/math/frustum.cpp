@@ -1,11 +1,23 @@
 #include "frustum.h"
 
+#include <cmath>
+#include <cstring>
+
+#if FRUSTUM_BATCH_SIMD
+#if defined(__AVX__)
+#include <immintrin.h>
+#define FRUSTUM_BATCH_WIDTH 8
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FRUSTUM_BATCH_WIDTH 4
+#endif
+#endif
+
+#ifndef FRUSTUM_BATCH_WIDTH
+#define FRUSTUM_BATCH_WIDTH 1
+#endif
+
 namespace apex {
-enum BoundingBoxFrustumResult {
-    OUTSIDE = 0,
-    INSIDE = 1,
-    INTERSECTS = 2
-};
 Frustum::Frustum()
 {
 }
@@ -22,10 +34,14 @@ Frustum::Frustum(const Matrix4 &view_proj)
 
 bool Frustum::BoundingBoxInFrustum(const BoundingBox &bounding_box) const
 {
+    return TestBoundingBox(bounding_box) != OUTSIDE;
+}
 
-    const Vector3 &center = bounding_box.GetCenter();
-    const Vector3 &size = bounding_box.GetDimensions();
-    unsigned int result = INSIDE; // Assume that the aabb will be inside the frustum
+Frustum::BoundingBoxFrustumResult Frustum::TestBoundingBox(const BoundingBox &bounding_box) const
+{
+    const Vector3 center = bounding_box.GetCenter();
+    const Vector3 size = bounding_box.GetDimensions() * 0.5f; // half extents
+    BoundingBoxFrustumResult result = INSIDE; // Assume that the aabb will be inside the frustum
 
     for (int i = 0; i < 6; i++) {
         const Vector4 &plane = m_planes[i];
@@ -41,7 +57,140 @@ bool Frustum::BoundingBoxInFrustum(const BoundingBox &bounding_box) const
         }
     }
 
-    return result != OUTSIDE;
+    return result;
+}
+
+void Frustum::TestBoundingBoxes(const float *min_x, const float *min_y, const float *min_z,
+    const float *max_x, const float *max_y, const float *max_z,
+    size_t count, uint32_t *out_mask) const
+{
+    std::memset(out_mask, 0, ((count + 31) / 32) * sizeof(uint32_t));
+
+    // same test as TestBoundingBox(): outside if the box is behind any one plane
+    float plane_abs[6][3];
+
+    for (int p = 0; p < 6; p++) {
+        plane_abs[p][0] = fabsf(m_planes[p].x);
+        plane_abs[p][1] = fabsf(m_planes[p].y);
+        plane_abs[p][2] = fabsf(m_planes[p].z);
+    }
+
+    size_t i = 0;
+
+#if FRUSTUM_BATCH_WIDTH == 8
+    const __m256 half = _mm256_set1_ps(0.5f);
+
+    for (; i + 8 <= count; i += 8) {
+        const __m256 lo_x = _mm256_loadu_ps(min_x + i), hi_x = _mm256_loadu_ps(max_x + i);
+        const __m256 lo_y = _mm256_loadu_ps(min_y + i), hi_y = _mm256_loadu_ps(max_y + i);
+        const __m256 lo_z = _mm256_loadu_ps(min_z + i), hi_z = _mm256_loadu_ps(max_z + i);
+
+        const __m256 center_x = _mm256_mul_ps(_mm256_add_ps(hi_x, lo_x), half);
+        const __m256 center_y = _mm256_mul_ps(_mm256_add_ps(hi_y, lo_y), half);
+        const __m256 center_z = _mm256_mul_ps(_mm256_add_ps(hi_z, lo_z), half);
+        const __m256 extent_x = _mm256_mul_ps(_mm256_sub_ps(hi_x, lo_x), half);
+        const __m256 extent_y = _mm256_mul_ps(_mm256_sub_ps(hi_y, lo_y), half);
+        const __m256 extent_z = _mm256_mul_ps(_mm256_sub_ps(hi_z, lo_z), half);
+
+        __m256 outside = _mm256_setzero_ps();
+
+        for (int p = 0; p < 6; p++) {
+            const Vector4 &plane = m_planes[p];
+
+            const __m256 dot = _mm256_add_ps(_mm256_add_ps(
+                _mm256_mul_ps(center_x, _mm256_set1_ps(plane.x)),
+                _mm256_mul_ps(center_y, _mm256_set1_ps(plane.y))),
+                _mm256_mul_ps(center_z, _mm256_set1_ps(plane.z)));
+            const __m256 radius = _mm256_add_ps(_mm256_add_ps(
+                _mm256_mul_ps(extent_x, _mm256_set1_ps(plane_abs[p][0])),
+                _mm256_mul_ps(extent_y, _mm256_set1_ps(plane_abs[p][1]))),
+                _mm256_mul_ps(extent_z, _mm256_set1_ps(plane_abs[p][2])));
+
+            outside = _mm256_or_ps(outside,
+                _mm256_cmp_ps(_mm256_add_ps(dot, radius), _mm256_set1_ps(-plane.w), _CMP_LT_OQ));
+        }
+
+        const uint32_t visible = uint32_t(~_mm256_movemask_ps(outside)) & 0xFF;
+
+        out_mask[i / 32] |= visible << (i % 32);
+    }
+#elif FRUSTUM_BATCH_WIDTH == 4
+    const __m128 half = _mm_set1_ps(0.5f);
+
+    for (; i + 4 <= count; i += 4) {
+        const __m128 lo_x = _mm_loadu_ps(min_x + i), hi_x = _mm_loadu_ps(max_x + i);
+        const __m128 lo_y = _mm_loadu_ps(min_y + i), hi_y = _mm_loadu_ps(max_y + i);
+        const __m128 lo_z = _mm_loadu_ps(min_z + i), hi_z = _mm_loadu_ps(max_z + i);
+
+        const __m128 center_x = _mm_mul_ps(_mm_add_ps(hi_x, lo_x), half);
+        const __m128 center_y = _mm_mul_ps(_mm_add_ps(hi_y, lo_y), half);
+        const __m128 center_z = _mm_mul_ps(_mm_add_ps(hi_z, lo_z), half);
+        const __m128 extent_x = _mm_mul_ps(_mm_sub_ps(hi_x, lo_x), half);
+        const __m128 extent_y = _mm_mul_ps(_mm_sub_ps(hi_y, lo_y), half);
+        const __m128 extent_z = _mm_mul_ps(_mm_sub_ps(hi_z, lo_z), half);
+
+        __m128 outside = _mm_setzero_ps();
+
+        for (int p = 0; p < 6; p++) {
+            const Vector4 &plane = m_planes[p];
+
+            const __m128 dot = _mm_add_ps(_mm_add_ps(
+                _mm_mul_ps(center_x, _mm_set1_ps(plane.x)),
+                _mm_mul_ps(center_y, _mm_set1_ps(plane.y))),
+                _mm_mul_ps(center_z, _mm_set1_ps(plane.z)));
+            const __m128 radius = _mm_add_ps(_mm_add_ps(
+                _mm_mul_ps(extent_x, _mm_set1_ps(plane_abs[p][0])),
+                _mm_mul_ps(extent_y, _mm_set1_ps(plane_abs[p][1]))),
+                _mm_mul_ps(extent_z, _mm_set1_ps(plane_abs[p][2])));
+
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(dot, radius), _mm_set1_ps(-plane.w)));
+        }
+
+        const uint32_t visible = uint32_t(~_mm_movemask_ps(outside)) & 0xF;
+
+        out_mask[i / 32] |= visible << (i % 32);
+    }
+#endif
+
+    // scalar fallback, and whatever is left over after the last full batch
+    for (; i < count; i++) {
+        const float center_x = (max_x[i] + min_x[i]) * 0.5f;
+        const float center_y = (max_y[i] + min_y[i]) * 0.5f;
+        const float center_z = (max_z[i] + min_z[i]) * 0.5f;
+        const float extent_x = (max_x[i] - min_x[i]) * 0.5f;
+        const float extent_y = (max_y[i] - min_y[i]) * 0.5f;
+        const float extent_z = (max_z[i] - min_z[i]) * 0.5f;
+
+        bool outside = false;
+
+        for (int p = 0; p < 6 && !outside; p++) {
+            const Vector4 &plane = m_planes[p];
+
+            const float dot = center_x * plane.x + center_y * plane.y + center_z * plane.z;
+            const float radius = extent_x * plane_abs[p][0] + extent_y * plane_abs[p][1] + extent_z * plane_abs[p][2];
+
+            outside = dot + radius < -plane.w;
+        }
+
+        if (!outside) {
+            out_mask[i / 32] |= 1u << (i % 32);
+        }
+    }
+}
+
+void Frustum::TestBoundingBoxes(const BoundingBoxBatch &batch, std::vector<uint32_t> &out_mask) const
+{
+    out_mask.resize((batch.Size() + 31) / 32);
+
+    if (batch.Size() == 0) {
+        return;
+    }
+
+    TestBoundingBoxes(
+        batch.min_x.data(), batch.min_y.data(), batch.min_z.data(),
+        batch.max_x.data(), batch.max_y.data(), batch.max_z.data(),
+        batch.Size(), out_mask.data()
+    );
 }
 
 void Frustum::SetViewProjectionMatrix(const Matrix4 &view_proj)
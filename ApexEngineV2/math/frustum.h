@@ -6,10 +6,21 @@
 #include "bounding_box.h"
 
 #include <array>
+#include <vector>
+#include <cstdint>
+
+// use SSE / AVX (whichever the compiler targets) for batch bounding box tests
+#define FRUSTUM_BATCH_SIMD 1
 
 namespace apex {
 class Frustum {
 public:
+    enum BoundingBoxFrustumResult {
+        OUTSIDE = 0,
+        INSIDE = 1,
+        INTERSECTS = 2
+    };
+
     Frustum();
     Frustum(const Frustum &other);
     Frustum(const Matrix4 &view_proj);
@@ -18,6 +29,13 @@ public:
     inline const Vector4 &GetPlane(size_t index) const { return m_planes[index]; }
 
     bool BoundingBoxInFrustum(const BoundingBox &bounding_box) const;
+    BoundingBoxFrustumResult TestBoundingBox(const BoundingBox &bounding_box) const;
+    // tests count boxes at once. bit (i % 32) of out_mask[i / 32] is set if box i
+    // is at least partially inside; out_mask must hold (count + 31) / 32 words.
+    void TestBoundingBoxes(const float *min_x, const float *min_y, const float *min_z,
+        const float *max_x, const float *max_y, const float *max_z,
+        size_t count, uint32_t *out_mask) const;
+    void TestBoundingBoxes(const BoundingBoxBatch &batch, std::vector<uint32_t> &out_mask) const;
     void SetViewProjectionMatrix(const Matrix4 &view_proj);
 
 private:
@@ -24,7 +24,6 @@ Transform::Transform(const Transform &other)
       m_rotation(other.m_rotation),
       m_matrix(other.m_matrix)
 {
-    UpdateMatrix();
 }
 
 void Transform::UpdateMatrix()
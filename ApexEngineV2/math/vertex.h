@@ -102,6 +102,8 @@ public:
     inline int GetBoneIndex(int i) const { return bone_indices[i]; }
     inline void AddBoneWeight(float val) { if (nboneweights < MAX_BONE_WEIGHTS) bone_weights[nboneweights++] = val; }
     inline void AddBoneIndex(int val) { if (nboneindices < MAX_BONE_INDICES) bone_indices[nboneindices++] = val; }
+    inline const std::array<float, MAX_BONE_WEIGHTS> &GetBoneWeights() const { return bone_weights; }
+    inline const std::array<int, MAX_BONE_INDICES> &GetBoneIndices() const { return bone_indices; }
 
 private:
     int nboneindices,
@@ -0,0 +1,74 @@
+#include "null_engine.h"
+#include "game.h"
+#include "profiler.h"
+
+namespace apex {
+
+NullEngine::NullEngine(size_t num_frames, double frame_time)
+    : m_num_frames(num_frames),
+      m_frame_time(frame_time),
+      m_next_id(1)
+{
+}
+
+bool NullEngine::InitializeGame(Game *game)
+{
+    game->Initialize();
+
+    stats.fps = m_frame_time > 0.0 ? 1.0 / m_frame_time : 0.0;
+
+    for (size_t i = 0; i < m_num_frames; i++) {
+        APEX_PROFILE_BEGIN_FRAME();
+        BeginFrame();
+
+        Clear(COLOR_BUFFER_BIT | DEPTH_BUFFER_BIT);
+
+        game->Update(m_frame_time);
+        game->Render();
+
+        EndFrame();
+        APEX_PROFILE_END_FRAME();
+    }
+
+    return true;
+}
+
+void NullEngine::GetShaderiv(unsigned int shader, int pname, int *params)
+{
+    // compile always succeeds, with an empty log
+    *params = (pname == COMPILE_STATUS) ? 1 : 0;
+}
+
+void NullEngine::GetShaderInfoLog(unsigned int shader, int max, int *len, char *info)
+{
+    if (len != nullptr) {
+        *len = 0;
+    }
+
+    if (info != nullptr && max > 0) {
+        info[0] = '\0';
+    }
+}
+
+void NullEngine::GetProgramiv(unsigned int program, int pname, int *params)
+{
+    *params = (pname == LINK_STATUS || pname == VALIDATE_STATUS) ? 1 : 0;
+}
+
+void NullEngine::GetProgramInfoLog(unsigned int program, int max, int *len, char *log)
+{
+    GetShaderInfoLog(program, max, len, log);
+}
+
+int NullEngine::GetUniformLocation(unsigned int program, const char *name)
+{
+    auto it = m_uniform_locations.find(name);
+
+    if (it == m_uniform_locations.end()) {
+        it = m_uniform_locations.insert({ name, int(m_uniform_locations.size()) }).first;
+    }
+
+    return it->second;
+}
+
+} // namespace apex
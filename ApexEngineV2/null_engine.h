@@ -0,0 +1,140 @@
+#ifndef NULL_ENGINE_H
+#define NULL_ENGINE_H
+
+#include "core_engine.h"
+
+#include <string>
+#include <unordered_map>
+
+namespace apex {
+
+// CoreEngine that runs without a window or GL context.
+// Every call is a no-op: objects get unique ids, shaders always compile and link,
+// and framebuffers are always complete. InitializeGame() runs a fixed number of
+// frames with a fixed timestep, so the whole update/cull/submit path can run headless.
+class NullEngine : public CoreEngine {
+public:
+    NullEngine(size_t num_frames = 1, double frame_time = 1.0 / 60.0);
+    virtual ~NullEngine() = default;
+
+    inline size_t GetNumFrames() const { return m_num_frames; }
+    inline double GetFrameTime() const { return m_frame_time; }
+
+    // called around every frame run by InitializeGame(). may also be called
+    // directly when driving the renderer without a Game.
+    virtual void BeginFrame() {}
+    virtual void EndFrame() {}
+
+    virtual bool InitializeGame(Game *game) override;
+    virtual void SetCursorLocked(bool locked) override {}
+    virtual void Viewport(int x, int y, size_t width, size_t height) override {}
+    virtual void Clear(int mask) override {}
+    virtual void SetMousePosition(double x, double y) override {}
+    virtual void Enable(int cap) override {}
+    virtual void Disable(int cap) override {}
+    virtual void DepthMask(bool mask) override {}
+    virtual void BlendFunc(int src, int dst) override {}
+    virtual void CullFace(int mode) override {}
+    virtual unsigned int GetError() override { return 0; }
+    virtual void GenBuffers(size_t count, unsigned int *buffers) override { GenIds(count, buffers); }
+    virtual void DeleteBuffers(size_t count, unsigned int *buffers) override {}
+    virtual void BindBuffer(int target, unsigned int buffer) override {}
+    virtual void BufferData(int target, size_t size, const void *data, int usage) override {}
+    virtual void BufferSubData(int target, size_t offset, size_t size, const void *data) override {}
+    virtual bool SupportsBufferStorage() override { return false; }
+    virtual void BufferStorage(int target, size_t size, const void *data, unsigned int flags) override {}
+    virtual void *MapBufferRange(int target, size_t offset, size_t size, unsigned int access) override { return nullptr; }
+    virtual bool UnmapBuffer(int target) override { return true; }
+    virtual void *FenceSync() override { return nullptr; }
+    virtual unsigned int ClientWaitSync(void *sync, bool flush, uint64_t timeout_ns) override { return ALREADY_SIGNALED; }
+    virtual void DeleteSync(void *sync) override {}
+    virtual void BindVertexArray(unsigned int target) override {}
+    virtual void GenVertexArrays(size_t size, unsigned int *arrays) override { GenIds(size, arrays); }
+    virtual void DeleteVertexArrays(size_t size, const unsigned int *arrays) override {}
+    virtual void EnableVertexAttribArray(unsigned int index) override {}
+    virtual void DisableVertexAttribArray(unsigned int index) override {}
+    virtual void VertexAttribPointer(unsigned int index, int size, int type, bool normalized, size_t stride, void *ptr) override {}
+    virtual void DrawElements(int mode, size_t count, int type, const void *indices) override {}
+    virtual void MultiDrawElements(int mode, const int *counts, int type, const void *const *indices, size_t drawcount) override {}
+    virtual void GenTextures(size_t n, unsigned int *textures) override { GenIds(n, textures); }
+    virtual void DeleteTextures(size_t n, const unsigned int *textures) override {}
+    virtual void TexParameteri(int target, int pname, int param) override {}
+    virtual void TexParameterf(int target, int pname, float param) override {}
+    virtual void TexImage2D(int target, int level, int ifmt, size_t width, size_t height,
+        int border, int fmt, int type, const void *data) override {}
+    virtual void CopyTexImage2D(int target, int level, int ifmt, int x, int y,
+        size_t width, size_t height, int border) override {}
+    virtual void TexImage3D(int target, int level, int ifmt, size_t width, size_t height, size_t depth,
+        int border, int fmt, int type, const void *data) override {}
+    virtual void TexSubImage3D(int target, int level, int x, int y, int z, size_t width, size_t height, size_t depth,
+        int fmt, int type, const void *data) override {}
+    virtual void GetTexImage(int target, int level, int fmt, int type, void *pixels) override {}
+    virtual void BindTexture(int target, unsigned int texture) override {}
+    virtual void ActiveTexture(int i) override {}
+    virtual void GenerateMipmap(int target) override {}
+    virtual void GenFramebuffers(size_t n, unsigned int *ids) override { GenIds(n, ids); }
+    virtual void DeleteFramebuffers(size_t n, const unsigned int *ids) override {}
+    virtual void BindFramebuffer(int target, unsigned int framebuffer) override {}
+    virtual void FramebufferTexture(int target, int attachment, unsigned int texture, int level) override {}
+    virtual void FramebufferTexture2D(int target, int attachment, int texture_target, unsigned int texture, int level) override {}
+    virtual void DrawBuffers(size_t n, const unsigned int *bufs) override {}
+    virtual void ReadBuffer(int mode) override {}
+    virtual unsigned int CheckFramebufferStatus(int target) override { return FRAMEBUFFER_COMPLETE; }
+    virtual unsigned int CreateProgram() override { return m_next_id++; }
+    virtual unsigned int CreateShader(int type) override { return m_next_id++; }
+    virtual void ShaderSource(unsigned int shader, size_t count, const char **str, const int *len) override {}
+    virtual void CompileShader(unsigned int shader) override {}
+    virtual void AttachShader(unsigned int program, unsigned int shader) override {}
+    virtual void GetShaderiv(unsigned int shader, int pname, int *params) override;
+    virtual void GetShaderInfoLog(unsigned int shader, int max, int *len, char *info) override;
+    virtual void BindAttribLocation(unsigned int program, unsigned int index, const char *name) override {}
+    virtual void BindFragDataLocation(unsigned int program, unsigned int color, const char *name) override {}
+    virtual void LinkProgram(unsigned int program) override {}
+    virtual void ValidateProgram(unsigned int program) override {}
+    virtual void GetProgramiv(unsigned int program, int pname, int *params) override;
+    virtual void GetProgramInfoLog(unsigned int program, int max, int *len, char *log) override;
+    virtual void ProgramParameteri(unsigned int program, int pname, int value) override {}
+    // no binary formats are supported, so programs are never cached
+    virtual void GetProgramBinary(unsigned int program, size_t max, size_t *len, unsigned int *format, void *binary) override { if (len != nullptr) { *len = 0; } }
+    virtual void ProgramBinary(unsigned int program, unsigned int format, const void *binary, size_t len) override {}
+    virtual const char *GetString(int name) override { return "null"; }
+    virtual void DeleteProgram(unsigned int program) override {}
+    virtual void DeleteShader(unsigned int shader) override {}
+    virtual void UseProgram(unsigned int program) override {}
+    virtual int GetUniformLocation(unsigned int program, const char *name) override;
+    // every program is treated as declaring every uniform block
+    virtual unsigned int GetUniformBlockIndex(unsigned int program, const char *name) override { return 0; }
+    virtual void UniformBlockBinding(unsigned int program, unsigned int index, unsigned int binding) override {}
+    virtual void BindBufferBase(int target, unsigned int index, unsigned int buffer) override {}
+    virtual void Uniform1f(int location, float v0) override {}
+    virtual void Uniform2f(int location, float v0, float v1) override {}
+    virtual void Uniform3f(int location, float v0, float v1, float v2) override {}
+    virtual void Uniform4f(int location, float v0, float v1, float v2, float v3) override {}
+    virtual void Uniform1i(int location, int v0) override {}
+    virtual void Uniform2i(int location, int v0, int v1) override {}
+    virtual void Uniform3i(int location, int v0, int v1, int v2) override {}
+    virtual void Uniform4i(int location, int v0, int v1, int v2, int v3) override {}
+    virtual void UniformMatrix4fv(int location, int count, bool transpose, const float *value) override {}
+    virtual void VertexAttribDivisor(unsigned int index, unsigned int divisor) override {}
+    virtual void DrawArraysInstanced(int mode, int first, size_t count, size_t primcount) override {}
+    virtual void DrawElementsInstanced(int mode, size_t count, int type, const void *indices, size_t primcount) override {}
+    virtual void BindImageTexture(unsigned int unit, unsigned int texture, int level, bool layered, int layer, unsigned int access, unsigned int format) override {}
+
+protected:
+    size_t m_num_frames;
+    double m_frame_time;
+    unsigned int m_next_id;
+    // uniform names map to the same location in every program
+    std::unordered_map<std::string, int> m_uniform_locations;
+
+    inline void GenIds(size_t count, unsigned int *ids)
+    {
+        for (size_t i = 0; i < count; i++) {
+            ids[i] = m_next_id++;
+        }
+    }
+};
+
+} // namespace apex
+
+#endif
@@ -5,7 +5,7 @@
 
 namespace apex {
 ParticleEmitterControl::ParticleEmitterControl(Camera *camera, const ParticleConstructionInfo &info)
-    : EntityControl(60.0),
+    : EntityControl(60.0, true),
       m_camera(camera)
 {
     m_particle_renderer.reset(new ParticleRenderer(info));
@@ -197,17 +197,7 @@ void ParticleRenderer::Render()
     // draw particles
     CoreEngine::GetInstance()->DrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, m_particles->size());
 
-    // reset changes
-    CoreEngine::GetInstance()->BindBuffer(GL_ARRAY_BUFFER, 0);
-
-    CoreEngine::GetInstance()->VertexAttribDivisor(0, 0);
-    CoreEngine::GetInstance()->VertexAttribDivisor(1, 0);
-    CoreEngine::GetInstance()->VertexAttribDivisor(2, 0);
-    CoreEngine::GetInstance()->VertexAttribDivisor(3, 0);
-
-    CoreEngine::GetInstance()->BindVertexArray(0);
-
-    CoreEngine::GetInstance()->Disable(GL_BLEND);
-    CoreEngine::GetInstance()->DepthMask(true);
+    // nothing is reset: the divisors belong to this vertex array, and the
+    // renderer sets the blending and depth state again before its next draw
 }
 } // namespace apex
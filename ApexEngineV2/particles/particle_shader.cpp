@@ -29,15 +29,17 @@ void ParticleShader::ApplyMaterial(const Material &mat)
 {
     int texture_index = 1;
 
-    for (auto it = mat.textures.begin(); it != mat.textures.end(); it++) {
-        if (it->second == nullptr) {
+    for (const Material::TextureEntry &entry : mat.GetTextures()) {
+        if (entry.texture == nullptr) {
             continue;
         }
 
+        const std::string &name = Material::GetKeyName(entry.key);
+
         Texture::ActiveTexture(texture_index);
-        it->second->Begin();
-        SetUniform(it->first, texture_index);
-        SetUniform(std::string("Has") + it->first, 1);
+        entry.texture->Begin();
+        SetUniform(name, texture_index);
+        SetUniform(std::string("Has") + name, 1);
 
         texture_index++;
     }
@@ -1,6 +1,7 @@
 #include "physics_manager.h"
 #include "collision_list.h"
 #include "../rendering/environment.h"
+#include "../profiler.h"
 
 #include "btBulletDynamicsCommon.h"
 
@@ -75,6 +76,8 @@ void PhysicsManager::UnregisterBody(physics::RigidBody *body)
 
 void PhysicsManager::RunPhysics(double dt)
 {
+    APEX_PROFILE_SCOPE("PhysicsManager::RunPhysics");
+
     m_dynamics_world->stepSimulation(dt);
 }
 
@@ -85,7 +85,7 @@ static Matrix3 CalculateInverseInertiaWorldMatrix(const Matrix3 &iit_body, const
 }
 
 RigidBody::RigidBody(std::shared_ptr<PhysicsShape> shape, PhysicsMaterial material)
-    : EntityControl(60.0),
+    : EntityControl(60.0, true),
       m_shape(shape),
       m_material(material),
       m_awake(true),
@@ -0,0 +1,180 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <fstream>
+#include <iomanip>
+
+namespace apex {
+
+static void WriteJsonString(std::ofstream &out, const char *str)
+{
+    out << '"';
+
+    for (const char *c = str; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\') {
+            out << '\\';
+        }
+
+        out << *c;
+    }
+
+    out << '"';
+}
+
+Profiler *Profiler::instance = nullptr;
+
+Profiler *Profiler::GetInstance()
+{
+    if (instance == nullptr) {
+        instance = new Profiler();
+    }
+
+    return instance;
+}
+
+Profiler::Profiler()
+    : m_epoch(std::chrono::steady_clock::now()),
+      m_main_thread(std::this_thread::get_id()),
+      m_frame_start(0),
+      m_frame_ms(0.0),
+      m_frame_index(0)
+{
+}
+
+Profiler::ThreadBuffer *Profiler::GetThreadBuffer()
+{
+    static thread_local ThreadBuffer *buffer = nullptr;
+
+    if (buffer == nullptr) {
+        std::lock_guard<std::mutex> lock(m_buffers_mutex);
+
+        m_buffers.push_back(std::unique_ptr<ThreadBuffer>(new ThreadBuffer(uint32_t(m_buffers.size()))));
+        m_buffers.back()->is_main_thread = (std::this_thread::get_id() == m_main_thread);
+        buffer = m_buffers.back().get();
+    }
+
+    return buffer;
+}
+
+void Profiler::Pop(const char *name, uint64_t start)
+{
+    ThreadBuffer *buffer = GetThreadBuffer();
+
+    buffer->depth--;
+
+    const size_t index = buffer->num_written.load(std::memory_order_relaxed);
+
+    buffer->events[index % PROFILER_THREAD_CAPACITY] = { name, start, Now(), buffer->depth };
+    buffer->num_written.store(index + 1, std::memory_order_release);
+}
+
+void Profiler::BeginFrame()
+{
+    m_frame_start = Now();
+}
+
+void Profiler::EndFrame()
+{
+    const uint64_t frame_end = Now();
+
+    m_frame_ms = double(frame_end - m_frame_start) / 1000000.0;
+    m_frame_index++;
+
+    // gather this frame's scopes from every thread
+    std::vector<std::pair<uint32_t, Event>> events;
+
+    {
+        std::lock_guard<std::mutex> lock(m_buffers_mutex);
+
+        for (auto &buffer : m_buffers) {
+            const size_t num_written = buffer->num_written.load(std::memory_order_acquire);
+            const size_t count = std::min(num_written, size_t(PROFILER_THREAD_CAPACITY));
+
+            for (size_t i = num_written - count; i < num_written; i++) {
+                const Event &event = buffer->events[i % PROFILER_THREAD_CAPACITY];
+
+                if (event.start >= m_frame_start) {
+                    events.push_back({ buffer->thread_index, event });
+                }
+            }
+        }
+    }
+
+    // scopes are written as they close, so children come before their parents
+    std::sort(events.begin(), events.end(), [](const std::pair<uint32_t, Event> &a, const std::pair<uint32_t, Event> &b) {
+        return a.first != b.first ? a.first < b.first : a.second.start < b.second.start;
+    });
+
+    m_aggregates.clear();
+
+    std::unordered_map<std::string, size_t> indices;
+
+    for (const auto &it : events) {
+        const Event &event = it.second;
+        const double ms = double(event.end - event.start) / 1000000.0;
+
+        std::string key(event.name);
+        key += '#';
+        key += std::to_string(event.depth);
+
+        auto index_it = indices.find(key);
+
+        if (index_it == indices.end()) {
+            index_it = indices.insert({ key, m_aggregates.size() }).first;
+            m_aggregates.push_back({ event.name, event.depth, 0, 0.0, 0.0 });
+        }
+
+        Aggregate &aggregate = m_aggregates[index_it->second];
+        aggregate.calls++;
+        aggregate.total_ms += ms;
+        aggregate.max_ms = std::max(aggregate.max_ms, ms);
+    }
+
+    m_frame_start = frame_end;
+}
+
+bool Profiler::WriteChromeTrace(const std::string &path) const
+{
+    std::ofstream out(path);
+
+    if (!out.is_open()) {
+        return false;
+    }
+
+    out << std::fixed << std::setprecision(3);
+    out << "{\"traceEvents\":[\n";
+
+    bool first = true;
+
+    std::lock_guard<std::mutex> lock(m_buffers_mutex);
+
+    for (auto &buffer : m_buffers) {
+        out << (first ? "" : ",\n");
+        out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->thread_index
+            << ",\"args\":{\"name\":\"" << (buffer->is_main_thread ? "main" : "worker")
+            << "\"}}";
+
+        first = false;
+
+        const size_t num_written = buffer->num_written.load(std::memory_order_acquire);
+        const size_t count = std::min(num_written, size_t(PROFILER_THREAD_CAPACITY));
+
+        for (size_t i = num_written - count; i < num_written; i++) {
+            const Event &event = buffer->events[i % PROFILER_THREAD_CAPACITY];
+
+            // timestamps are in microseconds
+            out << ",\n{\"name\":";
+            WriteJsonString(out, event.name);
+            out << ",\"cat\":\"apex\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->thread_index
+                << ",\"ts\":" << double(event.start) / 1000.0
+                << ",\"dur\":" << double(event.end - event.start) / 1000.0 << "}";
+        }
+    }
+
+    out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+    return out.good();
+}
+
+} // namespace apex
@@ -0,0 +1,141 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <cstdint>
+#include <cstddef>
+
+// set to 0 to compile every APEX_PROFILE_* macro out
+#define APEX_PROFILING 1
+// number of scopes each thread keeps before the oldest are overwritten
+#define PROFILER_THREAD_CAPACITY 16384
+
+#define APEX_PROFILE_CONCAT_IMPL(a, b) a##b
+#define APEX_PROFILE_CONCAT(a, b) APEX_PROFILE_CONCAT_IMPL(a, b)
+
+#if APEX_PROFILING
+// name must be a string literal (or otherwise outlive the profiler)
+#define APEX_PROFILE_SCOPE(name) ::apex::ProfileScope APEX_PROFILE_CONCAT(_profile_scope_, __LINE__)(name)
+#define APEX_PROFILE_FUNCTION() APEX_PROFILE_SCOPE(__func__)
+#define APEX_PROFILE_BEGIN_FRAME() ::apex::Profiler::GetInstance()->BeginFrame()
+#define APEX_PROFILE_END_FRAME() ::apex::Profiler::GetInstance()->EndFrame()
+#else
+#define APEX_PROFILE_SCOPE(name)
+#define APEX_PROFILE_FUNCTION()
+#define APEX_PROFILE_BEGIN_FRAME()
+#define APEX_PROFILE_END_FRAME()
+#endif
+
+namespace apex {
+
+// Collects timed, nested scopes from every thread.
+// Each thread writes to its own ring buffer without locking, so the cost of a
+// scope is two clock reads and a store. EndFrame() aggregates the scopes of the
+// frame that just finished; WriteChromeTrace() exports everything still in the
+// buffers as a chrome://tracing (trace_event) JSON file.
+// NOTE: EndFrame() and WriteChromeTrace() read other threads' buffers, so they
+// must be called while no worker thread is inside a scope (e.g between frames).
+class Profiler {
+public:
+    struct Event {
+        const char *name;
+        uint64_t start; // nanoseconds since the profiler was created
+        uint64_t end;
+        uint32_t depth;
+    };
+
+    struct Aggregate {
+        std::string name;
+        uint32_t depth;
+        size_t calls;
+        double total_ms;
+        double max_ms;
+    };
+
+    static Profiler *instance;
+    static Profiler *GetInstance();
+
+    Profiler();
+    Profiler(const Profiler &other) = delete;
+
+    void BeginFrame();
+    void EndFrame();
+
+    // scopes of the last finished frame, merged by name and depth, in the order first seen
+    inline const std::vector<Aggregate> &GetFrameAggregates() const { return m_aggregates; }
+    inline double GetFrameTime() const { return m_frame_ms; }
+    inline size_t GetFrameIndex() const { return m_frame_index; }
+
+    bool WriteChromeTrace(const std::string &path) const;
+
+    inline uint64_t Now() const
+    {
+        return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - m_epoch).count());
+    }
+
+    // used by ProfileScope
+    inline void Push() { GetThreadBuffer()->depth++; }
+    void Pop(const char *name, uint64_t start);
+
+private:
+    struct ThreadBuffer {
+        std::vector<Event> events;
+        std::atomic<size_t> num_written; // total, the ring index is num_written % capacity
+        uint32_t depth;
+        uint32_t thread_index;
+        bool is_main_thread;
+
+        ThreadBuffer(uint32_t thread_index)
+            : events(PROFILER_THREAD_CAPACITY),
+              num_written(0),
+              depth(0),
+              thread_index(thread_index),
+              is_main_thread(false)
+        {
+        }
+    };
+
+    std::chrono::steady_clock::time_point m_epoch;
+    std::thread::id m_main_thread; // the thread that created the profiler
+    std::vector<std::unique_ptr<ThreadBuffer>> m_buffers;
+    mutable std::mutex m_buffers_mutex;
+    std::vector<Aggregate> m_aggregates;
+    uint64_t m_frame_start;
+    double m_frame_ms;
+    size_t m_frame_index;
+
+    ThreadBuffer *GetThreadBuffer();
+};
+
+class ProfileScope {
+public:
+    inline ProfileScope(const char *name)
+        : m_name(name),
+          m_start(Profiler::GetInstance()->Now())
+    {
+        Profiler::GetInstance()->Push();
+    }
+
+    inline ~ProfileScope()
+    {
+        Profiler::GetInstance()->Pop(m_name, m_start);
+    }
+
+    ProfileScope(const ProfileScope &other) = delete;
+    ProfileScope &operator=(const ProfileScope &other) = delete;
+
+private:
+    const char *m_name;
+    uint64_t m_start;
+};
+
+} // namespace apex
+
+#endif
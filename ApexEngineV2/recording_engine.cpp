@@ -0,0 +1,515 @@
+#include "recording_engine.h"
+
+namespace apex {
+
+RecordingEngine::FrameCounts &RecordingEngine::FrameCounts::operator+=(const FrameCounts &other)
+{
+    draw_calls += other.draw_calls;
+    instances += other.instances;
+    indices += other.indices;
+    program_binds += other.program_binds;
+    texture_binds += other.texture_binds;
+    buffer_binds += other.buffer_binds;
+    vertex_array_binds += other.vertex_array_binds;
+    framebuffer_binds += other.framebuffer_binds;
+    state_changes += other.state_changes;
+    uniform_uploads += other.uniform_uploads;
+    buffer_uploads += other.buffer_uploads;
+    texture_uploads += other.texture_uploads;
+    bytes_uploaded += other.bytes_uploaded;
+    commands += other.commands;
+
+    return *this;
+}
+
+RecordingEngine::RecordingEngine(size_t num_frames, double frame_time, bool keep_commands)
+    : NullEngine(num_frames, frame_time),
+      m_keep_commands(keep_commands),
+      m_num_recorded_frames(0)
+{
+}
+
+void RecordingEngine::Reset()
+{
+    m_commands.clear();
+    m_current_counts = FrameCounts();
+    m_last_counts = FrameCounts();
+    m_total_counts = FrameCounts();
+    m_num_recorded_frames = 0;
+}
+
+void RecordingEngine::BeginFrame()
+{
+    // anything recorded between frames (e.g loading) is not part of a frame
+    m_commands.clear();
+    m_current_counts = FrameCounts();
+}
+
+void RecordingEngine::EndFrame()
+{
+    m_last_counts = m_current_counts;
+    m_total_counts += m_current_counts;
+    m_num_recorded_frames++;
+
+    m_render_state.NextFrame();
+}
+
+void RecordingEngine::RecordUniform(int location)
+{
+    Record(COMMAND_UNIFORM, 0, (unsigned int)location);
+    m_current_counts.uniform_uploads++;
+}
+
+void RecordingEngine::RecordState(int target, unsigned int value)
+{
+    Record(COMMAND_STATE, target, value);
+    m_current_counts.state_changes++;
+}
+
+size_t RecordingEngine::TextureDataSize(size_t width, size_t height, int fmt, int type)
+{
+    size_t num_components;
+
+    switch (fmt) {
+    case RGB:
+    case 0x80E0: // BGR
+        num_components = 3;
+        break;
+    case RGBA:
+    case 0x80E1: // BGRA
+        num_components = 4;
+        break;
+    case 0x8227: // RG
+        num_components = 2;
+        break;
+    default: // RED, ALPHA, DEPTH_COMPONENT
+        num_components = 1;
+        break;
+    }
+
+    size_t component_size;
+
+    switch (type) {
+    case BYTE:
+    case UNSIGNED_BYTE:
+        component_size = 1;
+        break;
+    case SHORT:
+    case UNSIGNED_SHORT:
+    case HALF_FLOAT:
+        component_size = 2;
+        break;
+    default:
+        component_size = 4;
+        break;
+    }
+
+    return width * height * num_components * component_size;
+}
+
+void RecordingEngine::Viewport(int x, int y, size_t width, size_t height)
+{
+    if (!m_render_state.SetViewport(x, y, width, height)) {
+        return;
+    }
+
+    Record(COMMAND_VIEWPORT, 0, 0, width * height);
+}
+
+void RecordingEngine::Clear(int mask)
+{
+    Record(COMMAND_CLEAR, mask);
+}
+
+void RecordingEngine::Enable(int cap)
+{
+    if (!m_render_state.SetCapability(cap, true)) {
+        return;
+    }
+
+    RecordState(cap, 1);
+}
+
+void RecordingEngine::Disable(int cap)
+{
+    if (!m_render_state.SetCapability(cap, false)) {
+        return;
+    }
+
+    RecordState(cap, 0);
+}
+
+void RecordingEngine::DepthMask(bool mask)
+{
+    if (!m_render_state.SetDepthMask(mask)) {
+        return;
+    }
+
+    RecordState(0x0B72 /* DEPTH_WRITEMASK */, mask);
+}
+
+void RecordingEngine::BlendFunc(int src, int dst)
+{
+    if (!m_render_state.SetBlendFunc(src, dst)) {
+        return;
+    }
+
+    RecordState(src, (unsigned int)dst);
+}
+
+void RecordingEngine::CullFace(int mode)
+{
+    if (!m_render_state.SetCullFace(mode)) {
+        return;
+    }
+
+    RecordState(CULL_FACE, (unsigned int)mode);
+}
+
+void RecordingEngine::GenBuffers(size_t count, unsigned int *buffers)
+{
+    NullEngine::GenBuffers(count, buffers);
+    Record(COMMAND_CREATE, ARRAY_BUFFER, 0, count);
+}
+
+void RecordingEngine::DeleteBuffers(size_t count, unsigned int *buffers)
+{
+    m_render_state.OnDeleteBuffers(count, buffers);
+    Record(COMMAND_DELETE, ARRAY_BUFFER, 0, count);
+}
+
+void RecordingEngine::BindBuffer(int target, unsigned int buffer)
+{
+    if (!m_render_state.SetBuffer(target, buffer)) {
+        return;
+    }
+
+    Record(COMMAND_BIND_BUFFER, target, buffer);
+    m_current_counts.buffer_binds++;
+}
+
+void RecordingEngine::BufferData(int target, size_t size, const void *data, int usage)
+{
+    // allocating without data does not transfer anything
+    const size_t bytes = data != nullptr ? size : 0;
+
+    Record(COMMAND_UPLOAD_BUFFER, target, 0, bytes);
+    m_current_counts.buffer_uploads++;
+    m_current_counts.bytes_uploaded += bytes;
+}
+
+void RecordingEngine::BufferSubData(int target, size_t offset, size_t size, const void *data)
+{
+    Record(COMMAND_UPLOAD_BUFFER, target, 0, size);
+    m_current_counts.buffer_uploads++;
+    m_current_counts.bytes_uploaded += size;
+}
+
+void RecordingEngine::BindVertexArray(unsigned int target)
+{
+    if (!m_render_state.SetVertexArray(target)) {
+        return;
+    }
+
+    Record(COMMAND_BIND_VERTEX_ARRAY, 0, target);
+    m_current_counts.vertex_array_binds++;
+}
+
+void RecordingEngine::GenVertexArrays(size_t size, unsigned int *arrays)
+{
+    NullEngine::GenVertexArrays(size, arrays);
+    Record(COMMAND_CREATE, 0, 0, size);
+}
+
+void RecordingEngine::DeleteVertexArrays(size_t size, const unsigned int *arrays)
+{
+    m_render_state.OnDeleteVertexArrays(size, arrays);
+    Record(COMMAND_DELETE, 0, 0, size);
+}
+
+void RecordingEngine::EnableVertexAttribArray(unsigned int index)
+{
+    Record(COMMAND_OTHER, 0, index);
+}
+
+void RecordingEngine::DisableVertexAttribArray(unsigned int index)
+{
+    Record(COMMAND_OTHER, 0, index);
+}
+
+void RecordingEngine::VertexAttribPointer(unsigned int index, int size, int type, bool normalized, size_t stride, void *ptr)
+{
+    Record(COMMAND_OTHER, type, index);
+}
+
+void RecordingEngine::DrawElements(int mode, size_t count, int type, const void *indices)
+{
+    Record(COMMAND_DRAW, mode, (unsigned int)count, 1);
+    m_current_counts.draw_calls++;
+    m_current_counts.instances++;
+    m_current_counts.indices += count;
+}
+
+void RecordingEngine::MultiDrawElements(int mode, const int *counts, int type, const void *const *indices, size_t drawcount)
+{
+    size_t count = 0;
+
+    for (size_t i = 0; i < drawcount; i++) {
+        count += size_t(counts[i]);
+    }
+
+    // one command, as the driver sees it
+    Record(COMMAND_DRAW, mode, (unsigned int)count, 1);
+    m_current_counts.draw_calls++;
+    m_current_counts.instances++;
+    m_current_counts.indices += count;
+}
+
+void RecordingEngine::GenTextures(size_t n, unsigned int *textures)
+{
+    NullEngine::GenTextures(n, textures);
+    Record(COMMAND_CREATE, TEXTURE, 0, n);
+}
+
+void RecordingEngine::DeleteTextures(size_t n, const unsigned int *textures)
+{
+    m_render_state.OnDeleteTextures(n, textures);
+    Record(COMMAND_DELETE, TEXTURE, 0, n);
+}
+
+void RecordingEngine::TexParameteri(int target, int pname, int param)
+{
+    Record(COMMAND_OTHER, target, (unsigned int)pname);
+}
+
+void RecordingEngine::TexParameterf(int target, int pname, float param)
+{
+    Record(COMMAND_OTHER, target, (unsigned int)pname);
+}
+
+void RecordingEngine::TexImage2D(int target, int level, int ifmt, size_t width, size_t height,
+    int border, int fmt, int type, const void *data)
+{
+    // allocating storage without data does not transfer anything
+    const size_t bytes = data != nullptr ? TextureDataSize(width, height, fmt, type) : 0;
+
+    Record(COMMAND_UPLOAD_TEXTURE, target, 0, bytes);
+    m_current_counts.texture_uploads++;
+    m_current_counts.bytes_uploaded += bytes;
+}
+
+void RecordingEngine::CopyTexImage2D(int target, int level, int ifmt, int x, int y,
+    size_t width, size_t height, int border)
+{
+    // copied on the gpu, so no bytes are uploaded
+    Record(COMMAND_UPLOAD_TEXTURE, target);
+    m_current_counts.texture_uploads++;
+}
+
+void RecordingEngine::TexImage3D(int target, int level, int ifmt, size_t width, size_t height, size_t depth,
+    int border, int fmt, int type, const void *data)
+{
+    const size_t bytes = data != nullptr ? TextureDataSize(width, height, fmt, type) * depth : 0;
+
+    Record(COMMAND_UPLOAD_TEXTURE, target, 0, bytes);
+    m_current_counts.texture_uploads++;
+    m_current_counts.bytes_uploaded += bytes;
+}
+
+void RecordingEngine::TexSubImage3D(int target, int level, int x, int y, int z, size_t width, size_t height, size_t depth,
+    int fmt, int type, const void *data)
+{
+    const size_t bytes = TextureDataSize(width, height, fmt, type) * depth;
+
+    Record(COMMAND_UPLOAD_TEXTURE, target, 0, bytes);
+    m_current_counts.texture_uploads++;
+    m_current_counts.bytes_uploaded += bytes;
+}
+
+void RecordingEngine::GetTexImage(int target, int level, int fmt, int type, void *pixels)
+{
+    Record(COMMAND_OTHER, target, (unsigned int)level);
+}
+
+void RecordingEngine::BindTexture(int target, unsigned int texture)
+{
+    if (!m_render_state.SetTexture(target, texture)) {
+        return;
+    }
+
+    Record(COMMAND_BIND_TEXTURE, target, texture);
+    m_current_counts.texture_binds++;
+}
+
+void RecordingEngine::ActiveTexture(int i)
+{
+    if (!m_render_state.SetActiveTexture(i)) {
+        return;
+    }
+
+    RecordState(ACTIVE_TEXTURE, (unsigned int)i);
+}
+
+void RecordingEngine::GenerateMipmap(int target)
+{
+    Record(COMMAND_OTHER, target);
+}
+
+void RecordingEngine::GenFramebuffers(size_t n, unsigned int *ids)
+{
+    NullEngine::GenFramebuffers(n, ids);
+    Record(COMMAND_CREATE, FRAMEBUFFER, 0, n);
+}
+
+void RecordingEngine::DeleteFramebuffers(size_t n, const unsigned int *ids)
+{
+    Record(COMMAND_DELETE, FRAMEBUFFER, 0, n);
+}
+
+void RecordingEngine::BindFramebuffer(int target, unsigned int framebuffer)
+{
+    Record(COMMAND_BIND_FRAMEBUFFER, target, framebuffer);
+    m_current_counts.framebuffer_binds++;
+}
+
+void RecordingEngine::FramebufferTexture(int target, int attachment, unsigned int texture, int level)
+{
+    Record(COMMAND_OTHER, attachment, texture);
+}
+
+void RecordingEngine::FramebufferTexture2D(int target, int attachment, int texture_target, unsigned int texture, int level)
+{
+    Record(COMMAND_OTHER, attachment, texture);
+}
+
+void RecordingEngine::DrawBuffers(size_t n, const unsigned int *bufs)
+{
+    Record(COMMAND_OTHER, 0, 0, n);
+}
+
+void RecordingEngine::ReadBuffer(int mode)
+{
+    Record(COMMAND_OTHER, mode);
+}
+
+unsigned int RecordingEngine::CreateProgram()
+{
+    const unsigned int program = NullEngine::CreateProgram();
+    Record(COMMAND_CREATE, 0, program);
+
+    return program;
+}
+
+unsigned int RecordingEngine::CreateShader(int type)
+{
+    const unsigned int shader = NullEngine::CreateShader(type);
+    Record(COMMAND_CREATE, type, shader);
+
+    return shader;
+}
+
+void RecordingEngine::DeleteProgram(unsigned int program)
+{
+    m_render_state.OnDeleteProgram(program);
+    Record(COMMAND_DELETE, 0, program);
+}
+
+void RecordingEngine::DeleteShader(unsigned int shader)
+{
+    Record(COMMAND_DELETE, 0, shader);
+}
+
+void RecordingEngine::UseProgram(unsigned int program)
+{
+    if (!m_render_state.SetProgram(program)) {
+        return;
+    }
+
+    Record(COMMAND_BIND_PROGRAM, 0, program);
+    m_current_counts.program_binds++;
+}
+
+void RecordingEngine::UniformBlockBinding(unsigned int program, unsigned int index, unsigned int binding)
+{
+    Record(COMMAND_OTHER, 0, binding);
+}
+
+void RecordingEngine::BindBufferBase(int target, unsigned int index, unsigned int buffer)
+{
+    m_render_state.OnBindBufferBase(target, buffer);
+    Record(COMMAND_BIND_BUFFER, target, buffer);
+    m_current_counts.buffer_binds++;
+}
+
+void RecordingEngine::Uniform1f(int location, float v0)
+{
+    RecordUniform(location);
+}
+
+void RecordingEngine::Uniform2f(int location, float v0, float v1)
+{
+    RecordUniform(location);
+}
+
+void RecordingEngine::Uniform3f(int location, float v0, float v1, float v2)
+{
+    RecordUniform(location);
+}
+
+void RecordingEngine::Uniform4f(int location, float v0, float v1, float v2, float v3)
+{
+    RecordUniform(location);
+}
+
+void RecordingEngine::Uniform1i(int location, int v0)
+{
+    RecordUniform(location);
+}
+
+void RecordingEngine::Uniform2i(int location, int v0, int v1)
+{
+    RecordUniform(location);
+}
+
+void RecordingEngine::Uniform3i(int location, int v0, int v1, int v2)
+{
+    RecordUniform(location);
+}
+
+void RecordingEngine::Uniform4i(int location, int v0, int v1, int v2, int v3)
+{
+    RecordUniform(location);
+}
+
+void RecordingEngine::UniformMatrix4fv(int location, int count, bool transpose, const float *value)
+{
+    RecordUniform(location);
+}
+
+void RecordingEngine::VertexAttribDivisor(unsigned int index, unsigned int divisor)
+{
+    Record(COMMAND_OTHER, 0, index);
+}
+
+void RecordingEngine::DrawArraysInstanced(int mode, int first, size_t count, size_t primcount)
+{
+    Record(COMMAND_DRAW, mode, (unsigned int)count, primcount);
+    m_current_counts.draw_calls++;
+    m_current_counts.instances += primcount;
+}
+
+void RecordingEngine::DrawElementsInstanced(int mode, size_t count, int type, const void *indices, size_t primcount)
+{
+    Record(COMMAND_DRAW, mode, (unsigned int)count, primcount);
+    m_current_counts.draw_calls++;
+    m_current_counts.instances += primcount;
+    m_current_counts.indices += count * primcount;
+}
+
+void RecordingEngine::BindImageTexture(unsigned int unit, unsigned int texture, int level, bool layered, int layer, unsigned int access, unsigned int format)
+{
+    Record(COMMAND_BIND_TEXTURE, 0, texture);
+    m_current_counts.texture_binds++;
+}
+
+} // namespace apex
@@ -0,0 +1,166 @@
+#ifndef RECORDING_ENGINE_H
+#define RECORDING_ENGINE_H
+
+#include "null_engine.h"
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace apex {
+
+// Headless engine that records every GL call made during a frame as a compact
+// command, and counts draws, binds, state changes and uploads per frame.
+// Calls that CoreEngine's RenderState finds redundant are not recorded, as they
+// never reach a real driver; RenderState counts them as elided instead.
+class RecordingEngine : public NullEngine {
+public:
+    enum CommandType : uint8_t {
+        COMMAND_DRAW,
+        COMMAND_BIND_PROGRAM,
+        COMMAND_BIND_TEXTURE,
+        COMMAND_BIND_BUFFER,
+        COMMAND_BIND_VERTEX_ARRAY,
+        COMMAND_BIND_FRAMEBUFFER,
+        COMMAND_UPLOAD_BUFFER,
+        COMMAND_UPLOAD_TEXTURE,
+        COMMAND_UNIFORM,
+        COMMAND_STATE,
+        COMMAND_CLEAR,
+        COMMAND_VIEWPORT,
+        COMMAND_CREATE,
+        COMMAND_DELETE,
+        COMMAND_OTHER
+    };
+
+    struct Command {
+        CommandType type;
+        int target; // GL target, cap or mode
+        unsigned int object; // bound object, uniform location or draw element count
+        size_t size; // bytes uploaded, or instances drawn
+    };
+
+    struct FrameCounts {
+        size_t draw_calls = 0;
+        size_t instances = 0;
+        size_t indices = 0; // drawn by indexed draws, once per instance
+        size_t program_binds = 0;
+        size_t texture_binds = 0;
+        size_t buffer_binds = 0;
+        size_t vertex_array_binds = 0;
+        size_t framebuffer_binds = 0;
+        size_t state_changes = 0;
+        size_t uniform_uploads = 0;
+        size_t buffer_uploads = 0;
+        size_t texture_uploads = 0;
+        size_t bytes_uploaded = 0; // buffer and texture data only
+        size_t commands = 0;
+
+        FrameCounts &operator+=(const FrameCounts &other);
+    };
+
+    // keep_commands can be turned off to only gather counts
+    RecordingEngine(size_t num_frames = 1, double frame_time = 1.0 / 60.0, bool keep_commands = true);
+    virtual ~RecordingEngine() = default;
+
+    // commands of the frame in progress, or of the last frame once it has ended
+    inline const std::vector<Command> &GetCommands() const { return m_commands; }
+    inline const FrameCounts &GetCurrentCounts() const { return m_current_counts; }
+    inline const FrameCounts &GetLastFrameCounts() const { return m_last_counts; }
+    inline const FrameCounts &GetTotalCounts() const { return m_total_counts; }
+    inline size_t NumRecordedFrames() const { return m_num_recorded_frames; }
+    void Reset();
+
+    virtual void BeginFrame() override;
+    virtual void EndFrame() override;
+
+    virtual void Viewport(int x, int y, size_t width, size_t height) override;
+    virtual void Clear(int mask) override;
+    virtual void Enable(int cap) override;
+    virtual void Disable(int cap) override;
+    virtual void DepthMask(bool mask) override;
+    virtual void BlendFunc(int src, int dst) override;
+    virtual void CullFace(int mode) override;
+    virtual void GenBuffers(size_t count, unsigned int *buffers) override;
+    virtual void DeleteBuffers(size_t count, unsigned int *buffers) override;
+    virtual void BindBuffer(int target, unsigned int buffer) override;
+    virtual void BufferData(int target, size_t size, const void *data, int usage) override;
+    virtual void BufferSubData(int target, size_t offset, size_t size, const void *data) override;
+    virtual void BindVertexArray(unsigned int target) override;
+    virtual void GenVertexArrays(size_t size, unsigned int *arrays) override;
+    virtual void DeleteVertexArrays(size_t size, const unsigned int *arrays) override;
+    virtual void EnableVertexAttribArray(unsigned int index) override;
+    virtual void DisableVertexAttribArray(unsigned int index) override;
+    virtual void VertexAttribPointer(unsigned int index, int size, int type, bool normalized, size_t stride, void *ptr) override;
+    virtual void DrawElements(int mode, size_t count, int type, const void *indices) override;
+    virtual void MultiDrawElements(int mode, const int *counts, int type, const void *const *indices, size_t drawcount) override;
+    virtual void GenTextures(size_t n, unsigned int *textures) override;
+    virtual void DeleteTextures(size_t n, const unsigned int *textures) override;
+    virtual void TexParameteri(int target, int pname, int param) override;
+    virtual void TexParameterf(int target, int pname, float param) override;
+    virtual void TexImage2D(int target, int level, int ifmt, size_t width, size_t height,
+        int border, int fmt, int type, const void *data) override;
+    virtual void CopyTexImage2D(int target, int level, int ifmt, int x, int y,
+        size_t width, size_t height, int border) override;
+    virtual void TexImage3D(int target, int level, int ifmt, size_t width, size_t height, size_t depth,
+        int border, int fmt, int type, const void *data) override;
+    virtual void TexSubImage3D(int target, int level, int x, int y, int z, size_t width, size_t height, size_t depth,
+        int fmt, int type, const void *data) override;
+    virtual void GetTexImage(int target, int level, int fmt, int type, void *pixels) override;
+    virtual void BindTexture(int target, unsigned int texture) override;
+    virtual void ActiveTexture(int i) override;
+    virtual void GenerateMipmap(int target) override;
+    virtual void GenFramebuffers(size_t n, unsigned int *ids) override;
+    virtual void DeleteFramebuffers(size_t n, const unsigned int *ids) override;
+    virtual void BindFramebuffer(int target, unsigned int framebuffer) override;
+    virtual void FramebufferTexture(int target, int attachment, unsigned int texture, int level) override;
+    virtual void FramebufferTexture2D(int target, int attachment, int texture_target, unsigned int texture, int level) override;
+    virtual void DrawBuffers(size_t n, const unsigned int *bufs) override;
+    virtual void ReadBuffer(int mode) override;
+    virtual unsigned int CreateProgram() override;
+    virtual unsigned int CreateShader(int type) override;
+    virtual void DeleteProgram(unsigned int program) override;
+    virtual void DeleteShader(unsigned int shader) override;
+    virtual void UseProgram(unsigned int program) override;
+    virtual void UniformBlockBinding(unsigned int program, unsigned int index, unsigned int binding) override;
+    virtual void BindBufferBase(int target, unsigned int index, unsigned int buffer) override;
+    virtual void Uniform1f(int location, float v0) override;
+    virtual void Uniform2f(int location, float v0, float v1) override;
+    virtual void Uniform3f(int location, float v0, float v1, float v2) override;
+    virtual void Uniform4f(int location, float v0, float v1, float v2, float v3) override;
+    virtual void Uniform1i(int location, int v0) override;
+    virtual void Uniform2i(int location, int v0, int v1) override;
+    virtual void Uniform3i(int location, int v0, int v1, int v2) override;
+    virtual void Uniform4i(int location, int v0, int v1, int v2, int v3) override;
+    virtual void UniformMatrix4fv(int location, int count, bool transpose, const float *value) override;
+    virtual void VertexAttribDivisor(unsigned int index, unsigned int divisor) override;
+    virtual void DrawArraysInstanced(int mode, int first, size_t count, size_t primcount) override;
+    virtual void DrawElementsInstanced(int mode, size_t count, int type, const void *indices, size_t primcount) override;
+    virtual void BindImageTexture(unsigned int unit, unsigned int texture, int level, bool layered, int layer, unsigned int access, unsigned int format) override;
+
+private:
+    bool m_keep_commands;
+    std::vector<Command> m_commands;
+    FrameCounts m_current_counts;
+    FrameCounts m_last_counts;
+    FrameCounts m_total_counts;
+    size_t m_num_recorded_frames;
+
+    inline void Record(CommandType type, int target = 0, unsigned int object = 0, size_t size = 0)
+    {
+        if (m_keep_commands) {
+            m_commands.push_back({ type, target, object, size });
+        }
+
+        m_current_counts.commands++;
+    }
+
+    void RecordUniform(int location);
+    void RecordState(int target, unsigned int value);
+
+    static size_t TextureDataSize(size_t width, size_t height, int fmt, int type);
+};
+
+} // namespace apex
+
+#endif
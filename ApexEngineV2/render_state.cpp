@@ -0,0 +1,290 @@
+#include "render_state.h"
+#include "core_engine.h"
+
+namespace apex {
+
+RenderState::Counts &RenderState::Counts::operator+=(const Counts &other)
+{
+    issued += other.issued;
+    elided += other.elided;
+
+    return *this;
+}
+
+RenderState::RenderState()
+{
+    Invalidate();
+}
+
+void RenderState::NextFrame()
+{
+    m_last_counts = m_current_counts;
+    m_total_counts += m_current_counts;
+    m_current_counts = Counts();
+}
+
+void RenderState::Invalidate()
+{
+    for (int &capability : m_capabilities) {
+        capability = UNKNOWN;
+    }
+
+    m_depth_mask = UNKNOWN;
+    m_blend_src = UNKNOWN;
+    m_blend_dst = UNKNOWN;
+    m_cull_face = UNKNOWN;
+
+    for (int &value : m_viewport) {
+        value = UNKNOWN;
+    }
+
+    m_program = UNKNOWN_OBJECT;
+    m_vertex_array = UNKNOWN_OBJECT;
+
+    for (unsigned int &buffer : m_buffers) {
+        buffer = UNKNOWN_OBJECT;
+    }
+
+    m_active_texture = UNKNOWN;
+
+    for (auto &unit : m_textures) {
+        for (unsigned int &texture : unit) {
+            texture = UNKNOWN_OBJECT;
+        }
+    }
+}
+
+bool RenderState::SetCapability(int cap, bool enabled)
+{
+    const int index = CapabilityIndex(cap);
+
+    if (index == UNKNOWN) {
+        return Issue(true);
+    }
+
+    const bool changed = m_capabilities[index] != int(enabled);
+    m_capabilities[index] = int(enabled);
+
+    return Issue(changed);
+}
+
+bool RenderState::SetDepthMask(bool mask)
+{
+    const bool changed = m_depth_mask != int(mask);
+    m_depth_mask = int(mask);
+
+    return Issue(changed);
+}
+
+bool RenderState::SetBlendFunc(int src, int dst)
+{
+    const bool changed = m_blend_src != src || m_blend_dst != dst;
+    m_blend_src = src;
+    m_blend_dst = dst;
+
+    return Issue(changed);
+}
+
+bool RenderState::SetCullFace(int mode)
+{
+    const bool changed = m_cull_face != mode;
+    m_cull_face = mode;
+
+    return Issue(changed);
+}
+
+bool RenderState::SetViewport(int x, int y, size_t width, size_t height)
+{
+    const int viewport[4] = { x, y, int(width), int(height) };
+    bool changed = false;
+
+    for (int i = 0; i < 4; i++) {
+        changed |= m_viewport[i] != viewport[i];
+        m_viewport[i] = viewport[i];
+    }
+
+    return Issue(changed);
+}
+
+bool RenderState::SetProgram(unsigned int program)
+{
+    const bool changed = m_program != program;
+    m_program = program;
+
+    return Issue(changed);
+}
+
+bool RenderState::SetVertexArray(unsigned int vertex_array)
+{
+    const bool changed = m_vertex_array != vertex_array;
+
+    if (changed) {
+        // the element array binding is part of the vertex array
+        m_buffers[BUFFER_ELEMENT_ARRAY] = UNKNOWN_OBJECT;
+    }
+
+    m_vertex_array = vertex_array;
+
+    return Issue(changed);
+}
+
+bool RenderState::SetBuffer(int target, unsigned int buffer)
+{
+    const int index = BufferIndex(target);
+
+    if (index == UNKNOWN) {
+        return Issue(true);
+    }
+
+    const bool changed = m_buffers[index] != buffer;
+    m_buffers[index] = buffer;
+
+    return Issue(changed);
+}
+
+bool RenderState::SetActiveTexture(int i)
+{
+    const int unit = i - CoreEngine::GLEnums::TEXTURE0;
+    const bool changed = m_active_texture != unit;
+    m_active_texture = unit;
+
+    return Issue(changed);
+}
+
+bool RenderState::SetTexture(int target, unsigned int texture)
+{
+    const int index = TextureTargetIndex(target);
+
+    if (index == UNKNOWN) {
+        return Issue(true);
+    }
+
+    if (m_active_texture == UNKNOWN) {
+        // could have been bound to any unit
+        for (auto &unit : m_textures) {
+            unit[index] = UNKNOWN_OBJECT;
+        }
+
+        return Issue(true);
+    }
+
+    if (m_active_texture < 0 || m_active_texture >= RENDER_STATE_MAX_TEXTURE_UNITS) {
+        return Issue(true);
+    }
+
+    unsigned int &bound = m_textures[m_active_texture][index];
+    const bool changed = bound != texture;
+    bound = texture;
+
+    return Issue(changed);
+}
+
+bool RenderState::IsTextureBound(int unit, int target, unsigned int texture) const
+{
+    const int index = TextureTargetIndex(target);
+
+    if (index == UNKNOWN || unit < 0 || unit >= RENDER_STATE_MAX_TEXTURE_UNITS) {
+        return false;
+    }
+
+#if RENDER_STATE_CACHE_ENABLED
+    return m_textures[unit][index] == texture;
+#else
+    return false;
+#endif
+}
+
+void RenderState::OnBindBufferBase(int target, unsigned int buffer)
+{
+    const int index = BufferIndex(target);
+
+    if (index != UNKNOWN) {
+        m_buffers[index] = buffer;
+    }
+}
+
+void RenderState::OnDeleteProgram(unsigned int program)
+{
+    // a program in use is only deleted once it is replaced
+    if (m_program == program) {
+        m_program = UNKNOWN_OBJECT;
+    }
+}
+
+void RenderState::OnDeleteBuffers(size_t count, const unsigned int *buffers)
+{
+    for (size_t i = 0; i < count; i++) {
+        for (unsigned int &buffer : m_buffers) {
+            if (buffer == buffers[i]) {
+                buffer = 0;
+            }
+        }
+    }
+}
+
+void RenderState::OnDeleteVertexArrays(size_t count, const unsigned int *arrays)
+{
+    for (size_t i = 0; i < count; i++) {
+        if (m_vertex_array == arrays[i]) {
+            m_vertex_array = 0;
+            m_buffers[BUFFER_ELEMENT_ARRAY] = UNKNOWN_OBJECT;
+        }
+    }
+}
+
+void RenderState::OnDeleteTextures(size_t count, const unsigned int *textures)
+{
+    for (size_t i = 0; i < count; i++) {
+        for (auto &unit : m_textures) {
+            for (unsigned int &texture : unit) {
+                if (texture == textures[i]) {
+                    texture = 0;
+                }
+            }
+        }
+    }
+}
+
+int RenderState::CapabilityIndex(int cap)
+{
+    switch (cap) {
+    case CoreEngine::GLEnums::BLEND:
+        return CAP_BLEND;
+    case CoreEngine::GLEnums::DEPTH_TEST:
+        return CAP_DEPTH_TEST;
+    case CoreEngine::GLEnums::CULL_FACE:
+        return CAP_CULL_FACE;
+    default:
+        return UNKNOWN;
+    }
+}
+
+int RenderState::BufferIndex(int target)
+{
+    switch (target) {
+    case CoreEngine::GLEnums::ARRAY_BUFFER:
+        return BUFFER_ARRAY;
+    case CoreEngine::GLEnums::ELEMENT_ARRAY_BUFFER:
+        return BUFFER_ELEMENT_ARRAY;
+    case CoreEngine::GLEnums::UNIFORM_BUFFER:
+        return BUFFER_UNIFORM;
+    default:
+        return UNKNOWN;
+    }
+}
+
+int RenderState::TextureTargetIndex(int target)
+{
+    switch (target) {
+    case CoreEngine::GLEnums::TEXTURE_2D:
+        return TEXTURE_TARGET_2D;
+    case CoreEngine::GLEnums::TEXTURE_CUBE_MAP:
+        return TEXTURE_TARGET_CUBE_MAP;
+    case CoreEngine::GLEnums::TEXTURE_2D_ARRAY:
+        return TEXTURE_TARGET_2D_ARRAY;
+    default:
+        return UNKNOWN;
+    }
+}
+
+} // namespace apex
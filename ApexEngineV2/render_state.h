@@ -0,0 +1,106 @@
+#ifndef RENDER_STATE_H
+#define RENDER_STATE_H
+
+#include <stddef.h>
+
+// when 0, state is still tracked but every call is issued
+#define RENDER_STATE_CACHE_ENABLED 1
+#define RENDER_STATE_MAX_TEXTURE_UNITS 32
+
+namespace apex {
+
+// Shadow copy of the GL state set through CoreEngine: the bound program, vertex array,
+// buffers and textures, the active texture unit, blending, depth and face culling, and
+// the viewport. Each Set*() function returns whether the call changes the cached state
+// and so has to be issued, and counts the call as issued or elided.
+// Everything starts out unknown, so the first call to set any state is always issued.
+// Invalidate() must be called whenever GL state is changed without going through CoreEngine.
+class RenderState {
+public:
+    struct Counts {
+        size_t issued = 0;
+        size_t elided = 0;
+
+        Counts &operator+=(const Counts &other);
+    };
+
+    RenderState();
+
+    // counts of the frame in progress, and of the last frame once NextFrame() is called
+    inline const Counts &GetCurrentCounts() const { return m_current_counts; }
+    inline const Counts &GetLastFrameCounts() const { return m_last_counts; }
+    inline const Counts &GetTotalCounts() const { return m_total_counts; }
+    void NextFrame();
+
+    void Invalidate();
+
+    bool SetCapability(int cap, bool enabled);
+    bool SetDepthMask(bool mask);
+    bool SetBlendFunc(int src, int dst);
+    bool SetCullFace(int mode);
+    bool SetViewport(int x, int y, size_t width, size_t height);
+    bool SetProgram(unsigned int program);
+    bool SetVertexArray(unsigned int vertex_array);
+    bool SetBuffer(int target, unsigned int buffer);
+    // i is the enum value, e.g TEXTURE0 + 1
+    bool SetActiveTexture(int i);
+    // binds to the active texture unit
+    bool SetTexture(int target, unsigned int texture);
+    // whether the texture is known to be bound to the unit (an index, not the enum value),
+    // so binding it can be skipped without changing the active unit
+    bool IsTextureBound(int unit, int target, unsigned int texture) const;
+
+    // glBindBufferBase() also binds the buffer to the generic binding point
+    void OnBindBufferBase(int target, unsigned int buffer);
+    // deleted objects are unbound by GL, and their ids may be reused
+    void OnDeleteProgram(unsigned int program);
+    void OnDeleteBuffers(size_t count, const unsigned int *buffers);
+    void OnDeleteVertexArrays(size_t count, const unsigned int *arrays);
+    void OnDeleteTextures(size_t count, const unsigned int *textures);
+
+private:
+    enum { CAP_BLEND, CAP_DEPTH_TEST, CAP_CULL_FACE, CAP_MAX };
+    enum { BUFFER_ARRAY, BUFFER_ELEMENT_ARRAY, BUFFER_UNIFORM, BUFFER_MAX };
+    enum { TEXTURE_TARGET_2D, TEXTURE_TARGET_CUBE_MAP, TEXTURE_TARGET_2D_ARRAY, TEXTURE_TARGET_MAX };
+
+    static const int UNKNOWN = -1;
+    static const unsigned int UNKNOWN_OBJECT = 0xFFFFFFFF;
+
+    int m_capabilities[CAP_MAX]; // 0, 1 or UNKNOWN
+    int m_depth_mask;
+    int m_blend_src, m_blend_dst;
+    int m_cull_face;
+    int m_viewport[4];
+    unsigned int m_program;
+    unsigned int m_vertex_array;
+    unsigned int m_buffers[BUFFER_MAX];
+    int m_active_texture; // unit index, not the enum value
+    unsigned int m_textures[RENDER_STATE_MAX_TEXTURE_UNITS][TEXTURE_TARGET_MAX];
+
+    Counts m_current_counts;
+    Counts m_last_counts;
+    Counts m_total_counts;
+
+    // counts the call, returning whether it has to be issued
+    inline bool Issue(bool changed)
+    {
+#if !RENDER_STATE_CACHE_ENABLED
+        changed = true;
+#endif
+        if (changed) {
+            m_current_counts.issued++;
+        } else {
+            m_current_counts.elided++;
+        }
+
+        return changed;
+    }
+
+    static int CapabilityIndex(int cap);
+    static int BufferIndex(int target);
+    static int TextureTargetIndex(int target);
+};
+
+} // namespace apex
+
+#endif
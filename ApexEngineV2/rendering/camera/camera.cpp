@@ -26,6 +26,8 @@ void Camera::Rotate(const Vector3 &axis, float radians)
 
 void Camera::UpdateFrustum()
 {
+    m_view_proj_mat = m_view_mat * m_proj_mat;
+
     m_frustum.SetViewProjectionMatrix(m_view_proj_mat);
 }
 
@@ -33,9 +35,6 @@ void Camera::Update(double dt)
 {
     UpdateLogic(dt);
     UpdateMatrices();
-
-    m_view_proj_mat = m_view_mat * m_proj_mat;
-
     UpdateFrustum();
 }
 
@@ -33,7 +33,8 @@ public:
     inline void SetViewMatrix(const Matrix4 &view_mat) { m_view_mat = view_mat; }
     inline const Matrix4 &GetProjectionMatrix() const { return m_proj_mat; }
     inline void SetProjectionMatrix(const Matrix4 &proj_mat) { m_proj_mat = proj_mat; }
-    inline Matrix4 GetViewProjectionMatrix() const { return m_view_mat * m_proj_mat; }
+    // cached by UpdateFrustum()
+    inline const Matrix4 &GetViewProjectionMatrix() const { return m_view_proj_mat; }
     inline const Frustum &GetFrustum() const { return m_frustum; }
 
     inline int GetFov() const { return m_fov; }
@@ -41,6 +42,10 @@ public:
     void Rotate(const Vector3 &axis, float radians);
     void Update(double dt);
 
+    // recalculate the view-projection matrix and frustum from the current view
+    // and projection matrices. called by Update(), and needed after setting the matrices directly.
+    void UpdateFrustum();
+
     virtual void UpdateLogic(double dt) = 0;
     virtual void UpdateMatrices() = 0;
 
@@ -56,8 +61,6 @@ protected:
 private:
 
     Matrix4 m_view_proj_mat;
-
-    void UpdateFrustum();
 };
 }
 
@@ -44,7 +44,7 @@ void Cubemap::UploadGpuData(bool should_upload_data)
                 throw std::runtime_error("Could not upload cubemap because texture #" + std::to_string(i + 1) + " had no bytes set.");
             }
 
-            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, tex->GetInternalFormat(),
+            CoreEngine::GetInstance()->TexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, tex->GetInternalFormat(),
                 tex->GetWidth(), tex->GetHeight(), 0, tex->GetFormat(), GL_UNSIGNED_BYTE, tex->GetBytes());            
         }
     }
@@ -54,10 +54,10 @@ void Cubemap::UploadGpuData(bool should_upload_data)
         CoreEngine::GLEnums::TEXTURE_MAG_FILTER,
         CoreEngine::GLEnums::LINEAR
     );
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    CoreEngine::GetInstance()->TexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    CoreEngine::GetInstance()->TexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    CoreEngine::GetInstance()->TexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    CoreEngine::GetInstance()->TexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
     // glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_BASE_LEVEL, 0);
     // glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, CUBEMAP_NUM_MIPMAPS);
 
@@ -68,12 +68,12 @@ void Cubemap::UploadGpuData(bool should_upload_data)
 
 void Cubemap::Use()
 {
-    glBindTexture(GL_TEXTURE_CUBE_MAP, id);
+    CoreEngine::GetInstance()->BindTexture(GL_TEXTURE_CUBE_MAP, id);
 }
 
 void Cubemap::End()
 {
-    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+    CoreEngine::GetInstance()->BindTexture(GL_TEXTURE_CUBE_MAP, 0);
 }
 
 } // namespace apex
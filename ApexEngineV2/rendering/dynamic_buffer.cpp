@@ -0,0 +1,134 @@
+#include "dynamic_buffer.h"
+#include "../core_engine.h"
+
+#include <algorithm>
+
+namespace apex {
+
+DynamicBuffer::DynamicBuffer(int target)
+    : m_target(target),
+      m_id(0),
+      m_region_size(0),
+      m_region(0),
+      m_mapped_size(0),
+      m_mapped(nullptr)
+{
+    std::fill(std::begin(m_fences), std::end(m_fences), nullptr);
+}
+
+DynamicBuffer::~DynamicBuffer()
+{
+    Destroy();
+}
+
+unsigned char *DynamicBuffer::Map(size_t size)
+{
+    if (m_id == 0 || size > m_region_size) {
+        // grow geometrically, so a buffer growing a little each frame is rarely reallocated
+        Allocate(std::max(size, m_region_size * 2));
+    } else {
+        CoreEngine *engine = CoreEngine::GetInstance();
+
+        // every draw reading the current region was issued before this point
+        if (m_fences[m_region] != nullptr) {
+            engine->DeleteSync(m_fences[m_region]);
+        }
+
+        m_fences[m_region] = engine->FenceSync();
+        m_region = (m_region + 1) % DYNAMIC_BUFFER_NUM_REGIONS;
+
+        WaitForRegion(m_region);
+    }
+
+    m_mapped_size = size;
+
+    if (m_mapped != nullptr) {
+        return m_mapped + GetOffset();
+    }
+
+    // keeps its capacity, so only growing the buffer allocates
+    m_staging.resize(size);
+
+    return m_staging.data();
+}
+
+void DynamicBuffer::Commit()
+{
+    CoreEngine::GetInstance()->BindBuffer(m_target, m_id);
+
+    // coherent mappings are visible to the GPU without any call
+    if (m_mapped == nullptr && m_mapped_size != 0) {
+        CoreEngine::GetInstance()->BufferSubData(m_target, GetOffset(), m_mapped_size, m_staging.data());
+    }
+}
+
+void DynamicBuffer::Allocate(size_t region_size)
+{
+    CoreEngine *engine = CoreEngine::GetInstance();
+
+    Destroy();
+
+    m_region_size = region_size;
+    m_region = 0;
+
+    engine->GenBuffers(1, &m_id);
+    engine->BindBuffer(m_target, m_id);
+
+    if (engine->SupportsBufferStorage()) {
+        const unsigned int map_flags = CoreEngine::GLEnums::MAP_WRITE_BIT
+            | CoreEngine::GLEnums::MAP_PERSISTENT_BIT
+            | CoreEngine::GLEnums::MAP_COHERENT_BIT;
+
+        // dynamic storage allows falling back to BufferSubData() if mapping fails
+        engine->BufferStorage(m_target, GetSize(), nullptr, map_flags | CoreEngine::GLEnums::DYNAMIC_STORAGE_BIT);
+        m_mapped = static_cast<unsigned char*>(engine->MapBufferRange(m_target, 0, GetSize(), map_flags));
+    } else {
+        engine->BufferData(m_target, GetSize(), nullptr, CoreEngine::GLEnums::DYNAMIC_DRAW);
+    }
+}
+
+void DynamicBuffer::Destroy()
+{
+    CoreEngine *engine = CoreEngine::GetInstance();
+
+    for (void *&fence : m_fences) {
+        if (fence != nullptr) {
+            engine->DeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+
+    if (m_id != 0) {
+        if (m_mapped != nullptr) {
+            engine->BindBuffer(m_target, m_id);
+            engine->UnmapBuffer(m_target);
+            m_mapped = nullptr;
+        }
+
+        // the driver keeps the storage alive until pending draws are done with it
+        engine->DeleteBuffers(1, &m_id);
+        m_id = 0;
+    }
+}
+
+void DynamicBuffer::WaitForRegion(size_t region)
+{
+    void *fence = m_fences[region];
+
+    if (fence == nullptr) {
+        return;
+    }
+
+    CoreEngine *engine = CoreEngine::GetInstance();
+    unsigned int status;
+
+    do {
+        // flushing, so the fence is sure to reach the GPU and be signaled
+        status = engine->ClientWaitSync(fence, true, 1000000);
+    } while (status == CoreEngine::GLEnums::TIMEOUT_EXPIRED);
+
+    engine->DeleteSync(fence);
+    m_fences[region] = nullptr;
+}
+
+} // namespace apex
@@ -0,0 +1,56 @@
+#ifndef DYNAMIC_BUFFER_H
+#define DYNAMIC_BUFFER_H
+
+#include <vector>
+#include <cstddef>
+
+#define DYNAMIC_BUFFER_NUM_REGIONS 3
+
+namespace apex {
+
+// A buffer split into DYNAMIC_BUFFER_NUM_REGIONS regions that are written in turn,
+// so new data never goes to a region the GPU may still be reading from.
+// With buffer storage support the whole buffer is mapped once and written in place,
+// otherwise the region is updated with BufferSubData() from a reused staging copy.
+// Moving on from a region places a fence, which is waited on before the region is
+// written again; that only blocks when the GPU is a full ring of writes behind.
+// The buffer is only reallocated when a write does not fit in a region.
+class DynamicBuffer {
+public:
+    DynamicBuffer(int target);
+    DynamicBuffer(const DynamicBuffer &other) = delete;
+    DynamicBuffer &operator=(const DynamicBuffer &other) = delete;
+    ~DynamicBuffer();
+
+    inline unsigned int GetId() const { return m_id; }
+    inline size_t GetRegionSize() const { return m_region_size; }
+    // total size of all regions
+    inline size_t GetSize() const { return m_region_size * DYNAMIC_BUFFER_NUM_REGIONS; }
+    // byte offset of the region last returned by Map()
+    inline size_t GetOffset() const { return m_region * m_region_size; }
+    inline bool IsPersistent() const { return m_mapped != nullptr; }
+
+    // returns where to write size bytes to the next region.
+    // the data is visible to the GPU at GetOffset() once Commit() is called.
+    unsigned char *Map(size_t size);
+    // leaves the buffer bound to its target
+    void Commit();
+
+private:
+    int m_target;
+    unsigned int m_id;
+    size_t m_region_size;
+    size_t m_region;
+    size_t m_mapped_size;
+    unsigned char *m_mapped;
+    std::vector<unsigned char> m_staging;
+    void *m_fences[DYNAMIC_BUFFER_NUM_REGIONS];
+
+    void Allocate(size_t region_size);
+    void Destroy();
+    void WaitForRegion(size_t region);
+};
+
+} // namespace apex
+
+#endif
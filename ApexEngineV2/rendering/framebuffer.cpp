@@ -69,7 +69,7 @@ Framebuffer::Framebuffer(int width, int height)
 Framebuffer::~Framebuffer()
 {
     if (is_created) {
-        glDeleteFramebuffers(1, &id);
+        CoreEngine::GetInstance()->DeleteFramebuffers(1, &id);
     }
     is_uploaded = false;
     is_created = false;
@@ -77,7 +77,7 @@ Framebuffer::~Framebuffer()
 
 void Framebuffer::End()
 {
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    CoreEngine::GetInstance()->BindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
 } // namespace apex
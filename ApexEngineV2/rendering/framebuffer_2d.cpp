@@ -1,4 +1,5 @@
 #include "./framebuffer_2d.h"
+#include "../core_engine.h"
 #include "../gl_util.h"
 #include "../util.h"
 
@@ -49,16 +50,16 @@ Framebuffer2D::~Framebuffer2D()
 void Framebuffer2D::Use()
 {
     if (!is_created) {
-        glGenFramebuffers(1, &id);
+        CoreEngine::GetInstance()->GenFramebuffers(1, &id);
         CatchGLErrors("Failed to generate framebuffer.");
 
         is_created = true;
     }
 
-    glBindFramebuffer(GL_FRAMEBUFFER, id);
+    CoreEngine::GetInstance()->BindFramebuffer(GL_FRAMEBUFFER, id);
     CatchGLErrors("Failed to bind framebuffer.", false);
 
-    glViewport(0, 0, width, height);
+    CoreEngine::GetInstance()->Viewport(0, 0, width, height);
 
     if (!is_uploaded) {
         unsigned int draw_buffers[FRAMEBUFFER_MAX_ATTACHMENTS - 1] = { GL_NONE }; // - 1 for depth
@@ -70,7 +71,7 @@ void Framebuffer2D::Use()
             }
 
             m_attachments[i]->Begin();
-            glFramebufferTexture2D(
+            CoreEngine::GetInstance()->FramebufferTexture2D(
                 GL_FRAMEBUFFER,
                 GL_COLOR_ATTACHMENT0 + i,
                 GL_TEXTURE_2D,
@@ -85,7 +86,7 @@ void Framebuffer2D::Use()
 
         if (m_attachments[AttachmentToOrdinal(FRAMEBUFFER_ATTACHMENT_DEPTH)] != nullptr) {
             m_attachments[AttachmentToOrdinal(FRAMEBUFFER_ATTACHMENT_DEPTH)]->Begin();
-            glFramebufferTexture2D(
+            CoreEngine::GetInstance()->FramebufferTexture2D(
                 GL_FRAMEBUFFER,
                 GL_DEPTH_ATTACHMENT,
                 GL_TEXTURE_2D,
@@ -96,9 +97,9 @@ void Framebuffer2D::Use()
             m_attachments[AttachmentToOrdinal(FRAMEBUFFER_ATTACHMENT_DEPTH)]->End();
         }
 
-        glDrawBuffers(draw_buffer_index, draw_buffers);
+        CoreEngine::GetInstance()->DrawBuffers(draw_buffer_index, draw_buffers);
 
-        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        if (CoreEngine::GetInstance()->CheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
             throw std::runtime_error("Could not create framebuffer");
         }
 
@@ -112,7 +113,7 @@ void Framebuffer2D::Store(FramebufferAttachment attachment, std::shared_ptr<Text
     soft_assert(m_attachments[AttachmentToOrdinal(attachment)] != nullptr);
 
     // What happens for depth tex?
-    glReadBuffer(GL_COLOR_ATTACHMENT0 + AttachmentToOrdinal(attachment));
+    CoreEngine::GetInstance()->ReadBuffer(GL_COLOR_ATTACHMENT0 + AttachmentToOrdinal(attachment));
     CatchGLErrors("Failed to set read buffer");
 
     texture->Begin(false); // do not upload data (eg glTexImage2D)
@@ -1,5 +1,6 @@
 #include "./framebuffer_cube.h"
 #include "../opengl.h"
+#include "../core_engine.h"
 #include "../gl_util.h"
 #include "../util.h"
 
@@ -60,19 +61,19 @@ FramebufferCube::~FramebufferCube()
 void FramebufferCube::Use()
 {
     if (!is_created) {
-        glGenFramebuffers(1, &id);
+        CoreEngine::GetInstance()->GenFramebuffers(1, &id);
         is_created = true;
 
         CatchGLErrors("Failed to generate framebuffer for framebuffer cube.");
     }
 
-    glBindFramebuffer(GL_FRAMEBUFFER, id);
-    glViewport(0, 0, width, height);
+    CoreEngine::GetInstance()->BindFramebuffer(GL_FRAMEBUFFER, id);
+    CoreEngine::GetInstance()->Viewport(0, 0, width, height);
 
     if (!is_uploaded) {
         m_attachments[AttachmentToOrdinal(FRAMEBUFFER_ATTACHMENT_COLOR)]->Begin(); // TODO: try with should_upload_data = false
         for (int i = 0; /*i < 6*/ i < 1; i++) {
-            glFramebufferTexture(
+            CoreEngine::GetInstance()->FramebufferTexture(
                 GL_FRAMEBUFFER,
                 GL_COLOR_ATTACHMENT0,
                 m_attachments[AttachmentToOrdinal(FRAMEBUFFER_ATTACHMENT_COLOR)]->GetId(),
@@ -85,7 +86,7 @@ void FramebufferCube::Use()
 
         m_attachments[AttachmentToOrdinal(FRAMEBUFFER_ATTACHMENT_DEPTH)]->Begin();
         for (int i = 0; /*i < 6*/ i < 1; i++) {
-            glFramebufferTexture(
+            CoreEngine::GetInstance()->FramebufferTexture(
                 GL_FRAMEBUFFER,
                 GL_DEPTH_ATTACHMENT,
                 m_attachments[AttachmentToOrdinal(FRAMEBUFFER_ATTACHMENT_DEPTH)]->GetId(),
@@ -100,12 +101,12 @@ void FramebufferCube::Use()
             GL_COLOR_ATTACHMENT0
         };
 
-        glDrawBuffers(1, draw_buffers);
+        CoreEngine::GetInstance()->DrawBuffers(1, draw_buffers);
         CatchGLErrors("Failed to use glDrawBuffers in framebuffer cube");
 
         unsigned int status;
 
-        if ((status = glCheckFramebufferStatus(GL_FRAMEBUFFER)) != GL_FRAMEBUFFER_COMPLETE) {
+        if ((status = CoreEngine::GetInstance()->CheckFramebufferStatus(GL_FRAMEBUFFER)) != GL_FRAMEBUFFER_COMPLETE) {
             std::cout << "Could not create FramebufferCube " << status << std::endl;
             throw std::runtime_error("Could not create FramebufferCube");
         }
@@ -1,11 +1,12 @@
 #include "material.h"
 
-namespace apex {
+#include <unordered_map>
+#include <deque>
+#include <mutex>
+#include <algorithm>
+#include <stdexcept>
 
-const std::map<std::string, MaterialParameter> Material::default_parameters = {
-    { "roughness", MaterialParameter(0.8f) },
-    { "shininess", MaterialParameter(0.04f) }
-};
+namespace apex {
 
 MaterialParameter::MaterialParameter()
     : size(0),
@@ -36,88 +37,210 @@ MaterialParameter::MaterialParameter(const MaterialParameter &other)
 {
 }
 
+static std::mutex key_mutex;
+static std::unordered_map<std::string, Material::Key_t> key_indices;
+static std::deque<std::string> key_names; // references stay valid as names are added
+
+Material::Key_t Material::GetKey(const std::string &name)
+{
+    std::lock_guard<std::mutex> lock(key_mutex);
+
+    auto it = key_indices.find(name);
+
+    if (it == key_indices.end()) {
+        it = key_indices.insert({ name, Key_t(key_names.size()) }).first;
+        key_names.push_back(name);
+    }
+
+    return it->second;
+}
+
+const std::string &Material::GetKeyName(Key_t key)
+{
+    std::lock_guard<std::mutex> lock(key_mutex);
+
+    return key_names.at(key);
+}
+
+void Material::Data::UpdateHashCode()
+{
+    HashCode hc;
+
+    for (const ParameterEntry &entry : parameters) {
+        hc.Add(entry.key);
+
+        for (size_t i = 0; i < entry.value.NumValues(); i++) {
+            hc.Add(entry.value[i]);
+        }
+    }
+
+    for (const TextureEntry &entry : textures) {
+        if (entry.texture == nullptr) {
+            continue;
+        }
+
+        hc.Add(entry.key);
+        // the texture object, render targets have no bytes on the CPU
+        hc.Add(intptr_t(entry.texture.get()));
+    }
+
+    hash_code = hc.Value();
+}
+
 Material::Material()
     : diffuse_color(Vector4(1.0))
 {
-    for (auto it : default_parameters) {
-        params[it.first] = it.second;
-    }
+    // every default material shares the same block until it is modified
+    static const std::shared_ptr<Data> default_data = []() {
+        auto data = std::make_shared<Data>();
+        data->parameters = {
+            { GetKey("roughness"), MaterialParameter(0.8f) },
+            { GetKey("shininess"), MaterialParameter(0.04f) }
+        };
+
+        std::sort(data->parameters.begin(), data->parameters.end(), [](const ParameterEntry &a, const ParameterEntry &b) {
+            return a.key < b.key;
+        });
+
+        data->UpdateHashCode();
+
+        return data;
+    }();
+
+    m_data = default_data;
 }
 
 Material::Material(const Material &other)
-    : params(other.params),
+    : cull_faces(other.cull_faces),
       alpha_blended(other.alpha_blended),
       depth_test(other.depth_test),
       depth_write(other.depth_write),
       diffuse_color(other.diffuse_color),
-      textures(other.textures)
+      m_data(other.m_data)
+{
+}
+
+Material &Material::operator=(const Material &other)
+{
+    cull_faces = other.cull_faces;
+    alpha_blended = other.alpha_blended;
+    depth_test = other.depth_test;
+    depth_write = other.depth_write;
+    diffuse_color = other.diffuse_color;
+    m_data = other.m_data;
+
+    return *this;
+}
+
+bool Material::SetsSameStateAs(const Material &other) const
 {
+    return SharesDataWith(other) &&
+        cull_faces == other.cull_faces &&
+        alpha_blended == other.alpha_blended &&
+        depth_test == other.depth_test &&
+        depth_write == other.depth_write &&
+        diffuse_color == other.diffuse_color;
 }
 
-bool Material::HasParameter(const std::string &name) const
+Material::Data &Material::GetMutableData()
 {
-    auto it = params.find(name);
-    if (it != params.end() && it->second.GetType() != MaterialParameter_None) {
-        return true;
+    if (m_data.use_count() != 1) {
+        m_data = std::make_shared<Data>(*m_data);
     }
+
+    return *m_data;
+}
+
+bool Material::HasParameter(Key_t key) const
+{
+    for (const ParameterEntry &entry : m_data->parameters) {
+        if (entry.key == key) {
+            return entry.value.GetType() != MaterialParameter_None;
+        }
+    }
+
     return false;
 }
 
-std::map<std::string, MaterialParameter> &Material::GetParameters()
+const MaterialParameter &Material::GetParameter(Key_t key) const
 {
-    return params;
+    for (const ParameterEntry &entry : m_data->parameters) {
+        if (entry.key == key) {
+            return entry.value;
+        }
+    }
+
+    throw std::out_of_range("parameter not found");
 }
 
-const MaterialParameter &Material::GetParameter(const std::string &name) const
+void Material::SetParameter(Key_t key, const MaterialParameter &value)
 {
-    auto it = params.find(name);
-    if (it == params.end()) {
-        throw std::out_of_range("parameter not found");
+    Data &data = GetMutableData();
+
+    auto it = std::lower_bound(data.parameters.begin(), data.parameters.end(), key,
+        [](const ParameterEntry &entry, Key_t key) { return entry.key < key; });
+
+    if (it != data.parameters.end() && it->key == key) {
+        it->value = value;
+    } else {
+        data.parameters.insert(it, { key, value });
     }
-    return it->second;
+
+    data.UpdateHashCode();
 }
 
 void Material::SetParameter(const std::string &name, float value)
 {
     float values[] = { value };
-    params[name] = MaterialParameter(values, 1, MaterialParameter_Float);
+    SetParameter(GetKey(name), MaterialParameter(values, 1, MaterialParameter_Float));
 }
 
 void Material::SetParameter(const std::string &name, int value)
 {
     float values[] = { (float)value };
-    params[name] = MaterialParameter(values, 1, MaterialParameter_Int);
+    SetParameter(GetKey(name), MaterialParameter(values, 1, MaterialParameter_Int));
 }
 
 void Material::SetParameter(const std::string &name, const Vector2 &value)
 {
     float values[] = { value.x, value.y };
-    params[name] = MaterialParameter(values, 2, MaterialParameter_Vector2);
+    SetParameter(GetKey(name), MaterialParameter(values, 2, MaterialParameter_Vector2));
 }
 
 void Material::SetParameter(const std::string &name, const Vector3 &value)
 {
     float values[] = { value.x, value.y, value.z };
-    params[name] = MaterialParameter(values, 3, MaterialParameter_Vector3);
+    SetParameter(GetKey(name), MaterialParameter(values, 3, MaterialParameter_Vector3));
 }
 
 void Material::SetParameter(const std::string &name, const Vector4 &value)
 {
     float values[] = { value.x, value.y, value.z, value.w };
-    params[name] = MaterialParameter(values, 4, MaterialParameter_Vector4);
+    SetParameter(GetKey(name), MaterialParameter(values, 4, MaterialParameter_Vector4));
 }
 
-void Material::SetTexture(const std::string &name, const std::shared_ptr<Texture> &texture)
+void Material::SetTexture(Key_t key, const std::shared_ptr<Texture> &texture)
 {
-    textures[name] = texture;
+    Data &data = GetMutableData();
+
+    auto it = std::lower_bound(data.textures.begin(), data.textures.end(), key,
+        [](const TextureEntry &entry, Key_t key) { return entry.key < key; });
+
+    if (it != data.textures.end() && it->key == key) {
+        it->texture = texture;
+    } else {
+        data.textures.insert(it, { key, texture });
+    }
+
+    data.UpdateHashCode();
 }
 
-std::shared_ptr<Texture> Material::GetTexture(const std::string &name) const
+std::shared_ptr<Texture> Material::GetTexture(Key_t key) const
 {
-    const auto it = textures.find(name);
-
-    if (it != textures.end()) {
-        return it->second;
+    for (const TextureEntry &entry : m_data->textures) {
+        if (entry.key == key) {
+            return entry.texture;
+        }
     }
 
     return nullptr;
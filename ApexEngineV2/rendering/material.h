@@ -9,8 +9,9 @@
 
 #include <string>
 #include <array>
-#include <map>
+#include <vector>
 #include <memory>
+#include <cstdint>
 
 namespace apex {
 
@@ -50,26 +51,62 @@ private:
     MaterialParameterType type;
 };
 
+// Parameters and textures live in a block shared between copies of a material,
+// which is only copied when a shared material is modified (copy-on-write), so
+// entities cloned from the same model share one block. Names are interned into
+// keys, and the block keeps its hash up to date, so GetHashCode() only adds
+// the render state fields below to it.
 class Material {
 public:
-    static const std::map<std::string, MaterialParameter> default_parameters;
+    using Key_t = uint32_t;
+
+    struct ParameterEntry {
+        Key_t key;
+        MaterialParameter value;
+    };
+
+    struct TextureEntry {
+        Key_t key;
+        std::shared_ptr<Texture> texture;
+    };
+
+    // the key of a parameter or texture name, interned on first use.
+    // keys are stable for the lifetime of the program.
+    static Key_t GetKey(const std::string &name);
+    static const std::string &GetKeyName(Key_t key);
 
     Material();
     Material(const Material &other);
+    Material &operator=(const Material &other);
 
-    bool HasParameter(const std::string &name) const;
+    inline bool HasParameter(const std::string &name) const { return HasParameter(GetKey(name)); }
+    bool HasParameter(Key_t key) const;
 
-    std::map<std::string, MaterialParameter> &GetParameters();
-    const MaterialParameter &GetParameter(const std::string &name) const;
+    // sorted by key
+    inline const std::vector<ParameterEntry> &GetParameters() const { return m_data->parameters; }
+    inline const MaterialParameter &GetParameter(const std::string &name) const { return GetParameter(GetKey(name)); }
+    const MaterialParameter &GetParameter(Key_t key) const;
 
     void SetParameter(const std::string &name, float);
     void SetParameter(const std::string &name, int);
     void SetParameter(const std::string &name, const Vector2 &);
     void SetParameter(const std::string &name, const Vector3 &);
     void SetParameter(const std::string &name, const Vector4 &);
-
-    void SetTexture(const std::string &name, const std::shared_ptr<Texture> &);
-    std::shared_ptr<Texture> GetTexture(const std::string &name) const;
+    void SetParameter(Key_t key, const MaterialParameter &value);
+
+    // sorted by key
+    inline const std::vector<TextureEntry> &GetTextures() const { return m_data->textures; }
+    inline void SetTexture(const std::string &name, const std::shared_ptr<Texture> &texture) { SetTexture(GetKey(name), texture); }
+    void SetTexture(Key_t key, const std::shared_ptr<Texture> &texture);
+    inline std::shared_ptr<Texture> GetTexture(const std::string &name) const { return GetTexture(GetKey(name)); }
+    std::shared_ptr<Texture> GetTexture(Key_t key) const;
+
+    // whether both materials share the same parameter and texture block
+    inline bool SharesDataWith(const Material &other) const { return m_data == other.m_data; }
+    // whether drawing with either material sets the same state: they share a block,
+    // and their render state fields are equal. unlike equal hash codes, never true
+    // for materials that differ.
+    bool SetsSameStateAs(const Material &other) const;
 
     MaterialFaceCull cull_faces = MaterialFace_Back;
 
@@ -78,29 +115,11 @@ public:
     bool depth_write = true;
     Vector4 diffuse_color = Vector4(1.0);
 
-    std::map<std::string, std::shared_ptr<Texture>> textures;
-
     inline HashCode GetHashCode() const
     {
         HashCode hc;
 
-        for (const auto &it : params) {
-            hc.Add(it.first);
-            
-            for (int i = 0; i < it.second.NumValues(); i++) {
-                hc.Add(it.second[i]);
-            }
-        }
-
-        for (const auto &it : textures) {
-            if (it.second == nullptr) {
-                continue;
-            }
-
-            hc.Add(it.first);
-            hc.Add(intptr_t(it.second->GetBytes())); // pointer to memory of image
-        }
-
+        hc.Add(m_data->hash_code);
         hc.Add(alpha_blended);
         hc.Add(depth_test);
         hc.Add(depth_write);
@@ -111,7 +130,19 @@ public:
     }
 
 private:
-    std::map<std::string, MaterialParameter> params;
+    struct Data {
+        std::vector<ParameterEntry> parameters;
+        std::vector<TextureEntry> textures;
+        size_t hash_code;
+
+        void UpdateHashCode();
+    };
+
+    // never modified while shared
+    std::shared_ptr<Data> m_data;
+
+    // the data, copied first if another material shares it
+    Data &GetMutableData();
 };
 
 } // namespace apex
@@ -1,6 +1,11 @@
 #include "mesh.h"
 #include "../math/triangle.h"
 #include "../gl_util.h"
+#include "../core_engine.h"
+#include "../util.h"
+
+#include <algorithm>
+#include <limits>
 
 namespace apex {
 
@@ -13,135 +18,249 @@ const Mesh::MeshAttribute Mesh::MeshAttribute::Bitangents = { 0, 3, 5 };
 const Mesh::MeshAttribute Mesh::MeshAttribute::BoneWeights = { 0, 4, 6 };
 const Mesh::MeshAttribute Mesh::MeshAttribute::BoneIndices = { 0, 4, 7 };
 
+const unsigned int Mesh::instance_matrix_attribute = 8;
+
+static_assert(int(Mesh::ATTR_POSITIONS) == VERTEX_ATTR_POSITIONS &&
+    int(Mesh::ATTR_NORMALS) == VERTEX_ATTR_NORMALS &&
+    int(Mesh::ATTR_TEXCOORDS0) == VERTEX_ATTR_TEXCOORDS0 &&
+    int(Mesh::ATTR_TEXCOORDS1) == VERTEX_ATTR_TEXCOORDS1 &&
+    int(Mesh::ATTR_TANGENTS) == VERTEX_ATTR_TANGENTS &&
+    int(Mesh::ATTR_BITANGENTS) == VERTEX_ATTR_BITANGENTS &&
+    int(Mesh::ATTR_BONEWEIGHTS) == VERTEX_ATTR_BONEWEIGHTS &&
+    int(Mesh::ATTR_BONEINDICES) == VERTEX_ATTR_BONEINDICES,
+    "mesh attribute types must match the vertex format attribute bits");
+
+// index of the attribute within VertexFormatInfo::attributes
+static inline int AttributeIndex(Mesh::MeshAttributeType type)
+{
+    int index = 0;
+
+    while ((1 << index) != type) {
+        index++;
+    }
+
+    return index;
+}
+
 Mesh::Mesh()
     : Renderable()
 {
     SetAttribute(ATTR_POSITIONS, MeshAttribute::Positions);
     SetPrimitiveType(PRIM_TRIANGLES);
+    vertex_packing = VERTEX_PACKING_COMPACT;
+    vertex_format = nullptr;
     is_uploaded = false;
     is_created = false;
+    is_released = false;
+    instance_vbo = 0;
+    num_indices = 0;
+    index_type = CoreEngine::GLEnums::UNSIGNED_INT;
+    residency = RESIDENCY_GPU_ONLY;
+    usage = USAGE_STATIC;
+    uploaded_vertex_count = 0;
+    dirty_begin = 0;
+    dirty_end = 0;
+    indices_dirty = false;
+    vertex_buffer_size = 0;
+    index_buffer_size = 0;
+    instance_buffer_size = 0;
 }
 
 Mesh::~Mesh()
 {
     if (is_created) {
-        glDeleteVertexArrays(1, &vao);
-        glDeleteBuffers(1, &vbo);
-        glDeleteBuffers(1, &ibo);
+        CoreEngine::GetInstance()->DeleteVertexArrays(1, &vao);
+        CoreEngine::GetInstance()->DeleteBuffers(1, &vbo);
+        CoreEngine::GetInstance()->DeleteBuffers(1, &ibo);
+    }
+
+    if (instance_vbo != 0) {
+        CoreEngine::GetInstance()->DeleteBuffers(1, &instance_vbo);
     }
 
     is_uploaded = false;
     is_created = false;
 }
 
+size_t Mesh::RetainedPositions::NumBytes() const
+{
+    return (x.capacity() + y.capacity() + z.capacity()) * sizeof(float)
+        + indices.capacity() * sizeof(MeshIndex);
+}
+
 void Mesh::SetVertices(const std::vector<Vertex> &verts)
 {
-    vertices = verts;
-    indices.clear();
-    for (size_t i = 0; i < verts.size(); i++) {
-        indices.push_back(static_cast<MeshIndex>(i));
-    }
+    std::vector<MeshIndex> sequential_indices(verts.size());
 
-    // update the aabb
-    // TODO: more concrete (virtual method?) way of setting aabb on Renderable
-    m_aabb.Clear();
-    for (Vertex &vertex : vertices) {
-        m_aabb.Extend(vertex.GetPosition());
+    for (size_t i = 0; i < verts.size(); i++) {
+        sequential_indices[i] = static_cast<MeshIndex>(i);
     }
 
-    is_uploaded = false;
+    SetVertices(verts, sequential_indices);
 }
 
 void Mesh::SetVertices(const std::vector<Vertex> &verts, const std::vector<MeshIndex> &ind)
 {
+    // with the same number of vertices, the uploaded buffers are updated in place
+    const bool update_in_place = is_uploaded && verts.size() == uploaded_vertex_count;
+    const bool indices_changed = is_released || ind != indices;
+
     vertices = verts;
     indices = ind;
+    num_indices = indices.size();
+    retained_positions.Clear();
+    // their bounds no longer hold, MeshletBuilder sets them again
+    m_meshlets.clear();
+    // simplified from the old vertices, MeshSimplifier generates them again
+    m_lods.clear();
+    is_released = false;
 
     // update the aabb
+    // TODO: more concrete (virtual method?) way of setting aabb on Renderable
     m_aabb.Clear();
     for (Vertex &vertex : vertices) {
         m_aabb.Extend(vertex.GetPosition());
     }
 
+    if (update_in_place) {
+        MarkVerticesDirty(0, vertices.size());
+        indices_dirty = indices_dirty || indices_changed;
+    } else {
+        is_uploaded = false;
+    }
+}
+
+void Mesh::UpdateVertices(size_t offset, const Vertex *verts, size_t count)
+{
+    ex_assert(!is_released);
+    ex_assert(offset + count <= vertices.size());
+
+    for (size_t i = 0; i < count; i++) {
+        vertices[offset + i] = verts[i];
+
+        // only grows, recomputing it would read every vertex
+        m_aabb.Extend(verts[i].GetPosition());
+    }
+
+    m_meshlets.clear();
+    m_lods.clear();
+
+    MarkVerticesDirty(offset, offset + count);
+}
+
+void Mesh::SetUsage(MeshUsage mesh_usage)
+{
+    usage = mesh_usage;
     is_uploaded = false;
 }
 
+void Mesh::MarkVerticesDirty(size_t begin, size_t end)
+{
+    if (dirty_begin >= dirty_end) {
+        dirty_begin = begin;
+        dirty_end = end;
+    } else {
+        dirty_begin = std::min(dirty_begin, begin);
+        dirty_end = std::max(dirty_end, end);
+    }
+}
+
 void Mesh::SetAttribute(MeshAttributeType type, const MeshAttribute &attribute)
 {
     attribs[type] = attribute;
     is_uploaded = false;
 }
 
-std::vector<float> Mesh::CreateBuffer()
+void Mesh::SetVertexPacking(VertexPacking packing)
+{
+    vertex_packing = packing;
+    is_uploaded = false;
+}
+
+void Mesh::SelectVertexFormat()
 {
-    unsigned int vert_size = 0, prev_size = 0, offset = 0;
+    unsigned int mask = 0;
 
     for (auto &&attr : attribs) {
-        offset += prev_size;
-        attr.second.offset = offset;
-        prev_size = attr.second.size;
-        vert_size += prev_size;
+        mask |= attr.first;
     }
 
-    vertex_size = vert_size;
+    VertexPacking packing = vertex_packing;
 
-    std::vector<float> buffer(vert_size * vertices.size());
+    if (packing == VERTEX_PACKING_COMPACT) {
+        packing = VertexFormatInfo::SelectPacking(mask, vertices.data(), vertices.size());
+    }
 
-    auto pos_it = attribs.find(ATTR_POSITIONS);
-    auto norm_it = attribs.find(ATTR_NORMALS);
-    auto tc0_it = attribs.find(ATTR_TEXCOORDS0);
-    auto tc1_it = attribs.find(ATTR_TEXCOORDS1);
-    auto tan_it = attribs.find(ATTR_TANGENTS);
-    auto bitan_it = attribs.find(ATTR_BITANGENTS);
-    auto bonew_it = attribs.find(ATTR_BONEWEIGHTS);
-    auto bonei_it = attribs.find(ATTR_BONEINDICES);
+    vertex_format = &VertexFormatInfo::Get(mask, packing);
 
-    for (size_t i = 0; i < vertices.size(); i++) {
-        auto &vertex = vertices[i];
+    for (auto &&attr : attribs) {
+        attr.second.offset = unsigned(vertex_format->attributes[AttributeIndex(attr.first)].offset);
+    }
+}
 
-        if (pos_it != attribs.end()) {
-            buffer[(i * vert_size) + pos_it->second.offset] = vertex.GetPosition().x;
-            buffer[(i * vert_size) + pos_it->second.offset + 1] = vertex.GetPosition().y;
-            buffer[(i * vert_size) + pos_it->second.offset + 2] = vertex.GetPosition().z;
-        }
-        if (norm_it != attribs.end()) {
-            buffer[(i * vert_size) + norm_it->second.offset] = vertex.GetNormal().x;
-            buffer[(i * vert_size) + norm_it->second.offset + 1] = vertex.GetNormal().y;
-            buffer[(i * vert_size) + norm_it->second.offset + 2] = vertex.GetNormal().z;
-        }
-        if (tc0_it != attribs.end()) {
-            buffer[(i * vert_size) + tc0_it->second.offset] = vertex.GetTexCoord0().x;
-            buffer[(i * vert_size) + tc0_it->second.offset + 1] = vertex.GetTexCoord0().y;
-        }
-        if (tc1_it != attribs.end()) {
-            buffer[(i * vert_size) + tc1_it->second.offset] = vertex.GetTexCoord1().x;
-            buffer[(i * vert_size) + tc1_it->second.offset + 1] = vertex.GetTexCoord1().y;
-        }
-        if (tan_it != attribs.end()) {
-            buffer[(i * vert_size) + tan_it->second.offset] = vertex.GetTangent().x;
-            buffer[(i * vert_size) + tan_it->second.offset + 1] = vertex.GetTangent().y;
-            buffer[(i * vert_size) + tan_it->second.offset + 2] = vertex.GetTangent().z;
-        }
-        if (bitan_it != attribs.end()) {
-            buffer[(i * vert_size) + bitan_it->second.offset] = vertex.GetBitangent().x;
-            buffer[(i * vert_size) + bitan_it->second.offset + 1] = vertex.GetBitangent().y;
-            buffer[(i * vert_size) + bitan_it->second.offset + 2] = vertex.GetBitangent().z;
-        }
-        if (bonei_it != attribs.end()) {
-            buffer[(i * vert_size) + bonei_it->second.offset] = static_cast<float>(vertex.GetBoneIndex(0));
-            buffer[(i * vert_size) + bonei_it->second.offset + 1] = static_cast<float>(vertex.GetBoneIndex(1));
-            buffer[(i * vert_size) + bonei_it->second.offset + 2] = static_cast<float>(vertex.GetBoneIndex(2));
-            buffer[(i * vert_size) + bonei_it->second.offset + 3] = static_cast<float>(vertex.GetBoneIndex(3));
-        }
-        if (bonew_it != attribs.end()) {
-            buffer[(i * vert_size) + bonew_it->second.offset] = vertex.GetBoneWeight(0);
-            buffer[(i * vert_size) + bonew_it->second.offset + 1] = vertex.GetBoneWeight(1);
-            buffer[(i * vert_size) + bonew_it->second.offset + 2] = vertex.GetBoneWeight(2);
-            buffer[(i * vert_size) + bonew_it->second.offset + 3] = vertex.GetBoneWeight(3);
+std::vector<unsigned char> Mesh::CreateBuffer()
+{
+    SelectVertexFormat();
+
+    std::vector<unsigned char> buffer(vertex_format->stride * vertices.size());
+    vertex_format->pack(vertices.data(), vertices.size(), buffer.data());
+
+    return buffer;
+}
+
+void Mesh::ReleaseVertexData()
+{
+    // dynamic meshes are written whole on every change, so they keep everything
+    if (residency == RESIDENCY_ALL || usage == USAGE_DYNAMIC) {
+        return;
+    }
+
+    if (residency == RESIDENCY_POSITIONS) {
+        retained_positions.Clear();
+        retained_positions.x.reserve(vertices.size());
+        retained_positions.y.reserve(vertices.size());
+        retained_positions.z.reserve(vertices.size());
+
+        for (const Vertex &vertex : vertices) {
+            retained_positions.x.push_back(vertex.GetPosition().x);
+            retained_positions.y.push_back(vertex.GetPosition().y);
+            retained_positions.z.push_back(vertex.GetPosition().z);
         }
+
+        retained_positions.indices.swap(indices);
     }
 
-    return buffer;
+    // swap with empty vectors, as clear() keeps the capacity
+    std::vector<Vertex>().swap(vertices);
+    std::vector<MeshIndex>().swap(indices);
+
+    is_released = true;
+}
+
+Mesh::MemoryUsage Mesh::GetMemoryUsage() const
+{
+    MemoryUsage memory;
+    memory.cpu_bytes = vertices.capacity() * sizeof(Vertex)
+        + indices.capacity() * sizeof(MeshIndex)
+        + retained_positions.NumBytes();
+    memory.gpu_bytes = (dynamic_vbo != nullptr ? dynamic_vbo->GetSize() : vertex_buffer_size)
+        + index_buffer_size + instance_buffer_size;
+
+    return memory;
+}
+
+size_t Mesh::NumTriangleIndices() const
+{
+    return is_released ? retained_positions.indices.size() : indices.size();
+}
+
+Vector3 Mesh::GetTrianglePosition(size_t index) const
+{
+    if (is_released) {
+        return retained_positions.Get(retained_positions.indices[index]);
+    }
+
+    return vertices[indices[index]].GetPosition();
 }
 
 void Mesh::CalculateTangents()
@@ -192,62 +311,224 @@ void Mesh::CalculateTangents()
     SetAttribute(ATTR_BITANGENTS, MeshAttribute::Bitangents);
 }
 
-void Mesh::Render()
+void Mesh::Prepare()
 {
     if (!is_created) {
-        glGenVertexArrays(1, &vao);
+        CoreEngine::GetInstance()->GenVertexArrays(1, &vao);
         CatchGLErrors("Failed to generate vertex arrays.");
 
-        glGenBuffers(1, &vbo);
-        glGenBuffers(1, &ibo);
+        CoreEngine::GetInstance()->GenBuffers(1, &vbo);
+        CoreEngine::GetInstance()->GenBuffers(1, &ibo);
 
         is_created = true;
     }
 
-    glBindVertexArray(vao);
+    CoreEngine::GetInstance()->BindVertexArray(vao);
+
+    // once released, the buffers keep the last uploaded data
+    if (is_released) {
+        return;
+    }
 
     if (!is_uploaded) {
-        std::vector<float> buffer = CreateBuffer();
+        Upload();
+    } else if (dirty_begin < dirty_end || indices_dirty) {
+        UploadChanges();
+    }
+}
 
-        glBindBuffer(GL_ARRAY_BUFFER, vbo);
-        glBufferData(GL_ARRAY_BUFFER, buffer.size() * sizeof(float), &buffer[0], GL_STATIC_DRAW);
+void Mesh::Upload()
+{
+    if (usage == USAGE_DYNAMIC) {
+        SelectVertexFormat();
+        WriteDynamicVertices();
+    } else {
+        std::vector<unsigned char> buffer = CreateBuffer();
+        vertex_buffer_size = buffer.size();
+        dynamic_vbo.reset();
+
+        CoreEngine::GetInstance()->BindBuffer(GL_ARRAY_BUFFER, vbo);
+        CoreEngine::GetInstance()->BufferData(GL_ARRAY_BUFFER, buffer.size(), buffer.data(), GL_STATIC_DRAW);
         CatchGLErrors("Failed to set buffer data.");
 
-        unsigned int error;
+        SetAttributePointers(0);
+    }
+
+    UploadIndices(true);
+
+    uploaded_vertex_count = vertices.size();
+    dirty_begin = dirty_end = 0;
+    indices_dirty = false;
+    is_uploaded = true;
 
-        for (auto &&attr : attribs) {
-            glEnableVertexAttribArray(attr.second.index);
-            CatchGLErrors("Failed to enable vertex attribute array." __FILE__);
+    ReleaseVertexData();
+}
+
+void Mesh::UploadChanges()
+{
+    if (dirty_begin < dirty_end) {
+        // a change that the compact packing can not hold needs the float layout
+        if (vertex_format->packing == VERTEX_PACKING_COMPACT &&
+            VertexFormatInfo::SelectPacking(vertex_format->mask, &vertices[dirty_begin],
+            dirty_end - dirty_begin) != VERTEX_PACKING_COMPACT) {
+            Upload();
+            return;
+        }
+
+        if (usage == USAGE_DYNAMIC) {
+            WriteDynamicVertices();
+        } else {
+            const size_t count = dirty_end - dirty_begin;
 
-            glVertexAttribPointer(attr.second.index, attr.second.size, GL_FLOAT,
-                false, vertex_size * sizeof(float), (void*)(attr.second.offset * sizeof(float)));
+            // keeps its capacity, so repeated updates do not allocate
+            upload_buffer.resize(count * vertex_format->stride);
+            vertex_format->pack(&vertices[dirty_begin], count, upload_buffer.data());
 
-            CatchGLErrors("Failed to set vertex attribute pointer.");
+            CoreEngine::GetInstance()->BindBuffer(GL_ARRAY_BUFFER, vbo);
+            CoreEngine::GetInstance()->BufferSubData(GL_ARRAY_BUFFER, dirty_begin * vertex_format->stride,
+                upload_buffer.size(), upload_buffer.data());
         }
 
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(MeshIndex), &indices[0], GL_STATIC_DRAW);
+        dirty_begin = dirty_end = 0;
+    }
+
+    if (indices_dirty) {
+        UploadIndices(false);
+        indices_dirty = false;
+    }
+
+    ReleaseVertexData();
+}
 
-        is_uploaded = true;
+void Mesh::WriteDynamicVertices()
+{
+    if (dynamic_vbo == nullptr) {
+        dynamic_vbo.reset(new DynamicBuffer(CoreEngine::GLEnums::ARRAY_BUFFER));
     }
 
-    glDrawElements(primitive_type, indices.size(), GL_UNSIGNED_INT, 0);
+    // the next region holds none of the previous data, so every vertex is written
+    unsigned char *dst = dynamic_vbo->Map(vertices.size() * vertex_format->stride);
+    vertex_format->pack(vertices.data(), vertices.size(), dst);
+    dynamic_vbo->Commit();
+
+    vertex_buffer_size = 0;
 
-    glBindVertexArray(0);
+    // the region moved, and the buffer itself may have been reallocated
+    SetAttributePointers(dynamic_vbo->GetOffset());
+}
+
+void Mesh::SetAttributePointers(size_t base_offset)
+{
+    for (auto &&attr : attribs) {
+        CoreEngine::GetInstance()->EnableVertexAttribArray(attr.second.index);
+        CatchGLErrors("Failed to enable vertex attribute array." __FILE__);
+
+        const VertexFormatInfo::Attribute &format = vertex_format->attributes[AttributeIndex(attr.first)];
+
+        CoreEngine::GetInstance()->VertexAttribPointer(attr.second.index, format.components, format.type,
+            format.normalized, vertex_format->stride, (void*)(base_offset + format.offset));
+
+        CatchGLErrors("Failed to set vertex attribute pointer.");
+    }
+}
+
+void Mesh::UploadIndices(bool reallocate)
+{
+    CoreEngine::GetInstance()->BindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+
+    const void *data = indices.data();
+    size_t size = indices.size() * sizeof(MeshIndex);
+    std::vector<uint16_t> short_indices;
+
+    if (vertices.size() <= std::numeric_limits<uint16_t>::max()) {
+        // half the index bandwidth, every index fits in 16 bits
+        short_indices.assign(indices.begin(), indices.end());
+        data = short_indices.data();
+        size = short_indices.size() * sizeof(uint16_t);
+        index_type = CoreEngine::GLEnums::UNSIGNED_SHORT;
+    } else {
+        index_type = CoreEngine::GLEnums::UNSIGNED_INT;
+    }
+
+    if (reallocate || size != index_buffer_size) {
+        index_buffer_size = size;
+        CoreEngine::GetInstance()->BufferData(GL_ELEMENT_ARRAY_BUFFER, size, data, GL_STATIC_DRAW);
+    } else {
+        CoreEngine::GetInstance()->BufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, size, data);
+    }
+}
+
+void Mesh::Render()
+{
+    Prepare();
+
+    // the vertex array stays bound, as the next draw binds its own
+    CoreEngine::GetInstance()->DrawElements(primitive_type, num_indices, index_type, 0);
+}
+
+void Mesh::RenderRanges(const IndexRange *ranges, size_t count)
+{
+    Prepare();
+
+    const size_t index_size = index_type == CoreEngine::GLEnums::UNSIGNED_SHORT
+        ? sizeof(uint16_t)
+        : sizeof(uint32_t);
+
+    range_counts.clear();
+    range_offsets.clear();
+
+    for (size_t i = 0; i < count; i++) {
+        range_counts.push_back(int(ranges[i].count));
+        range_offsets.push_back((const void*)(size_t(ranges[i].offset) * index_size));
+    }
+
+    CoreEngine::GetInstance()->MultiDrawElements(primitive_type, range_counts.data(), index_type,
+        range_offsets.data(), count);
+}
+
+void Mesh::RenderInstanced(const Matrix4 *model_matrices, size_t count)
+{
+    CoreEngine *engine = CoreEngine::GetInstance();
+
+    Prepare();
+
+    if (instance_vbo == 0) {
+        engine->GenBuffers(1, &instance_vbo);
+        engine->BindBuffer(CoreEngine::GLEnums::ARRAY_BUFFER, instance_vbo);
+
+        // a mat4 attribute is four vec4 columns, each advancing once per instance.
+        // stored in the vertex array, so this is only set up once.
+        for (unsigned int i = 0; i < 4; i++) {
+            engine->EnableVertexAttribArray(instance_matrix_attribute + i);
+            engine->VertexAttribPointer(instance_matrix_attribute + i, 4, CoreEngine::GLEnums::FLOAT,
+                false, sizeof(float) * 16, (void*)(sizeof(float) * 4 * i));
+            engine->VertexAttribDivisor(instance_matrix_attribute + i, 1);
+        }
+    } else {
+        engine->BindBuffer(CoreEngine::GLEnums::ARRAY_BUFFER, instance_vbo);
+    }
+
+    instance_buffer_size = sizeof(float) * 16 * count;
+    engine->BufferData(CoreEngine::GLEnums::ARRAY_BUFFER, instance_buffer_size,
+        model_matrices, CoreEngine::GLEnums::STREAM_DRAW);
+
+    engine->DrawElementsInstanced(primitive_type, num_indices, index_type, 0, count);
 }
 
 bool Mesh::IntersectRay(const Ray &ray, const Transform &transform, RaytestHit &out) const
 {
-    if (primitive_type != PRIM_TRIANGLES) {
+    if (primitive_type != PRIM_TRIANGLES || (is_released && retained_positions.Size() == 0)) {
         // fall back to aabb test
         return Renderable::IntersectRay(ray, transform, out);
     }
 
-    for (size_t i = 0; i < indices.size(); i += 3) {
+    const size_t count = NumTriangleIndices();
+
+    for (size_t i = 0; i < count; i += 3) {
         Triangle t(
-            vertices[indices[i]].GetPosition(),
-            vertices[indices[i + 1]].GetPosition(),
-            vertices[indices[i + 2]].GetPosition()
+            GetTrianglePosition(i),
+            GetTrianglePosition(i + 1),
+            GetTrianglePosition(i + 2)
         );
 
         t *= transform;
@@ -264,16 +545,18 @@ bool Mesh::IntersectRay(const Ray &ray, const Transform &transform, RaytestHitLi
 {
     bool intersected = false;
 
-    if (primitive_type != PRIM_TRIANGLES) {
+    if (primitive_type != PRIM_TRIANGLES || (is_released && retained_positions.Size() == 0)) {
         // fall back to aabb test
         return Renderable::IntersectRay(ray, transform, out);
     }
 
-    for (size_t i = 0; i < indices.size(); i += 3) {
+    const size_t count = NumTriangleIndices();
+
+    for (size_t i = 0; i < count; i += 3) {
         Triangle t(
-            vertices[indices[i]].GetPosition(),
-            vertices[indices[i + 1]].GetPosition(),
-            vertices[indices[i + 2]].GetPosition()
+            GetTrianglePosition(i),
+            GetTrianglePosition(i + 1),
+            GetTrianglePosition(i + 2)
         );
 
         t *= transform;
@@ -2,10 +2,13 @@
 #define MESH_H
 
 #include "renderable.h"
+#include "vertex_format.h"
+#include "dynamic_buffer.h"
 #include "../math/vertex.h"
 
 #include <vector>
 #include <map>
+#include <memory>
 
 #include <cstddef>
 #include <cstdint>
@@ -37,12 +40,50 @@ public:
         ATTR_BONEINDICES = 0x80,
     };
 
+    // what is kept on the CPU once the vertex data has been uploaded
+    enum MeshResidency {
+        // vertices and indices are released, ray tests fall back to the aabb
+        RESIDENCY_GPU_ONLY = 0,
+        // a compact copy of the positions and indices is kept for ray tests,
+        // physics shapes and bounds
+        RESIDENCY_POSITIONS,
+        // every vertex is kept, for meshes that are read back or edited after upload
+        RESIDENCY_ALL
+    };
+
+    // positions stored as separate x, y and z arrays, with the indices of the triangles
+    struct RetainedPositions {
+        std::vector<float> x, y, z;
+        std::vector<MeshIndex> indices;
+
+        inline size_t Size() const { return x.size(); }
+        inline Vector3 Get(size_t i) const { return Vector3(x[i], y[i], z[i]); }
+        inline void Clear() { x.clear(); y.clear(); z.clear(); indices.clear(); }
+        size_t NumBytes() const;
+    };
+
+    enum MeshUsage {
+        // uploaded once, changes are written over the existing buffer
+        USAGE_STATIC = 0,
+        // changed often: every change writes the next region of a ring of buffers,
+        // persistently mapped where supported, so updates neither allocate nor stall
+        USAGE_DYNAMIC
+    };
+
+    struct MemoryUsage {
+        // held in vertices, indices and retained positions
+        size_t cpu_bytes;
+        // held in the vertex, index and instance buffers
+        size_t gpu_bytes;
+    };
+
     struct MeshAttribute {
         static const MeshAttribute Positions, Normals,
             TexCoords0, TexCoords1,
             Tangents, Bitangents,
             BoneWeights, BoneIndices;
 
+        // offset is in bytes, set from the vertex format when the mesh is uploaded
         unsigned int offset, size, index;
 
         MeshAttribute()
@@ -71,14 +112,41 @@ public:
     virtual ~Mesh();
 
     void SetVertices(const std::vector<Vertex> &verts);
+    // once uploaded, setting the same number of vertices updates the buffers in place.
+    // drops the meshlets and levels of detail, which were built from the old vertices.
     void SetVertices(const std::vector<Vertex> &verts, const std::vector<MeshIndex> &ind);
+    // replaces count vertices from offset, only uploading that range.
+    // needs the vertex data, so static meshes must use RESIDENCY_ALL.
+    void UpdateVertices(size_t offset, const Vertex *verts, size_t count);
+    // empty once released after upload, unless the residency is RESIDENCY_ALL
     inline const std::vector<Vertex> &GetVertices() const { return vertices; }
     inline const std::vector<MeshIndex> &GetIndices() const { return indices; }
+    // only filled after upload with RESIDENCY_POSITIONS
+    inline const RetainedPositions &GetRetainedPositions() const { return retained_positions; }
+    inline size_t NumIndices() const { return num_indices; }
+    // UNSIGNED_SHORT when every index fits in 16 bits, otherwise UNSIGNED_INT
+    inline int GetIndexType() const { return index_type; }
+    // true while the full vertex data is on the CPU
+    inline bool HasVertexData() const { return !is_released; }
+
+    // takes effect on the next upload. changing it after the vertex data was
+    // released does not bring it back, call SetVertices() again for that.
+    inline void SetResidency(MeshResidency mesh_residency) { residency = mesh_residency; }
+    inline MeshResidency GetResidency() const { return residency; }
+    MemoryUsage GetMemoryUsage() const;
+
+    void SetUsage(MeshUsage mesh_usage);
+    inline MeshUsage GetUsage() const { return usage; }
 
     void SetAttribute(MeshAttributeType type, const MeshAttribute &attribute);
     inline const std::map<MeshAttributeType, MeshAttribute> &GetAttributes() const { return attribs; }
     inline void SetPrimitiveType(PrimitiveType prim_type) { primitive_type = prim_type; }
     inline PrimitiveType GetPrimitiveType() const { return primitive_type; }
+    // the compact packing is used unless a vertex can not be represented by it
+    void SetVertexPacking(VertexPacking packing);
+    inline VertexPacking GetVertexPacking() const { return vertex_packing; }
+    // the format of the uploaded vertex buffer, or nullptr before it is uploaded
+    inline const VertexFormatInfo *GetVertexFormat() const { return vertex_format; }
 
     virtual bool IntersectRay(const Ray &ray, const Transform &transform, RaytestHit &out) const override;
     virtual bool IntersectRay(const Ray &ray, const Transform &transform, RaytestHitList_t &out) const override;
@@ -88,18 +156,61 @@ public:
     void CalculateTangents();
 
     void Render();
+    virtual void RenderRanges(const IndexRange *ranges, size_t count) override;
+
+    virtual bool SupportsInstancing() const override { return true; }
+    virtual void RenderInstanced(const Matrix4 *model_matrices, size_t count) override;
+
+    // first of the four attribute locations holding the per-instance model matrix
+    static const unsigned int instance_matrix_attribute;
 
 private:
-    bool is_uploaded, is_created;
-    unsigned int vao, vbo, ibo, vertex_size;
+    bool is_uploaded, is_created, is_released;
+    unsigned int vao, vbo, ibo;
+    unsigned int instance_vbo;
     std::vector<Vertex> vertices;
     std::vector<MeshIndex> indices;
+    size_t num_indices;
+    int index_type;
+    MeshResidency residency;
+    MeshUsage usage;
+    std::unique_ptr<DynamicBuffer> dynamic_vbo;
+    // range of vertices changed since the last upload
+    size_t dirty_begin, dirty_end;
+    bool indices_dirty;
+    size_t uploaded_vertex_count;
+    // staging memory for partial updates
+    std::vector<unsigned char> upload_buffer;
+    RetainedPositions retained_positions;
+    // scratch for RenderRanges()
+    std::vector<int> range_counts;
+    std::vector<const void*> range_offsets;
+    size_t vertex_buffer_size, index_buffer_size, instance_buffer_size;
     PrimitiveType primitive_type;
+    VertexPacking vertex_packing;
+    const VertexFormatInfo *vertex_format;
 
     // map attribute to offset
     std::map<MeshAttributeType, MeshAttribute> attribs;
 
-    std::vector<float> CreateBuffer();
+    // picks the vertex format for the attributes and vertices, and sets the attribute offsets
+    void SelectVertexFormat();
+    // packs the vertices into the interleaved layout of vertex_format
+    std::vector<unsigned char> CreateBuffer();
+    // creates and uploads the buffers if needed, leaving the vertex array bound
+    void Prepare();
+    void Upload();
+    // uploads only the dirty vertex range and the indices, if they changed
+    void UploadChanges();
+    void WriteDynamicVertices();
+    void SetAttributePointers(size_t base_offset);
+    void UploadIndices(bool reallocate);
+    void MarkVerticesDirty(size_t begin, size_t end);
+    // drops what the residency does not keep, once the buffers are uploaded
+    void ReleaseVertexData();
+    // reads a triangle from the vertices, or the retained positions once released
+    size_t NumTriangleIndices() const;
+    Vector3 GetTrianglePosition(size_t index) const;
 };
 } // namespace apex
 
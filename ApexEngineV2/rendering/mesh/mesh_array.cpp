@@ -1,6 +1,7 @@
 #include "mesh_array.h"
 
 #include "../../util/mesh_factory.h"
+#include "../../util/mesh_optimizer.h"
 
 namespace apex {
 MeshArray::MeshArray()
@@ -57,5 +58,9 @@ void MeshArray::Optimize()
     }
 
     m_submeshes.resize(1);
+
+#if MESH_OPTIMIZER_ENABLED
+    MeshOptimizer::Optimize(m_submeshes[0].mesh);
+#endif
 }
 } // namespace apex
@@ -21,7 +21,7 @@ public:
 
     virtual void Render() override;
 
-    // merges all submeshes into one
+    // merges all submeshes into one, reordered for the vertex cache
     void Optimize();
 
 protected:
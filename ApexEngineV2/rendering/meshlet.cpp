@@ -0,0 +1,93 @@
+#include "meshlet.h"
+#include "camera/camera.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace apex {
+
+MeshletCuller::View::View(const Camera *cam)
+    : position(cam->GetTranslation()),
+      direction(cam->GetDirection()),
+      // with a perspective projection, w does not depend on z
+      is_perspective(cam->GetProjectionMatrix()(3, 3) == 0.0f)
+{
+    for (size_t i = 0; i < planes.size(); i++) {
+        const Vector4 &plane = cam->GetFrustum().GetPlane(i);
+        const float length = std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+
+        planes[i] = length > 0.0f
+            ? Vector4(plane.x / length, plane.y / length, plane.z / length, plane.w / length)
+            : plane;
+    }
+
+    direction.Normalize();
+}
+
+size_t MeshletCuller::Cull(const View &view, const std::vector<Meshlet> &meshlets, const Transform &transform,
+    bool test_frustum, bool cull_backfaces, std::vector<IndexRange> &out_ranges, Stats *stats)
+{
+    const Matrix4 &matrix = transform.GetMatrix();
+    const Vector3 &scale = transform.GetScale();
+    const float max_scale = std::max(std::fabs(scale.x), std::max(std::fabs(scale.y), std::fabs(scale.z)));
+    const float min_scale = std::min(scale.x, std::min(scale.y, scale.z));
+
+    // the cone only bounds the transformed normals under positive, uniform scale
+    cull_backfaces = cull_backfaces && min_scale > 0.0f && max_scale - min_scale <= max_scale * 0.001f;
+
+    const Vector3 origin = Vector3() * matrix;
+    size_t num_added = 0;
+
+    for (const Meshlet &meshlet : meshlets) {
+        const Vector3 center = meshlet.center * matrix;
+        const float radius = meshlet.radius * max_scale;
+
+        bool visible = true;
+
+        if (test_frustum) {
+            for (const Vector4 &plane : view.planes) {
+                if (plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w < -radius) {
+                    visible = false;
+                    break;
+                }
+            }
+        }
+
+        if (visible && cull_backfaces && meshlet.cone_cutoff < 1.0f) {
+            Vector3 axis = meshlet.cone_axis * matrix - origin;
+            axis.Normalize();
+
+            if (view.is_perspective) {
+                // every point of the sphere sees each triangle from behind
+                const Vector3 to_center = center - view.position;
+
+                visible = to_center.Dot(axis) < meshlet.cone_cutoff * to_center.Length() + radius;
+            } else {
+                visible = view.direction.Dot(axis) < meshlet.cone_cutoff;
+            }
+        }
+
+        if (!visible) {
+            if (stats != nullptr) {
+                stats->meshlets_culled++;
+            }
+
+            continue;
+        }
+
+        if (stats != nullptr) {
+            stats->meshlets_drawn++;
+        }
+
+        if (num_added != 0 && out_ranges.back().offset + out_ranges.back().count == meshlet.index_offset) {
+            out_ranges.back().count += meshlet.index_count;
+        } else {
+            out_ranges.push_back({ meshlet.index_offset, meshlet.index_count });
+            num_added++;
+        }
+    }
+
+    return num_added;
+}
+
+} // namespace apex
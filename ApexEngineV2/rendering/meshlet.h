@@ -0,0 +1,68 @@
+#ifndef MESHLET_H
+#define MESHLET_H
+
+#include "../math/vector3.h"
+#include "../math/vector4.h"
+#include "../math/transform.h"
+
+#include <vector>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// set to 0 to always draw meshes split into meshlets as a whole
+#define MESHLET_CULLING_ENABLED 1
+
+namespace apex {
+
+class Camera;
+
+// A cluster of neighbouring triangles, stored as a range of its mesh's indices.
+// Bounded by a sphere, and by a cone holding the normals of its triangles, so
+// clusters facing entirely away from the viewer can be skipped.
+struct Meshlet {
+    uint32_t index_offset;
+    uint32_t index_count;
+    Vector3 center;
+    float radius;
+    Vector3 cone_axis;
+    // sine of the angle between the axis and the edge of the cone.
+    // 1 when the normals are too spread out for the cone to ever cull.
+    float cone_cutoff;
+};
+
+// a range of indices to draw, in indices rather than bytes
+struct IndexRange {
+    uint32_t offset;
+    uint32_t count;
+};
+
+class MeshletCuller {
+public:
+    // what the culling needs from a camera, taken once per bucket
+    struct View {
+        // planes with unit normals, facing into the frustum
+        std::array<Vector4, 6> planes;
+        Vector3 position;
+        Vector3 direction;
+        bool is_perspective;
+
+        View(const Camera *cam);
+    };
+
+    struct Stats {
+        size_t meshlets_drawn = 0;
+        size_t meshlets_culled = 0;
+    };
+
+    // appends the ranges of the meshlets visible from view to out_ranges, joining
+    // runs of meshlets that are next to each other in the index buffer.
+    // back facing meshlets are only culled when cull_backfaces is set, so two sided
+    // materials stay whole. returns the number of ranges added.
+    static size_t Cull(const View &view, const std::vector<Meshlet> &meshlets, const Transform &transform,
+        bool test_frustum, bool cull_backfaces, std::vector<IndexRange> &out_ranges, Stats *stats = nullptr);
+};
+
+} // namespace apex
+
+#endif
@@ -2,6 +2,7 @@
 #include "../../core_engine.h"
 #include "../../gl_util.h"
 #include "../../util/mesh_factory.h"
+#include "../../profiler.h"
 
 namespace apex {
 PostProcessing::PostProcessing()
@@ -32,6 +33,8 @@ void PostProcessing::RemoveFilter(const std::string &tag)
 
 void PostProcessing::Render(Camera *cam, Framebuffer2D *fbo)
 {
+    APEX_PROFILE_SCOPE("PostProcessing::Render");
+
     hard_assert(!m_filters.empty());
 
     if (!m_chained_textures_initialized) {
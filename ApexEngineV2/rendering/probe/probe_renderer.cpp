@@ -2,6 +2,7 @@
 #include "../framebuffer_cube.h"
 #include "../shader_manager.h"
 #include "../shaders/cubemap_renderer_shader.h"
+#include "../../profiler.h"
 
 namespace apex {
 ProbeRenderer::ProbeRenderer(int width, int height)
@@ -39,6 +40,8 @@ void ProbeRenderer::UpdateUniforms()
 
 void ProbeRenderer::Render(Renderer *renderer, Camera *cam)
 {
+    APEX_PROFILE_SCOPE("ProbeRenderer::Render");
+
     m_fbo->Use();
     m_probe->Begin();
 
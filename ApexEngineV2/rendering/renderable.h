@@ -2,6 +2,7 @@
 #define RENDERABLE_H
 
 #include "shader.h"
+#include "meshlet.h"
 #include "../math/vertex.h"
 #include "../math/ray.h"
 #include "../math/bounding_box.h"
@@ -27,6 +28,13 @@ public:
         RB_DEBUG = 5
     };
 
+    // a simpler version of this renderable, drawn while the projected size of its
+    // bounds, as a fraction of the viewport height, is under screen_size
+    struct Lod {
+        std::shared_ptr<Renderable> renderable;
+        float screen_size;
+    };
+
     Renderable(RenderBucket bucket = RB_OPAQUE);
     virtual ~Renderable() = default;
 
@@ -36,15 +44,36 @@ public:
     inline void SetShader(const std::shared_ptr<Shader> &shader) { m_shader = shader; }
     inline const BoundingBox &GetAABB() const { return m_aabb; }
 
+    // levels of detail after this one, ordered from most to least detailed
+    inline const std::vector<Lod> &GetLods() const { return m_lods; }
+    inline void SetLods(const std::vector<Lod> &lods) { m_lods = lods; }
+    inline size_t NumLods() const { return m_lods.size(); }
+    // level 0 is this renderable
+    inline Renderable *GetLod(size_t level)
+        { return level == 0 || level > m_lods.size() ? this : m_lods[level - 1].renderable.get(); }
+
+    // clusters of triangles that RenderRanges() can draw on their own, empty if not split
+    inline const std::vector<Meshlet> &GetMeshlets() const { return m_meshlets; }
+    inline void SetMeshlets(const std::vector<Meshlet> &meshlets) { m_meshlets = meshlets; }
+
     virtual bool IntersectRay(const Ray &ray, const Transform &transform, RaytestHit &out) const;
     virtual bool IntersectRay(const Ray &ray, const Transform &transform, RaytestHitList_t &out) const;
 
     virtual void Render() = 0;
+    // draws only the given ranges of the meshlets
+    virtual void RenderRanges(const IndexRange *ranges, size_t count) { Render(); }
+
+    // renderables that return true here can draw many copies of themselves in one
+    // call, one per model matrix. matrices are column major (already transposed).
+    virtual bool SupportsInstancing() const { return false; }
+    virtual void RenderInstanced(const Matrix4 *model_matrices, size_t count) {}
 
 protected:
     RenderBucket m_bucket;
     std::shared_ptr<Shader> m_shader;
     BoundingBox m_aabb;
+    std::vector<Lod> m_lods;
+    std::vector<Meshlet> m_meshlets;
 };
 
 } // namespace apex
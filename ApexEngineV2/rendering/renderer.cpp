@@ -1,14 +1,20 @@
 #include "renderer.h"
 #include "shader_manager.h"
+#include "uniform_blocks.h"
 #include "postprocess/filters/deferred_rendering_filter.h"
 
+#include "../math/math_util.h"
 #include "../util.h"
+#include "../profiler.h"
+
+#include <algorithm>
 
 namespace apex {
 Renderer::Renderer(const RenderWindow &render_window)
     : m_render_window(render_window),
       m_fbo(nullptr),
-      m_is_deferred(false)
+      m_is_deferred(false),
+      m_synced_epoch(0)
 {
     m_post_processing = new PostProcessing();
 
@@ -16,6 +22,14 @@ Renderer::Renderer(const RenderWindow &render_window)
     m_buckets[Renderable::RB_PARTICLE].enable_culling = false; // TODO
     m_buckets[Renderable::RB_SCREEN].enable_culling = false;
     m_buckets[Renderable::RB_DEBUG].enable_culling = false;
+
+    m_buckets[Renderable::RB_SKY].cull_faces = false;
+    m_buckets[Renderable::RB_SCREEN].cull_faces = false;
+
+    // sky, screen and debug items are drawn in the order they were added
+    m_buckets[Renderable::RB_OPAQUE].sort_mode = Bucket::SORT_FRONT_TO_BACK;
+    m_buckets[Renderable::RB_TRANSPARENT].sort_mode = Bucket::SORT_BACK_TO_FRONT;
+    m_buckets[Renderable::RB_PARTICLE].sort_mode = Bucket::SORT_BACK_TO_FRONT;
 }
 
 Renderer::~Renderer()
@@ -26,11 +40,25 @@ Renderer::~Renderer()
 
 void Renderer::Begin(Camera *cam, Entity *top)
 {
-    FindRenderables(cam, top, false, true);
+    APEX_PROFILE_SCOPE("Renderer::Begin");
+
+    m_frame_stats = FrameStats();
+
+    UniformBlocks::GetInstance()->BeginFrame();
+    UniformBlocks::GetInstance()->UpdateEnvironment();
+
+    FindRenderables(top);
+
+#if RENDERER_LOD_ENABLED
+    // chosen for the main camera only, so every other pass draws the same triangles
+    SelectLods(cam);
+#endif
 }
 
 void Renderer::Render(Camera *cam)
 {
+    APEX_PROFILE_SCOPE("Renderer::Render");
+
     if (m_fbo == nullptr) {
         m_fbo = new Framebuffer2D(
             m_render_window.GetScaledWidth(),
@@ -49,11 +77,11 @@ void Renderer::Render(Camera *cam)
 
 void Renderer::End(Camera *cam, Entity *top)
 {
+    APEX_PROFILE_SCOPE("Renderer::End");
+
     RenderPost(cam, m_fbo);
 
-    CoreEngine::GetInstance()->Disable(CoreEngine::GLEnums::CULL_FACE);
     RenderBucket(cam, m_buckets[Renderable::RB_SCREEN]);
-    CoreEngine::GetInstance()->Enable(CoreEngine::GLEnums::CULL_FACE);
 }
 
 void Renderer::ClearRenderables()
@@ -61,146 +89,500 @@ void Renderer::ClearRenderables()
    for (int i = 0; i < sizeof(m_buckets) / sizeof(Bucket); i++) {
        m_buckets[i].ClearAll();
    }
+
+   // every item has to be added again
+   m_synced_epoch = 0;
 }
 
-void Renderer::FindRenderables(Camera *cam, Entity *top, bool frustum_culled, bool is_root)
+void Renderer::FindRenderables(Entity *top)
 {
-    const size_t entity_hash = top->GetHashCode().Value();
-    size_t previous_hash = 0;
-    const auto it = m_hash_cache.find(top);
-    bool recalc = true;
+    APEX_PROFILE_SCOPE("Renderer::FindRenderables");
 
-    Bucket *new_bucket = nullptr;
+    // changes made from here on fall in the next epoch, and are picked up next frame
+    const uint32_t epoch = Entity::AdvanceChangeEpoch();
 
-    if (it != m_hash_cache.end()) {
-        previous_hash = it->second;
+    FindRenderables(top, false);
 
-        if (previous_hash == entity_hash) {
-            recalc = false;
-        }
+    m_synced_epoch = epoch;
+}
+
+void Renderer::FindRenderables(Entity *entity, bool visit_all)
+{
+    // nothing in this subtree changed since the last sync
+    if (!visit_all && entity->GetSubtreeChangeEpoch() <= m_synced_epoch) {
+        return;
     }
 
-    if (recalc) {
-        if (top->PendingRemoval()) {
-            m_hash_cache.erase(top);
-        } else {
-            m_hash_cache[top] = entity_hash;
+    // only syncs the buckets with the scene; culling happens per bucket in RenderBucket()
+    UpdateBucketItem(entity);
+
+    // a changed transform moves everything beneath it, without stamping it
+    visit_all = visit_all || entity->GetTransformChangeEpoch() > m_synced_epoch;
+
+    for (size_t i = 0; i < entity->NumChildren(); i++) {
+        FindRenderables(entity->GetChild(i).get(), visit_all);
+    }
+
+    for (size_t i = 0; i < entity->NumChildrenPendingRemoval(); i++) {
+        FindRenderables(entity->GetChildPendingRemoval(i).get(), true);
+    }
+}
+
+BucketItem *Renderer::UpdateBucketItem(Entity *entity)
+{
+    auto it = m_entity_states.find(entity);
+
+    // entity is being removed, or its renderable was unset: drop its item.
+    if (entity->PendingRemoval() || entity->GetRenderable() == nullptr) {
+        if (it != m_entity_states.end()) {
+            Bucket &bucket = m_buckets[it->second.bucket];
+
+            if (bucket.IsValid(it->second.handle)) {
+                bucket.RemoveItem(it->second.handle);
+            }
+
+            m_entity_states.erase(it);
         }
+
+        return nullptr;
     }
 
-    if (top->GetRenderable() != nullptr) { // NOTE: this currently doesnt handle renderable being set to null.
-        const Renderable::RenderBucket new_bucket_index = top->GetRenderable()->GetRenderBucket();
+    const Renderable::RenderBucket bucket_index = entity->GetRenderable()->GetRenderBucket();
 
-        hard_assert(new_bucket_index < sizeof(m_buckets) / sizeof(Bucket));
+    hard_assert(bucket_index < sizeof(m_buckets) / sizeof(Bucket));
 
-        new_bucket = &m_buckets[new_bucket_index];
-    
-        if (recalc) {
-            bool push_new = true;
+    Bucket &bucket = m_buckets[bucket_index];
 
-            if (previous_hash != 0) {
-                auto item_in_existing_bucket = m_hash_to_bucket.find(previous_hash);
+    if (it == m_entity_states.end()) {
+        EntityRenderState state;
+        state.revision = entity->GetRevision();
+        state.bucket = bucket_index;
+        state.handle = bucket.AddItem(CreateBucketItem(entity));
 
-                Bucket *previous_bucket = nullptr;
+        m_entity_states[entity] = state;
 
-                // IF bucket has changed, we have to remove the entry from that bucket first.
-                if (item_in_existing_bucket != m_hash_to_bucket.end()) {
-                    const Renderable::RenderBucket previous_bucket_index = item_in_existing_bucket->second;
+        return bucket.GetItemPtr(state.handle);
+    }
 
-                    hard_assert(previous_bucket_index < sizeof(m_buckets) / sizeof(Bucket));
+    EntityRenderState &state = it->second;
 
-                    // remove from prev bucket
-                    previous_bucket = &m_buckets[previous_bucket_index];
+    if (state.bucket != bucket_index || !m_buckets[state.bucket].IsValid(state.handle)) {
+        // bucket has changed (or was cleared), move the item over to the new bucket.
+        if (m_buckets[state.bucket].IsValid(state.handle)) {
+            m_buckets[state.bucket].RemoveItem(state.handle);
+        }
 
-                    m_hash_to_bucket.erase(item_in_existing_bucket);
-                }
+        state.handle = bucket.AddItem(CreateBucketItem(entity));
+    } else if (state.revision != entity->GetRevision()) {
+        bucket.SetItem(state.handle, CreateBucketItem(entity));
+    }
 
-                if (previous_bucket != nullptr) {
-                    if (top->PendingRemoval() || new_bucket != previous_bucket) {
-                        previous_bucket->RemoveItem(previous_hash);
-                    } else {
-                        BucketItem bucket_item;
-                        bucket_item.renderable = top->GetRenderable().get();
-                        bucket_item.material = &top->GetMaterial();
-                        bucket_item.aabb = top->GetAABB();
-                        bucket_item.transform = top->GetGlobalTransform();
-                        bucket_item.hash_code = entity_hash;
-
-                        previous_bucket->SetItem(previous_hash, bucket_item);
-
-                        push_new = false;
-                    }
-                }
+    state.revision = entity->GetRevision();
+    state.bucket = bucket_index;
+
+    return bucket.GetItemPtr(state.handle);
+}
+
+BucketItem Renderer::CreateBucketItem(const Entity *entity) const
+{
+    BucketItem bucket_item;
+    bucket_item.renderable = entity->GetRenderable().get();
+    bucket_item.material = &entity->GetMaterial();
+    bucket_item.material_hash = entity->GetMaterial().GetHashCode().Value();
+    bucket_item.aabb = entity->GetAABB();
+    bucket_item.transform = entity->GetGlobalTransform();
+    bucket_item.id = size_t(entity);
+
+    return bucket_item;
+}
+
+void Renderer::SelectLods(Camera *cam)
+{
+    APEX_PROFILE_SCOPE("Renderer::SelectLods");
+
+    const Matrix4 &projection = cam->GetProjectionMatrix();
+    // with a perspective projection the size shrinks with distance
+    const bool is_perspective = projection(3, 3) == 0.0f;
+
+    for (Bucket &bucket : m_buckets) {
+        const std::vector<BucketItem> &items = bucket.GetItems();
+
+        for (uint32_t i = 0; i < items.size(); i++) {
+            BucketItem &item = bucket.GetItemAt(i);
+            const std::vector<Renderable::Lod> &lods = item.renderable->GetLods();
+
+            if (lods.empty() || item.aabb.Empty()) {
+                item.lod = 0;
+                continue;
             }
 
-            if (!top->PendingRemoval()) {
-                m_hash_to_bucket[entity_hash] = new_bucket_index;
+            const Vector3 center = item.aabb.GetCenter();
+            const float radius = (item.aabb.GetMax() - center).Length();
+            const float distance = is_perspective
+                ? std::max(center.Distance(cam->GetTranslation()) - radius, float(MathUtil::EPSILON))
+                : 1.0f;
+            // fraction of the viewport height covered by the bounding sphere
+            const float screen_size = radius * projection(1, 1) / distance;
 
-                if (push_new) {
-                    BucketItem bucket_item;
-                    bucket_item.renderable = top->GetRenderable().get();
-                    bucket_item.material = &top->GetMaterial();
-                    bucket_item.aabb = top->GetAABB();
-                    bucket_item.transform = top->GetGlobalTransform();
-                    bucket_item.hash_code = entity_hash;
+            size_t lod = std::min(size_t(item.lod), lods.size());
 
-                    new_bucket->AddItem(bucket_item);
-                }
+            // level n is drawn under lods[n - 1].screen_size
+            while (lod < lods.size() && screen_size < lods[lod].screen_size * (1.0f - RENDERER_LOD_HYSTERESIS)) {
+                lod++;
+            }
+
+            while (lod > 0 && screen_size > lods[lod - 1].screen_size * (1.0f + RENDERER_LOD_HYSTERESIS)) {
+                lod--;
             }
+
+            item.lod = uint8_t(lod);
         }
     }
+}
+
+void Renderer::CullBucket(const Frustum &frustum, const Bucket &bucket,
+    CullScratch &scratch, std::vector<uint32_t> &out_indices)
+{
+    const std::vector<BucketItem> &items = bucket.GetItems();
+
+    scratch.candidates.clear();
+    scratch.bounds.Clear();
 
-    if (!frustum_culled && !is_root) {
-        frustum_culled = !MemoizedFrustumCheck(cam, top->GetAABB());
+    // leaves entirely inside the frustum are visible as they are. the tree's leaf
+    // bounds are padded, so leaves on the boundary are tested again on their
+    // exact bounds, in one batch.
+    bucket.GetTree().QueryFrustum(frustum, [&](uint64_t handle, bool inside) {
+        const uint32_t index = bucket.GetIndex(handle);
+
+        if (inside) {
+            out_indices.push_back(index);
+        } else {
+            scratch.candidates.push_back(index);
+            scratch.bounds.Add(items[index].aabb);
+        }
+    });
+
+    frustum.TestBoundingBoxes(scratch.bounds, scratch.mask);
+
+    for (size_t i = 0; i < scratch.candidates.size(); i++) {
+        if (scratch.mask[i / 32] & (1u << (i % 32))) {
+            out_indices.push_back(scratch.candidates[i]);
+        }
     }
+}
+
+void Renderer::QueryFrustum(const Frustum &frustum, std::vector<Entity*> &out) const
+{
+    CullScratch scratch;
+    std::vector<uint32_t> indices;
+
+    for (const Bucket &bucket : m_buckets) {
+        indices.clear();
+        CullBucket(frustum, bucket, scratch, indices);
 
-    if (new_bucket != nullptr) {
-        if (BucketItem *bucket_item_ptr = new_bucket->GetItemPtr(entity_hash)) {
-            bucket_item_ptr->frustum_culled = frustum_culled;
+        for (uint32_t index : indices) {
+            out.push_back(reinterpret_cast<Entity*>(bucket.GetItems()[index].id));
         }
     }
+}
+
+void Renderer::QueryAABB(const BoundingBox &aabb, std::vector<Entity*> &out) const
+{
+    for (const Bucket &bucket : m_buckets) {
+        bucket.GetTree().QueryAABB(aabb, [&bucket, &out](uint64_t handle) {
+            out.push_back(reinterpret_cast<Entity*>(bucket.GetItems()[bucket.GetIndex(handle)].id));
+        });
+    }
+}
+
+void Renderer::QuerySphere(const Vector3 &center, float radius, std::vector<Entity*> &out) const
+{
+    for (const Bucket &bucket : m_buckets) {
+        bucket.GetTree().QuerySphere(center, radius, [&bucket, &out](uint64_t handle) {
+            out.push_back(reinterpret_cast<Entity*>(bucket.GetItems()[bucket.GetIndex(handle)].id));
+        });
+    }
+}
+
+void Renderer::QueryRay(const Ray &ray, std::vector<Entity*> &out) const
+{
+    for (const Bucket &bucket : m_buckets) {
+        bucket.GetTree().QueryRay(ray, [&bucket, &out](uint64_t handle) {
+            out.push_back(reinterpret_cast<Entity*>(bucket.GetItems()[bucket.GetIndex(handle)].id));
+        });
+    }
+}
+
+uint64_t Renderer::CreateSortKey(Camera *cam, size_t bucket_index, Bucket::SortMode sort_mode,
+    const BucketItem &item, const Shader *shader)
+{
+    auto shader_it = m_shader_ids.find(shader);
+
+    if (shader_it == m_shader_ids.end()) {
+        shader_it = m_shader_ids.emplace(shader, uint16_t(m_shader_ids.size())).first;
+    }
+
+    const uint64_t bucket_id = bucket_index & 0x7;
+    const uint64_t shader_id = shader_it->second;
+    const uint64_t material_id = item.material_hash & 0xFFFF;
+    const uint64_t mesh_id = (uintptr_t(item.renderable->GetLod(item.lod)) >> 4) & 0xFFF;
+
+    const Vector3 position = item.aabb.Empty() ? item.transform.GetTranslation() : item.aabb.GetCenter();
+    const float depth = MathUtil::Clamp(
+        position.Distance(cam->GetTranslation()) / std::max(cam->GetFar(), float(MathUtil::EPSILON)),
+        0.0f,
+        1.0f
+    );
+
+    if (sort_mode == Bucket::SORT_BACK_TO_FRONT) {
+        // bucket:3 | inverted depth:24 | shader:16 | material:16 | mesh:5
+        const uint64_t depth_bits = 0xFFFFFF - uint64_t(depth * 0xFFFFFF);
 
-    for (size_t i = 0; i < top->NumChildren(); i++) {
-        Entity *child = top->GetChild(i).get();
-        FindRenderables(cam, child, frustum_culled);
+        return (bucket_id << 61) | (depth_bits << 37) | (shader_id << 21) | (material_id << 5) | (mesh_id & 0x1F);
     }
 
-    for (size_t i = 0; i < top->NumChildrenPendingRemoval(); i++) {
-        Entity *child = top->GetChildPendingRemoval(i).get();
-        FindRenderables(cam, child, frustum_culled);
+    // bucket:3 | shader:16 | material:16 | mesh:12 | depth:17
+    const uint64_t depth_bits = uint64_t(depth * 0x1FFFF);
+
+    return (bucket_id << 61) | (shader_id << 45) | (material_id << 29) | (mesh_id << 17) | depth_bits;
+}
+
+void Renderer::SortBucket(Camera *cam, const Bucket &bucket, Shader *override_shader, bool enable_frustum_culling)
+{
+    APEX_PROFILE_SCOPE("Renderer::SortBucket");
+
+    const std::vector<BucketItem> &items = bucket.GetItems();
+    const size_t num_buckets = sizeof(m_buckets) / sizeof(Bucket);
+    const size_t bucket_index = (&bucket >= m_buckets && &bucket < m_buckets + num_buckets)
+        ? size_t(&bucket - m_buckets)
+        : 0;
+
+    m_sort_items.clear();
+    m_sort_items.reserve(items.size());
+
+    auto add_item = [&](uint32_t index) {
+        const BucketItem &it = items[index];
+
+        const Shader *shader = (override_shader ? override_shader : it.renderable->m_shader.get());
+
+        if (shader == nullptr) {
+            return;
+        }
+
+        SortItem sort_item;
+        sort_item.key = bucket.sort_mode == Bucket::SORT_NONE
+            ? index
+            : CreateSortKey(cam, bucket_index, bucket.sort_mode, it, shader);
+        sort_item.index = index;
+
+        m_sort_items.push_back(sort_item);
+    };
+
+    if (enable_frustum_culling) {
+        m_visible_indices.clear();
+        CullBucket(cam->GetFrustum(), bucket, m_cull_scratch, m_visible_indices);
+
+        for (uint32_t index : m_visible_indices) {
+            add_item(index);
+        }
+
+        // tree order is arbitrary, so unsorted buckets are put back in insertion order
+        RadixSort(m_sort_items, m_sort_scratch);
+    } else {
+        for (size_t i = 0; i < items.size(); i++) {
+            add_item(uint32_t(i));
+        }
+
+        if (bucket.sort_mode != Bucket::SORT_NONE) {
+            RadixSort(m_sort_items, m_sort_scratch);
+        }
     }
 }
 
-bool Renderer::MemoizedFrustumCheck(Camera *cam, const BoundingBox &aabb)
+void Renderer::RadixSort(std::vector<SortItem> &items, std::vector<SortItem> &scratch)
 {
-    return cam->GetFrustum().BoundingBoxInFrustum(aabb);
+    if (items.size() < 2) {
+        return;
+    }
+
+    // least significant byte first. each pass is stable, so ties keep insertion order.
+    scratch.resize(items.size());
+
+    for (int shift = 0; shift < 64; shift += 8) {
+        size_t offsets[256] = { 0 };
+
+        for (const SortItem &item : items) {
+            offsets[(item.key >> shift) & 0xFF]++;
+        }
+
+        // every key shares this byte, nothing to reorder
+        if (offsets[(items.front().key >> shift) & 0xFF] == items.size()) {
+            continue;
+        }
+
+        size_t total = 0;
+
+        for (size_t &offset : offsets) {
+            const size_t count = offset;
+            offset = total;
+            total += count;
+        }
+
+        for (const SortItem &item : items) {
+            scratch[offsets[(item.key >> shift) & 0xFF]++] = item;
+        }
+
+        items.swap(scratch);
+    }
 }
 
 void Renderer::RenderBucket(Camera *cam, Bucket &bucket, Shader *override_shader, bool enable_frustum_culling)
 {
+    APEX_PROFILE_SCOPE("Renderer::RenderBucket");
+
     enable_frustum_culling = enable_frustum_culling && bucket.enable_culling;
 
-    Shader *shader = nullptr;
+    SortBucket(cam, bucket, override_shader, enable_frustum_culling);
 
-    for (const BucketItem &it : bucket.GetItems()) {
-        if (!it.alive) {
-            continue;
+    const std::vector<BucketItem> &items = bucket.GetItems();
+
+#if MESHLET_CULLING_ENABLED
+    const MeshletCuller::View meshlet_view(cam);
+#endif
+
+    // the shader and item whose material is currently applied
+    Shader *bound_shader = nullptr;
+    const BucketItem *bound_item = nullptr;
+
+    for (size_t i = 0; i < m_sort_items.size();) {
+        const BucketItem &it = items[m_sort_items[i].index];
+
+        Shader *shader = (override_shader ? override_shader : it.renderable->m_shader.get());
+
+        // the run of consecutive items that can be drawn together with this one
+        size_t run_end = i + 1;
+
+#if RENDERER_INSTANCING
+        if (it.renderable->SupportsInstancing()) {
+            while (run_end < m_sort_items.size()) {
+                const BucketItem &next = items[m_sort_items[run_end].index];
+
+                if (next.renderable != it.renderable || next.lod != it.lod ||
+                    (override_shader == nullptr && next.renderable->m_shader.get() != shader) ||
+                    (next.material != it.material && !next.material->SetsSameStateAs(*it.material))) {
+                    break;
+                }
+
+                run_end++;
+            }
         }
 
-        if (enable_frustum_culling && it.frustum_culled) {
-            continue;
+        Shader *instanced_shader = nullptr;
+
+        if (run_end - i >= RENDERER_INSTANCING_MIN_COUNT) {
+            instanced_shader = shader->GetInstancedVariant();
+        }
+
+        if (instanced_shader != nullptr) {
+            shader = instanced_shader;
+        } else {
+            run_end = i + 1;
         }
+#endif
+
+        Renderable *renderable = it.renderable->GetLod(it.lod);
+
+#if MESHLET_CULLING_ENABLED
+        // culled before any state is set, so items with nothing visible cost no binds
+        // the bounds are of the bind pose, so skinned draws are never culled per meshlet
+        const bool draw_meshlets = run_end - i == 1 && !renderable->GetMeshlets().empty() &&
+            !shader->GetProperties().GetValue("SKINNING").IsTruthy();
+
+        if (draw_meshlets) {
+            // back faces are only skipped where the rasterizer would skip them too
+            const bool cull_backfaces = bucket.cull_faces && it.material->cull_faces == MaterialFace_Back;
+
+            MeshletCuller::Stats meshlet_stats;
+            m_meshlet_ranges.clear();
+
+            MeshletCuller::Cull(meshlet_view, renderable->GetMeshlets(), it.transform,
+                enable_frustum_culling, cull_backfaces, m_meshlet_ranges, &meshlet_stats);
+
+            m_frame_stats.meshlets_drawn += meshlet_stats.meshlets_drawn;
+            m_frame_stats.meshlets_culled += meshlet_stats.meshlets_culled;
+
+            if (m_meshlet_ranges.empty()) {
+                i = run_end;
+                continue;
+            }
+        }
+#endif
+
+        const bool same_material = shader == bound_shader && bound_item != nullptr &&
+            (bound_item->material == it.material || bound_item->material->SetsSameStateAs(*it.material));
 
-        // TODO: group by same shader
-        shader = (override_shader ? override_shader : it.renderable->m_shader.get());
+        if (!same_material) {
+            if (bound_shader != shader) {
+                if (bound_shader != nullptr) {
+                    bound_shader->End();
+                }
+
+                m_frame_stats.program_switches++;
+            }
 
-        if (shader) {
+            // sets all of the state the previous material may have changed
+            shader->ApplyRenderState(*it.material, bucket.cull_faces);
             shader->ApplyMaterial(*it.material);
-            shader->ApplyTransforms(it.transform, cam);
-            shader->Use();
-            it.renderable->Render();
-            shader->End();
+            m_frame_stats.material_switches++;
+
+            bound_shader = shader;
+            bound_item = &it;
         }
+
+        shader->ApplyTransforms(it.transform, cam);
+        shader->Use();
+
+        if (it.lod != 0) {
+            m_frame_stats.lod_items += run_end - i;
+        }
+
+        if (run_end - i > 1) {
+            m_instance_matrices.clear();
+
+            for (size_t j = i; j < run_end; j++) {
+                m_instance_matrices.push_back(items[m_sort_items[j].index].transform.GetMatrix());
+                m_instance_matrices.back().Transpose(); // uniforms are uploaded transposed too
+            }
+
+            renderable->RenderInstanced(m_instance_matrices.data(), m_instance_matrices.size());
+
+            m_frame_stats.instanced_draw_calls++;
+            m_frame_stats.instances += run_end - i;
+#if MESHLET_CULLING_ENABLED
+        } else if (draw_meshlets) {
+            renderable->RenderRanges(m_meshlet_ranges.data(), m_meshlet_ranges.size());
+#endif
+        } else {
+            renderable->Render();
+        }
+
+        m_frame_stats.draw_calls++;
+        i = run_end;
+
+        if (!shader->IsBound()) {
+            // the renderable used a shader of its own, which changed the program and render state
+            bound_shader = nullptr;
+            bound_item = nullptr;
+        }
+    }
+
+    if (bound_shader != nullptr) {
+        bound_shader->End();
+    }
+
+    if (!m_sort_items.empty()) {
+        // whatever draws next may not set any state of its own
+        Shader::ResetMaterial();
     }
 }
 
@@ -215,9 +597,7 @@ void Renderer::RenderAll(Camera *cam, Framebuffer2D *fbo)
 
     CoreEngine::GetInstance()->Clear(CoreEngine::GLEnums::COLOR_BUFFER_BIT | CoreEngine::GLEnums::DEPTH_BUFFER_BIT);
 
-    CoreEngine::GetInstance()->Disable(CoreEngine::GLEnums::CULL_FACE);
     RenderBucket(cam, m_buckets[Renderable::RB_SKY]);
-    CoreEngine::GetInstance()->Enable(CoreEngine::GLEnums::CULL_FACE);
     RenderBucket(cam, m_buckets[Renderable::RB_OPAQUE]);
     RenderBucket(cam, m_buckets[Renderable::RB_TRANSPARENT]);
     RenderBucket(cam, m_buckets[Renderable::RB_PARTICLE]);
@@ -3,6 +3,7 @@
 
 #include <vector>
 #include <map>
+#include <unordered_map>
 #include <cstdlib>
 
 #include "../util.h"
@@ -10,64 +11,98 @@
 #include "../entity.h"
 #include "../hash_code.h"
 #include "math/bounding_box.h"
+#include "math/dynamic_bvh.h"
+#include "math/ray.h"
 #include "render_window.h"
 #include "material.h"
 #include "camera/camera.h"
 #include "framebuffer_2d.h"
 #include "postprocess/post_processing.h"
 
-namespace apex {
-
-struct MemoizedFrustumCheckKey {
-    size_t frustum_hash_code;
-    size_t aabb_hash_code;
-};
+// draw runs of items sharing a renderable, shader and material with one instanced call
+#define RENDERER_INSTANCING 1
+#define RENDERER_INSTANCING_MIN_COUNT 2
+// pick a level of detail for each item from its projected size, once per frame
+#define RENDERER_LOD_ENABLED 1
+// how far past a level's screen size an item must go before switching,
+// so items near the threshold do not switch back and forth every frame
+#define RENDERER_LOD_HYSTERESIS 0.1f
 
+namespace apex {
 
 struct BucketItem {
     Renderable *renderable;
-    Material *material;
+    const Material *material;
+    size_t material_hash; // taken when the item was last updated, used for draw ordering
     BoundingBox aabb;
     Transform transform;
-    size_t hash_code;
-    bool frustum_culled;
-    bool alive;
+    size_t id;
+    DynamicBVH::ProxyId_t proxy; // managed by the bucket
+    uint8_t lod; // level of detail drawn, managed by the renderer
 
     BucketItem()
         : renderable(nullptr),
           material(nullptr),
+          material_hash(0),
           aabb(),
           transform(),
-          hash_code(0),
-          frustum_culled(false),
-          alive(true)
+          id(0),
+          proxy(DynamicBVH::null_proxy),
+          lod(0)
     {
     }
 
     BucketItem(const BucketItem &other)
         : renderable(other.renderable),
           material(other.material),
+          material_hash(other.material_hash),
           aabb(other.aabb),
           transform(other.transform),
-          hash_code(other.hash_code),
-          frustum_culled(other.frustum_culled),
-          alive(other.alive)
+          id(other.id),
+          proxy(other.proxy),
+          lod(other.lod)
     {
     }
 };
 
+// Dense array of items with a generational sparse index.
+// Removing an item swaps the last item into its place, so the array never
+// holds dead entries; handles stay valid across those moves and go stale
+// (rather than aliasing a new item) once their item is removed.
+// The exception is SORT_NONE, which draws in insertion order: there removal
+// shifts every later item down and reindexes it, O(n) in the bucket's size.
+// Buckets with culling enabled also keep every item with a non-empty aabb in
+// a bounding volume hierarchy, whose user data is the item's handle.
+// NOTE: enable_culling must be set before any items are added.
 struct Bucket {
+    using Handle_t = uint64_t;
+
+    enum SortMode {
+        SORT_NONE, // draw in insertion order
+        SORT_FRONT_TO_BACK, // group by state, then nearest first
+        SORT_BACK_TO_FRONT // farthest first, then group by state
+    };
+
     bool enable_culling;
+    bool cull_faces; // when false, back faces are drawn whatever the material says
+    SortMode sort_mode;
 
     Bucket()
-        : enable_culling(true)
+        : enable_culling(true),
+          cull_faces(true),
+          sort_mode(SORT_NONE)
     {
     }
 
     Bucket(const Bucket &other)
         : enable_culling(other.enable_culling),
+          cull_faces(other.cull_faces),
+          sort_mode(other.sort_mode),
           items(other.items),
-          hash_to_item_index(other.hash_to_item_index)
+          item_slots(other.item_slots),
+          slots(other.slots),
+          free_slots(other.free_slots),
+          tree(other.tree)
     {
     }
 
@@ -76,97 +111,162 @@ struct Bucket {
         return items;
     }
 
-    std::size_t GetIndex(size_t at)
+    inline const DynamicBVH &GetTree() const
     {
-        const auto it = hash_to_item_index.find(at);
-        ex_assert(it != hash_to_item_index.end());
+        return tree;
+    }
 
-        return it->second;
+    inline uint32_t GetIndex(Handle_t handle) const
+    {
+        return slots[uint32_t(handle)].index;
     }
 
-    BucketItem *GetItemPtr(size_t at)
+    inline bool IsValid(Handle_t handle) const
     {
-        const auto it = hash_to_item_index.find(at);
+        const uint32_t slot = uint32_t(handle);
+
+        return slot < slots.size() && slots[slot].generation == uint32_t(handle >> 32);
+    }
 
-        if (it == hash_to_item_index.end())
-        {
+    BucketItem *GetItemPtr(Handle_t handle)
+    {
+        if (!IsValid(handle)) {
             return nullptr;
         }
 
-        const size_t index = it->second;
-        ex_assert(index < items.size());
-
-        return &items[index];
+        return &items[slots[uint32_t(handle)].index];
     }
 
-    BucketItem &GetItem(size_t at)
+    // index as returned by GetIndex(), or into GetItems()
+    inline BucketItem &GetItemAt(uint32_t index)
     {
-        const auto it = hash_to_item_index.find(at);
-        ex_assert(it != hash_to_item_index.end());
+        return items[index];
+    }
 
-        const size_t index = it->second;
-        ex_assert(index < items.size());
+    BucketItem &GetItem(Handle_t handle)
+    {
+        ex_assert(IsValid(handle));
 
-        return items[index];
+        return items[slots[uint32_t(handle)].index];
     }
 
-    void AddItem(const BucketItem &bucket_item)
+    Handle_t AddItem(const BucketItem &bucket_item)
     {
-        const auto it = hash_to_item_index.find(bucket_item.hash_code);
-        ex_assert(it == hash_to_item_index.end());
+        uint32_t slot;
+
+        if (!free_slots.empty()) {
+            slot = free_slots.back();
+            free_slots.pop_back();
+        } else {
+            slot = uint32_t(slots.size());
+            slots.push_back(Slot());
+        }
 
-        const size_t index = items.size();
+        slots[slot].index = uint32_t(items.size());
+
+        const Handle_t handle = (Handle_t(slots[slot].generation) << 32) | slot;
 
         items.push_back(bucket_item);
-        hash_to_item_index[bucket_item.hash_code] = index;
+        item_slots.push_back(slot);
+
+        items.back().proxy = DynamicBVH::null_proxy;
+        UpdateProxy(items.back(), handle);
+
+        return handle;
     }
 
-    void SetItem(size_t at, const BucketItem &bucket_item)
+    void SetItem(Handle_t handle, const BucketItem &bucket_item)
     {
-        const auto it = hash_to_item_index.find(at);
-        ex_assert(it != hash_to_item_index.end());
-
-        const size_t index = it->second;
-        ex_assert(index < items.size());
+        BucketItem &item = GetItem(handle);
+        const DynamicBVH::ProxyId_t proxy = item.proxy;
+        // keep the level of detail, so hysteresis carries across updates
+        const uint8_t lod = item.renderable == bucket_item.renderable ? item.lod : 0;
 
-        items[index] = bucket_item;
+        item = bucket_item;
+        item.proxy = proxy;
+        item.lod = lod;
 
-        if (bucket_item.hash_code != at) {
-            hash_to_item_index.erase(it);
-            hash_to_item_index[bucket_item.hash_code] = index;
-        }
+        UpdateProxy(item, handle);
     }
 
-    void RemoveItem(size_t at)
+    void RemoveItem(Handle_t handle)
     {
-        const auto it = hash_to_item_index.find(at);
-        ex_assert(it != hash_to_item_index.end());
+        ex_assert(IsValid(handle));
 
-        const size_t index = it->second;
-        ex_assert(index < items.size());
+        const uint32_t slot = uint32_t(handle);
+        const uint32_t index = slots[slot].index;
+        const uint32_t last = uint32_t(items.size() - 1);
 
-        hash_to_item_index.erase(it);
-        //items.erase(items.begin() + index);
-
-        // refrain from erasing in the middle of the vector,
-        // which would lose indexes
+        if (items[index].proxy != DynamicBVH::null_proxy) {
+            tree.DestroyProxy(items[index].proxy);
+        }
 
-        items[index].alive = false;
+        if (sort_mode == SORT_NONE) {
+            // draw order is insertion order, so shift the remaining items down
+            items.erase(items.begin() + index);
+            item_slots.erase(item_slots.begin() + index);
+
+            for (uint32_t i = index; i < last; i++) {
+                slots[item_slots[i]].index = i;
+            }
+        } else {
+            if (index != last) {
+                items[index] = items[last];
+                item_slots[index] = item_slots[last];
+                slots[item_slots[index]].index = index;
+            }
 
-        if (index == items.size() - 1) {
             items.pop_back();
+            item_slots.pop_back();
         }
+
+        // outstanding handles to this slot are now stale
+        slots[slot].generation++;
+        free_slots.push_back(slot);
     }
 
     void ClearAll()
     {
+        for (uint32_t slot : item_slots) {
+            slots[slot].generation++;
+            free_slots.push_back(slot);
+        }
+
         items.clear();
+        item_slots.clear();
+        tree.Clear();
     }
 
 private:
+    struct Slot {
+        uint32_t index = 0;
+        uint32_t generation = 0;
+    };
 
     std::vector<BucketItem> items;
-    std::map<std::size_t, std::size_t> hash_to_item_index;
+    std::vector<uint32_t> item_slots; // dense index -> slot
+    std::vector<Slot> slots; // slot -> dense index
+    std::vector<uint32_t> free_slots;
+    DynamicBVH tree;
+
+    void UpdateProxy(BucketItem &item, Handle_t handle)
+    {
+        if (!enable_culling) {
+            return;
+        }
+
+        // items without bounds are never visible to the culling queries
+        if (item.aabb.Empty()) {
+            if (item.proxy != DynamicBVH::null_proxy) {
+                tree.DestroyProxy(item.proxy);
+                item.proxy = DynamicBVH::null_proxy;
+            }
+        } else if (item.proxy == DynamicBVH::null_proxy) {
+            item.proxy = tree.CreateProxy(item.aabb, handle);
+        } else {
+            tree.MoveProxy(item.proxy, item.aabb);
+        }
+    }
 };
 
 using Bucket_t = std::vector<BucketItem>;
@@ -196,6 +296,26 @@ public:
 
     inline Bucket &GetBucket(Renderable::RenderBucket bucket) { return m_buckets[bucket]; }
 
+    // spatial queries over the entities in every culled bucket, as of the last Begin()
+    void QueryFrustum(const Frustum &frustum, std::vector<Entity*> &out) const;
+    void QueryAABB(const BoundingBox &aabb, std::vector<Entity*> &out) const;
+    void QuerySphere(const Vector3 &center, float radius, std::vector<Entity*> &out) const;
+    void QueryRay(const Ray &ray, std::vector<Entity*> &out) const;
+
+    struct FrameStats {
+        size_t draw_calls = 0;
+        size_t instanced_draw_calls = 0; // included in draw_calls
+        size_t instances = 0; // items drawn by instanced calls
+        size_t program_switches = 0;
+        size_t material_switches = 0;
+        size_t lod_items = 0; // items drawn at a level of detail other than the full one
+        size_t meshlets_drawn = 0;
+        size_t meshlets_culled = 0;
+    };
+
+    // counters for the last frame, reset in Begin()
+    inline const FrameStats &GetFrameStats() const { return m_frame_stats; }
+
     Bucket m_buckets[6];
 
 private:
@@ -204,14 +324,53 @@ private:
     RenderWindow m_render_window;
     bool m_is_deferred;
 
-    std::map<Entity*, std::size_t> m_hash_cache;
-    std::map<std::size_t, Renderable::RenderBucket> m_hash_to_bucket;
+    // what was last pushed into the buckets for each renderable entity,
+    // so unchanged entities can be skipped without rehashing them every frame.
+    struct EntityRenderState {
+        size_t revision;
+        Renderable::RenderBucket bucket;
+        Bucket::Handle_t handle;
+    };
 
-    void ClearRenderables();
-    void FindRenderables(Camera *cam, Entity *top, bool frustum_culled = false, bool is_root = false);
-    bool MemoizedFrustumCheck(Camera *cam, const BoundingBox &aabb);
+    std::unordered_map<Entity*, EntityRenderState> m_entity_states;
+    // the change epoch the buckets were last synced in, see Entity::GetSubtreeChangeEpoch()
+    uint32_t m_synced_epoch;
+
+    struct SortItem {
+        uint64_t key;
+        uint32_t index;
+    };
 
-    std::map<MemoizedFrustumCheckKey, bool> m_memoized_frustum_checks; // TODO: some sort of deque map
+    std::vector<SortItem> m_sort_items;
+    std::vector<SortItem> m_sort_scratch;
+    std::unordered_map<const Shader*, uint16_t> m_shader_ids;
+    FrameStats m_frame_stats;
+
+    void ClearRenderables();
+    void FindRenderables(Entity *top);
+    // visits only the subtrees changed since the last sync, unless visit_all is set
+    void FindRenderables(Entity *entity, bool visit_all);
+    BucketItem *UpdateBucketItem(Entity *entity);
+    BucketItem CreateBucketItem(const Entity *entity) const;
+    void SelectLods(Camera *cam);
+    uint64_t CreateSortKey(Camera *cam, size_t bucket_index, Bucket::SortMode sort_mode,
+        const BucketItem &item, const Shader *shader);
+    void SortBucket(Camera *cam, const Bucket &bucket, Shader *override_shader, bool enable_frustum_culling);
+    static void RadixSort(std::vector<SortItem> &items, std::vector<SortItem> &scratch);
+
+    struct CullScratch {
+        std::vector<uint32_t> candidates;
+        BoundingBoxBatch bounds;
+        std::vector<uint32_t> mask;
+    };
+
+    CullScratch m_cull_scratch;
+    std::vector<uint32_t> m_visible_indices;
+    std::vector<Matrix4> m_instance_matrices;
+    std::vector<IndexRange> m_meshlet_ranges;
+
+    static void CullBucket(const Frustum &frustum, const Bucket &bucket,
+        CullScratch &scratch, std::vector<uint32_t> &out_indices);
 };
 } // namespace apex
 
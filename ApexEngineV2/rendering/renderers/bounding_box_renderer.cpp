@@ -16,6 +16,8 @@ BoundingBoxRenderer::BoundingBoxRenderer()
     m_vertices.resize(8);
 
     m_mesh->SetPrimitiveType(Mesh::PRIM_LINES);
+    // the corners are set every frame
+    m_mesh->SetUsage(Mesh::USAGE_DYNAMIC);
 
     m_shader.reset(new Shader(ShaderProperties(), ShaderCode::aabb_debug_vs, ShaderCode::aabb_debug_fs));
 }
@@ -1,19 +1,32 @@
 #include "shader.h"
 #include "../util/string_util.h"
-#include "../util/shader_preprocessor.h"
 #include "../util.h"
+#include "../core_engine.h"
 #include "../gl_util.h"
+#include "uniform_blocks.h"
+#include "shader_cache.h"
+#include "shader_warmup.h"
+#include "shader_manager.h"
+#include "texture_arrays.h"
+
+#include <algorithm>
 
 namespace apex {
 
+unsigned int Shader::bound_program = 0;
+
 Shader::Shader(const ShaderProperties &properties)
     : m_properties(properties),
-      m_previous_properties_hash_code(properties.GetHashCode().Value()),
       m_override_cull(MaterialFaceCull::MaterialFace_None),
+      m_instanced_variant_created(false),
       is_uploaded(false),
       is_created(false),
-      uniform_changed(false)
+      m_previous_properties_hash_code(properties.GetHashCode().Value()),
+      m_previous_properties_generation(0),
+      m_used_texture_units(0),
+      m_uniform_blocks(0)
 {
+    RegisterBaseUniforms();
     ResetUniforms();
 }
 
@@ -21,12 +34,16 @@ Shader::Shader(const ShaderProperties &properties,
     const std::string &vscode,
     const std::string &fscode)
     : m_properties(properties),
-      m_previous_properties_hash_code(properties.GetHashCode().Value()),
       m_override_cull(MaterialFaceCull::MaterialFace_None),
+      m_instanced_variant_created(false),
       is_uploaded(false),
       is_created(false),
-      uniform_changed(false)
+      m_previous_properties_hash_code(properties.GetHashCode().Value()),
+      m_previous_properties_generation(0),
+      m_used_texture_units(0),
+      m_uniform_blocks(0)
 {
+    RegisterBaseUniforms();
     AddSubShader(SubShaderType::SUBSHADER_VERTEX, vscode, properties, "");
     AddSubShader(SubShaderType::SUBSHADER_FRAGMENT, fscode, properties, "");
 
@@ -38,16 +55,88 @@ Shader::~Shader()
     DestroyGpuData();
 }
 
+void Shader::RegisterBaseUniforms()
+{
+    m_uniform_model_matrix = GetUniformHandle("u_modelMatrix");
+    m_uniform_view_matrix = GetUniformHandle("u_viewMatrix");
+    m_uniform_proj_matrix = GetUniformHandle("u_projMatrix");
+    m_uniform_view_proj_matrix = GetUniformHandle("u_viewProjMatrix");
+
+    m_uniform_has_maps = {
+        GetUniformHandle("HasDiffuseMap"),
+        GetUniformHandle("HasNormalMap"),
+        GetUniformHandle("HasParallaxMap"),
+        GetUniformHandle("HasAoMap"),
+        GetUniformHandle("HasBrdfMap"),
+        GetUniformHandle("HasMetalnessMap"),
+        GetUniformHandle("HasRoughnessMap")
+    };
+}
+
+Shader::UniformHandle_t Shader::GetUniformHandle(const std::string &name)
+{
+    auto it = m_uniform_handles.find(name);
+
+    if (it != m_uniform_handles.end()) {
+        return it->second;
+    }
+
+    const UniformHandle_t handle = UniformHandle_t(m_uniforms.size());
+
+    UniformSlot slot;
+    slot.name = name;
+    slot.location = is_uploaded ? CoreEngine::GetInstance()->GetUniformLocation(progid, name.c_str()) : -1;
+    slot.texture_unit = -1;
+    slot.dirty = false;
+
+    m_uniforms.push_back(slot);
+    m_uniform_handles[name] = handle;
+
+    return handle;
+}
+
+void Shader::ResolveUniforms()
+{
+    m_dirty_uniforms.clear();
+    m_texture_uniforms.clear();
+    m_used_texture_units = 0;
+
+    for (size_t i = 0; i < m_uniforms.size(); i++) {
+        UniformSlot &slot = m_uniforms[i];
+
+        slot.location = CoreEngine::GetInstance()->GetUniformLocation(progid, slot.name.c_str());
+        slot.texture_unit = -1;
+        slot.dirty = false;
+
+        // handles that were registered but never set have nothing to upload
+        if (slot.value.type != Uniform::Uniform_None) {
+            slot.dirty = true;
+            m_dirty_uniforms.push_back(UniformHandle_t(i));
+        }
+    }
+
+    m_uniform_blocks = 0;
+
+    for (int i = 0; i < UniformBlocks::BLOCK_MAX; i++) {
+        const unsigned int index = CoreEngine::GetInstance()->GetUniformBlockIndex(progid, UniformBlocks::block_names[i]);
+
+        if (index != CoreEngine::INVALID_INDEX) {
+            CoreEngine::GetInstance()->UniformBlockBinding(progid, index, i);
+            m_uniform_blocks |= (1u << i);
+        }
+    }
+}
+
 void Shader::CreateGpuData()
 {
     ex_assert(!is_created);
 
-    progid = glCreateProgram();
+    progid = CoreEngine::GetInstance()->CreateProgram();
 
     CatchGLErrors("Failed to create shader program.");
 
     for (auto &&sub : subshaders) {
-        sub.second.id = glCreateShader(sub.first);
+        sub.second.id = CoreEngine::GetInstance()->CreateShader(sub.first);
 
         CatchGLErrors("Failed to create subshader.");
     }
@@ -59,23 +148,44 @@ void Shader::UploadGpuData()
 {
     ex_assert(is_created && !is_uploaded);
 
+#if SHADER_CACHE_ENABLED
+    std::vector<const std::string*> processed_codes;
+
+    for (auto &&it : subshaders) {
+        processed_codes.push_back(&it.second.processed_code);
+    }
+
+    const uint64_t program_key = ShaderCache::GetInstance()->GetProgramKey(processed_codes);
+
+    // a cached binary already has the attribute and frag data locations linked in
+    if (ShaderCache::GetInstance()->LoadProgram(progid, program_key)) {
+        ResolveUniforms();
+
+        is_uploaded = true;
+
+        return;
+    }
+
+    CoreEngine::GetInstance()->ProgramParameteri(progid, CoreEngine::GLEnums::PROGRAM_BINARY_RETRIEVABLE_HINT, 1);
+#endif
+
     for (auto &&it : subshaders) {
         auto &sub = it.second;
 
         const char *code_str = sub.processed_code.c_str();
-        glShaderSource(sub.id, 1, &code_str, NULL);
-        glCompileShader(sub.id);
-        glAttachShader(progid, sub.id);
+        CoreEngine::GetInstance()->ShaderSource(sub.id, 1, &code_str, NULL);
+        CoreEngine::GetInstance()->CompileShader(sub.id);
+        CoreEngine::GetInstance()->AttachShader(progid, sub.id);
 
         int status = -1;
-        glGetShaderiv(sub.id, GL_COMPILE_STATUS, &status);
+        CoreEngine::GetInstance()->GetShaderiv(sub.id, GL_COMPILE_STATUS, &status);
 
         if (!status) {
             int maxlen;
-            glGetShaderiv(sub.id, GL_INFO_LOG_LENGTH, &maxlen);
+            CoreEngine::GetInstance()->GetShaderiv(sub.id, GL_INFO_LOG_LENGTH, &maxlen);
             char *log = new char[maxlen];
             memset(log, 0, maxlen);
-            glGetShaderInfoLog(sub.id, maxlen, NULL, log);
+            CoreEngine::GetInstance()->GetShaderInfoLog(sub.id, maxlen, NULL, log);
 
             std::cout << "In shader of class " << typeid(*this).name() << ":\n";
             std::cout << "\tShader compile error! ";
@@ -85,38 +195,38 @@ void Shader::UploadGpuData()
         }
     }
 
-    glBindFragDataLocation(progid, 0, "output0");
-    glBindFragDataLocation(progid, 1, "output1");
-    glBindFragDataLocation(progid, 2, "output2");
-    glBindFragDataLocation(progid, 3, "output3");
-    glBindFragDataLocation(progid, 4, "output4");
-    glBindFragDataLocation(progid, 5, "output5");
+    CoreEngine::GetInstance()->BindFragDataLocation(progid, 0, "output0");
+    CoreEngine::GetInstance()->BindFragDataLocation(progid, 1, "output1");
+    CoreEngine::GetInstance()->BindFragDataLocation(progid, 2, "output2");
+    CoreEngine::GetInstance()->BindFragDataLocation(progid, 3, "output3");
+    CoreEngine::GetInstance()->BindFragDataLocation(progid, 4, "output4");
+    CoreEngine::GetInstance()->BindFragDataLocation(progid, 5, "output5");
     CatchGLErrors("Failed to bind shader frag data.");
 
-    glBindAttribLocation(progid, 0, "a_position");
-    glBindAttribLocation(progid, 1, "a_normal");
-    glBindAttribLocation(progid, 2, "a_texcoord0");
-    glBindAttribLocation(progid, 3, "a_texcoord1");
-    glBindAttribLocation(progid, 4, "a_tangent");
-    glBindAttribLocation(progid, 5, "a_bitangent");
-    glBindAttribLocation(progid, 6, "a_boneweights");
-    glBindAttribLocation(progid, 7, "a_boneindices");
+    CoreEngine::GetInstance()->BindAttribLocation(progid, 0, "a_position");
+    CoreEngine::GetInstance()->BindAttribLocation(progid, 1, "a_normal");
+    CoreEngine::GetInstance()->BindAttribLocation(progid, 2, "a_texcoord0");
+    CoreEngine::GetInstance()->BindAttribLocation(progid, 3, "a_texcoord1");
+    CoreEngine::GetInstance()->BindAttribLocation(progid, 4, "a_tangent");
+    CoreEngine::GetInstance()->BindAttribLocation(progid, 5, "a_bitangent");
+    CoreEngine::GetInstance()->BindAttribLocation(progid, 6, "a_boneweights");
+    CoreEngine::GetInstance()->BindAttribLocation(progid, 7, "a_boneindices");
     CatchGLErrors("Failed to bind shader attributes.");
 
-    glLinkProgram(progid);
-    glValidateProgram(progid);
+    CoreEngine::GetInstance()->LinkProgram(progid);
+    CoreEngine::GetInstance()->ValidateProgram(progid);
 
     int linked = 0;
-    glGetProgramiv(progid, GL_LINK_STATUS, &linked);
+    CoreEngine::GetInstance()->GetProgramiv(progid, GL_LINK_STATUS, &linked);
 
     if (!linked) {
         int maxlen = 0;
-        glGetProgramiv(progid, GL_INFO_LOG_LENGTH, &maxlen);
+        CoreEngine::GetInstance()->GetProgramiv(progid, GL_INFO_LOG_LENGTH, &maxlen);
 
         if (maxlen != 0) {
             char *log = new char[maxlen];
 
-            glGetProgramInfoLog(progid, maxlen, NULL, log);
+            CoreEngine::GetInstance()->GetProgramInfoLog(progid, maxlen, NULL, log);
 
             std::cout << "In shader of class " << typeid(*this).name() << ":\n";
             std::cout << "\tShader linker error! ";
@@ -146,7 +256,7 @@ void Shader::UploadGpuData()
                 std::cout << "\n\n";
             }
 
-            glDeleteProgram(progid);
+            CoreEngine::GetInstance()->DeleteProgram(progid);
 
             delete[] log;
 
@@ -154,16 +264,26 @@ void Shader::UploadGpuData()
         }
     }
 
+#if SHADER_CACHE_ENABLED
+    ShaderCache::GetInstance()->StoreProgram(progid, program_key);
+#endif
+
+    ResolveUniforms();
+
     is_uploaded = true;
 }
 
 void Shader::DestroyGpuData()
 {
     if (is_created) {
-        glDeleteProgram(progid);
+        if (bound_program == progid) {
+            bound_program = 0;
+        }
+
+        CoreEngine::GetInstance()->DeleteProgram(progid);
 
         for (auto &&sub : subshaders) {
-            glDeleteShader(sub.second.id);
+            CoreEngine::GetInstance()->DeleteShader(sub.second.id);
         }
     }
 
@@ -171,26 +291,121 @@ void Shader::DestroyGpuData()
     is_uploaded = false;
 }
 
-bool Shader::ShaderPropertiesChanged() const
+int Shader::GetSamplerUnit(const std::string &name)
 {
-    // TODO: memoization
+    static std::unordered_map<std::string, int> units;
+    static int next_unit = 1;
+
+    auto it = units.find(name);
+
+    if (it != units.end()) {
+        return it->second;
+    }
+
+    const int unit = next_unit;
+
+    // once every unit is taken, names start sharing them
+    next_unit = (next_unit + 1 < SHADER_MAX_TEXTURE_UNITS) ? next_unit + 1 : 1;
+
+    units[name] = unit;
+
+    return unit;
+}
+
+int Shader::AssignTextureUnit(const std::string &name)
+{
+    int unit = GetSamplerUnit(name);
+
+    if (m_used_texture_units & (1u << unit)) {
+        // shared with another sampler of this program, so take any free unit
+        unit = 1;
+
+        while (unit < SHADER_MAX_TEXTURE_UNITS - 1 && (m_used_texture_units & (1u << unit))) {
+            unit++;
+        }
+    }
+
+    m_used_texture_units |= (1u << unit);
+
+    return unit;
+}
+
+bool Shader::ShaderPropertiesChanged()
+{
+    // the hash is only compared once the properties have actually been modified
+    if (m_properties.GetGeneration() == m_previous_properties_generation) {
+        return false;
+    }
+
+    m_previous_properties_generation = m_properties.GetGeneration();
+
     return m_properties.GetHashCode().Value() != m_previous_properties_hash_code;
 }
 
 void Shader::ResetUniforms()
 {
-    SetUniform("HasDiffuseMap", 0);
-    SetUniform("HasNormalMap", 0);
-    SetUniform("HasParallaxMap", 0);
-    SetUniform("HasAoMap", 0);
-    SetUniform("HasBrdfMap", 0);
-    SetUniform("HasMetalnessMap", 0);
-    SetUniform("HasRoughnessMap", 0);
+    for (UniformHandle_t handle : m_uniform_has_maps) {
+        SetUniform(handle, 0);
+    }
+}
+
+void Shader::ApplyMaterialTextures(const Material &mat)
+{
+    const bool use_texture_arrays = m_properties.GetValue("TEXTURE_ARRAYS").IsTruthy();
+
+    for (const Material::TextureEntry &entry : mat.GetTextures()) {
+        if (entry.texture == nullptr) {
+            continue;
+        }
+
+        entry.texture->Prepare();
+
+        auto handles_it = std::find_if(m_material_texture_handles.begin(), m_material_texture_handles.end(),
+            [&entry](const MaterialTextureHandles &handles) { return handles.key == entry.key; });
+
+        if (handles_it == m_material_texture_handles.end()) {
+            const std::string &name = Material::GetKeyName(entry.key);
+
+            MaterialTextureHandles handles;
+            handles.key = entry.key;
+            handles.texture = GetUniformHandle(name);
+            handles.has_texture = GetUniformHandle("Has" + name);
+            handles.array = GetUniformHandle(name + "Array");
+            handles.layer = GetUniformHandle(name + "Layer");
+
+            handles_it = m_material_texture_handles.insert(m_material_texture_handles.end(), handles);
+        }
+
+        // only known once linked, so the first draw always takes the plain sampler
+        if (use_texture_arrays && m_uniforms[handles_it->array].location != -1) {
+            const TextureArrays::Layer layer = TextureArrays::GetInstance()->GetLayer(entry.texture);
+
+            if (layer.array != nullptr) {
+                SetUniform(handles_it->array, layer.array.get());
+                SetUniform(handles_it->layer, layer.index);
+                SetUniform(handles_it->has_texture, 1);
+
+                continue;
+            }
+        }
+
+        if (use_texture_arrays) {
+            SetUniform(handles_it->layer, -1);
+        }
+
+        SetUniform(handles_it->texture, entry.texture.get());
+        SetUniform(handles_it->has_texture, 1);
+    }
 }
 
 void Shader::ApplyMaterial(const Material &mat)
 {
     ResetUniforms();
+}
+
+void Shader::ApplyRenderState(const Material &mat, bool cull_faces)
+{
+    CoreEngine *engine = CoreEngine::GetInstance();
 
     MaterialFaceCull cull_mode(mat.cull_faces);
 
@@ -198,37 +413,87 @@ void Shader::ApplyMaterial(const Material &mat)
         cull_mode = m_override_cull;
     }
 
-    if (cull_mode == (MaterialFaceCull::MaterialFace_Front | MaterialFaceCull::MaterialFace_Back)) {
-        glCullFace(GL_FRONT_AND_BACK);
-    } else if (cull_mode & MaterialFaceCull::MaterialFace_Front) {
-        glCullFace(GL_FRONT);
-    } else if (cull_mode & MaterialFaceCull::MaterialFace_Back) {
-        glCullFace(GL_BACK);
-    } else if (cull_mode == MaterialFaceCull::MaterialFace_None) {
-        glDisable(GL_CULL_FACE);
+    if (!cull_faces || cull_mode == MaterialFaceCull::MaterialFace_None) {
+        engine->Disable(GL_CULL_FACE);
+    } else {
+        engine->Enable(GL_CULL_FACE);
+
+        if (cull_mode == (MaterialFaceCull::MaterialFace_Front | MaterialFaceCull::MaterialFace_Back)) {
+            engine->CullFace(GL_FRONT_AND_BACK);
+        } else if (cull_mode & MaterialFaceCull::MaterialFace_Front) {
+            engine->CullFace(GL_FRONT);
+        } else {
+            engine->CullFace(GL_BACK);
+        }
     }
 
     if (mat.alpha_blended) {
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        engine->Enable(GL_BLEND);
+        engine->BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    } else {
+        engine->Disable(GL_BLEND);
     }
-    if (!mat.depth_test) {
-        glDisable(GL_DEPTH_TEST);
+
+    if (mat.depth_test) {
+        engine->Enable(GL_DEPTH_TEST);
+    } else {
+        engine->Disable(GL_DEPTH_TEST);
     }
-    if (!mat.depth_write) {
-        glDepthMask(false);
+
+    engine->DepthMask(mat.depth_write);
+}
+
+void Shader::SetProperties(const ShaderProperties &properties)
+{
+    if (m_properties == properties) {
+        return;
+    }
+
+    // recompiled on the next Use()
+    m_properties = properties;
+
+    // recreated from the new properties when next needed
+    m_instanced_variant = nullptr;
+    m_instanced_variant_created = false;
+}
+
+Shader *Shader::GetInstancedVariant()
+{
+    if (m_properties.GetValue("INSTANCING").IsTruthy()) {
+        return this;
+    }
+
+    if (!m_instanced_variant_created) {
+        // through ShaderManager, so warm-up records the variant along with this one
+        if (HasInstancedVariant(m_properties)) {
+            m_instanced_variant = ShaderManager::GetInstance()->GetInstancedVariant(this);
+        }
+
+        m_instanced_variant_created = true;
     }
+
+    if (m_instanced_variant != nullptr) {
+        m_instanced_variant->m_override_cull = m_override_cull;
+    }
+
+    return m_instanced_variant.get();
 }
 
 void Shader::ApplyTransforms(const Transform &transform, Camera *camera)
 {
-    SetUniform("u_modelMatrix", transform.GetMatrix());
-    SetUniform("u_viewMatrix", camera->GetViewMatrix());
-    SetUniform("u_projMatrix", camera->GetProjectionMatrix());
-    SetUniform("u_viewProjMatrix", camera->GetViewProjectionMatrix());
+    SetUniform(m_uniform_model_matrix, transform.GetMatrix());
+
+    // the program is not linked before its first Use(), so the block is always filled
+    UniformBlocks::GetInstance()->SetCamera(camera);
+
+    if (!HasUniformBlock(UniformBlocks::BLOCK_CAMERA)) {
+        SetUniform(m_uniform_view_matrix, camera->GetViewMatrix());
+        SetUniform(m_uniform_proj_matrix, camera->GetProjectionMatrix());
+        SetUniform(m_uniform_view_proj_matrix, camera->GetViewProjectionMatrix());
+    }
 }
 
-void Shader::Use()
+void Shader::Compile()
 {
     if (!is_created) {
         CreateGpuData();
@@ -248,74 +513,110 @@ void Shader::Use()
 
         m_previous_properties_hash_code = m_properties.GetHashCode().Value();
     }
+}
 
-    glUseProgram(progid);
+void Shader::Use()
+{
+    Compile();
 
-    if (uniform_changed) {
-        int texture_index = 1;
+    if (bound_program != progid) {
+        CoreEngine::GetInstance()->UseProgram(progid);
+        bound_program = progid;
+    }
 
-        for (auto &&uniform : uniforms) {
-            int loc = glGetUniformLocation(progid, uniform.first.c_str());
+    CoreEngine *engine = CoreEngine::GetInstance();
 
-            if (loc != -1) {
-                switch (uniform.second.type) {
-                case Uniform::Uniform_Float:
-                    glUniform1f(loc, uniform.second.data[0]);
-                    break;
-                case Uniform::Uniform_Int:
-                    glUniform1i(loc, (int)uniform.second.data[0]);
-                    break;
-                case Uniform::Uniform_Vector2:
-                    glUniform2f(loc, uniform.second.data[0], uniform.second.data[1]);
-                    break;
-                case Uniform::Uniform_Vector3:
-                    glUniform3f(loc, uniform.second.data[0], uniform.second.data[1],
-                        uniform.second.data[2]);
-                    break;
-                case Uniform::Uniform_Vector4:
-                    glUniform4f(loc, uniform.second.data[0], uniform.second.data[1],
-                        uniform.second.data[2], uniform.second.data[3]);
-                    break;
-                case Uniform::Uniform_Matrix4:
-                    glUniformMatrix4fv(loc, 1, true, &uniform.second.data[0]);
-                    break;
-                case Uniform::Uniform_Texture2D:
-                    Texture::ActiveTexture(texture_index);
-                    glBindTexture(GL_TEXTURE_2D, int(uniform.second.data[0]));
-                    glUniform1i(loc, texture_index);
-                    texture_index++;
-                    break;
-                case Uniform::Uniform_Texture3D:
-                    Texture::ActiveTexture(texture_index);
-                    glBindTexture(GL_TEXTURE_CUBE_MAP, int(uniform.second.data[0]));
-                    glUniform1i(loc, texture_index);
-                    texture_index++;
-                    break;
-                default:
-                    std::cout << "invalid uniform: " << uniform.first << "\n";
-                    break;
-                }
+    for (UniformHandle_t handle : m_dirty_uniforms) {
+        UniformSlot &slot = m_uniforms[handle];
+        slot.dirty = false;
+
+        if (slot.location == -1) {
+            continue;
+        }
 
-                CatchGLErrors((uniform.first + ": Failed to set uniform").c_str(), false);
+        const Uniform &uniform = slot.value;
+
+        switch (uniform.type) {
+        case Uniform::Uniform_Float:
+            engine->Uniform1f(slot.location, uniform.data[0]);
+            break;
+        case Uniform::Uniform_Int:
+            engine->Uniform1i(slot.location, (int)uniform.data[0]);
+            break;
+        case Uniform::Uniform_Vector2:
+            engine->Uniform2f(slot.location, uniform.data[0], uniform.data[1]);
+            break;
+        case Uniform::Uniform_Vector3:
+            engine->Uniform3f(slot.location, uniform.data[0], uniform.data[1],
+                uniform.data[2]);
+            break;
+        case Uniform::Uniform_Vector4:
+            engine->Uniform4f(slot.location, uniform.data[0], uniform.data[1],
+                uniform.data[2], uniform.data[3]);
+            break;
+        case Uniform::Uniform_Matrix4:
+            engine->UniformMatrix4fv(slot.location, 1, true, &uniform.data[0]);
+            break;
+        case Uniform::Uniform_Texture2D:
+        case Uniform::Uniform_Texture3D:
+        case Uniform::Uniform_Texture2DArray:
+            // the sampler keeps its unit; the texture itself is bound below
+            if (slot.texture_unit == -1) {
+                slot.texture_unit = AssignTextureUnit(slot.name);
+                m_texture_uniforms.push_back(handle);
             }
+
+            engine->Uniform1i(slot.location, slot.texture_unit);
+            break;
+        default:
+            std::cout << "invalid uniform: " << slot.name << "\n";
+            break;
+        }
+
+        CatchGLErrors((slot.name + ": Failed to set uniform").c_str(), false);
+    }
+
+    m_dirty_uniforms.clear();
+
+    const RenderState &render_state = engine->GetRenderState();
+
+    for (UniformHandle_t handle : m_texture_uniforms) {
+        const UniformSlot &slot = m_uniforms[handle];
+
+        int target = GL_TEXTURE_2D;
+
+        if (slot.value.type == Uniform::Uniform_Texture3D) {
+            target = GL_TEXTURE_CUBE_MAP;
+        } else if (slot.value.type == Uniform::Uniform_Texture2DArray) {
+            target = CoreEngine::GLEnums::TEXTURE_2D_ARRAY;
         }
 
-        uniform_changed = false;
+        const unsigned int texture = (unsigned int)slot.value.data[0];
+
+        // also saves switching the active unit
+        if (render_state.IsTextureBound(slot.texture_unit, target, texture)) {
+            continue;
+        }
+
+        Texture::ActiveTexture(slot.texture_unit);
+        engine->BindTexture(target, texture);
     }
 }
 
+void Shader::ResetMaterial()
+{
+    CoreEngine::GetInstance()->Disable(GL_BLEND);
+    CoreEngine::GetInstance()->Enable(GL_DEPTH_TEST);
+    CoreEngine::GetInstance()->DepthMask(true);
+    CoreEngine::GetInstance()->Enable(GL_CULL_FACE);
+    CoreEngine::GetInstance()->CullFace(GL_BACK);
+    CoreEngine::GetInstance()->BlendFunc(GL_ONE, GL_ZERO);
+    CoreEngine::GetInstance()->BindTexture(GL_TEXTURE_2D, 0);
+}
+
 void Shader::End()
 {
-    // m_override_cull = MaterialFaceCull::MaterialFace_None;
-    glDisable(GL_BLEND);
-    glEnable(GL_DEPTH_TEST);
-    glDepthMask(true);
-    glEnable(GL_CULL_FACE);
-    glCullFace(GL_BACK);
-    glBlendFunc(GL_ONE, GL_ZERO);
-    glBindTexture(GL_TEXTURE_2D, 0);
-
-    glUseProgram(0);
+    // the program stays in use until another one replaces it, so Use() can skip binding it again
 }
 
 void Shader::AddSubShader(SubShaderType type,
@@ -328,13 +629,17 @@ void Shader::AddSubShader(SubShaderType type,
     sub_shader.type = type;
     sub_shader.code = code;
     sub_shader.path = path;
-    sub_shader.processed_code = ShaderPreprocessor::ProcessShader(code, properties, path);
+    sub_shader.processed_code = ShaderCache::GetInstance()->Preprocess(code, properties, path);
     subshaders[type] = sub_shader;
+
+    ShaderWarmup::GetInstance()->RecordSource(path, properties);
 }
 
 void Shader::ReprocessSubShader(SubShader &sub_shader, const ShaderProperties &properties)
 {
-    sub_shader.processed_code = ShaderPreprocessor::ProcessShader(sub_shader.code, properties, sub_shader.path);
+    sub_shader.processed_code = ShaderCache::GetInstance()->Preprocess(sub_shader.code, properties, sub_shader.path);
+
+    ShaderWarmup::GetInstance()->RecordSource(sub_shader.path, properties);
 }
 
 } // namespace apex
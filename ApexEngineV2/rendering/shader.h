@@ -15,8 +15,14 @@
 #include <vector>
 #include <array>
 #include <map>
+#include <unordered_map>
 #include <string>
 #include <cstring>
+#include <cstdint>
+
+// sampler units handed out by Shader::GetSamplerUnit(). unit 0 is left for
+// binding textures while they are uploaded.
+#define SHADER_MAX_TEXTURE_UNITS 16
 
 namespace apex {
 class Texture;
@@ -75,19 +81,43 @@ public:
         }
     };
 
-    ShaderProperties() {}
+    ShaderProperties()
+        : m_is_hash_dirty(false),
+          m_generation(0)
+    {
+    }
+
     ShaderProperties(const ShaderProperties &other)
-        : m_properties(other.m_properties)
+        : m_properties(other.m_properties),
+          m_hash_code(other.m_hash_code),
+          m_is_hash_dirty(other.m_is_hash_dirty),
+          m_generation(0)
     {
     }
 
-    std::map<std::string, ShaderProperty> m_properties;
+    // the generation is not copied, so it only ever increases for this instance
+    inline ShaderProperties &operator=(const ShaderProperties &other)
+    {
+        m_properties = other.m_properties;
+        m_hash_code = other.m_hash_code;
+        m_is_hash_dirty = other.m_is_hash_dirty;
+        m_generation++;
+
+        return *this;
+    }
 
     inline bool operator==(const ShaderProperties &other) const
     {
-        return m_properties == other.m_properties;
+        return GetHashCode().Value() == other.GetHashCode().Value() &&
+            m_properties == other.m_properties;
     }
 
+    inline bool operator!=(const ShaderProperties &other) const { return !operator==(other); }
+
+    inline const std::map<std::string, ShaderProperty> &GetValues() const { return m_properties; }
+    // incremented whenever a value is defined, merged or assigned
+    inline uint32_t GetGeneration() const { return m_generation; }
+
     inline bool HasValue(const std::string &key) const
     {
         auto it = m_properties.find(key);
@@ -117,6 +147,7 @@ public:
         shader_property.type = ShaderProperty::ShaderPropertyType::SHADER_PROPERTY_STRING;
 
         m_properties[key] = shader_property;
+        Changed();
 
         return *this;
     }
@@ -129,6 +160,7 @@ public:
         shader_property.type = ShaderProperty::ShaderPropertyType::SHADER_PROPERTY_INT;
 
         m_properties[key] = shader_property;
+        Changed();
 
         return *this;
     }
@@ -141,6 +173,7 @@ public:
         shader_property.type = ShaderProperty::ShaderPropertyType::SHADER_PROPERTY_FLOAT;
 
         m_properties[key] = shader_property;
+        Changed();
 
         return *this;
     }
@@ -153,34 +186,61 @@ public:
         shader_property.type = ShaderProperty::ShaderPropertyType::SHADER_PROPERTY_BOOL;
 
         m_properties[key] = shader_property;
+        Changed();
 
         return *this;
     }
 
     inline ShaderProperties &Merge(const ShaderProperties &other)
     {
+        if (other.m_properties.empty()) {
+            return *this;
+        }
+
         for (auto &it : other.m_properties) {
             m_properties[it.first] = it.second;
         }
 
+        Changed();
+
         return *this;
     }
 
+    // computed on first use after a change
     inline HashCode GetHashCode() const
     {
-        HashCode hc;
+        if (m_is_hash_dirty) {
+            HashCode hc;
+
+            for (const auto &it : m_properties) {
+                hc.Add(it.first);
+                hc.Add(it.second.GetHashCode());
+            }
 
-        for (const auto &it : m_properties) {
-            hc.Add(it.first);
-            hc.Add(it.second.GetHashCode());
+            m_hash_code = hc;
+            m_is_hash_dirty = false;
         }
 
-        return hc;
+        return m_hash_code;
+    }
+
+private:
+    std::map<std::string, ShaderProperty> m_properties;
+    mutable HashCode m_hash_code;
+    mutable bool m_is_hash_dirty;
+    uint32_t m_generation;
+
+    inline void Changed()
+    {
+        m_is_hash_dirty = true;
+        m_generation++;
     }
 };
 
 class Shader {
 public:
+    using UniformHandle_t = uint32_t;
+
     Shader(const ShaderProperties &properties);
     Shader(const ShaderProperties &properties,
         const std::string &vscode, const std::string &fscode);
@@ -188,25 +248,63 @@ public:
 
     virtual void ApplyMaterial(const Material &mat);
     virtual void ApplyTransforms(const Transform &transform, Camera *camera);
+    // sets the face culling, blending and depth state of the material. every value is
+    // set, so nothing has to be reset between draws; CoreEngine skips unchanged state.
+    // face culling is left disabled when cull_faces is false.
+    void ApplyRenderState(const Material &mat, bool cull_faces = true);
 
     inline ShaderProperties &GetProperties() { return m_properties; }
     inline const ShaderProperties &GetProperties() const { return m_properties; }
-    inline void SetProperties(const ShaderProperties &properties) { m_properties = properties; }
+    void SetProperties(const ShaderProperties &properties);
 
     inline MaterialFaceCull SetOverrideCullMode() const { return m_override_cull; }
     inline void SetOverrideCullMode(MaterialFaceCull cull_mode) { m_override_cull = cull_mode; }
 
-    inline void SetUniform(const std::string &name, float value) { uniforms[name] = Uniform(value); uniform_changed = true; }
-    inline void SetUniform(const std::string &name, int value) { uniforms[name] = Uniform(value); uniform_changed = true; }
-    inline void SetUniform(const std::string &name, Texture *value) { uniforms[name] = Uniform(value); uniform_changed = true; }
-    inline void SetUniform(const std::string &name, const Vector2 &value) { uniforms[name] = Uniform(value); uniform_changed = true; }
-    inline void SetUniform(const std::string &name, const Vector3 &value) { uniforms[name] = Uniform(value); uniform_changed = true; }
-    inline void SetUniform(const std::string &name, const Vector4 &value) { uniforms[name] = Uniform(value); uniform_changed = true; }
-    inline void SetUniform(const std::string &name, const Matrix4 &value) { uniforms[name] = Uniform(value); uniform_changed = true; }
-
+    // index of the uniform with the given name, registering it on first use.
+    // handles stay valid for the lifetime of the shader, including across relinks,
+    // so they can be looked up once and used on every draw.
+    UniformHandle_t GetUniformHandle(const std::string &name);
+
+    inline void SetUniform(UniformHandle_t handle, float value) { SetUniformValue(handle, Uniform(value)); }
+    inline void SetUniform(UniformHandle_t handle, int value) { SetUniformValue(handle, Uniform(value)); }
+    inline void SetUniform(UniformHandle_t handle, Texture *value) { SetUniformValue(handle, Uniform(value)); }
+    inline void SetUniform(UniformHandle_t handle, const Vector2 &value) { SetUniformValue(handle, Uniform(value)); }
+    inline void SetUniform(UniformHandle_t handle, const Vector3 &value) { SetUniformValue(handle, Uniform(value)); }
+    inline void SetUniform(UniformHandle_t handle, const Vector4 &value) { SetUniformValue(handle, Uniform(value)); }
+    inline void SetUniform(UniformHandle_t handle, const Matrix4 &value) { SetUniformValue(handle, Uniform(value)); }
+
+    inline void SetUniform(const std::string &name, float value) { SetUniform(GetUniformHandle(name), value); }
+    inline void SetUniform(const std::string &name, int value) { SetUniform(GetUniformHandle(name), value); }
+    inline void SetUniform(const std::string &name, Texture *value) { SetUniform(GetUniformHandle(name), value); }
+    inline void SetUniform(const std::string &name, const Vector2 &value) { SetUniform(GetUniformHandle(name), value); }
+    inline void SetUniform(const std::string &name, const Vector3 &value) { SetUniform(GetUniformHandle(name), value); }
+    inline void SetUniform(const std::string &name, const Vector4 &value) { SetUniform(GetUniformHandle(name), value); }
+    inline void SetUniform(const std::string &name, const Matrix4 &value) { SetUniform(GetUniformHandle(name), value); }
+
+    // creates and links the program, or recompiles it if the properties changed.
+    // called by Use(); only needs calling directly to compile ahead of time.
+    void Compile();
+
+    // Use() skips glUseProgram when this program is already bound,
+    // and only uploads uniforms whose value changed since the last Use().
     void Use();
+    // restores the default render state: back faces culled, depth test and writes on, no blending
+    static void ResetMaterial();
+    // leaves the program and render state for the next draw to change, so using
+    // the same shader again skips binding its program
     void End();
 
+    inline bool IsBound() const { return is_created && bound_program == progid; }
+
+    // whether the linked program declares the block with the given UniformBlocks::BlockBinding
+    inline bool HasUniformBlock(int block) const { return (m_uniform_blocks & (1u << block)) != 0; }
+
+    // a copy of this shader compiled with INSTANCING, which takes the model matrix
+    // from a per-instance vertex attribute instead of u_modelMatrix.
+    // returns nullptr if this shader has no instanced variant, or was not created
+    // through ShaderManager.
+    Shader *GetInstancedVariant();
+
 protected:
     ShaderProperties m_properties;
     MaterialFaceCull m_override_cull;
@@ -260,16 +358,40 @@ protected:
     // two different paths..? a flag on the uniform?
     void ResetUniforms();
 
+    // sets every texture of the material, along with its "Has<name>" flag.
+    // when the TEXTURE_ARRAYS property is defined, textures that can be packed by
+    // TextureArrays are set as the sampler2DArray "<name>Array", with the layer in
+    // "<name>Layer", if the program declares them. otherwise the layer is set to -1.
+    void ApplyMaterialTextures(const Material &mat);
+
+    // overridden by shaders whose vertex stage handles INSTANCING. the variant is
+    // created by ShaderManager as the same class as this shader, so a subclass
+    // with a vertex stage of its own must override this again.
+    virtual bool HasInstancedVariant(const ShaderProperties &properties) const { return false; }
+
 private:
-    bool is_uploaded, is_created, uniform_changed;
+    static unsigned int bound_program;
+
+    // every sampler name is given the same unit in every program, so a texture shared
+    // between programs (e.g a shadow map) stays bound across program switches
+    static int GetSamplerUnit(const std::string &name);
+    int AssignTextureUnit(const std::string &name);
+
+    std::shared_ptr<Shader> m_instanced_variant;
+    bool m_instanced_variant_created;
+
+    bool is_uploaded, is_created;
     unsigned int progid;
 
     size_t m_previous_properties_hash_code;
+    uint32_t m_previous_properties_generation;
 
     void CreateGpuData();
     void UploadGpuData();
     void DestroyGpuData();
-    bool ShaderPropertiesChanged() const;
+    bool ShaderPropertiesChanged();
+    // looks up the location of every registered uniform, and marks them all for upload
+    void ResolveUniforms();
 
     struct Uniform {
         enum UniformType {
@@ -281,7 +403,8 @@ private:
             Uniform_Vector4,
             Uniform_Matrix4,
             Uniform_Texture2D,
-            Uniform_Texture3D
+            Uniform_Texture3D,
+            Uniform_Texture2DArray
         } type;
 
         std::array<float, 16> data;
@@ -348,10 +471,87 @@ private:
             data = other.data;
             return *this;
         }
+
+        inline size_t NumValues() const
+        {
+            switch (type) {
+            case Uniform_Vector2:
+                return 2;
+            case Uniform_Vector3:
+                return 3;
+            case Uniform_Vector4:
+                return 4;
+            case Uniform_Matrix4:
+                return 16;
+            case Uniform_None:
+                return 0;
+            default:
+                return 1;
+            }
+        }
+
+        inline bool operator==(const Uniform &other) const
+        {
+            return type == other.type
+                && std::memcmp(&data[0], &other.data[0], NumValues() * sizeof(float)) == 0;
+        }
+
+        inline bool IsTexture() const { return type == Uniform_Texture2D || type == Uniform_Texture3D || type == Uniform_Texture2DArray; }
+    };
+
+    struct UniformSlot {
+        std::string name;
+        Uniform value;
+        int location; // -1 if not linked, or not used by the program
+        int texture_unit; // assigned the first time a texture is uploaded, see GetSamplerUnit()
+        bool dirty;
+    };
+
+    struct MaterialTextureHandles {
+        Material::Key_t key;
+        UniformHandle_t texture;
+        UniformHandle_t has_texture;
+        UniformHandle_t array; // "<name>Array", the sampler2DArray read when TEXTURE_ARRAYS is defined
+        UniformHandle_t layer; // "<name>Layer", -1 when the texture is set as "<name>" instead
     };
 
     std::map<SubShaderType, SubShader> subshaders;
-    std::map<std::string, Uniform> uniforms;
+
+    std::vector<UniformSlot> m_uniforms;
+    std::unordered_map<std::string, UniformHandle_t> m_uniform_handles;
+    std::vector<UniformHandle_t> m_dirty_uniforms;
+    // textures are bound to their unit on every Use(), as texture bindings are not program state.
+    // binding is skipped when CoreEngine's RenderState has the texture on that unit already.
+    std::vector<UniformHandle_t> m_texture_uniforms;
+    uint32_t m_used_texture_units; // one bit per unit assigned to a sampler of this program
+    uint32_t m_uniform_blocks; // one bit per UniformBlocks::BlockBinding
+
+    // materials hold only a handful of textures, so these are searched linearly
+    std::vector<MaterialTextureHandles> m_material_texture_handles;
+
+    UniformHandle_t m_uniform_model_matrix;
+    UniformHandle_t m_uniform_view_matrix;
+    UniformHandle_t m_uniform_proj_matrix;
+    UniformHandle_t m_uniform_view_proj_matrix;
+    std::array<UniformHandle_t, 7> m_uniform_has_maps;
+
+    inline void SetUniformValue(UniformHandle_t handle, const Uniform &value)
+    {
+        UniformSlot &slot = m_uniforms[handle];
+
+        if (slot.value == value) {
+            return;
+        }
+
+        slot.value = value;
+
+        if (!slot.dirty) {
+            slot.dirty = true;
+            m_dirty_uniforms.push_back(handle);
+        }
+    }
+
+    void RegisterBaseUniforms();
 };
 
 } // namespace apex
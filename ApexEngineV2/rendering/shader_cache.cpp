@@ -0,0 +1,421 @@
+#include "shader_cache.h"
+#include "shader.h"
+#include "../core_engine.h"
+#include "../asset/asset_manager.h"
+#include "../asset/text_loader.h"
+#include "../util/shader_preprocessor.h"
+
+#include <fstream>
+#include <cstring>
+
+namespace apex {
+
+static const char cache_magic[8] = { 'A', 'P', 'X', 'S', 'H', 'C', '0', '1' };
+
+// FNV-1a, which unlike std::hash is the same across runs and platforms
+static uint64_t HashBytes(const void *data, size_t size, uint64_t hash = 0xcbf29ce484222325ull)
+{
+    const unsigned char *bytes = static_cast<const unsigned char*>(data);
+
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+
+    return hash;
+}
+
+static inline uint64_t HashString(const std::string &str, uint64_t hash = 0xcbf29ce484222325ull)
+{
+    // include the terminator, so that ("ab", "c") and ("a", "bc") hash differently
+    return HashBytes(str.c_str(), str.size() + 1, hash);
+}
+
+template <typename T>
+static inline void Write(std::ofstream &out, const T &value)
+{
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+static inline void WriteString(std::ofstream &out, const std::string &str)
+{
+    Write(out, uint32_t(str.size()));
+    out.write(str.data(), str.size());
+}
+
+template <typename T>
+static inline bool Read(std::ifstream &in, T &value)
+{
+    return bool(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+static inline bool ReadString(std::ifstream &in, std::string &str)
+{
+    uint32_t size;
+
+    if (!Read(in, size)) {
+        return false;
+    }
+
+    str.resize(size);
+
+    return size == 0 || bool(in.read(&str[0], size));
+}
+
+ShaderCache *ShaderCache::instance = nullptr;
+
+ShaderCache *ShaderCache::GetInstance()
+{
+    if (instance == nullptr) {
+        instance = new ShaderCache();
+    }
+
+    return instance;
+}
+
+ShaderCache::ShaderCache()
+    : m_run_index(0),
+      m_is_dirty(false)
+{
+#if SHADER_CACHE_ENABLED
+    Load();
+#endif
+}
+
+uint64_t ShaderCache::GetFileHash(const std::string &path)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto it = m_file_hashes.find(path);
+
+        if (it != m_file_hashes.end()) {
+            return it->second;
+        }
+    }
+
+    // loaded without holding the lock, the asset manager takes its own
+    uint64_t hash = 0;
+
+    if (auto loaded = AssetManager::GetInstance()->LoadFromFile<TextLoader::LoadedText>(path)) {
+        hash = HashString(loaded->GetText());
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    return m_file_hashes.emplace(path, hash).first->second;
+}
+
+void ShaderCache::MarkUsed(uint32_t &last_used_run)
+{
+    // the file is rewritten so that entries still in use are not pruned
+    if (last_used_run != m_run_index) {
+        last_used_run = m_run_index;
+        m_is_dirty = true;
+    }
+}
+
+std::string ShaderCache::Preprocess(const std::string &code,
+    const ShaderProperties &properties,
+    const std::string &path)
+{
+#if !SHADER_CACHE_ENABLED
+    return ShaderPreprocessor::ProcessShader(code, properties, path);
+#else
+    uint64_t key = HashString(path);
+    key = HashString(code, key);
+
+    for (const auto &it : properties.GetValues()) {
+        key = HashString(it.first, key);
+        key = HashBytes(&it.second.type, sizeof(it.second.type), key);
+        key = HashString(it.second.raw_value, key);
+    }
+
+    // only the lookups and inserts are locked. hashing the included files loads
+    // them through the asset manager, which must never wait while this lock is held.
+    bool is_cached = false;
+    SourceEntry cached;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto it = m_sources.find(key);
+
+        if (it != m_sources.end()) {
+            cached = it->second;
+            is_cached = true;
+        }
+    }
+
+    if (is_cached) {
+        bool is_valid = true;
+
+        for (const Dependency &dependency : cached.dependencies) {
+            if (GetFileHash(dependency.path) != dependency.hash) {
+                is_valid = false;
+                break;
+            }
+        }
+
+        if (is_valid) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            auto it = m_sources.find(key);
+
+            if (it != m_sources.end()) {
+                MarkUsed(it->second.last_used_run);
+            }
+
+            m_stats.source_hits++;
+
+            return cached.processed_code;
+        }
+    }
+
+    // preprocessed without holding the lock, so warm-up threads run in parallel
+    std::vector<std::string> include_paths;
+
+    SourceEntry entry;
+    entry.processed_code = ShaderPreprocessor::ProcessShader(code, properties, path, nullptr, &include_paths);
+
+    for (const std::string &include_path : include_paths) {
+        entry.dependencies.push_back({ include_path, GetFileHash(include_path) });
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    entry.last_used_run = m_run_index;
+    m_stats.source_misses++;
+    m_is_dirty = true;
+
+    return (m_sources[key] = std::move(entry)).processed_code;
+#endif
+}
+
+uint64_t ShaderCache::GetProgramKey(const std::vector<const std::string*> &processed_codes)
+{
+    if (m_driver.empty()) {
+        m_driver = CoreEngine::GetInstance()->GetString(CoreEngine::GLEnums::VENDOR);
+        m_driver += '/';
+        m_driver += CoreEngine::GetInstance()->GetString(CoreEngine::GLEnums::RENDERER);
+        m_driver += '/';
+        m_driver += CoreEngine::GetInstance()->GetString(CoreEngine::GLEnums::VERSION);
+    }
+
+    uint64_t key = HashString(m_driver);
+
+    for (const std::string *processed_code : processed_codes) {
+        key = HashString(*processed_code, key);
+    }
+
+    return key;
+}
+
+bool ShaderCache::LoadProgram(unsigned int program, uint64_t key)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it = m_programs.find(key);
+
+    if (it == m_programs.end()) {
+        m_stats.program_misses++;
+
+        return false;
+    }
+
+    CoreEngine::GetInstance()->ProgramBinary(program, it->second.format,
+        it->second.binary.data(), it->second.binary.size());
+
+    int linked = 0;
+    CoreEngine::GetInstance()->GetProgramiv(program, CoreEngine::GLEnums::LINK_STATUS, &linked);
+
+    if (!linked) {
+        // drivers may reject binaries from other builds even with the same version string
+        m_programs.erase(it);
+        m_stats.program_misses++;
+        m_is_dirty = true;
+
+        return false;
+    }
+
+    MarkUsed(it->second.last_used_run);
+    m_stats.program_hits++;
+
+    return true;
+}
+
+void ShaderCache::StoreProgram(unsigned int program, uint64_t key)
+{
+#if SHADER_CACHE_ENABLED
+    int length = 0;
+    CoreEngine::GetInstance()->GetProgramiv(program, CoreEngine::GLEnums::PROGRAM_BINARY_LENGTH, &length);
+
+    if (length <= 0) {
+        return;
+    }
+
+    ProgramEntry entry;
+    entry.binary.resize(length);
+    entry.format = 0;
+    entry.last_used_run = m_run_index;
+
+    size_t written = 0;
+    CoreEngine::GetInstance()->GetProgramBinary(program, entry.binary.size(), &written, &entry.format, entry.binary.data());
+
+    if (written == 0) {
+        return;
+    }
+
+    entry.binary.resize(written);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_programs[key] = std::move(entry);
+    m_is_dirty = true;
+#endif
+}
+
+void ShaderCache::Load()
+{
+    std::ifstream in(SHADER_CACHE_PATH, std::ios::binary);
+
+    if (!in.is_open()) {
+        return;
+    }
+
+    char magic[sizeof(cache_magic)];
+    uint32_t run_index, num_sources, num_programs;
+
+    if (!in.read(magic, sizeof(magic)) || memcmp(magic, cache_magic, sizeof(magic)) != 0 ||
+        !Read(in, run_index) || !Read(in, num_sources)) {
+        return;
+    }
+
+    std::unordered_map<uint64_t, SourceEntry> sources;
+    std::unordered_map<uint64_t, ProgramEntry> programs;
+
+    for (uint32_t i = 0; i < num_sources; i++) {
+        uint64_t key;
+        uint32_t num_dependencies;
+        SourceEntry entry;
+
+        if (!Read(in, key) || !Read(in, entry.last_used_run) || !Read(in, num_dependencies)) {
+            return;
+        }
+
+        entry.dependencies.resize(num_dependencies);
+
+        for (Dependency &dependency : entry.dependencies) {
+            if (!ReadString(in, dependency.path) || !Read(in, dependency.hash)) {
+                return;
+            }
+        }
+
+        if (!ReadString(in, entry.processed_code)) {
+            return;
+        }
+
+        sources[key] = std::move(entry);
+    }
+
+    if (!Read(in, num_programs)) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < num_programs; i++) {
+        uint64_t key;
+        uint32_t size;
+        ProgramEntry entry;
+
+        if (!Read(in, key) || !Read(in, entry.last_used_run) || !Read(in, entry.format) || !Read(in, size)) {
+            return;
+        }
+
+        entry.binary.resize(size);
+
+        if (size != 0 && !in.read(entry.binary.data(), size)) {
+            return;
+        }
+
+        programs[key] = std::move(entry);
+    }
+
+    // only use a file that was read completely
+    m_sources = std::move(sources);
+    m_programs = std::move(programs);
+    m_run_index = run_index + 1;
+}
+
+bool ShaderCache::Save()
+{
+#if SHADER_CACHE_ENABLED
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (!m_is_dirty) {
+        return true;
+    }
+
+    std::ofstream out(SHADER_CACHE_PATH, std::ios::binary | std::ios::trunc);
+
+    if (!out.is_open()) {
+        return false;
+    }
+
+    const auto is_stale = [this](uint32_t last_used_run) {
+        return m_run_index - last_used_run >= SHADER_CACHE_MAX_UNUSED_RUNS;
+    };
+
+    uint32_t num_sources = 0, num_programs = 0;
+
+    for (const auto &it : m_sources) {
+        num_sources += is_stale(it.second.last_used_run) ? 0 : 1;
+    }
+
+    for (const auto &it : m_programs) {
+        num_programs += is_stale(it.second.last_used_run) ? 0 : 1;
+    }
+
+    out.write(cache_magic, sizeof(cache_magic));
+    Write(out, m_run_index);
+    Write(out, num_sources);
+
+    for (const auto &it : m_sources) {
+        if (is_stale(it.second.last_used_run)) {
+            continue;
+        }
+
+        Write(out, it.first);
+        Write(out, it.second.last_used_run);
+        Write(out, uint32_t(it.second.dependencies.size()));
+
+        for (const Dependency &dependency : it.second.dependencies) {
+            WriteString(out, dependency.path);
+            Write(out, dependency.hash);
+        }
+
+        WriteString(out, it.second.processed_code);
+    }
+
+    Write(out, num_programs);
+
+    for (const auto &it : m_programs) {
+        if (is_stale(it.second.last_used_run)) {
+            continue;
+        }
+
+        Write(out, it.first);
+        Write(out, it.second.last_used_run);
+        Write(out, it.second.format);
+        Write(out, uint32_t(it.second.binary.size()));
+        out.write(it.second.binary.data(), it.second.binary.size());
+    }
+
+    m_is_dirty = false;
+
+    return out.good();
+#else
+    return true;
+#endif
+}
+
+} // namespace apex
@@ -0,0 +1,98 @@
+#ifndef SHADER_CACHE_H
+#define SHADER_CACHE_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <cstdint>
+#include <cstddef>
+
+// set to 0 to always preprocess and compile shaders from source
+#define SHADER_CACHE_ENABLED 1
+#define SHADER_CACHE_PATH "shader_cache.bin"
+// entries that have not been used for this many runs are dropped on save
+#define SHADER_CACHE_MAX_UNUSED_RUNS 8
+
+namespace apex {
+class ShaderProperties;
+
+// Persistent cache of preprocessed shader sources and linked program binaries.
+// Sources are keyed by the path, code and properties of a sub shader, and are
+// only used while every file they included still has the same content.
+// Program binaries are keyed by the preprocessed code of all of their stages and
+// the GL vendor, renderer and version, so a driver update invalidates them.
+// The cache file is read on first use and written by Save().
+class ShaderCache {
+public:
+    struct Stats {
+        size_t source_hits = 0;
+        size_t source_misses = 0;
+        size_t program_hits = 0;
+        size_t program_misses = 0;
+    };
+
+    static ShaderCache *GetInstance();
+
+    ShaderCache();
+    ShaderCache(const ShaderCache &other) = delete;
+
+    inline const Stats &GetStats() const { return m_stats; }
+
+    // the preprocessed code, taken from the cache when it is still valid.
+    // may be called from worker threads; everything else is main thread only.
+    std::string Preprocess(const std::string &code,
+        const ShaderProperties &properties,
+        const std::string &path);
+
+    // key of a program linked from the given preprocessed stages, with the current driver
+    uint64_t GetProgramKey(const std::vector<const std::string*> &processed_codes);
+    // loads the cached binary into the program. returns false if there is no
+    // binary for the key, or the driver rejected it (the program is then left unlinked).
+    bool LoadProgram(unsigned int program, uint64_t key);
+    // stores the binary of a successfully linked program
+    void StoreProgram(unsigned int program, uint64_t key);
+
+    // writes the cache to SHADER_CACHE_PATH, if anything was added or used
+    bool Save();
+
+private:
+    static ShaderCache *instance;
+
+    struct Dependency {
+        std::string path;
+        uint64_t hash;
+    };
+
+    struct SourceEntry {
+        std::vector<Dependency> dependencies;
+        std::string processed_code;
+        uint32_t last_used_run;
+    };
+
+    struct ProgramEntry {
+        unsigned int format;
+        std::vector<char> binary;
+        uint32_t last_used_run;
+    };
+
+    std::unordered_map<uint64_t, SourceEntry> m_sources;
+    std::unordered_map<uint64_t, ProgramEntry> m_programs;
+    // content hashes of included files, which do not change while running
+    std::unordered_map<std::string, uint64_t> m_file_hashes;
+    std::string m_driver;
+    uint32_t m_run_index;
+    bool m_is_dirty;
+    Stats m_stats;
+    std::mutex m_mutex; // guards everything but the driver string
+
+    // takes the lock itself, so must be called without holding it
+    uint64_t GetFileHash(const std::string &path);
+    // called with the lock held
+    void MarkUsed(uint32_t &last_used_run);
+    void Load();
+};
+
+} // namespace apex
+
+#endif
@@ -13,22 +13,70 @@ ShaderManager *ShaderManager::GetInstance()
     return instance;
 }
 
-void ShaderManager::SetBaseShaderProperties(const ShaderProperties &properties)
+std::shared_ptr<Shader> ShaderManager::GetShader(const std::string &type_name, const ShaderProperties &properties)
 {
-    m_base_shader_properties.Merge(properties);
+    auto type_it = m_types.find(type_name);
+
+    if (type_it == m_types.end()) {
+        return nullptr;
+    }
+
+    std::vector<Variant> &variants = m_variants[VariantKey(type_it->second.type, properties.GetHashCode().Value())];
+
+    for (const Variant &variant : variants) {
+        if (variant.properties == properties) {
+            return variant.shader;
+        }
+    }
+
+    ShaderProperties provided_merged_with_base(m_base_shader_properties);
+    provided_merged_with_base.Merge(properties);
+
+    auto new_ins = type_it->second.create(provided_merged_with_base);
+    variants.push_back({ new_ins, properties });
+
+    ShaderWarmup::GetInstance()->RecordVariant(type_name, properties);
+
+    return new_ins;
+}
+
+std::shared_ptr<Shader> ShaderManager::GetInstancedVariant(const Shader *shader)
+{
+    // once per shader, as the shader keeps the variant
+    for (const auto &it : m_variants) {
+        for (const Variant &variant : it.second) {
+            if (variant.shader.get() != shader) {
+                continue;
+            }
 
-    for (auto &it : instances) {
-        if (it.first == nullptr) {
-            continue;
+            const std::string type_name(it.first.type.name());
+            ShaderProperties properties(variant.properties);
+            properties.Define("INSTANCING", true);
+
+            // m_variants may rehash in GetShader, so the loop ends here
+            return GetShader(type_name, properties);
         }
+    }
+
+    return nullptr;
+}
+
+void ShaderManager::SetBaseShaderProperties(const ShaderProperties &properties)
+{
+    m_base_shader_properties.Merge(properties);
 
-        const ShaderProperties &current = it.second;
+    for (auto &it : m_variants) {
+        for (Variant &variant : it.second) {
+            if (variant.shader == nullptr) {
+                continue;
+            }
 
-        ShaderProperties updated(m_base_shader_properties);
-        updated.Merge(current);
+            ShaderProperties updated(m_base_shader_properties);
+            updated.Merge(variant.properties);
 
-        it.first->SetProperties(updated);
-        // NOTE: do not update it.second because that excludes base properties
+            // only shaders whose properties differ are marked for recompilation
+            variant.shader->SetProperties(updated);
+        }
     }
 }
 
@@ -2,9 +2,13 @@
 #define SHADER_MANAGER_H
 
 #include "shader.h"
+#include "shader_warmup.h"
 
 #include <map>
 #include <vector>
+#include <unordered_map>
+#include <typeindex>
+#include <functional>
 #include <utility>
 #include <string>
 
@@ -24,36 +28,96 @@ public:
         static_assert(std::is_constructible<T, const ShaderProperties &>::value,
             "T must be constructable with: const ShaderProperties &");
 
+        std::vector<Variant> &variants = m_variants[VariantKey(typeid(T), properties.GetHashCode().Value())];
+
+        // more than one only on a hash collision
+        for (const Variant &variant : variants) {
+            if (variant.properties == properties) {
+                return std::static_pointer_cast<T>(variant.shader);
+            }
+        }
+
         ShaderProperties provided_merged_with_base(m_base_shader_properties);
         provided_merged_with_base.Merge(properties);
 
-        for (auto &&ins : instances) {
-            auto ins_casted = std::dynamic_pointer_cast<T>(ins.first);
+        auto new_ins = std::make_shared<T>(provided_merged_with_base);
+        variants.push_back({ new_ins, properties });
 
-            if (ins_casted && ins.second == properties) {
-                return ins_casted;
-            }
+        // lets warm-up create recorded variants of this class by name
+        if (m_types.find(typeid(T).name()) == m_types.end()) {
+            m_types.insert({ typeid(T).name(), ShaderType(typeid(T), [](const ShaderProperties &properties) {
+                return std::shared_ptr<Shader>(std::make_shared<T>(properties));
+            }) });
         }
 
-        auto new_ins = std::make_shared<T>(provided_merged_with_base);
-        instances.push_back(std::make_pair(new_ins, properties));
+        ShaderWarmup::GetInstance()->RecordVariant(typeid(T).name(), properties);
 
         return new_ins;
     }
 
+    // like GetShader<T>, for a class given by its typeid name.
+    // returns nullptr if no shader of that class has been requested through GetShader<T>.
+    std::shared_ptr<Shader> GetShader(const std::string &type_name, const ShaderProperties &properties);
+
+    // the variant of a shader created here, of the same class and requested with
+    // the same properties plus INSTANCING. used by Shader::GetInstancedVariant.
+    // returns nullptr if the shader was not created through ShaderManager.
+    std::shared_ptr<Shader> GetInstancedVariant(const Shader *shader);
+
     const ShaderProperties &GetBaseShaderProperties() const { return m_base_shader_properties; }
-    // merge values into the base instance. Updates all existing shaders.
+    // merge values into the base instance. Existing shaders whose properties
+    // change are recompiled the next time they are used.
     void SetBaseShaderProperties(const ShaderProperties &properties);
 
 private:
+    // a shader class, and the hash of the properties it was requested with
+    struct VariantKey {
+        std::type_index type;
+        size_t properties_hash;
+
+        VariantKey(std::type_index type, size_t properties_hash)
+            : type(type),
+              properties_hash(properties_hash)
+        {
+        }
+
+        inline bool operator==(const VariantKey &other) const
+        {
+            return type == other.type && properties_hash == other.properties_hash;
+        }
+    };
+
+    struct VariantKeyHash {
+        inline size_t operator()(const VariantKey &key) const
+        {
+            HashCode hc;
+            hc.Add(key.type.hash_code());
+            hc.Add(key.properties_hash);
+
+            return hc.Value();
+        }
+    };
+
+    struct ShaderType {
+        std::type_index type;
+        std::function<std::shared_ptr<Shader>(const ShaderProperties &)> create;
+
+        ShaderType(std::type_index type, const std::function<std::shared_ptr<Shader>(const ShaderProperties &)> &create)
+            : type(type),
+              create(create)
+        {
+        }
+    };
+
+    struct Variant {
+        std::shared_ptr<Shader> shader;
+        ShaderProperties properties; // as requested, without the base properties
+    };
+
     ShaderProperties m_base_shader_properties;
 
-    std::vector<
-        std::pair<
-            std::shared_ptr<Shader>, 
-            ShaderProperties
-        >
-    > instances;
+    std::unordered_map<VariantKey, std::vector<Variant>, VariantKeyHash> m_variants;
+    std::unordered_map<std::string, ShaderType> m_types;
 };
 
 } // namespace apex
@@ -0,0 +1,223 @@
+#include "shader_warmup.h"
+#include "shader_cache.h"
+#include "shader_manager.h"
+#include "../asset/asset_manager.h"
+#include "../asset/text_loader.h"
+#include "../worker_pool.h"
+#include "../profiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+namespace apex {
+
+ShaderWarmup *ShaderWarmup::instance = nullptr;
+
+ShaderWarmup *ShaderWarmup::GetInstance()
+{
+    if (instance == nullptr) {
+        instance = new ShaderWarmup();
+    }
+
+    return instance;
+}
+
+ShaderWarmup::ShaderWarmup()
+    : m_is_recording(false),
+      m_is_changed(false)
+{
+}
+
+ShaderWarmup::~ShaderWarmup()
+{
+    Wait();
+}
+
+void ShaderWarmup::Add(std::vector<Entry> &entries, const char *kind,
+    const std::string &name, const ShaderProperties &properties)
+{
+    std::string key(kind);
+    key += ' ';
+    key += name;
+    key += ' ';
+    key += std::to_string(properties.GetHashCode().Value());
+
+    if (m_keys.insert(key).second) {
+        entries.push_back({ name, properties });
+        m_is_changed = true;
+    }
+}
+
+void ShaderWarmup::RecordSource(const std::string &path, const ShaderProperties &properties)
+{
+    if (m_is_recording && !path.empty()) {
+        Add(m_sources, "source", path, properties);
+    }
+}
+
+void ShaderWarmup::RecordVariant(const std::string &type_name, const ShaderProperties &properties)
+{
+    if (m_is_recording) {
+        Add(m_variants, "variant", type_name, properties);
+    }
+}
+
+bool ShaderWarmup::Load()
+{
+    std::ifstream in(SHADER_WARMUP_PATH);
+
+    if (!in.is_open()) {
+        return false;
+    }
+
+    // each entry is a "source <path>" or "variant <class>" line,
+    // followed by "define <type> <name> <value>" lines and "end"
+    std::vector<Entry> *entries = nullptr;
+    const char *kind = nullptr;
+    std::string name;
+    ShaderProperties properties;
+    std::string line;
+
+    while (std::getline(in, line)) {
+        std::istringstream ss(line);
+        std::string word;
+        ss >> word;
+
+        if (word == "source" || word == "variant") {
+            entries = (word == "source") ? &m_sources : &m_variants;
+            kind = (word == "source") ? "source" : "variant";
+            properties = ShaderProperties();
+
+            ss >> std::ws;
+            std::getline(ss, name);
+        } else if (word == "define" && entries != nullptr) {
+            int type = 0;
+            std::string key, value;
+
+            ss >> type >> key >> std::ws;
+            std::getline(ss, value);
+
+            switch (type) {
+            case ShaderProperties::ShaderProperty::SHADER_PROPERTY_STRING:
+                properties.Define(key, value);
+                break;
+            case ShaderProperties::ShaderProperty::SHADER_PROPERTY_FLOAT:
+                properties.Define(key, std::stof(value));
+                break;
+            case ShaderProperties::ShaderProperty::SHADER_PROPERTY_INT:
+                properties.Define(key, std::stoi(value));
+                break;
+            case ShaderProperties::ShaderProperty::SHADER_PROPERTY_BOOL:
+                properties.Define(key, value == "1");
+                break;
+            }
+        } else if (word == "end" && entries != nullptr) {
+            Add(*entries, kind, name, properties);
+            entries = nullptr;
+        }
+    }
+
+    m_is_changed = false;
+
+    return true;
+}
+
+bool ShaderWarmup::Save()
+{
+    if (!m_is_changed) {
+        return true;
+    }
+
+    std::ofstream out(SHADER_WARMUP_PATH);
+
+    if (!out.is_open()) {
+        return false;
+    }
+
+    const auto write_entries = [&out](const std::vector<Entry> &entries, const char *kind) {
+        for (const Entry &entry : entries) {
+            out << kind << " " << entry.name << "\n";
+
+            for (const auto &it : entry.properties.GetValues()) {
+                out << "define " << int(it.second.type) << " " << it.first << " " << it.second.raw_value << "\n";
+            }
+
+            out << "end\n";
+        }
+    };
+
+    write_entries(m_sources, "source");
+    write_entries(m_variants, "variant");
+
+    m_is_changed = false;
+
+    return out.good();
+}
+
+void ShaderWarmup::PreprocessAsync()
+{
+#if SHADER_CACHE_ENABLED
+    Wait();
+
+    if (m_sources.empty()) {
+        return;
+    }
+
+    // created here so the worker threads do not race to create them
+    AssetManager::GetInstance();
+    ShaderCache::GetInstance();
+    WorkerPool::GetInstance();
+    Profiler::GetInstance();
+
+    // sources recorded from now on are not touched by the worker threads
+    m_thread = std::thread([sources = m_sources]() {
+        APEX_PROFILE_SCOPE("ShaderWarmup::PreprocessAsync");
+
+        // the pool runs one job at a time, so the sources are submitted one per thread
+        // at a time. a job from the main thread (Entity::Update, TransformSystem) then
+        // only waits for the slowest source of a batch, rather than for all of them.
+        const size_t batch_size = WorkerPool::GetInstance()->NumWorkers() + 1;
+
+        for (size_t begin = 0; begin < sources.size(); begin += batch_size) {
+            const size_t count = std::min(batch_size, sources.size() - begin);
+
+            WorkerPool::GetInstance()->ParallelFor(count, [&sources, begin](size_t i) {
+                const Entry &entry = sources[begin + i];
+
+                if (auto loaded = AssetManager::GetInstance()->LoadFromFile<TextLoader::LoadedText>(entry.name)) {
+                    ShaderCache::GetInstance()->Preprocess(loaded->GetText(), entry.properties, entry.name);
+                }
+            });
+
+            // lets a job waiting on the pool take it before the next batch
+            std::this_thread::yield();
+        }
+    });
+#endif
+}
+
+void ShaderWarmup::Wait()
+{
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+void ShaderWarmup::CompileVariants()
+{
+    APEX_PROFILE_SCOPE("ShaderWarmup::CompileVariants");
+
+    Wait();
+
+    // GetShader() may record new variants while iterating
+    const std::vector<Entry> variants(m_variants);
+
+    for (const Entry &entry : variants) {
+        if (auto shader = ShaderManager::GetInstance()->GetShader(entry.name, entry.properties)) {
+            shader->Compile();
+        }
+    }
+}
+
+} // namespace apex
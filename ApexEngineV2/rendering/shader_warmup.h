@@ -0,0 +1,77 @@
+#ifndef SHADER_WARMUP_H
+#define SHADER_WARMUP_H
+
+#include "shader.h"
+
+#include <string>
+#include <vector>
+#include <unordered_set>
+#include <thread>
+
+#define SHADER_WARMUP_PATH "shader_warmup.txt"
+
+namespace apex {
+
+// A manifest of the shader sources and variants used in earlier runs.
+// While recording, every preprocessed source (path, properties) and every
+// variant created through ShaderManager (shader class, properties) is noted,
+// and Save() merges them into the manifest.
+// On startup, PreprocessAsync() preprocesses the recorded sources on the
+// WorkerPool while the game loads, so shader constructors find them in the
+// ShaderCache. CompileVariants() then creates and links the recorded variants
+// on the GL thread, before the first frame instead of when they are first drawn.
+// NOTE: shader classes are recorded by their typeid name, so a manifest is only
+// useful to builds from the same compiler.
+class ShaderWarmup {
+public:
+    struct Entry {
+        std::string name; // source path, or shader class
+        ShaderProperties properties;
+    };
+
+    static ShaderWarmup *GetInstance();
+
+    ShaderWarmup();
+    ShaderWarmup(const ShaderWarmup &other) = delete;
+    ~ShaderWarmup();
+
+    inline bool IsRecording() const { return m_is_recording; }
+    inline void SetRecording(bool is_recording) { m_is_recording = is_recording; }
+
+    inline const std::vector<Entry> &GetSources() const { return m_sources; }
+    inline const std::vector<Entry> &GetVariants() const { return m_variants; }
+
+    // only called on the main thread
+    void RecordSource(const std::string &path, const ShaderProperties &properties);
+    void RecordVariant(const std::string &type_name, const ShaderProperties &properties);
+
+    bool Load();
+    // merges everything recorded into SHADER_WARMUP_PATH
+    bool Save();
+
+    // starts preprocessing the loaded sources in the background, in small batches
+    // that leave the WorkerPool free for other jobs in between
+    void PreprocessAsync();
+    // waits for PreprocessAsync() to finish
+    void Wait();
+    // creates and links every recorded variant whose shader class has been
+    // requested from ShaderManager at least once. must be called on the GL thread.
+    void CompileVariants();
+
+private:
+    static ShaderWarmup *instance;
+
+    std::vector<Entry> m_sources;
+    std::vector<Entry> m_variants;
+    std::unordered_set<std::string> m_keys; // of entries in either list
+    std::thread m_thread;
+    bool m_is_recording;
+    bool m_is_changed;
+
+    void Add(std::vector<Entry> &entries, const char *kind,
+        const std::string &name, const ShaderProperties &properties);
+};
+
+} // namespace apex
+
+#endif
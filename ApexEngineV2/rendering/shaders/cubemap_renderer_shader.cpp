@@ -1,5 +1,4 @@
 #include "cubemap_renderer_shader.h"
-#include "../environment.h"
 #include "../../asset/asset_manager.h"
 #include "../../asset/text_loader.h"
 #include "../../util/shader_preprocessor.h"
@@ -49,18 +48,7 @@ void CubemapRendererShader::ApplyMaterial(const Material &mat)
 
     SetUniform("u_diffuseColor", mat.diffuse_color);
 
-    for (auto it = mat.textures.begin(); it != mat.textures.end(); it++) {
-        if (it->second == nullptr) {
-            continue;
-        }
-
-        it->second->Prepare();
-
-        SetUniform(it->first, it->second.get());
-        SetUniform(std::string("Has") + it->first, 1);
-    }
-
-    Environment::GetInstance()->GetSun().Bind(0, this);
+    ApplyMaterialTextures(mat);
 }
 
 void CubemapRendererShader::ApplyTransforms(const Transform &transform, Camera *camera)
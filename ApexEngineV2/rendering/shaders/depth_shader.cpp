@@ -35,4 +35,10 @@ void DepthShader::ApplyTransforms(const Transform &transform, Camera *camera)
     Shader::ApplyTransforms(transform, camera);
     SetUniform("u_camerapos", camera->GetTranslation());
 }
+
+bool DepthShader::HasInstancedVariant(const ShaderProperties &properties) const
+{
+    // bone matrices are per entity, so skinned meshes are never instanced
+    return !properties.GetValue("SKINNING").IsTruthy();
+}
 } // namespace apex
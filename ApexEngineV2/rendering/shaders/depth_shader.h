@@ -11,6 +11,9 @@ public:
 
     virtual void ApplyMaterial(const Material &mat);
     virtual void ApplyTransforms(const Transform &transform, Camera *camera);
+
+protected:
+    virtual bool HasInstancedVariant(const ShaderProperties &properties) const;
 };
 } // namespace apex
 
@@ -11,6 +11,10 @@ public:
 
     virtual void ApplyMaterial(const Material &mat) override;
     virtual void ApplyTransforms(const Transform &transform, Camera *camera) override;
+
+protected:
+    // fur.vert and fur.geom only read u_modelMatrix
+    virtual bool HasInstancedVariant(const ShaderProperties &properties) const override { return false; }
 };
 } // namespace apex
 
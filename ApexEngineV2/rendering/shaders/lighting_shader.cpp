@@ -29,6 +29,25 @@ LightingShader::LightingShader(const ShaderProperties &properties)
         SetUniform("poissonDisk[" + std::to_string(i) + "]",
             Environment::possion_disk[i]);
     }
+
+    m_uniform_diffuse_color = GetUniformHandle("u_diffuseColor");
+    m_uniform_shininess = GetUniformHandle("u_shininess");
+    m_uniform_roughness = GetUniformHandle("u_roughness");
+    m_uniform_rim_shading = GetUniformHandle("RimShading");
+    m_uniform_flip_uv_x = GetUniformHandle("FlipUV_X");
+    m_uniform_flip_uv_y = GetUniformHandle("FlipUV_Y");
+    m_uniform_global_cubemap = GetUniformHandle("env_GlobalCubemap");
+    m_uniform_global_irradiance_cubemap = GetUniformHandle("env_GlobalIrradianceCubemap");
+}
+
+Shader::UniformHandle_t LightingShader::GetShadowMapUniform(int index)
+{
+    while (m_shadow_map_uniforms.size() <= size_t(index)) {
+        m_shadow_map_uniforms.push_back(GetUniformHandle("u_shadowMap[" +
+            std::to_string(m_shadow_map_uniforms.size()) + "]"));
+    }
+
+    return m_shadow_map_uniforms[index];
 }
 
 void LightingShader::ApplyMaterial(const Material &mat)
@@ -38,80 +57,63 @@ void LightingShader::ApplyMaterial(const Material &mat)
     auto *env = Environment::GetInstance();
     if (env->ShadowsEnabled()) {
         for (int i = 0; i < env->NumCascades(); i++) {
-            const std::string i_str = std::to_string(i);
-
             if (auto shadow_map = env->GetShadowMap(i)) {
                 shadow_map->Prepare();
 
-                SetUniform("u_shadowMap[" + i_str + "]", shadow_map.get());
+                SetUniform(GetShadowMapUniform(i), shadow_map.get());
             }
-
-            SetUniform("u_shadowMatrix[" + i_str + "]", env->GetShadowMatrix(i));
-            SetUniform("u_shadowSplit[" + i_str + "]", (float)env->GetShadowSplit(i));
         }
     }
 
-    env->GetSun().Bind(0, this);
-
-    SetUniform("env_NumPointLights", (int)env->GetNumPointLights());
-
-    for (int i = 0; i < env->GetNumPointLights(); i++) {
-        if (auto point_light = env->GetPointLight(i)) {
-            point_light->Bind(i, this);
-        }
-    }
-
-    SetUniform("u_diffuseColor", mat.diffuse_color);
+    SetUniform(m_uniform_diffuse_color, mat.diffuse_color);
 
     if (auto cubemap = env->GetGlobalCubemap()) {
         cubemap->Prepare();
 
-        SetUniform("env_GlobalCubemap", cubemap.get());
+        SetUniform(m_uniform_global_cubemap, cubemap.get());
     }
 
     if (auto cubemap = env->GetGlobalIrradianceCubemap()) {
         cubemap->Prepare();
 
-        SetUniform("env_GlobalIrradianceCubemap", cubemap.get());
+        SetUniform(m_uniform_global_irradiance_cubemap, cubemap.get());
     }
 
-    for (auto it = mat.textures.begin(); it != mat.textures.end(); it++) {
-        if (it->second == nullptr) {
-            continue;
-        }
-
-        it->second->Prepare();
+    ApplyMaterialTextures(mat);
 
-        SetUniform(it->first, it->second.get());
-        SetUniform(std::string("Has") + it->first, 1);
-    }
+    static const Material::Key_t shininess_key = Material::GetKey("shininess"),
+        roughness_key = Material::GetKey("roughness"),
+        rim_shading_key = Material::GetKey("RimShading"),
+        flip_uv_key = Material::GetKey("FlipUV"),
+        flip_uv_x_key = Material::GetKey("FlipUV_X"),
+        flip_uv_y_key = Material::GetKey("FlipUV_Y");
 
-    if (mat.HasParameter("shininess")) {
-        SetUniform("u_shininess", mat.GetParameter("shininess")[0]);
+    if (mat.HasParameter(shininess_key)) {
+        SetUniform(m_uniform_shininess, mat.GetParameter(shininess_key)[0]);
     }
 
-    if (mat.HasParameter("roughness")) {
-        SetUniform("u_roughness", mat.GetParameter("roughness")[0]);
+    if (mat.HasParameter(roughness_key)) {
+        SetUniform(m_uniform_roughness, mat.GetParameter(roughness_key)[0]);
     }
 
-    if (mat.HasParameter("RimShading")) {
-        SetUniform("RimShading", mat.GetParameter("RimShading")[0]);
+    if (mat.HasParameter(rim_shading_key)) {
+        SetUniform(m_uniform_rim_shading, mat.GetParameter(rim_shading_key)[0]);
     }
 
-    if (mat.HasParameter("FlipUV")) {
-        const auto &param = mat.GetParameter("FlipUV");
-        SetUniform("FlipUV_X", int(param[0]));
-        SetUniform("FlipUV_Y", int(param[1]));
-    } else if (mat.HasParameter("FlipUV_X")) {
-        SetUniform("FlipUV_X", int(mat.GetParameter("FlipUV_X")[0]));
-    } else if (mat.HasParameter("FlipUV_Y")) {
-        SetUniform("FlipUV_Y", int(mat.GetParameter("FlipUV_X")[0]));
+    if (mat.HasParameter(flip_uv_key)) {
+        const auto &param = mat.GetParameter(flip_uv_key);
+        SetUniform(m_uniform_flip_uv_x, int(param[0]));
+        SetUniform(m_uniform_flip_uv_y, int(param[1]));
+    } else if (mat.HasParameter(flip_uv_x_key)) {
+        SetUniform(m_uniform_flip_uv_x, int(mat.GetParameter(flip_uv_x_key)[0]));
+    } else if (mat.HasParameter(flip_uv_y_key)) {
+        SetUniform(m_uniform_flip_uv_y, int(mat.GetParameter(flip_uv_y_key)[0]));
     }
 }
 
-void LightingShader::ApplyTransforms(const Transform &transform, Camera *camera)
+bool LightingShader::HasInstancedVariant(const ShaderProperties &properties) const
 {
-    Shader::ApplyTransforms(transform, camera);
-    SetUniform("u_camerapos", camera->GetTranslation());
+    // bone matrices are per entity, so skinned meshes are never instanced
+    return !properties.GetValue("SKINNING").IsTruthy();
 }
 } // namespace apex
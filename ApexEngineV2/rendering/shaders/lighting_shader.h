@@ -10,7 +10,25 @@ public:
     virtual ~LightingShader() = default;
 
     virtual void ApplyMaterial(const Material &mat);
-    virtual void ApplyTransforms(const Transform &transform, Camera *camera);
+
+protected:
+    virtual bool HasInstancedVariant(const ShaderProperties &properties) const;
+
+private:
+    UniformHandle_t m_uniform_diffuse_color;
+    UniformHandle_t m_uniform_shininess;
+    UniformHandle_t m_uniform_roughness;
+    UniformHandle_t m_uniform_rim_shading;
+    UniformHandle_t m_uniform_flip_uv_x;
+    UniformHandle_t m_uniform_flip_uv_y;
+    UniformHandle_t m_uniform_global_cubemap;
+    UniformHandle_t m_uniform_global_irradiance_cubemap;
+
+    // grown as the number of cascades increases. the lights, shadow matrices
+    // and camera are read from the uniform blocks, leaving only the samplers here.
+    std::vector<UniformHandle_t> m_shadow_map_uniforms;
+
+    UniformHandle_t GetShadowMapUniform(int index);
 };
 } // namespace apex
 
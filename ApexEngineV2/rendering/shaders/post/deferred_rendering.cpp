@@ -30,26 +30,11 @@ void DeferredRenderingShader::ApplyMaterial(const Material &mat)
     auto *env = Environment::GetInstance();
     if (env->ShadowsEnabled()) {
         for (int i = 0; i < env->NumCascades(); i++) {
-            const std::string i_str = std::to_string(i);
-
             if (auto shadow_map = env->GetShadowMap(i)) {
                 shadow_map->Prepare();
 
-                SetUniform("u_shadowMap[" + i_str + "]", shadow_map.get());
+                SetUniform("u_shadowMap[" + std::to_string(i) + "]", shadow_map.get());
             }
-
-            SetUniform("u_shadowMatrix[" + i_str + "]", env->GetShadowMatrix(i));
-            SetUniform("u_shadowSplit[" + i_str + "]", (float)env->GetShadowSplit(i));
-        }
-    }
-
-    env->GetSun().Bind(0, this);
-
-    SetUniform("env_NumPointLights", (int)env->GetNumPointLights());
-
-    for (int i = 0; i < env->GetNumPointLights(); i++) {
-        if (auto point_light = env->GetPointLight(i)) {
-            point_light->Bind(i, this);
         }
     }
 
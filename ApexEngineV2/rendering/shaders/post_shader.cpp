@@ -19,11 +19,6 @@ PostShader::PostShader(const ShaderProperties &properties)
 
 void PostShader::ApplyMaterial(const Material &mat)
 {
-    for (auto it = mat.textures.begin(); it != mat.textures.end(); it++) {
-        it->second->Prepare();
-
-        SetUniform(it->first, it->second.get());
-        SetUniform(std::string("Has") + it->first, 1);
-    }
+    ApplyMaterialTextures(mat);
 }
 } // namespace apex
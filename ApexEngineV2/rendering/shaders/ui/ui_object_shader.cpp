@@ -64,11 +64,13 @@ void UIObjectShader::ApplyMaterial(const Material &mat)
     //     texture_index++;
     // }
 
-    for (auto it = mat.textures.begin(); it != mat.textures.end(); it++) {
+    for (const Material::TextureEntry &entry : mat.GetTextures()) {
+        const std::string &name = Material::GetKeyName(entry.key);
+
         Texture::ActiveTexture(texture_index);
-        it->second->Begin();
-        SetUniform(it->first, texture_index);
-        SetUniform(std::string("Has") + it->first, 1);
+        entry.texture->Begin();
+        SetUniform(name, texture_index);
+        SetUniform(std::string("Has") + name, 1);
         texture_index++;
     }
 
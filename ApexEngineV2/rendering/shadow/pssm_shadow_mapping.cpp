@@ -1,7 +1,9 @@
 #include "pssm_shadow_mapping.h"
 #include "../shader_manager.h"
 #include "../shaders/depth_shader.h"
+#include "../uniform_blocks.h"
 #include "../../util.h"
+#include "../../profiler.h"
 
 namespace apex {
 PssmShadowMapping::PssmShadowMapping(Camera *view_cam, int num_splits, double max_dist)
@@ -62,6 +64,8 @@ void PssmShadowMapping::SetVarianceShadowMapping(bool value)
 
 void PssmShadowMapping::Render(Renderer *renderer)
 {
+    APEX_PROFILE_SCOPE("PssmShadowMapping::Render");
+
     m_depth_shader->SetOverrideCullMode(MaterialFaceCull::MaterialFace_Front);
 
     for (int i = 0; i < num_splits; i++) {
@@ -74,18 +78,18 @@ void PssmShadowMapping::Render(Renderer *renderer)
         renderer->RenderBucket(
             shadow_renderers[i]->GetShadowCamera(),
             renderer->GetBucket(Renderable::RB_OPAQUE),
-            m_depth_shader.get(),
-            false
+            m_depth_shader.get()
         );
 
         renderer->RenderBucket(
             shadow_renderers[i]->GetShadowCamera(),
             renderer->GetBucket(Renderable::RB_TRANSPARENT),
-            m_depth_shader.get(),
-            false
+            m_depth_shader.get()
         );
 
         shadow_renderers[i]->End();
     }
+
+    UniformBlocks::GetInstance()->UpdateShadows();
 }
 } // namespace apex
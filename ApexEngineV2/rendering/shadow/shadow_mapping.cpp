@@ -84,6 +84,7 @@ void ShadowMapping::Begin()
 
     shadow_cam->SetViewMatrix(new_view);
     shadow_cam->SetProjectionMatrix(new_proj);
+    shadow_cam->UpdateFrustum();
 
     if (m_use_fbo) {
         fbo->Use();
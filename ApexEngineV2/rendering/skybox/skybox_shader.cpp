@@ -30,21 +30,7 @@ void SkyboxShader::ApplyMaterial(const Material &mat)
 {
     Shader::ApplyMaterial(mat);
 
-    // int texture_index = 10;
-
-    for (auto it = mat.textures.begin(); it != mat.textures.end(); it++) {
-        if (it->second == nullptr) {
-            continue;
-        }
-
-        // Texture::ActiveTexture(texture_index);
-        it->second->Prepare();
-
-        SetUniform(it->first, it->second.get());
-        SetUniform(std::string("Has") + it->first, 1);
-
-        // texture_index++;
-    }
+    ApplyMaterialTextures(mat);
 }
 
 void SkyboxShader::ApplyTransforms(const Transform &transform, Camera *camera)
@@ -1,6 +1,5 @@
 #include "clouds_shader.h"
 #include "../environment.h"
-#include "../../core_engine.h"
 #include "../../asset/asset_manager.h"
 #include "../../asset/text_loader.h"
 #include "../../util/shader_preprocessor.h"
@@ -42,17 +41,6 @@ void CloudsShader::ApplyMaterial(const Material &mat)
 
     SetUniform("m_GlobalTime", m_global_time);
     SetUniform("m_CloudColor", m_cloud_color);
-
-    if (mat.alpha_blended) {
-        CoreEngine::GetInstance()->Enable(CoreEngine::GLEnums::BLEND);
-        CoreEngine::GetInstance()->BlendFunc(CoreEngine::GLEnums::SRC_ALPHA, CoreEngine::GLEnums::ONE_MINUS_SRC_ALPHA);
-    }
-    if (!mat.depth_test) {
-        CoreEngine::GetInstance()->Disable(CoreEngine::GLEnums::DEPTH_TEST);
-    }
-    if (!mat.depth_write) {
-        CoreEngine::GetInstance()->DepthMask(false);
-    }
 }
 
 void CloudsShader::ApplyTransforms(const Transform &transform, Camera *camera)
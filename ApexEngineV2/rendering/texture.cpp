@@ -92,7 +92,7 @@ size_t Texture::NumComponents(int format)
 
 void Texture::ActiveTexture(int i)
 {
-    glActiveTexture(GL_TEXTURE0 + i);
+    CoreEngine::GetInstance()->ActiveTexture(GL_TEXTURE0 + i);
     CatchGLErrors("Failed to set active texture", true);
 }
 
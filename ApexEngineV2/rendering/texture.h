@@ -10,7 +10,8 @@ class Texture : public Loadable {
 public:
     enum TextureType {
         TEXTURE_TYPE_2D = 0x0,
-        TEXTURE_TYPE_3D = 0x1
+        TEXTURE_TYPE_3D = 0x1,
+        TEXTURE_TYPE_2D_ARRAY = 0x2
     };
 
     Texture(TextureType texture_type);
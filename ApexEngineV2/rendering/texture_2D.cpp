@@ -23,17 +23,17 @@ Texture2D::~Texture2D()
 
 void Texture2D::UploadGpuData(bool should_upload_data)
 {
-    glTexParameteri(GL_TEXTURE_2D,
+    CoreEngine::GetInstance()->TexParameteri(GL_TEXTURE_2D,
         GL_TEXTURE_MAG_FILTER, mag_filter);
-    glTexParameteri(GL_TEXTURE_2D,
+    CoreEngine::GetInstance()->TexParameteri(GL_TEXTURE_2D,
         GL_TEXTURE_MIN_FILTER, min_filter);
-    glTexParameteri(GL_TEXTURE_2D,
+    CoreEngine::GetInstance()->TexParameteri(GL_TEXTURE_2D,
         GL_TEXTURE_WRAP_S, wrap_s);
-    glTexParameteri(GL_TEXTURE_2D,
+    CoreEngine::GetInstance()->TexParameteri(GL_TEXTURE_2D,
         GL_TEXTURE_WRAP_T, wrap_t);
 
     if (should_upload_data) {
-        glTexImage2D(GL_TEXTURE_2D, 0, ifmt,
+        CoreEngine::GetInstance()->TexImage2D(GL_TEXTURE_2D, 0, ifmt,
             width, height, 0, fmt, GL_UNSIGNED_BYTE, bytes);
 
         CatchGLErrors("glTexImage2D failed.", false);
@@ -41,7 +41,7 @@ void Texture2D::UploadGpuData(bool should_upload_data)
         if (min_filter == GL_LINEAR_MIPMAP_LINEAR ||
             min_filter == GL_LINEAR_MIPMAP_NEAREST ||
             min_filter == GL_NEAREST_MIPMAP_NEAREST) {
-            glGenerateMipmap(GL_TEXTURE_2D);
+            CoreEngine::GetInstance()->GenerateMipmap(GL_TEXTURE_2D);
             CatchGLErrors("Failed to generate Texture2D mipmaps.", false);
         }
     }
@@ -55,19 +55,19 @@ void Texture2D::CopyData(Texture * const other)
     ex_assert(ifmt == other->GetInternalFormat());
     ex_assert(fmt == other->GetFormat());
 
-    glCopyTexImage2D(GL_TEXTURE_2D, 0, fmt, 0, 0, width, height, 0);
+    CoreEngine::GetInstance()->CopyTexImage2D(GL_TEXTURE_2D, 0, fmt, 0, 0, width, height, 0);
 
     CatchGLErrors("Failed to copy texture data", false);
 }
 
 void Texture2D::Use()
 {
-    glBindTexture(GL_TEXTURE_2D, id);
+    CoreEngine::GetInstance()->BindTexture(GL_TEXTURE_2D, id);
 }
 
 void Texture2D::End()
 {
-    glBindTexture(GL_TEXTURE_2D, 0);
+    CoreEngine::GetInstance()->BindTexture(GL_TEXTURE_2D, 0);
 }
 
 } // namespace apex
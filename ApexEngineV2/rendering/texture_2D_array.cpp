@@ -0,0 +1,226 @@
+#include "texture_2D_array.h"
+#include "../core_engine.h"
+#include "../gl_util.h"
+#include "../util.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace apex {
+
+namespace {
+
+// rows are padded to 4 bytes, as GL reads them with the default unpack alignment
+inline size_t RowStride(int width, size_t components)
+{
+    return (size_t(width) * components + 3) & ~size_t(3);
+}
+
+// averages each 2x2 block of src into one pixel of dst
+void Downsample(const unsigned char *src, int src_width, int src_height, size_t components,
+    std::vector<unsigned char> &dst, int dst_width, int dst_height)
+{
+    const size_t src_stride = RowStride(src_width, components);
+    const size_t dst_stride = RowStride(dst_width, components);
+
+    dst.assign(dst_stride * size_t(dst_height), 0);
+
+    for (int y = 0; y < dst_height; y++) {
+        const int y0 = std::min(y * 2, src_height - 1);
+        const int y1 = std::min(y * 2 + 1, src_height - 1);
+
+        for (int x = 0; x < dst_width; x++) {
+            const int x0 = std::min(x * 2, src_width - 1);
+            const int x1 = std::min(x * 2 + 1, src_width - 1);
+
+            for (size_t c = 0; c < components; c++) {
+                const unsigned int sum = src[y0 * src_stride + x0 * components + c]
+                    + src[y0 * src_stride + x1 * components + c]
+                    + src[y1 * src_stride + x0 * components + c]
+                    + src[y1 * src_stride + x1 * components + c];
+
+                dst[y * dst_stride + x * components + c] = (unsigned char)((sum + 2) / 4);
+            }
+        }
+    }
+}
+
+} // namespace
+
+Texture2DArray::Texture2DArray(int width, int height, int max_layers, int fmt, int ifmt)
+    : Texture(TextureType::TEXTURE_TYPE_2D_ARRAY, width, height, nullptr),
+      m_max_layers(max_layers),
+      m_num_allocated_layers(std::min(max_layers, TEXTURE_2D_ARRAY_INITIAL_LAYERS)),
+      m_num_used_layers(0)
+{
+    SetFormat(fmt);
+    SetInternalFormat(ifmt);
+}
+
+Texture2DArray::~Texture2DArray()
+{
+    // deleted in parent destructor
+}
+
+bool Texture2DArray::CanHold(const Texture *texture) const
+{
+    return texture != nullptr
+        && texture->GetTextureType() == TextureType::TEXTURE_TYPE_2D
+        && texture->GetBytes() != nullptr
+        && texture->GetWidth() == width
+        && texture->GetHeight() == height
+        && texture->GetFormat() == fmt
+        && texture->GetInternalFormat() == ifmt;
+}
+
+int Texture2DArray::AddLayer(const Texture *texture)
+{
+    if (IsFull() || !CanHold(texture)) {
+        return -1;
+    }
+
+    // storage for the first layers is allocated on the first call
+    Prepare();
+
+    if (m_num_used_layers == m_num_allocated_layers) {
+        Grow(std::min(m_num_allocated_layers * 2, m_max_layers));
+    }
+
+    const int layer = m_num_used_layers++;
+
+    Use();
+
+    CoreEngine::GetInstance()->TexSubImage3D(CoreEngine::GLEnums::TEXTURE_2D_ARRAY, 0, 0, 0, layer,
+        width, height, 1, fmt, CoreEngine::GLEnums::UNSIGNED_BYTE, texture->GetBytes());
+
+    CatchGLErrors("glTexSubImage3D failed.", false);
+
+    // glGenerateMipmap would redo every layer, each time one is added
+    const size_t components = NumComponents(fmt);
+    const unsigned char *level_pixels = texture->GetBytes();
+    int level_width = width, level_height = height;
+    std::vector<unsigned char> level_data, next_level_data;
+
+    for (int level = 1; level < NumLevels(); level++) {
+        const int next_width = std::max(level_width / 2, 1);
+        const int next_height = std::max(level_height / 2, 1);
+
+        Downsample(level_pixels, level_width, level_height, components, next_level_data, next_width, next_height);
+
+        CoreEngine::GetInstance()->TexSubImage3D(CoreEngine::GLEnums::TEXTURE_2D_ARRAY, level, 0, 0, layer,
+            next_width, next_height, 1, fmt, CoreEngine::GLEnums::UNSIGNED_BYTE, next_level_data.data());
+
+        level_data.swap(next_level_data);
+        level_pixels = level_data.data();
+        level_width = next_width;
+        level_height = next_height;
+    }
+
+    CatchGLErrors("Failed to upload Texture2DArray mipmaps.", false);
+
+    End();
+
+    return layer;
+}
+
+void Texture2DArray::UploadGpuData(bool should_upload_data)
+{
+    CoreEngine::GetInstance()->TexParameteri(CoreEngine::GLEnums::TEXTURE_2D_ARRAY,
+        CoreEngine::GLEnums::TEXTURE_MAG_FILTER, mag_filter);
+    CoreEngine::GetInstance()->TexParameteri(CoreEngine::GLEnums::TEXTURE_2D_ARRAY,
+        CoreEngine::GLEnums::TEXTURE_MIN_FILTER, min_filter);
+    CoreEngine::GetInstance()->TexParameteri(CoreEngine::GLEnums::TEXTURE_2D_ARRAY,
+        CoreEngine::GLEnums::TEXTURE_WRAP_S, wrap_s);
+    CoreEngine::GetInstance()->TexParameteri(CoreEngine::GLEnums::TEXTURE_2D_ARRAY,
+        CoreEngine::GLEnums::TEXTURE_WRAP_T, wrap_t);
+
+    // layers are uploaded one at a time by AddLayer(), so every level is allocated here
+    for (int level = 0; level < NumLevels(); level++) {
+        CoreEngine::GetInstance()->TexImage3D(CoreEngine::GLEnums::TEXTURE_2D_ARRAY, level, ifmt,
+            std::max(width >> level, 1), std::max(height >> level, 1), m_num_allocated_layers, 0,
+            fmt, CoreEngine::GLEnums::UNSIGNED_BYTE, nullptr);
+    }
+
+    CatchGLErrors("glTexImage3D failed.", false);
+}
+
+void Texture2DArray::Grow(int num_layers)
+{
+    // GL 4.1 has no glCopyImageSubData, so each level goes through a pixel buffer
+    // on the gpu. level 0 is the largest, so the buffer is sized for it.
+    const size_t level_bytes = RowStride(width, NumComponents(fmt)) * size_t(height) * size_t(m_num_used_layers);
+
+    unsigned int pixel_buffer = 0;
+    CoreEngine::GetInstance()->GenBuffers(1, &pixel_buffer);
+    CoreEngine::GetInstance()->BindBuffer(CoreEngine::GLEnums::PIXEL_PACK_BUFFER, pixel_buffer);
+    CoreEngine::GetInstance()->BufferData(CoreEngine::GLEnums::PIXEL_PACK_BUFFER, level_bytes,
+        nullptr, CoreEngine::GLEnums::STREAM_COPY);
+    CoreEngine::GetInstance()->BindBuffer(CoreEngine::GLEnums::PIXEL_PACK_BUFFER, 0);
+
+    unsigned int old_id = id;
+    CoreEngine::GetInstance()->GenTextures(1, &id);
+    m_num_allocated_layers = num_layers;
+
+    Use();
+    UploadGpuData(false);
+
+    for (int level = 0; level < NumLevels(); level++) {
+        CoreEngine::GetInstance()->BindTexture(CoreEngine::GLEnums::TEXTURE_2D_ARRAY, old_id);
+        CoreEngine::GetInstance()->BindBuffer(CoreEngine::GLEnums::PIXEL_PACK_BUFFER, pixel_buffer);
+        CoreEngine::GetInstance()->GetTexImage(CoreEngine::GLEnums::TEXTURE_2D_ARRAY, level,
+            fmt, CoreEngine::GLEnums::UNSIGNED_BYTE, nullptr);
+        CoreEngine::GetInstance()->BindBuffer(CoreEngine::GLEnums::PIXEL_PACK_BUFFER, 0);
+
+        Use();
+        CoreEngine::GetInstance()->BindBuffer(CoreEngine::GLEnums::PIXEL_UNPACK_BUFFER, pixel_buffer);
+        CoreEngine::GetInstance()->TexSubImage3D(CoreEngine::GLEnums::TEXTURE_2D_ARRAY, level, 0, 0, 0,
+            std::max(width >> level, 1), std::max(height >> level, 1), m_num_used_layers,
+            fmt, CoreEngine::GLEnums::UNSIGNED_BYTE, nullptr);
+        CoreEngine::GetInstance()->BindBuffer(CoreEngine::GLEnums::PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    CatchGLErrors("Failed to copy Texture2DArray layers.", false);
+
+    CoreEngine::GetInstance()->DeleteTextures(1, &old_id);
+    CoreEngine::GetInstance()->DeleteBuffers(1, &pixel_buffer);
+}
+
+bool Texture2DArray::HasMipmaps() const
+{
+    return min_filter == CoreEngine::GLEnums::LINEAR_MIPMAP_LINEAR ||
+        min_filter == CoreEngine::GLEnums::LINEAR_MIPMAP_NEAREST ||
+        min_filter == CoreEngine::GLEnums::NEAREST_MIPMAP_LINEAR ||
+        min_filter == CoreEngine::GLEnums::NEAREST_MIPMAP_NEAREST;
+}
+
+int Texture2DArray::NumLevels() const
+{
+    if (!HasMipmaps()) {
+        return 1;
+    }
+
+    int num_levels = 1;
+
+    for (int size = std::max(width, height); size > 1; size /= 2) {
+        num_levels++;
+    }
+
+    return num_levels;
+}
+
+void Texture2DArray::CopyData(Texture * const other)
+{
+    not_implemented;
+}
+
+void Texture2DArray::Use()
+{
+    CoreEngine::GetInstance()->BindTexture(CoreEngine::GLEnums::TEXTURE_2D_ARRAY, id);
+}
+
+void Texture2DArray::End()
+{
+    CoreEngine::GetInstance()->BindTexture(CoreEngine::GLEnums::TEXTURE_2D_ARRAY, 0);
+}
+
+} // namespace apex
@@ -0,0 +1,53 @@
+#ifndef TEXTURE_2D_ARRAY_H
+#define TEXTURE_2D_ARRAY_H
+
+#include "texture.h"
+
+// layers allocated on the first AddLayer(), doubled each time they are all used
+#define TEXTURE_2D_ARRAY_INITIAL_LAYERS 4
+
+namespace apex {
+
+// Up to a fixed number of same-size 2D layers in one texture object.
+// Layers are filled with AddLayer(), which copies the pixels of an uploaded 2D texture.
+// Storage grows with the layers used, copying the existing layers on the gpu.
+class Texture2DArray : public Texture {
+public:
+    Texture2DArray(int width, int height, int max_layers, int fmt, int ifmt);
+    virtual ~Texture2DArray();
+
+    inline int NumLayers() const { return m_max_layers; }
+    inline int NumAllocatedLayers() const { return m_num_allocated_layers; }
+    inline int NumUsedLayers() const { return m_num_used_layers; }
+    inline bool IsFull() const { return m_num_used_layers == m_max_layers; }
+
+    // whether the texture is 2D, has its pixels on the cpu, and matches the size and format of the layers
+    bool CanHold(const Texture *texture) const;
+    // copies the pixels of the texture into the next free layer and returns its index,
+    // or -1 if the array is full or cannot hold the texture. with a mipmapped filter, the
+    // mipmaps of the layer are made on the cpu, leaving the other layers untouched.
+    // must be called on the GL thread.
+    int AddLayer(const Texture *texture);
+
+    virtual void End() override;
+    virtual void CopyData(Texture * const other) override;
+
+protected:
+    virtual void UploadGpuData(bool should_upload_data) override;
+    virtual void Use() override;
+
+private:
+    int m_max_layers;
+    int m_num_allocated_layers;
+    int m_num_used_layers;
+
+    bool HasMipmaps() const;
+    // down to 1x1, or just the one level without mipmaps
+    int NumLevels() const;
+    // moves the layers into a new texture object with room for num_layers
+    void Grow(int num_layers);
+};
+
+} // namespace apex
+
+#endif
@@ -0,0 +1,58 @@
+#include "texture_arrays.h"
+
+namespace apex {
+
+TextureArrays *TextureArrays::instance = nullptr;
+
+TextureArrays *TextureArrays::GetInstance()
+{
+    if (instance == nullptr) {
+        instance = new TextureArrays();
+    }
+
+    return instance;
+}
+
+TextureArrays::Layer TextureArrays::GetLayer(const std::shared_ptr<Texture> &texture)
+{
+    // only textures whose pixels are still on the cpu can be copied into a layer
+    if (texture == nullptr || texture->GetTextureType() != Texture::TEXTURE_TYPE_2D || texture->GetBytes() == nullptr) {
+        return { nullptr, -1 };
+    }
+
+    auto it = m_packed.find(texture.get());
+
+    if (it != m_packed.end()) {
+        if (it->second.texture.lock() == texture) {
+            return it->second.layer;
+        }
+
+        m_packed.erase(it);
+    }
+
+    Layer layer = { nullptr, -1 };
+
+    for (const auto &array : m_arrays) {
+        if (!array->IsFull() && array->CanHold(texture.get())) {
+            layer = { array, array->AddLayer(texture.get()) };
+            break;
+        }
+    }
+
+    if (layer.array == nullptr) {
+        auto array = std::make_shared<Texture2DArray>(texture->GetWidth(), texture->GetHeight(),
+            TEXTURE_ARRAYS_MAX_LAYERS, texture->GetFormat(), texture->GetInternalFormat());
+        array->SetFilter(texture->GetMagFilter(), texture->GetMinFilter());
+        array->SetWrapMode(texture->GetWrapS(), texture->GetWrapT());
+
+        m_arrays.push_back(array);
+
+        layer = { array, array->AddLayer(texture.get()) };
+    }
+
+    m_packed[texture.get()] = { texture, layer };
+
+    return layer;
+}
+
+} // namespace apex
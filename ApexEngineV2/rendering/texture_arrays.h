@@ -0,0 +1,52 @@
+#ifndef TEXTURE_ARRAYS_H
+#define TEXTURE_ARRAYS_H
+
+#include "texture_2D_array.h"
+
+#include <memory>
+#include <vector>
+#include <unordered_map>
+
+// the most textures packed into one array, its storage grows up to this many layers
+#define TEXTURE_ARRAYS_MAX_LAYERS 64
+
+namespace apex {
+
+// Packs 2D textures of the same size and format into the layers of shared
+// Texture2DArrays. Materials that only differ in such textures then bind the
+// same array, and only differ in the layer index they pass to the shader.
+// Each array takes its filtering and wrapping from the first texture packed into it.
+// NOTE: layers are not reused once their texture is destroyed.
+class TextureArrays {
+public:
+    struct Layer {
+        std::shared_ptr<Texture2DArray> array; // null if the texture cannot be packed
+        int index;
+    };
+
+    static TextureArrays *GetInstance();
+
+    TextureArrays() = default;
+    TextureArrays(const TextureArrays &other) = delete;
+
+    // the layer holding the pixels of the texture, packing it into an array the first
+    // time it is requested. must be called on the GL thread.
+    Layer GetLayer(const std::shared_ptr<Texture> &texture);
+
+    inline const std::vector<std::shared_ptr<Texture2DArray>> &GetArrays() const { return m_arrays; }
+
+private:
+    static TextureArrays *instance;
+
+    struct PackedTexture {
+        std::weak_ptr<Texture> texture; // to tell a destroyed texture from a new one at the same address
+        Layer layer;
+    };
+
+    std::vector<std::shared_ptr<Texture2DArray>> m_arrays;
+    std::unordered_map<const Texture*, PackedTexture> m_packed;
+};
+
+} // namespace apex
+
+#endif
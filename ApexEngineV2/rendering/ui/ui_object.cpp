@@ -26,19 +26,19 @@ void UIObject::UpdateTransform()
 
 bool UIObject::IsMouseOver(double x, double y) const
 {
-    if (x < m_global_transform.GetTranslation().x) {
+    if (x < GetGlobalTransform().GetTranslation().x) {
         return false;
     }
 
-    if (x > m_global_transform.GetTranslation().x + m_global_transform.GetScale().x) {
+    if (x > GetGlobalTransform().GetTranslation().x + GetGlobalTransform().GetScale().x) {
         return false;
     }
 
-    if (y < m_global_transform.GetTranslation().y) {
+    if (y < GetGlobalTransform().GetTranslation().y) {
         return false;
     }
 
-    if (y > m_global_transform.GetTranslation().y + m_global_transform.GetScale().y) {
+    if (y > GetGlobalTransform().GetTranslation().y + GetGlobalTransform().GetScale().y) {
         return false;
     }
 
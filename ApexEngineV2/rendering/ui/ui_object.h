@@ -27,17 +27,17 @@ public:
     inline std::shared_ptr<Texture> GetImage() const
         { return m_material.GetTexture("ColorMap"); }
     inline void SetImage(std::shared_ptr<Texture> texture)
-        { m_material.SetTexture("ColorMap", texture); }
+        { m_material.SetTexture("ColorMap", texture); Invalidate(); }
 
     inline void SetLocalTranslation2D(const Vector2 &translation)   
-        { SetLocalTranslation(Vector3(translation.x, translation.y, m_local_translation.z)); }
+        { SetLocalTranslation(Vector3(translation.x, translation.y, GetLocalTranslation().z)); }
     inline Vector2 GetLocalTranslation2D() const
-        { return Vector2(m_local_translation.x, m_local_translation.y); }
+        { return Vector2(GetLocalTranslation().x, GetLocalTranslation().y); }
 
     inline void SetLocalScale2D(const Vector2 &scale)   
-        { SetLocalScale(Vector3(scale.x, scale.y, m_local_scale.z)); }
+        { SetLocalScale(Vector3(scale.x, scale.y, GetLocalScale().z)); }
     inline Vector2 GetLocalScale2D() const
-        { return Vector2(m_local_scale.x, m_local_scale.y); }
+        { return Vector2(GetLocalScale().x, GetLocalScale().y); }
 
 protected:
     InputEvent m_click_event;
@@ -0,0 +1,125 @@
+#include "uniform_blocks.h"
+#include "environment.h"
+#include "camera/camera.h"
+
+#include <algorithm>
+#include <cstring>
+#include <cstddef>
+
+namespace apex {
+
+static_assert(sizeof(Matrix4) == 64, "Matrix4 must be 16 tightly packed floats to be copied into a uniform block");
+static_assert(sizeof(UniformBlocks::CameraData) == 208, "CameraData does not match the std140 layout of CameraBlock");
+static_assert(sizeof(UniformBlocks::EnvironmentData) == 32, "EnvironmentData does not match the std140 layout of EnvironmentBlock");
+static_assert(sizeof(UniformBlocks::ShadowData) == 320, "ShadowData does not match the std140 layout of ShadowBlock");
+static_assert(sizeof(UniformBlocks::PointLightData) == 208, "PointLightData does not match the std140 layout of PointLightBlock");
+
+static inline void CopyVector(float *dst, const Vector3 &vec)
+{
+    dst[0] = vec.x;
+    dst[1] = vec.y;
+    dst[2] = vec.z;
+    dst[3] = 0.0f;
+}
+
+static inline void CopyVector(float *dst, const Vector4 &vec)
+{
+    dst[0] = vec.x;
+    dst[1] = vec.y;
+    dst[2] = vec.z;
+    dst[3] = vec.w;
+}
+
+const char *const UniformBlocks::block_names[UniformBlocks::BLOCK_MAX] = {
+    "CameraBlock",
+    "EnvironmentBlock",
+    "ShadowBlock",
+    "PointLightBlock"
+};
+
+UniformBlocks *UniformBlocks::instance = nullptr;
+
+UniformBlocks *UniformBlocks::GetInstance()
+{
+    if (instance == nullptr) {
+        instance = new UniformBlocks();
+    }
+
+    return instance;
+}
+
+UniformBlocks::UniformBlocks()
+    : m_camera_buffer(sizeof(CameraData), BLOCK_CAMERA),
+      m_environment_buffer(sizeof(EnvironmentData), BLOCK_ENVIRONMENT),
+      m_shadow_buffer(sizeof(ShadowData), BLOCK_SHADOWS),
+      m_point_light_buffer(sizeof(PointLightData), BLOCK_POINT_LIGHTS),
+      m_camera(nullptr),
+      m_frame_index(1),
+      m_camera_frame_index(0)
+{
+}
+
+void UniformBlocks::UpdateCamera(Camera *camera)
+{
+    CameraData data;
+    data.view_matrix = camera->GetViewMatrix();
+    data.proj_matrix = camera->GetProjectionMatrix();
+    data.view_proj_matrix = camera->GetViewProjectionMatrix();
+    CopyVector(data.camera_position, camera->GetTranslation());
+
+    m_camera_buffer.Update(&data, sizeof(data));
+
+    m_camera = camera;
+    m_camera_frame_index = m_frame_index;
+}
+
+void UniformBlocks::UpdateEnvironment()
+{
+    const Environment *env = Environment::GetInstance();
+
+    EnvironmentData environment_data;
+    CopyVector(environment_data.sun_direction, env->GetSun().GetDirection());
+    CopyVector(environment_data.sun_color, env->GetSun().GetColor());
+
+    m_environment_buffer.Update(&environment_data, sizeof(environment_data));
+
+    PointLightData point_light_data;
+    memset(&point_light_data, 0, sizeof(point_light_data));
+
+    int num_point_lights = 0;
+
+    for (size_t i = 0; i < env->GetNumPointLights() && num_point_lights < UNIFORM_BLOCKS_MAX_POINT_LIGHTS; i++) {
+        if (const auto &point_light = env->GetPointLight(i)) {
+            PointLightData::PointLight &dst = point_light_data.point_lights[num_point_lights++];
+
+            CopyVector(dst.position, point_light->GetPosition());
+            CopyVector(dst.color, point_light->GetColor());
+            dst.radius = point_light->GetRadius();
+        }
+    }
+
+    point_light_data.num_point_lights = num_point_lights;
+
+    // only upload the lights in use
+    m_point_light_buffer.Update(&point_light_data,
+        offsetof(PointLightData, point_lights) + num_point_lights * sizeof(PointLightData::PointLight));
+}
+
+void UniformBlocks::UpdateShadows()
+{
+    const Environment *env = Environment::GetInstance();
+
+    ShadowData data;
+    memset(data.shadow_splits, 0, sizeof(data.shadow_splits));
+
+    const int num_cascades = std::min(env->NumCascades(), UNIFORM_BLOCKS_MAX_CASCADES);
+
+    for (int i = 0; i < num_cascades; i++) {
+        data.shadow_matrices[i] = env->GetShadowMatrix(i);
+        data.shadow_splits[i][0] = float(env->GetShadowSplit(i));
+    }
+
+    m_shadow_buffer.Update(&data, sizeof(data));
+}
+
+} // namespace apex
@@ -0,0 +1,105 @@
+#ifndef UNIFORM_BLOCKS_H
+#define UNIFORM_BLOCKS_H
+
+#include "uniform_buffer.h"
+#include "../math/matrix4.h"
+
+#include <cstddef>
+
+// sizes of the fixed arrays in ShadowBlock and PointLightBlock,
+// must match res/shaders/include/uniform_blocks.inc
+#define UNIFORM_BLOCKS_MAX_CASCADES 4
+#define UNIFORM_BLOCKS_MAX_POINT_LIGHTS 4
+
+namespace apex {
+class Camera;
+
+// Data shared by every program through std140 uniform blocks, declared in
+// res/shaders/include/uniform_blocks.inc. Each block has a fixed binding point,
+// which Shader assigns to the block of the same name after linking, so the
+// blocks are filled once per frame (or per camera) instead of once per draw.
+class UniformBlocks {
+public:
+    enum BlockBinding {
+        BLOCK_CAMERA = 0,
+        BLOCK_ENVIRONMENT,
+        BLOCK_SHADOWS,
+        BLOCK_POINT_LIGHTS,
+        BLOCK_MAX
+    };
+
+    // indexed by BlockBinding
+    static const char *const block_names[BLOCK_MAX];
+
+    // std140 layouts of the blocks. matrices are declared row_major,
+    // matching the transposed uploads of matrix uniforms.
+    struct CameraData {
+        Matrix4 view_matrix;
+        Matrix4 proj_matrix;
+        Matrix4 view_proj_matrix;
+        float camera_position[4]; // vec3
+    };
+
+    struct EnvironmentData {
+        float sun_direction[4]; // vec3
+        float sun_color[4];
+    };
+
+    struct ShadowData {
+        Matrix4 shadow_matrices[UNIFORM_BLOCKS_MAX_CASCADES];
+        float shadow_splits[UNIFORM_BLOCKS_MAX_CASCADES][4]; // arrays of floats have a 16 byte stride
+    };
+
+    struct PointLightData {
+        struct PointLight {
+            float position[4]; // vec3
+            float color[4];
+            float radius;
+            float padding[3];
+        };
+
+        int num_point_lights;
+        int padding[3];
+        PointLight point_lights[UNIFORM_BLOCKS_MAX_POINT_LIGHTS];
+    };
+
+    static UniformBlocks *GetInstance();
+
+    UniformBlocks();
+    UniformBlocks(const UniformBlocks &other) = delete;
+
+    // called by the renderer at the start of each frame,
+    // so that cameras are uploaded again with their new matrices
+    inline void BeginFrame() { m_frame_index++; }
+
+    // uploads the camera block, unless it already holds this camera for the current frame
+    inline void SetCamera(Camera *camera)
+    {
+        if (camera != m_camera || m_camera_frame_index != m_frame_index) {
+            UpdateCamera(camera);
+        }
+    }
+
+    // uploads the sun and point lights of the environment
+    void UpdateEnvironment();
+    // uploads the shadow matrices and splits of the environment
+    void UpdateShadows();
+
+private:
+    static UniformBlocks *instance;
+
+    UniformBuffer m_camera_buffer;
+    UniformBuffer m_environment_buffer;
+    UniformBuffer m_shadow_buffer;
+    UniformBuffer m_point_light_buffer;
+
+    Camera *m_camera;
+    size_t m_frame_index;
+    size_t m_camera_frame_index;
+
+    void UpdateCamera(Camera *camera);
+};
+
+} // namespace apex
+
+#endif
@@ -0,0 +1,43 @@
+#include "uniform_buffer.h"
+#include "../core_engine.h"
+#include "../util.h"
+
+namespace apex {
+
+UniformBuffer::UniformBuffer(size_t size, unsigned int binding)
+    : m_size(size),
+      m_binding(binding),
+      m_id(0),
+      is_created(false)
+{
+}
+
+UniformBuffer::~UniformBuffer()
+{
+    if (is_created) {
+        CoreEngine::GetInstance()->DeleteBuffers(1, &m_id);
+    }
+}
+
+void UniformBuffer::Update(const void *data, size_t size)
+{
+    ex_assert(size <= m_size);
+
+    if (!is_created) {
+        CoreEngine::GetInstance()->GenBuffers(1, &m_id);
+        CoreEngine::GetInstance()->BindBuffer(CoreEngine::GLEnums::UNIFORM_BUFFER, m_id);
+        CoreEngine::GetInstance()->BufferData(CoreEngine::GLEnums::UNIFORM_BUFFER, m_size, nullptr, CoreEngine::GLEnums::DYNAMIC_DRAW);
+
+        // binding points are shared by every program, so the buffer only has to be attached once
+        CoreEngine::GetInstance()->BindBufferBase(CoreEngine::GLEnums::UNIFORM_BUFFER, m_binding, m_id);
+
+        is_created = true;
+    } else {
+        CoreEngine::GetInstance()->BindBuffer(CoreEngine::GLEnums::UNIFORM_BUFFER, m_id);
+    }
+
+    // left bound, as it does not affect the indexed binding point
+    CoreEngine::GetInstance()->BufferSubData(CoreEngine::GLEnums::UNIFORM_BUFFER, 0, size, data);
+}
+
+} // namespace apex
@@ -0,0 +1,32 @@
+#ifndef UNIFORM_BUFFER_H
+#define UNIFORM_BUFFER_H
+
+#include <cstddef>
+
+namespace apex {
+
+// A uniform buffer object of a fixed size, attached to one binding point.
+// The buffer is created on the first call to Update().
+class UniformBuffer {
+public:
+    UniformBuffer(size_t size, unsigned int binding);
+    UniformBuffer(const UniformBuffer &other) = delete;
+    UniformBuffer &operator=(const UniformBuffer &other) = delete;
+    ~UniformBuffer();
+
+    inline size_t GetSize() const { return m_size; }
+    inline unsigned int GetBinding() const { return m_binding; }
+
+    // replaces the contents of the buffer; size must not exceed GetSize()
+    void Update(const void *data, size_t size);
+
+private:
+    size_t m_size;
+    unsigned int m_binding;
+    unsigned int m_id;
+    bool is_created;
+};
+
+} // namespace apex
+
+#endif
@@ -0,0 +1,144 @@
+#include "vertex_format.h"
+
+#include <array>
+#include <cmath>
+#include <type_traits>
+#include <utility>
+
+namespace apex {
+
+namespace {
+
+template <class Format, unsigned int Attribute>
+inline void PackAttribute(unsigned char *dst, const Vertex &vertex, std::true_type)
+{
+    VertexAttributeTraits<Attribute, Format::packing>::Pack(dst + Format::template Offset<Attribute>(), vertex);
+}
+
+template <class Format, unsigned int Attribute>
+inline void PackAttribute(unsigned char *, const Vertex &, std::false_type)
+{
+}
+
+template <class Format, unsigned int Attribute>
+inline void PackAttribute(unsigned char *dst, const Vertex &vertex)
+{
+    PackAttribute<Format, Attribute>(dst, vertex,
+        std::integral_constant<bool, (Format::mask & Attribute) != 0>());
+}
+
+// the packing kernel of one layout: which attributes are written, where and how
+// is all known at compile time, so there are no per-vertex branches or lookups
+template <unsigned int Mask, VertexPacking Packing>
+void PackVertices(const Vertex *vertices, size_t count, unsigned char *out)
+{
+    typedef VertexFormat<Mask, Packing> Format;
+
+    for (size_t i = 0; i < count; i++) {
+        unsigned char *dst = out + i * Format::stride;
+        const Vertex &vertex = vertices[i];
+
+        PackAttribute<Format, VERTEX_ATTR_POSITIONS>(dst, vertex);
+        PackAttribute<Format, VERTEX_ATTR_NORMALS>(dst, vertex);
+        PackAttribute<Format, VERTEX_ATTR_TEXCOORDS0>(dst, vertex);
+        PackAttribute<Format, VERTEX_ATTR_TEXCOORDS1>(dst, vertex);
+        PackAttribute<Format, VERTEX_ATTR_TANGENTS>(dst, vertex);
+        PackAttribute<Format, VERTEX_ATTR_BITANGENTS>(dst, vertex);
+        PackAttribute<Format, VERTEX_ATTR_BONEWEIGHTS>(dst, vertex);
+        PackAttribute<Format, VERTEX_ATTR_BONEINDICES>(dst, vertex);
+    }
+}
+
+template <class Format, unsigned int Attribute>
+VertexFormatInfo::Attribute MakeAttribute()
+{
+    typedef typename VertexAttributeTraits<Attribute, Format::packing>::Element Element;
+
+    VertexFormatInfo::Attribute attribute;
+    attribute.offset = Format::template Offset<Attribute>();
+    attribute.type = Element::type;
+    attribute.components = Element::components;
+    attribute.normalized = Element::normalized;
+
+    return attribute;
+}
+
+template <unsigned int Mask, VertexPacking Packing>
+VertexFormatInfo MakeInfo()
+{
+    typedef VertexFormat<Mask, Packing> Format;
+
+    VertexFormatInfo info;
+    info.mask = Mask;
+    info.packing = Packing;
+    info.stride = Format::stride;
+    info.attributes[0] = MakeAttribute<Format, VERTEX_ATTR_POSITIONS>();
+    info.attributes[1] = MakeAttribute<Format, VERTEX_ATTR_NORMALS>();
+    info.attributes[2] = MakeAttribute<Format, VERTEX_ATTR_TEXCOORDS0>();
+    info.attributes[3] = MakeAttribute<Format, VERTEX_ATTR_TEXCOORDS1>();
+    info.attributes[4] = MakeAttribute<Format, VERTEX_ATTR_TANGENTS>();
+    info.attributes[5] = MakeAttribute<Format, VERTEX_ATTR_BITANGENTS>();
+    info.attributes[6] = MakeAttribute<Format, VERTEX_ATTR_BONEWEIGHTS>();
+    info.attributes[7] = MakeAttribute<Format, VERTEX_ATTR_BONEINDICES>();
+    info.pack = &PackVertices<Mask, Packing>;
+
+    return info;
+}
+
+template <VertexPacking Packing, unsigned int... Masks>
+std::array<VertexFormatInfo, sizeof...(Masks)> MakeInfos(std::integer_sequence<unsigned int, Masks...>)
+{
+    return {{ MakeInfo<Masks, Packing>()... }};
+}
+
+typedef std::make_integer_sequence<unsigned int, VERTEX_ATTR_ALL + 1> AllMasks;
+
+} // namespace
+
+const VertexFormatInfo &VertexFormatInfo::Get(unsigned int mask, VertexPacking packing)
+{
+    // one entry per combination of attributes
+    static const std::array<VertexFormatInfo, VERTEX_ATTR_ALL + 1> float_formats =
+        MakeInfos<VERTEX_PACKING_FLOAT>(AllMasks());
+    static const std::array<VertexFormatInfo, VERTEX_ATTR_ALL + 1> compact_formats =
+        MakeInfos<VERTEX_PACKING_COMPACT>(AllMasks());
+
+    mask &= VERTEX_ATTR_ALL;
+
+    return packing == VERTEX_PACKING_COMPACT ? compact_formats[mask] : float_formats[mask];
+}
+
+VertexPacking VertexFormatInfo::SelectPacking(unsigned int mask, const Vertex *vertices, size_t count)
+{
+    const bool check_texcoords0 = (mask & VERTEX_ATTR_TEXCOORDS0) != 0;
+    const bool check_texcoords1 = (mask & VERTEX_ATTR_TEXCOORDS1) != 0;
+    const bool check_bone_indices = (mask & VERTEX_ATTR_BONEINDICES) != 0;
+
+    for (size_t i = 0; i < count; i++) {
+        const Vertex &vertex = vertices[i];
+
+        if (check_texcoords0 &&
+            (std::abs(vertex.GetTexCoord0().x) > VERTEX_FORMAT_MAX_HALF_TEXCOORD ||
+            std::abs(vertex.GetTexCoord0().y) > VERTEX_FORMAT_MAX_HALF_TEXCOORD)) {
+            return VERTEX_PACKING_FLOAT;
+        }
+
+        if (check_texcoords1 &&
+            (std::abs(vertex.GetTexCoord1().x) > VERTEX_FORMAT_MAX_HALF_TEXCOORD ||
+            std::abs(vertex.GetTexCoord1().y) > VERTEX_FORMAT_MAX_HALF_TEXCOORD)) {
+            return VERTEX_PACKING_FLOAT;
+        }
+
+        if (check_bone_indices) {
+            for (int index : vertex.GetBoneIndices()) {
+                if (index < 0 || index > VERTEX_FORMAT_MAX_BYTE_BONE_INDEX) {
+                    return VERTEX_PACKING_FLOAT;
+                }
+            }
+        }
+    }
+
+    return VERTEX_PACKING_COMPACT;
+}
+
+} // namespace apex
@@ -0,0 +1,296 @@
+#ifndef VERTEX_FORMAT_H
+#define VERTEX_FORMAT_H
+
+#include "../math/vertex.h"
+#include "../core_engine.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// texcoords are only stored as half floats while they all lie within this range,
+// otherwise the mesh falls back to float texcoords. half floats step by 1/1024
+// at 1 and 1/512 at 2, tiled texcoords further out would visibly snap.
+#define VERTEX_FORMAT_MAX_HALF_TEXCOORD 2.0f
+#define VERTEX_FORMAT_MAX_BYTE_BONE_INDEX 255
+#define VERTEX_FORMAT_NUM_ATTRIBUTES 8
+
+namespace apex {
+
+enum VertexPacking {
+    // every attribute stored as 32-bit floats
+    VERTEX_PACKING_FLOAT = 0,
+    // 10:10:10:2 normals and tangents, half float texcoords,
+    // unorm8 bone weights and uint8 bone indices. positions stay 32-bit floats.
+    VERTEX_PACKING_COMPACT = 1,
+    VERTEX_PACKING_MAX
+};
+
+// Bits of the attributes in a vertex format, in the order they are laid out.
+// These match Mesh::MeshAttributeType.
+enum VertexFormatAttribute {
+    VERTEX_ATTR_POSITIONS = 0x01,
+    VERTEX_ATTR_NORMALS = 0x02,
+    VERTEX_ATTR_TEXCOORDS0 = 0x04,
+    VERTEX_ATTR_TEXCOORDS1 = 0x08,
+    VERTEX_ATTR_TANGENTS = 0x10,
+    VERTEX_ATTR_BITANGENTS = 0x20,
+    VERTEX_ATTR_BONEWEIGHTS = 0x40,
+    VERTEX_ATTR_BONEINDICES = 0x80,
+    VERTEX_ATTR_ALL = 0xFF
+};
+
+namespace vertex_packing {
+
+inline uint16_t FloatToHalf(float value)
+{
+    // rebias the exponent with a float multiply, rounding to nearest.
+    // denormals and overflow fall out of the arithmetic, only inf/nan need a select.
+    const uint32_t f32_infinity = 255 << 23;
+    const uint32_t f16_infinity = 31 << 23;
+    const uint32_t round_mask = ~0xFFFu;
+    const float magic = 1.92592994e-34f; // 2^-112, i.e 15 << 23 as bits
+
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    const uint32_t sign = bits & 0x80000000u;
+    bits ^= sign;
+
+    uint32_t rebiased_bits = bits & round_mask;
+    float rebiased;
+    std::memcpy(&rebiased, &rebiased_bits, sizeof(rebiased));
+    rebiased *= magic;
+    std::memcpy(&rebiased_bits, &rebiased, sizeof(rebiased_bits));
+    rebiased_bits -= round_mask;
+    rebiased_bits = std::min(rebiased_bits, f16_infinity);
+
+    const uint32_t special = bits > f32_infinity ? 0x7E00 : 0x7C00;
+    const uint32_t half = bits >= f32_infinity ? special : (rebiased_bits >> 13);
+
+    return uint16_t(half | (sign >> 16));
+}
+
+inline int32_t FloatToSnorm10(float value)
+{
+    const float clamped = std::max(-1.0f, std::min(1.0f, value));
+
+    // round half away from zero, as the conversion truncates.
+    // copysign keeps it free of a branch on the sign of random normals.
+    return int32_t(clamped * 511.0f + std::copysign(0.5f, clamped));
+}
+
+// GL_INT_2_10_10_10_REV: x in the low bits, w in the top two
+inline uint32_t PackSnorm10x3(const Vector3 &vec)
+{
+    return (uint32_t(FloatToSnorm10(vec.x)) & 0x3FF)
+        | ((uint32_t(FloatToSnorm10(vec.y)) & 0x3FF) << 10)
+        | ((uint32_t(FloatToSnorm10(vec.z)) & 0x3FF) << 20);
+}
+
+inline uint8_t FloatToUnorm8(float value)
+{
+    const float clamped = std::max(0.0f, std::min(1.0f, value));
+
+    return uint8_t(clamped * 255.0f + 0.5f);
+}
+
+// Component encodings. Each has the GL type and component count passed to
+// VertexAttribPointer, its size in bytes, and packs its source value to dst.
+struct Float3 {
+    static constexpr int type = CoreEngine::GLEnums::FLOAT;
+    static constexpr int components = 3;
+    static constexpr bool normalized = false;
+    static constexpr size_t size = sizeof(float) * 3;
+
+    static inline void Pack(unsigned char *dst, const Vector3 &vec)
+    {
+        const float values[3] = { vec.x, vec.y, vec.z };
+        std::memcpy(dst, values, size);
+    }
+};
+
+struct Float2 {
+    static constexpr int type = CoreEngine::GLEnums::FLOAT;
+    static constexpr int components = 2;
+    static constexpr bool normalized = false;
+    static constexpr size_t size = sizeof(float) * 2;
+
+    static inline void Pack(unsigned char *dst, const Vector2 &vec)
+    {
+        const float values[2] = { vec.x, vec.y };
+        std::memcpy(dst, values, size);
+    }
+};
+
+struct Float4 {
+    static constexpr int type = CoreEngine::GLEnums::FLOAT;
+    static constexpr int components = 4;
+    static constexpr bool normalized = false;
+    static constexpr size_t size = sizeof(float) * 4;
+
+    template <class T, size_t N>
+    static inline void Pack(unsigned char *dst, const std::array<T, N> &arr)
+    {
+        static_assert(N >= 4, "needs four components");
+
+        const float values[4] = { float(arr[0]), float(arr[1]), float(arr[2]), float(arr[3]) };
+        std::memcpy(dst, values, size);
+    }
+};
+
+struct Half2 {
+    static constexpr int type = CoreEngine::GLEnums::HALF_FLOAT;
+    static constexpr int components = 2;
+    static constexpr bool normalized = false;
+    static constexpr size_t size = sizeof(uint16_t) * 2;
+
+    static inline void Pack(unsigned char *dst, const Vector2 &vec)
+    {
+        const uint16_t values[2] = { FloatToHalf(vec.x), FloatToHalf(vec.y) };
+        std::memcpy(dst, values, size);
+    }
+};
+
+// read as a vec4 with w = 0, the shaders only use xyz
+struct Snorm10x3 {
+    static constexpr int type = CoreEngine::GLEnums::INT_2_10_10_10_REV;
+    static constexpr int components = 4;
+    static constexpr bool normalized = true;
+    static constexpr size_t size = sizeof(uint32_t);
+
+    static inline void Pack(unsigned char *dst, const Vector3 &vec)
+    {
+        const uint32_t value = PackSnorm10x3(vec);
+        std::memcpy(dst, &value, size);
+    }
+};
+
+struct Unorm8x4 {
+    static constexpr int type = CoreEngine::GLEnums::UNSIGNED_BYTE;
+    static constexpr int components = 4;
+    static constexpr bool normalized = true;
+    static constexpr size_t size = 4;
+
+    template <size_t N>
+    static inline void Pack(unsigned char *dst, const std::array<float, N> &arr)
+    {
+        static_assert(N >= 4, "needs four components");
+
+        for (int i = 0; i < 4; i++) {
+            dst[i] = FloatToUnorm8(arr[i]);
+        }
+    }
+};
+
+// not normalized, so shaders still read the indices as floats
+struct Uint8x4 {
+    static constexpr int type = CoreEngine::GLEnums::UNSIGNED_BYTE;
+    static constexpr int components = 4;
+    static constexpr bool normalized = false;
+    static constexpr size_t size = 4;
+
+    template <size_t N>
+    static inline void Pack(unsigned char *dst, const std::array<int, N> &arr)
+    {
+        static_assert(N >= 4, "needs four components");
+
+        for (int i = 0; i < 4; i++) {
+            dst[i] = uint8_t(arr[i]);
+        }
+    }
+};
+
+} // namespace vertex_packing
+
+// The encoding of each attribute under a packing, and how it is read from a Vertex.
+template <unsigned int Attribute, VertexPacking Packing>
+struct VertexAttributeTraits;
+
+#define VERTEX_ATTRIBUTE_TRAITS(attribute, packing, element, getter) \
+    template <> \
+    struct VertexAttributeTraits<attribute, packing> { \
+        typedef vertex_packing::element Element; \
+        static inline void Pack(unsigned char *dst, const Vertex &vertex) { Element::Pack(dst, getter); } \
+    }
+
+VERTEX_ATTRIBUTE_TRAITS(VERTEX_ATTR_POSITIONS, VERTEX_PACKING_FLOAT, Float3, vertex.GetPosition());
+VERTEX_ATTRIBUTE_TRAITS(VERTEX_ATTR_NORMALS, VERTEX_PACKING_FLOAT, Float3, vertex.GetNormal());
+VERTEX_ATTRIBUTE_TRAITS(VERTEX_ATTR_TEXCOORDS0, VERTEX_PACKING_FLOAT, Float2, vertex.GetTexCoord0());
+VERTEX_ATTRIBUTE_TRAITS(VERTEX_ATTR_TEXCOORDS1, VERTEX_PACKING_FLOAT, Float2, vertex.GetTexCoord1());
+VERTEX_ATTRIBUTE_TRAITS(VERTEX_ATTR_TANGENTS, VERTEX_PACKING_FLOAT, Float3, vertex.GetTangent());
+VERTEX_ATTRIBUTE_TRAITS(VERTEX_ATTR_BITANGENTS, VERTEX_PACKING_FLOAT, Float3, vertex.GetBitangent());
+VERTEX_ATTRIBUTE_TRAITS(VERTEX_ATTR_BONEWEIGHTS, VERTEX_PACKING_FLOAT, Float4, vertex.GetBoneWeights());
+VERTEX_ATTRIBUTE_TRAITS(VERTEX_ATTR_BONEINDICES, VERTEX_PACKING_FLOAT, Float4, vertex.GetBoneIndices());
+
+VERTEX_ATTRIBUTE_TRAITS(VERTEX_ATTR_POSITIONS, VERTEX_PACKING_COMPACT, Float3, vertex.GetPosition());
+VERTEX_ATTRIBUTE_TRAITS(VERTEX_ATTR_NORMALS, VERTEX_PACKING_COMPACT, Snorm10x3, vertex.GetNormal());
+VERTEX_ATTRIBUTE_TRAITS(VERTEX_ATTR_TEXCOORDS0, VERTEX_PACKING_COMPACT, Half2, vertex.GetTexCoord0());
+VERTEX_ATTRIBUTE_TRAITS(VERTEX_ATTR_TEXCOORDS1, VERTEX_PACKING_COMPACT, Half2, vertex.GetTexCoord1());
+VERTEX_ATTRIBUTE_TRAITS(VERTEX_ATTR_TANGENTS, VERTEX_PACKING_COMPACT, Snorm10x3, vertex.GetTangent());
+VERTEX_ATTRIBUTE_TRAITS(VERTEX_ATTR_BITANGENTS, VERTEX_PACKING_COMPACT, Snorm10x3, vertex.GetBitangent());
+VERTEX_ATTRIBUTE_TRAITS(VERTEX_ATTR_BONEWEIGHTS, VERTEX_PACKING_COMPACT, Unorm8x4, vertex.GetBoneWeights());
+VERTEX_ATTRIBUTE_TRAITS(VERTEX_ATTR_BONEINDICES, VERTEX_PACKING_COMPACT, Uint8x4, vertex.GetBoneIndices());
+
+#undef VERTEX_ATTRIBUTE_TRAITS
+
+// Compile-time description of an interleaved vertex layout holding the attributes
+// in Mask, in bit order, each encoded as chosen by Packing.
+template <unsigned int Mask, VertexPacking Packing>
+struct VertexFormat {
+    static constexpr unsigned int mask = Mask;
+    static constexpr VertexPacking packing = Packing;
+
+    template <unsigned int Attribute>
+    static constexpr size_t AttributeSize()
+    {
+        return (Mask & Attribute) ? VertexAttributeTraits<Attribute, Packing>::Element::size : 0;
+    }
+
+    // byte offset of the attribute, the sum of the sizes of those before it
+    template <unsigned int Attribute>
+    static constexpr size_t Offset()
+    {
+        return (Attribute > VERTEX_ATTR_POSITIONS ? AttributeSize<VERTEX_ATTR_POSITIONS>() : 0)
+            + (Attribute > VERTEX_ATTR_NORMALS ? AttributeSize<VERTEX_ATTR_NORMALS>() : 0)
+            + (Attribute > VERTEX_ATTR_TEXCOORDS0 ? AttributeSize<VERTEX_ATTR_TEXCOORDS0>() : 0)
+            + (Attribute > VERTEX_ATTR_TEXCOORDS1 ? AttributeSize<VERTEX_ATTR_TEXCOORDS1>() : 0)
+            + (Attribute > VERTEX_ATTR_TANGENTS ? AttributeSize<VERTEX_ATTR_TANGENTS>() : 0)
+            + (Attribute > VERTEX_ATTR_BITANGENTS ? AttributeSize<VERTEX_ATTR_BITANGENTS>() : 0)
+            + (Attribute > VERTEX_ATTR_BONEWEIGHTS ? AttributeSize<VERTEX_ATTR_BONEWEIGHTS>() : 0)
+            + (Attribute > VERTEX_ATTR_BONEINDICES ? AttributeSize<VERTEX_ATTR_BONEINDICES>() : 0);
+    }
+
+    static constexpr size_t stride = Offset<VERTEX_ATTR_ALL>();
+};
+
+// Runtime view of a VertexFormat, used to set up the attribute pointers.
+struct VertexFormatInfo {
+    typedef void(*PackFunction)(const Vertex *vertices, size_t count, unsigned char *out);
+
+    struct Attribute {
+        size_t offset;
+        int type;
+        int components;
+        bool normalized;
+    };
+
+    unsigned int mask;
+    VertexPacking packing;
+    size_t stride;
+    // indexed by the bit index of the attribute, only valid for those in mask
+    Attribute attributes[VERTEX_FORMAT_NUM_ATTRIBUTES];
+    // writes count vertices of stride bytes each
+    PackFunction pack;
+
+    static const VertexFormatInfo &Get(unsigned int mask, VertexPacking packing);
+    // the compact packing can not represent bone indices over 255, or texcoords
+    // beyond VERTEX_FORMAT_MAX_HALF_TEXCOORD. returns VERTEX_PACKING_FLOAT if any vertex needs it.
+    static VertexPacking SelectPacking(unsigned int mask, const Vertex *vertices, size_t count);
+};
+
+} // namespace apex
+
+#endif
@@ -5,6 +5,7 @@
 #include "../../rendering/shaders/lighting_shader.h"
 #include "../../rendering/environment.h"
 #include "../../util/random/worley_noise_generator.h"
+#include "../../profiler.h"
 
 #include <noise/noise.h>
 #include <noise/module/ridgedmulti.h>
@@ -71,6 +72,8 @@ NoiseTerrainChunk::NoiseTerrainChunk(const std::vector<double> &heights, const C
 
 void NoiseTerrainChunk::OnAdded()
 {
+    APEX_PROFILE_SCOPE("NoiseTerrainChunk::OnAdded");
+
     std::shared_ptr<Mesh> mesh = BuildMesh(m_heights);
 
     mesh->SetShader(ShaderManager::GetInstance()->GetShader<TerrainShader>(ShaderProperties()
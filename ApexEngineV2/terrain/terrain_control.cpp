@@ -1,5 +1,6 @@
 #include "terrain_control.h"
 #include "../rendering/renderers/bounding_box_renderer.h"
+#include "../profiler.h"
 
 #include <thread>
 
@@ -37,6 +38,8 @@ void TerrainControl::OnRemoved()
 
 void TerrainControl::OnUpdate(double dt)
 {
+    APEX_PROFILE_SCOPE("TerrainControl::OnUpdate");
+
     Vector3 campos(m_camera->GetTranslation());
     campos -= parent->GetGlobalTransform().GetTranslation();
     campos *= Vector3::One() / (m_scale * float(m_chunk_size - 1));
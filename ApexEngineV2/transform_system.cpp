@@ -0,0 +1,398 @@
+#include "transform_system.h"
+#include "entity.h"
+#include "worker_pool.h"
+#include "util.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace apex {
+
+static const uint32_t invalid_index = std::numeric_limits<uint32_t>::max();
+
+template <class T>
+static void RemoveSlot(std::vector<T> &values, uint32_t index)
+{
+    if (index != values.size() - 1) {
+        values[index] = values.back();
+    }
+
+    values.pop_back();
+}
+
+const TransformSystem::Handle_t TransformSystem::invalid_handle = std::numeric_limits<Handle_t>::max();
+const int32_t TransformSystem::no_parent;
+
+TransformSystem *TransformSystem::instance = nullptr;
+
+TransformSystem *TransformSystem::GetInstance()
+{
+    if (instance == nullptr) {
+        instance = new TransformSystem();
+    }
+
+    return instance;
+}
+
+TransformSystem::TransformSystem()
+    : m_order_dirty(false),
+      m_dirty_begin(invalid_index),
+      m_dirty_end(0),
+      m_update_id(0)
+{
+}
+
+TransformSystem::Handle_t TransformSystem::Register(Entity *entity)
+{
+    Handle_t handle;
+
+    if (!m_free_handles.empty()) {
+        handle = m_free_handles.back();
+        m_free_handles.pop_back();
+    } else {
+        handle = Handle_t(m_indices.size());
+        m_indices.push_back(invalid_index);
+    }
+
+    // new slots have no parent, so appending them keeps the order valid
+    const uint32_t index = uint32_t(m_entities.size());
+
+    m_indices[handle] = index;
+
+    m_entities.push_back(entity);
+    m_handles.push_back(handle);
+    m_parent_handles.push_back(invalid_handle);
+    m_parents.push_back(no_parent);
+    m_subtree_ends.push_back(index + 1);
+    m_flags.push_back(0);
+    m_update_ids.push_back(0);
+    m_revisions.push_back(0);
+    m_local_translations.push_back(Vector3::Zero());
+    m_local_scales.push_back(Vector3::One());
+    m_local_rotations.push_back(Quaternion::Identity());
+    m_global_transforms.push_back(Transform());
+
+    MarkDirty(handle);
+
+    return handle;
+}
+
+void TransformSystem::Unregister(Handle_t handle)
+{
+    const uint32_t index = m_indices[handle];
+    ex_assert(index != invalid_index);
+
+    RemoveSlot(m_entities, index);
+    RemoveSlot(m_handles, index);
+    RemoveSlot(m_parent_handles, index);
+    RemoveSlot(m_parents, index);
+    RemoveSlot(m_subtree_ends, index);
+    RemoveSlot(m_flags, index);
+    RemoveSlot(m_update_ids, index);
+    RemoveSlot(m_revisions, index);
+    RemoveSlot(m_local_translations, index);
+    RemoveSlot(m_local_scales, index);
+    RemoveSlot(m_local_rotations, index);
+    RemoveSlot(m_global_transforms, index);
+
+    if (index < m_handles.size()) {
+        m_indices[m_handles[index]] = index;
+    }
+
+    m_indices[handle] = invalid_index;
+
+    // children may still reference this handle as their parent,
+    // so it is only reused after the next reorder has detached them.
+    m_released_handles.push_back(handle);
+    m_order_dirty = true;
+}
+
+void TransformSystem::SetParent(Handle_t handle, Handle_t parent)
+{
+    m_parent_handles[m_indices[handle]] = parent;
+    m_order_dirty = true;
+
+    MarkDirty(handle);
+}
+
+void TransformSystem::SetCustomUpdate(Handle_t handle, bool custom_update)
+{
+    const uint32_t index = m_indices[handle];
+
+    if (custom_update) {
+        m_flags[index] |= SLOT_CUSTOM_UPDATE;
+    } else {
+        m_flags[index] &= ~SLOT_CUSTOM_UPDATE;
+    }
+}
+
+void TransformSystem::MarkDirty(Handle_t handle)
+{
+    const uint32_t index = m_indices[handle];
+
+    const uint32_t subtree_end = m_subtree_ends[index];
+
+    m_flags[index] |= SLOT_DIRTY;
+
+    // controls on different subtrees may mark slots dirty concurrently
+    uint32_t begin = m_dirty_begin.load(std::memory_order_relaxed);
+    while (index < begin && !m_dirty_begin.compare_exchange_weak(begin, index, std::memory_order_relaxed));
+
+    uint32_t end = m_dirty_end.load(std::memory_order_relaxed);
+    while (subtree_end > end && !m_dirty_end.compare_exchange_weak(end, subtree_end, std::memory_order_relaxed));
+}
+
+void TransformSystem::UpdateTransform(Handle_t handle)
+{
+    const uint32_t index = m_indices[handle];
+    const Handle_t parent_handle = m_parent_handles[index];
+
+    int32_t parent = no_parent;
+
+    if (parent_handle != invalid_handle && m_indices[parent_handle] != invalid_index) {
+        parent = int32_t(m_indices[parent_handle]);
+    }
+
+    CalculateSlot(index, parent);
+}
+
+void TransformSystem::Update()
+{
+    APEX_PROFILE_SCOPE("TransformSystem::Update");
+
+    if (m_order_dirty) {
+        Reorder();
+
+        m_dirty_begin = 0;
+        m_dirty_end = uint32_t(m_entities.size());
+    }
+
+    const uint32_t begin = m_dirty_begin;
+    const uint32_t end = std::min(m_dirty_end.load(), uint32_t(m_entities.size()));
+
+    m_dirty_begin = invalid_index;
+    m_dirty_end = 0;
+
+    if (begin >= end) {
+        return;
+    }
+
+    ++m_update_id;
+
+    UpdateRange(begin, end);
+}
+
+void TransformSystem::UpdateSlot(uint32_t index)
+{
+    const int32_t parent = m_parents[index];
+
+    if (!(m_flags[index] & SLOT_DIRTY) && (parent == no_parent || m_update_ids[parent] != m_update_id)) {
+        return;
+    }
+
+    if (m_flags[index] & SLOT_CUSTOM_UPDATE) {
+        // calls back into UpdateTransform(handle)
+        m_entities[index]->UpdateTransform();
+
+        return;
+    }
+
+    CalculateSlot(index, parent);
+}
+
+void TransformSystem::CalculateSlot(uint32_t index, int32_t parent)
+{
+    const Vector3 &translation = m_local_translations[index];
+    const Vector3 &scale = m_local_scales[index];
+    const Quaternion &rotation = m_local_rotations[index];
+
+    if (parent == no_parent) {
+        m_global_transforms[index] = Transform(translation, scale, rotation);
+    } else {
+        const Transform &parent_transform = m_global_transforms[parent];
+
+        m_global_transforms[index] = Transform(
+            translation + parent_transform.GetTranslation(),
+            scale * parent_transform.GetScale(),
+            rotation * parent_transform.GetRotation()
+        );
+    }
+
+    m_flags[index] &= ~SLOT_DIRTY;
+    m_update_ids[index] = m_update_id;
+    ++m_revisions[index];
+}
+
+void TransformSystem::UpdateRange(uint32_t begin, uint32_t end)
+{
+#if TRANSFORM_SYSTEM_MULTITHREADED
+    WorkerPool *pool = WorkerPool::GetInstance();
+    const uint32_t num_threads = uint32_t(pool->NumWorkers() + 1);
+
+    if (num_threads > 1 && end - begin >= TRANSFORM_SYSTEM_MIN_PARALLEL_COUNT) {
+        // split the range into independent subtrees. Any subtree too large to be
+        // a single task has its root updated up front and its children split further.
+        const uint32_t grain = std::max(64u, (end - begin) / (num_threads * 4));
+
+        std::vector<uint32_t> spine;
+        std::vector<std::pair<uint32_t, uint32_t>> ranges;
+        std::vector<std::pair<uint32_t, uint32_t>> pending = { { begin, end } };
+
+        while (!pending.empty()) {
+            const auto range = pending.back();
+            pending.pop_back();
+
+            std::vector<std::pair<uint32_t, uint32_t>> children;
+
+            for (uint32_t i = range.first; i < range.second;) {
+                const uint32_t subtree_end = std::min(m_subtree_ends[i], range.second);
+
+                if (subtree_end - i > grain) {
+                    spine.push_back(i);
+                    children.push_back({ i + 1, subtree_end });
+                } else {
+                    ranges.push_back({ i, subtree_end });
+                }
+
+                i = subtree_end;
+            }
+
+            pending.insert(pending.end(), children.rbegin(), children.rend());
+        }
+
+        // parents always have a lower index than their children
+        std::sort(spine.begin(), spine.end());
+
+        for (uint32_t index : spine) {
+            UpdateSlot(index);
+        }
+
+        pool->ParallelFor(ranges.size(), [this, &ranges](size_t r) {
+            for (uint32_t i = ranges[r].first; i < ranges[r].second; i++) {
+                UpdateSlot(i);
+            }
+        });
+
+        return;
+    }
+#endif
+
+    for (uint32_t i = begin; i < end; i++) {
+        UpdateSlot(i);
+    }
+}
+
+void TransformSystem::Reorder()
+{
+    const uint32_t count = uint32_t(m_entities.size());
+
+    // resolve parent handles, detaching slots whose parent was unregistered
+    std::vector<uint32_t> child_offsets(count + 1, 0);
+
+    for (uint32_t i = 0; i < count; i++) {
+        const Handle_t parent_handle = m_parent_handles[i];
+
+        if (parent_handle == invalid_handle || m_indices[parent_handle] == invalid_index) {
+            m_parent_handles[i] = invalid_handle;
+            m_parents[i] = no_parent;
+
+            continue;
+        }
+
+        m_parents[i] = int32_t(m_indices[parent_handle]);
+        child_offsets[m_parents[i] + 1]++;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        child_offsets[i + 1] += child_offsets[i];
+    }
+
+    std::vector<uint32_t> children(child_offsets[count]);
+    std::vector<uint32_t> child_counts(count, 0);
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (m_parents[i] != no_parent) {
+            const uint32_t parent = uint32_t(m_parents[i]);
+            children[child_offsets[parent] + child_counts[parent]++] = i;
+        }
+    }
+
+    // depth first, keeping roots and siblings in their current relative order
+    std::vector<uint32_t> order;
+    order.reserve(count);
+
+    std::vector<uint32_t> stack;
+
+    for (uint32_t root = 0; root < count; root++) {
+        if (m_parents[root] != no_parent) {
+            continue;
+        }
+
+        stack.push_back(root);
+
+        while (!stack.empty()) {
+            const uint32_t index = stack.back();
+            stack.pop_back();
+
+            order.push_back(index);
+
+            for (uint32_t c = child_offsets[index + 1]; c > child_offsets[index]; c--) {
+                stack.push_back(children[c - 1]);
+            }
+        }
+    }
+
+    // anything not reached from a root is part of a parent cycle
+    ex_assert(order.size() == count);
+
+    std::vector<uint32_t> new_indices(count);
+
+    for (uint32_t i = 0; i < count; i++) {
+        new_indices[order[i]] = i;
+    }
+
+    Permute(m_entities, order);
+    Permute(m_handles, order);
+    Permute(m_parent_handles, order);
+    Permute(m_parents, order);
+    Permute(m_flags, order);
+    Permute(m_update_ids, order);
+    Permute(m_revisions, order);
+    Permute(m_local_translations, order);
+    Permute(m_local_scales, order);
+    Permute(m_local_rotations, order);
+    Permute(m_global_transforms, order);
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (m_parents[i] != no_parent) {
+            m_parents[i] = int32_t(new_indices[m_parents[i]]);
+        }
+
+        m_indices[m_handles[i]] = i;
+        m_subtree_ends[i] = 0;
+    }
+
+    // children come after their parent, so walking backwards accumulates subtree sizes
+    for (uint32_t i = count; i > 0; i--) {
+        const uint32_t index = i - 1;
+
+        m_subtree_ends[index] += 1;
+
+        if (m_parents[index] != no_parent) {
+            m_subtree_ends[m_parents[index]] += m_subtree_ends[index];
+        }
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        m_subtree_ends[i] += i;
+    }
+
+    m_free_handles.insert(m_free_handles.end(), m_released_handles.begin(), m_released_handles.end());
+    m_released_handles.clear();
+
+    m_order_dirty = false;
+}
+
+} // namespace apex
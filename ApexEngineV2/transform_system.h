@@ -0,0 +1,122 @@
+#ifndef TRANSFORM_SYSTEM_H
+#define TRANSFORM_SYSTEM_H
+
+#include "math/vector3.h"
+#include "math/quaternion.h"
+#include "math/transform.h"
+
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+#define TRANSFORM_SYSTEM_MULTITHREADED 0
+#define TRANSFORM_SYSTEM_MIN_PARALLEL_COUNT 4096
+
+namespace apex {
+
+class Entity;
+
+// Flat storage for the local and global transforms of every entity.
+// Slots are kept in depth-first (parent before child) order, so propagating
+// dirty transforms down the hierarchy is a single linear pass over the arrays,
+// and every subtree occupies a contiguous range.
+// Entities refer to their slot through a stable handle; the dense index of a slot
+// changes whenever the hierarchy is reordered.
+// NOTE: references returned by the getters are only valid until the next
+// Register() / Update() call. Setting the local transform of distinct slots from
+// multiple threads is safe; everything else must happen on one thread.
+class TransformSystem {
+public:
+    using Handle_t = uint32_t;
+
+    static const Handle_t invalid_handle;
+
+    static TransformSystem *instance;
+    static TransformSystem *GetInstance();
+
+    TransformSystem();
+
+    Handle_t Register(Entity *entity);
+    void Unregister(Handle_t handle);
+    void SetParent(Handle_t handle, Handle_t parent);
+    // slots flagged as custom get their entity's virtual UpdateTransform() called during Update()
+    void SetCustomUpdate(Handle_t handle, bool custom_update);
+
+    inline const Vector3 &GetLocalTranslation(Handle_t handle) const { return m_local_translations[m_indices[handle]]; }
+    inline void SetLocalTranslation(Handle_t handle, const Vector3 &translation)
+        { m_local_translations[m_indices[handle]] = translation; MarkDirty(handle); }
+    inline const Vector3 &GetLocalScale(Handle_t handle) const { return m_local_scales[m_indices[handle]]; }
+    inline void SetLocalScale(Handle_t handle, const Vector3 &scale)
+        { m_local_scales[m_indices[handle]] = scale; MarkDirty(handle); }
+    inline const Quaternion &GetLocalRotation(Handle_t handle) const { return m_local_rotations[m_indices[handle]]; }
+    inline void SetLocalRotation(Handle_t handle, const Quaternion &rotation)
+        { m_local_rotations[m_indices[handle]] = rotation; MarkDirty(handle); }
+
+    inline const Transform &GetGlobalTransform(Handle_t handle) const { return m_global_transforms[m_indices[handle]]; }
+    /** incremented each time the global transform of the slot is recalculated */
+    inline size_t GetRevision(Handle_t handle) const { return m_revisions[m_indices[handle]]; }
+
+    inline size_t NumSlots() const { return m_entities.size(); }
+
+    void MarkDirty(Handle_t handle);
+    // recalculate a single slot from its parent's current global transform
+    void UpdateTransform(Handle_t handle);
+    // reorder the slots if the hierarchy changed, then recalculate
+    // every dirty slot (and all slots beneath it) in one pass.
+    void Update();
+
+private:
+    enum SlotFlags {
+        SLOT_DIRTY = 0x01,
+        SLOT_CUSTOM_UPDATE = 0x02
+    };
+
+    static const int32_t no_parent = -1;
+
+    // dense, ordered arrays
+    std::vector<Entity*> m_entities;
+    std::vector<Handle_t> m_handles;
+    std::vector<Handle_t> m_parent_handles;
+    std::vector<int32_t> m_parents;
+    std::vector<uint32_t> m_subtree_ends;
+    std::vector<uint8_t> m_flags;
+    std::vector<uint32_t> m_update_ids;
+    std::vector<size_t> m_revisions;
+    std::vector<Vector3> m_local_translations;
+    std::vector<Vector3> m_local_scales;
+    std::vector<Quaternion> m_local_rotations;
+    std::vector<Transform> m_global_transforms;
+
+    // sparse: handle -> dense index
+    std::vector<uint32_t> m_indices;
+    std::vector<Handle_t> m_free_handles;
+    std::vector<Handle_t> m_released_handles;
+
+    bool m_order_dirty;
+    std::atomic<uint32_t> m_dirty_begin;
+    std::atomic<uint32_t> m_dirty_end;
+    uint32_t m_update_id;
+
+    void Reorder();
+    void UpdateRange(uint32_t begin, uint32_t end);
+    void UpdateSlot(uint32_t index);
+    void CalculateSlot(uint32_t index, int32_t parent);
+
+    template <class T>
+    static void Permute(std::vector<T> &values, const std::vector<uint32_t> &order)
+    {
+        std::vector<T> permuted;
+        permuted.reserve(order.size());
+
+        for (uint32_t index : order) {
+            permuted.push_back(values[index]);
+        }
+
+        values.swap(permuted);
+    }
+};
+
+} // namespace apex
+
+#endif
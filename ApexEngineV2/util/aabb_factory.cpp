@@ -4,12 +4,8 @@ namespace apex {
 
 BoundingBox AABBFactory::CreateMeshBoundingBox(const std::shared_ptr<Mesh> &mesh)
 {
-    BoundingBox aabb;
-    auto vertices = mesh->GetVertices();
-    for (auto &&vert : vertices) {
-        aabb.Extend(vert.GetPosition());
-    }
-    return aabb;
+    // kept by the mesh from SetVertices(), still valid once the vertices are released
+    return mesh->GetAABB();
 }
 
 BoundingBox AABBFactory::CreateEntityBoundingBox(const std::shared_ptr<Entity> &entity)
@@ -1,5 +1,11 @@
 #include "mesh_factory.h"
+#include "mesh_optimizer.h"
+#include "mesh_simplifier.h"
+#include "meshlet_builder.h"
 #include "../math/math_util.h"
+#include "../util.h"
+
+#include <algorithm>
 
 namespace apex {
 
@@ -52,6 +58,9 @@ std::shared_ptr<Mesh> MeshFactory::CreateQuad(bool triangle_fan)
 std::shared_ptr<Mesh> MeshFactory::TransformMesh(const std::shared_ptr<Mesh> &mesh,
     const Transform &transform)
 {
+    // released after upload unless the residency is RESIDENCY_ALL
+    ex_assert(mesh->HasVertexData());
+
     auto new_mesh = std::make_shared<Mesh>();
 
     std::map<Mesh::MeshAttributeType, Mesh::MeshAttribute> all_mesh_attributes;
@@ -74,6 +83,7 @@ std::shared_ptr<Mesh> MeshFactory::TransformMesh(const std::shared_ptr<Mesh> &me
 
     new_mesh->SetVertices(all_vertices, all_indices);
     new_mesh->SetPrimitiveType(mesh->GetPrimitiveType());
+    new_mesh->SetResidency(mesh->GetResidency());
 
     return new_mesh;
 }
@@ -84,6 +94,9 @@ std::shared_ptr<Mesh> MeshFactory::MergeMeshes(const std::shared_ptr<Mesh> &a,
     Transform transform_b)
 {
     // TODO: raise error if primitive types differ
+    ex_assert(a->HasVertexData());
+    ex_assert(b->HasVertexData());
+
     std::shared_ptr<Mesh> new_mesh = std::make_shared<Mesh>(),
         a_transformed = TransformMesh(a, transform_a),
         b_transformed = TransformMesh(b, transform_b);
@@ -123,6 +136,7 @@ std::shared_ptr<Mesh> MeshFactory::MergeMeshes(const std::shared_ptr<Mesh> &a,
 
     new_mesh->SetVertices(all_vertices, all_indices);
     new_mesh->SetPrimitiveType(Mesh::PrimitiveType::PRIM_TRIANGLES);
+    new_mesh->SetResidency(std::max(a->GetResidency(), b->GetResidency()));
 
     return new_mesh;
 }
@@ -176,4 +190,19 @@ std::shared_ptr<Mesh> MeshFactory::CreateCube(Vector3 offset)
     return mesh;
 }
 
+void MeshFactory::PrepareImportedMesh(const std::shared_ptr<Mesh> &mesh, const std::string &name)
+{
+#if MESH_OPTIMIZER_ENABLED
+    MeshOptimizer::LogStats(name, MeshOptimizer::Optimize(mesh));
+#endif
+
+#if MESH_LOD_ENABLED
+    MeshSimplifier::GenerateLods(mesh);
+#endif
+
+#if MESHLET_BUILDER_ENABLED
+    MeshletBuilder::Build(mesh);
+#endif
+}
+
 } // namespace apex
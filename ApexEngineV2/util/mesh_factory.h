@@ -5,18 +5,25 @@
 #include "../math/transform.h"
 
 #include <memory>
+#include <string>
 
 namespace apex {
 class MeshFactory {
 public:
     static std::shared_ptr<Mesh> CreateQuad(bool triangle_fan = true);
     static std::shared_ptr<Mesh> CreateCube(Vector3 offset = Vector3(0.0));
+    // these read the vertices, so the source meshes must not have released them yet
     static std::shared_ptr<Mesh> MergeMeshes(const std::shared_ptr<Mesh> &a,
         const std::shared_ptr<Mesh> &b,
         Transform transform_a,
         Transform transform_b);
     static std::shared_ptr<Mesh> TransformMesh(const std::shared_ptr<Mesh> &mesh,
         const Transform &transform);
+
+    // runs the import time steps that are enabled (MeshOptimizer, MeshSimplifier
+    // LODs, MeshletBuilder) on a mesh that was just loaded, before its first upload.
+    // name is used for logging.
+    static void PrepareImportedMesh(const std::shared_ptr<Mesh> &mesh, const std::string &name);
 };
 } // namespace apex
 
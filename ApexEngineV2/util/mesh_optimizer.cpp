@@ -0,0 +1,474 @@
+#include "mesh_optimizer.h"
+#include "../hash_code.h"
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <cstdint>
+
+namespace apex {
+
+namespace {
+
+HashCode HashVertex(const Vertex &vertex, unsigned int mask)
+{
+    HashCode hc;
+    hc.Add(vertex.GetPosition().GetHashCode());
+
+    if (mask & Mesh::ATTR_NORMALS) {
+        hc.Add(vertex.GetNormal().GetHashCode());
+    }
+
+    if (mask & Mesh::ATTR_TEXCOORDS0) {
+        hc.Add(vertex.GetTexCoord0().GetHashCode());
+    }
+
+    if (mask & Mesh::ATTR_TEXCOORDS1) {
+        hc.Add(vertex.GetTexCoord1().GetHashCode());
+    }
+
+    if (mask & Mesh::ATTR_TANGENTS) {
+        hc.Add(vertex.GetTangent().GetHashCode());
+    }
+
+    if (mask & Mesh::ATTR_BITANGENTS) {
+        hc.Add(vertex.GetBitangent().GetHashCode());
+    }
+
+    if (mask & Mesh::ATTR_BONEWEIGHTS) {
+        for (float weight : vertex.GetBoneWeights()) {
+            hc.Add(weight);
+        }
+    }
+
+    if (mask & Mesh::ATTR_BONEINDICES) {
+        for (int index : vertex.GetBoneIndices()) {
+            hc.Add(index);
+        }
+    }
+
+    return hc;
+}
+
+bool VerticesEqual(const Vertex &a, const Vertex &b, unsigned int mask)
+{
+    return a.GetPosition() == b.GetPosition()
+        && (!(mask & Mesh::ATTR_NORMALS) || a.GetNormal() == b.GetNormal())
+        && (!(mask & Mesh::ATTR_TEXCOORDS0) || a.GetTexCoord0() == b.GetTexCoord0())
+        && (!(mask & Mesh::ATTR_TEXCOORDS1) || a.GetTexCoord1() == b.GetTexCoord1())
+        && (!(mask & Mesh::ATTR_TANGENTS) || a.GetTangent() == b.GetTangent())
+        && (!(mask & Mesh::ATTR_BITANGENTS) || a.GetBitangent() == b.GetBitangent())
+        && (!(mask & Mesh::ATTR_BONEWEIGHTS) || a.GetBoneWeights() == b.GetBoneWeights())
+        && (!(mask & Mesh::ATTR_BONEINDICES) || a.GetBoneIndices() == b.GetBoneIndices());
+}
+
+// FIFO post-transform cache. a vertex is cached while fewer than cache_size
+// misses happened since it was last missed.
+class CacheSimulator {
+public:
+    CacheSimulator(size_t num_vertices, size_t cache_size)
+        : m_cache_time(num_vertices, 0),
+          m_time(uint32_t(cache_size) + 1),
+          m_cache_size(uint32_t(cache_size))
+    {
+    }
+
+    // returns true on a miss
+    inline bool Access(MeshIndex index)
+    {
+        if (m_time - m_cache_time[index] > m_cache_size) {
+            m_cache_time[index] = m_time++;
+            return true;
+        }
+
+        return false;
+    }
+
+    // as if every vertex was evicted
+    inline void Flush() { m_time += m_cache_size + 1; }
+
+private:
+    std::vector<uint32_t> m_cache_time;
+    uint32_t m_time;
+    uint32_t m_cache_size;
+};
+
+} // namespace
+
+MeshOptimizer::Stats MeshOptimizer::Optimize(const std::shared_ptr<Mesh> &mesh)
+{
+    Stats stats;
+
+    if (mesh == nullptr || mesh->GetPrimitiveType() != Mesh::PRIM_TRIANGLES || !mesh->HasVertexData()) {
+        return stats;
+    }
+
+    std::vector<Vertex> vertices = mesh->GetVertices();
+    std::vector<MeshIndex> indices = mesh->GetIndices();
+
+    if (indices.empty() || indices.size() % 3 != 0) {
+        return stats;
+    }
+
+    unsigned int mask = 0;
+
+    for (auto &&attr : mesh->GetAttributes()) {
+        mask |= attr.first;
+    }
+
+    stats.vertices_before = vertices.size();
+    stats.triangles = indices.size() / 3;
+    stats.before = AnalyzeVertexCache(indices, vertices.size());
+
+    WeldVertices(vertices, indices, mask);
+    std::vector<size_t> cluster_offsets = OptimizeVertexCache(indices, vertices.size());
+    OptimizeOverdraw(vertices, indices, cluster_offsets);
+    OptimizeVertexFetch(vertices, indices);
+
+    stats.vertices_after = vertices.size();
+    stats.after = AnalyzeVertexCache(indices, vertices.size());
+
+    mesh->SetVertices(vertices, indices);
+
+    return stats;
+}
+
+void MeshOptimizer::LogStats(const std::string &name, const Stats &stats)
+{
+#if MESH_OPTIMIZER_LOG_STATS
+    std::cout << "[" << name << "]: " << stats.triangles << " triangles, "
+        << stats.vertices_before << " -> " << stats.vertices_after << " vertices, "
+        << "ACMR " << stats.before.acmr << " -> " << stats.after.acmr << ", "
+        << "ATVR " << stats.before.atvr << " -> " << stats.after.atvr << "\n";
+#endif
+}
+
+MeshOptimizer::CacheStats MeshOptimizer::AnalyzeVertexCache(const std::vector<MeshIndex> &indices,
+    size_t num_vertices, size_t cache_size)
+{
+    CacheStats stats;
+
+    if (indices.empty() || num_vertices == 0) {
+        return stats;
+    }
+
+    CacheSimulator cache(num_vertices, cache_size);
+    size_t misses = 0;
+
+    for (MeshIndex index : indices) {
+        misses += cache.Access(index);
+    }
+
+    stats.acmr = float(misses) / float(indices.size() / 3);
+    stats.atvr = float(misses) / float(num_vertices);
+
+    return stats;
+}
+
+void MeshOptimizer::WeldVertices(std::vector<Vertex> &vertices, std::vector<MeshIndex> &indices,
+    unsigned int attribute_mask)
+{
+    const MeshIndex empty = std::numeric_limits<MeshIndex>::max();
+
+    // open addressing table of indices into welded, at most half full
+    size_t table_size = 1;
+
+    while (table_size < vertices.size() * 2) {
+        table_size <<= 1;
+    }
+
+    std::vector<MeshIndex> table(table_size, empty);
+    std::vector<MeshIndex> remap(vertices.size());
+    std::vector<Vertex> welded;
+    welded.reserve(vertices.size());
+
+    for (size_t i = 0; i < vertices.size(); i++) {
+        size_t slot = HashVertex(vertices[i], attribute_mask).Value() & (table_size - 1);
+
+        while (table[slot] != empty && !VerticesEqual(welded[table[slot]], vertices[i], attribute_mask)) {
+            slot = (slot + 1) & (table_size - 1);
+        }
+
+        if (table[slot] == empty) {
+            table[slot] = MeshIndex(welded.size());
+            welded.push_back(vertices[i]);
+        }
+
+        remap[i] = table[slot];
+    }
+
+    for (MeshIndex &index : indices) {
+        index = remap[index];
+    }
+
+    vertices.swap(welded);
+}
+
+std::vector<size_t> MeshOptimizer::OptimizeVertexCache(std::vector<MeshIndex> &indices,
+    size_t num_vertices, size_t cache_size)
+{
+    std::vector<size_t> cluster_offsets;
+
+    const size_t num_triangles = indices.size() / 3;
+
+    if (num_triangles == 0) {
+        return cluster_offsets;
+    }
+
+    // triangles using each vertex, and how many of them are not emitted yet
+    std::vector<uint32_t> live(num_vertices, 0);
+
+    for (MeshIndex index : indices) {
+        live[index]++;
+    }
+
+    std::vector<uint32_t> adjacency_offsets(num_vertices + 1, 0);
+
+    for (size_t i = 0; i < num_vertices; i++) {
+        adjacency_offsets[i + 1] = adjacency_offsets[i] + live[i];
+    }
+
+    std::vector<uint32_t> adjacency(indices.size());
+    std::vector<uint32_t> adjacency_fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+
+    for (size_t i = 0; i < indices.size(); i++) {
+        adjacency[adjacency_fill[indices[i]]++] = uint32_t(i / 3);
+    }
+
+    std::vector<uint32_t> cache_time(num_vertices, 0);
+    std::vector<bool> emitted(num_triangles, false);
+    std::vector<MeshIndex> dead_ends;
+    std::vector<MeshIndex> candidates;
+    std::vector<MeshIndex> result;
+    dead_ends.reserve(indices.size());
+    result.reserve(indices.size());
+
+    uint32_t time = uint32_t(cache_size) + 1;
+    size_t cursor = 0;
+    int64_t fanning = indices[0];
+
+    cluster_offsets.push_back(0);
+
+    while (fanning >= 0) {
+        candidates.clear();
+
+        // emit every remaining triangle around the fanning vertex
+        for (uint32_t i = adjacency_offsets[fanning]; i < adjacency_offsets[fanning + 1]; i++) {
+            const uint32_t triangle = adjacency[i];
+
+            if (emitted[triangle]) {
+                continue;
+            }
+
+            for (int j = 0; j < 3; j++) {
+                const MeshIndex index = indices[triangle * 3 + j];
+
+                result.push_back(index);
+                dead_ends.push_back(index);
+                candidates.push_back(index);
+                live[index]--;
+
+                if (time - cache_time[index] > cache_size) {
+                    cache_time[index] = time++;
+                }
+            }
+
+            emitted[triangle] = true;
+        }
+
+        // fan next around the candidate that entered the cache earliest, as long
+        // as it will still be cached once its remaining triangles are emitted
+        fanning = -1;
+        int64_t best_priority = -1;
+
+        for (MeshIndex index : candidates) {
+            if (live[index] == 0) {
+                continue;
+            }
+
+            int64_t priority = 0;
+
+            if (time - cache_time[index] + 2 * live[index] <= cache_size) {
+                priority = time - cache_time[index];
+            }
+
+            if (priority > best_priority) {
+                best_priority = priority;
+                fanning = index;
+            }
+        }
+
+        if (fanning >= 0) {
+            continue;
+        }
+
+        // dead end: go back to recently used vertices, then to any vertex left
+        while (!dead_ends.empty()) {
+            const MeshIndex index = dead_ends.back();
+            dead_ends.pop_back();
+
+            if (live[index] > 0) {
+                fanning = index;
+                break;
+            }
+        }
+
+        while (fanning < 0 && cursor < num_vertices) {
+            if (live[cursor] > 0) {
+                fanning = int64_t(cursor);
+            }
+
+            cursor++;
+        }
+
+        if (fanning >= 0) {
+            cluster_offsets.push_back(result.size());
+        }
+    }
+
+    indices.swap(result);
+
+    return cluster_offsets;
+}
+
+void MeshOptimizer::OptimizeOverdraw(const std::vector<Vertex> &vertices, std::vector<MeshIndex> &indices,
+    const std::vector<size_t> &cluster_offsets, float threshold, size_t cache_size)
+{
+    const size_t num_triangles = indices.size() / 3;
+
+    if (num_triangles == 0) {
+        return;
+    }
+
+    // split each cluster further wherever the triangles so far are nearly as cache
+    // friendly as the whole cluster, so restarting the cache there costs little
+    std::vector<size_t> starts;
+    CacheSimulator cache(vertices.size(), cache_size);
+
+    for (size_t c = 0; c < cluster_offsets.size(); c++) {
+        const size_t begin = cluster_offsets[c] / 3;
+        const size_t end = c + 1 < cluster_offsets.size() ? cluster_offsets[c + 1] / 3 : num_triangles;
+
+        if (begin >= end) {
+            continue;
+        }
+
+        size_t cluster_misses = 0;
+        cache.Flush();
+
+        for (size_t i = begin * 3; i < end * 3; i++) {
+            cluster_misses += cache.Access(indices[i]);
+        }
+
+        const float cluster_acmr = float(cluster_misses) / float(end - begin);
+
+        size_t misses = 0;
+        size_t triangles = 0;
+        cache.Flush();
+        starts.push_back(begin);
+
+        for (size_t t = begin; t < end; t++) {
+            for (int j = 0; j < 3; j++) {
+                misses += cache.Access(indices[t * 3 + j]);
+            }
+
+            triangles++;
+
+            if (t + 1 < end && float(misses) <= threshold * cluster_acmr * float(triangles)) {
+                starts.push_back(t + 1);
+                misses = 0;
+                triangles = 0;
+                cache.Flush();
+            }
+        }
+    }
+
+    struct Cluster {
+        size_t begin, end;
+        float sort_key;
+    };
+
+    std::vector<Cluster> clusters(starts.size());
+    std::vector<Vector3> centroids(starts.size());
+    std::vector<Vector3> normals(starts.size());
+    Vector3 mesh_centroid;
+    float mesh_area = 0.0f;
+
+    for (size_t c = 0; c < starts.size(); c++) {
+        clusters[c].begin = starts[c];
+        clusters[c].end = c + 1 < starts.size() ? starts[c + 1] : num_triangles;
+
+        Vector3 centroid;
+        Vector3 normal;
+        float area = 0.0f;
+
+        for (size_t t = clusters[c].begin; t < clusters[c].end; t++) {
+            const Vector3 &p0 = vertices[indices[t * 3]].GetPosition();
+            const Vector3 &p1 = vertices[indices[t * 3 + 1]].GetPosition();
+            const Vector3 &p2 = vertices[indices[t * 3 + 2]].GetPosition();
+
+            // twice the area, in the direction of the face normal
+            Vector3 cross = p1 - p0;
+            cross.Cross(p2 - p0);
+            const float triangle_area = cross.Length();
+
+            centroid += (p0 + p1 + p2) * Vector3(triangle_area / 3.0f);
+            normal += cross;
+            area += triangle_area;
+        }
+
+        mesh_centroid += centroid;
+        mesh_area += area;
+
+        centroids[c] = area > 0.0f ? centroid / Vector3(area) : centroid;
+        normals[c] = normal;
+    }
+
+    if (mesh_area > 0.0f) {
+        mesh_centroid /= Vector3(mesh_area);
+    }
+
+    for (size_t c = 0; c < clusters.size(); c++) {
+        if (normals[c].LengthSquared() > 0.0f) {
+            normals[c].Normalize();
+        }
+
+        clusters[c].sort_key = (centroids[c] - mesh_centroid).Dot(normals[c]);
+    }
+
+    // clusters on the outside, facing away from the center, occlude the rest
+    std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster &a, const Cluster &b) {
+        return a.sort_key > b.sort_key;
+    });
+
+    std::vector<MeshIndex> result;
+    result.reserve(indices.size());
+
+    for (const Cluster &cluster : clusters) {
+        result.insert(result.end(), indices.begin() + cluster.begin * 3, indices.begin() + cluster.end * 3);
+    }
+
+    indices.swap(result);
+}
+
+void MeshOptimizer::OptimizeVertexFetch(std::vector<Vertex> &vertices, std::vector<MeshIndex> &indices)
+{
+    const MeshIndex unused = std::numeric_limits<MeshIndex>::max();
+
+    std::vector<MeshIndex> remap(vertices.size(), unused);
+    std::vector<Vertex> ordered;
+    ordered.reserve(vertices.size());
+
+    for (MeshIndex &index : indices) {
+        if (remap[index] == unused) {
+            remap[index] = MeshIndex(ordered.size());
+            ordered.push_back(vertices[index]);
+        }
+
+        index = remap[index];
+    }
+
+    vertices.swap(ordered);
+}
+
+} // namespace apex
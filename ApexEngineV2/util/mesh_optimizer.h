@@ -0,0 +1,70 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include "../rendering/mesh.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstddef>
+
+// set to 0 to load meshes with the triangle order of the file
+#define MESH_OPTIMIZER_ENABLED 1
+// set to 0 to not print the cache statistics of each optimized mesh
+#define MESH_OPTIMIZER_LOG_STATS 1
+// size of the simulated post-transform vertex cache
+#define MESH_OPTIMIZER_CACHE_SIZE 16
+// how much worse than the cache order a cluster may be after being split for overdraw
+#define MESH_OPTIMIZER_OVERDRAW_THRESHOLD 1.05f
+
+namespace apex {
+
+// Reorders the triangles and vertices of a mesh for the GPU, in the order of:
+// welding identical vertices, ordering triangles for the post-transform vertex
+// cache (Tipsify, Sander et al. 2007), ordering clusters of those triangles so
+// outward facing ones draw first to lower overdraw, and ordering vertices by first
+// use so vertex fetches are sequential.
+// Meant to run at import or bake time, before the mesh is uploaded.
+class MeshOptimizer {
+public:
+    struct CacheStats {
+        // average cache miss ratio: vertex shader invocations per triangle
+        float acmr = 0.0f;
+        // average transformed to vertex ratio: invocations per unique vertex, 1.0 at best
+        float atvr = 0.0f;
+    };
+
+    struct Stats {
+        size_t vertices_before = 0;
+        size_t vertices_after = 0;
+        size_t triangles = 0;
+        CacheStats before;
+        CacheStats after;
+    };
+
+    // optimizes a triangle mesh that still has its vertex data.
+    // other primitive types are left as they are.
+    static Stats Optimize(const std::shared_ptr<Mesh> &mesh);
+    static void LogStats(const std::string &name, const Stats &stats);
+
+    static CacheStats AnalyzeVertexCache(const std::vector<MeshIndex> &indices, size_t num_vertices,
+        size_t cache_size = MESH_OPTIMIZER_CACHE_SIZE);
+
+    // merges vertices whose attributes in attribute_mask (Mesh::MeshAttributeType bits) are equal
+    static void WeldVertices(std::vector<Vertex> &vertices, std::vector<MeshIndex> &indices,
+        unsigned int attribute_mask);
+    // returns the offsets, in indices, where the cache order had to restart from a dead end
+    static std::vector<size_t> OptimizeVertexCache(std::vector<MeshIndex> &indices, size_t num_vertices,
+        size_t cache_size = MESH_OPTIMIZER_CACHE_SIZE);
+    // sorts clusters of triangles, split at the given offsets and wherever the
+    // cache order allows, so that those facing away from the center draw first
+    static void OptimizeOverdraw(const std::vector<Vertex> &vertices, std::vector<MeshIndex> &indices,
+        const std::vector<size_t> &cluster_offsets, float threshold = MESH_OPTIMIZER_OVERDRAW_THRESHOLD,
+        size_t cache_size = MESH_OPTIMIZER_CACHE_SIZE);
+    // orders vertices by first use in indices, dropping unused ones
+    static void OptimizeVertexFetch(std::vector<Vertex> &vertices, std::vector<MeshIndex> &indices);
+};
+
+} // namespace apex
+
+#endif
@@ -0,0 +1,532 @@
+#include "mesh_simplifier.h"
+#include "mesh_optimizer.h"
+
+#include <algorithm>
+#include <unordered_set>
+#include <cmath>
+#include <cstdint>
+
+// weight of the planes that keep open borders in place, relative to the face planes
+#define MESH_SIMPLIFIER_BORDER_WEIGHT 10.0
+
+namespace apex {
+
+namespace {
+
+// symmetric 4x4 matrix of the sum of squared distances to a set of planes
+struct Quadric {
+    double a2 = 0, ab = 0, ac = 0, ad = 0,
+        b2 = 0, bc = 0, bd = 0,
+        c2 = 0, cd = 0,
+        d2 = 0;
+
+    static Quadric Plane(double a, double b, double c, double d, double weight)
+    {
+        Quadric q;
+        q.a2 = a * a * weight; q.ab = a * b * weight; q.ac = a * c * weight; q.ad = a * d * weight;
+        q.b2 = b * b * weight; q.bc = b * c * weight; q.bd = b * d * weight;
+        q.c2 = c * c * weight; q.cd = c * d * weight;
+        q.d2 = d * d * weight;
+
+        return q;
+    }
+
+    Quadric &operator+=(const Quadric &other)
+    {
+        a2 += other.a2; ab += other.ab; ac += other.ac; ad += other.ad;
+        b2 += other.b2; bc += other.bc; bd += other.bd;
+        c2 += other.c2; cd += other.cd;
+        d2 += other.d2;
+
+        return *this;
+    }
+
+    double Evaluate(const Vector3 &p) const
+    {
+        const double x = p.x, y = p.y, z = p.z;
+
+        return a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+            + b2 * y * y + 2 * bc * y * z + 2 * bd * y
+            + c2 * z * z + 2 * cd * z
+            + d2;
+    }
+};
+
+struct Collapse {
+    uint32_t from, to; // position groups
+    double cost;
+};
+
+inline uint64_t EdgeKey(uint32_t a, uint32_t b)
+{
+    return (uint64_t(a) << 32) | b;
+}
+
+inline Vector3 FaceNormal(const Vector3 &p0, const Vector3 &p1, const Vector3 &p2)
+{
+    Vector3 normal = p1 - p0;
+    normal.Cross(p2 - p0);
+
+    return normal;
+}
+
+// connectivity of the current triangles, rebuilt on every pass
+struct Adjacency {
+    // triangles of each vertex
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> triangles;
+    // directed edges between position groups
+    std::unordered_set<uint64_t> edges;
+
+    void Build(const std::vector<MeshIndex> &indices, const std::vector<uint32_t> &group, size_t num_vertices)
+    {
+        offsets.assign(num_vertices + 1, 0);
+
+        for (MeshIndex index : indices) {
+            offsets[index + 1]++;
+        }
+
+        for (size_t i = 0; i < num_vertices; i++) {
+            offsets[i + 1] += offsets[i];
+        }
+
+        triangles.resize(indices.size());
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+
+        for (size_t i = 0; i < indices.size(); i++) {
+            triangles[fill[indices[i]]++] = uint32_t(i / 3);
+        }
+
+        edges.clear();
+
+        for (size_t i = 0; i < indices.size(); i += 3) {
+            for (int j = 0; j < 3; j++) {
+                edges.insert(EdgeKey(group[indices[i + j]], group[indices[i + (j + 1) % 3]]));
+            }
+        }
+    }
+
+    inline bool IsBorderEdge(uint32_t a, uint32_t b) const
+    {
+        // only one of the two triangles an interior edge has
+        return edges.count(EdgeKey(a, b)) != edges.count(EdgeKey(b, a));
+    }
+};
+
+} // namespace
+
+std::vector<MeshIndex> MeshSimplifier::Simplify(const std::vector<Vertex> &vertices, const std::vector<MeshIndex> &indices,
+    size_t target_index_count, float max_error, float *out_error)
+{
+    std::vector<MeshIndex> result(indices);
+
+    if (out_error != nullptr) {
+        *out_error = 0.0f;
+    }
+
+    if (indices.size() < 3 || target_index_count >= indices.size()) {
+        return result;
+    }
+
+    const size_t num_vertices = vertices.size();
+
+    // vertices at the same position form a group, its wedges differ in their other attributes
+    std::vector<uint32_t> sorted(num_vertices);
+
+    for (size_t i = 0; i < num_vertices; i++) {
+        sorted[i] = uint32_t(i);
+    }
+
+    std::sort(sorted.begin(), sorted.end(), [&vertices](uint32_t a, uint32_t b) {
+        const Vector3 &pa = vertices[a].GetPosition();
+        const Vector3 &pb = vertices[b].GetPosition();
+
+        return pa.x != pb.x ? pa.x < pb.x : (pa.y != pb.y ? pa.y < pb.y : pa.z < pb.z);
+    });
+
+    std::vector<uint32_t> group(num_vertices);
+    std::vector<Vector3> positions;
+    std::vector<uint32_t> wedge_offsets;
+
+    for (size_t i = 0; i < num_vertices; i++) {
+        if (i == 0 || !(vertices[sorted[i]].GetPosition() == vertices[sorted[i - 1]].GetPosition())) {
+            positions.push_back(vertices[sorted[i]].GetPosition());
+            wedge_offsets.push_back(uint32_t(i));
+        }
+
+        group[sorted[i]] = uint32_t(positions.size() - 1);
+    }
+
+    wedge_offsets.push_back(uint32_t(num_vertices));
+
+    const size_t num_groups = positions.size();
+    // wedges of group g are sorted[wedge_offsets[g]] to sorted[wedge_offsets[g + 1]]
+    const std::vector<uint32_t> &wedges = sorted;
+
+    BoundingBox bounds;
+
+    for (const Vector3 &position : positions) {
+        bounds.Extend(position);
+    }
+
+    const double extent = std::max(double((bounds.GetMax() - bounds.GetMin()).Length()), 1e-6);
+    const double max_cost = (double(max_error) * extent) * (double(max_error) * extent);
+
+    Adjacency adjacency;
+    adjacency.Build(result, group, num_vertices);
+
+    // planes of the faces around each group, and of the borders running through it
+    std::vector<Quadric> quadrics(num_groups);
+
+    for (size_t i = 0; i < result.size(); i += 3) {
+        const uint32_t g[3] = { group[result[i]], group[result[i + 1]], group[result[i + 2]] };
+        Vector3 normal = FaceNormal(positions[g[0]], positions[g[1]], positions[g[2]]);
+
+        if (normal.LengthSquared() == 0.0f) {
+            continue;
+        }
+
+        normal.Normalize();
+
+        const Quadric face = Quadric::Plane(normal.x, normal.y, normal.z, -normal.Dot(positions[g[0]]), 1.0);
+
+        for (int j = 0; j < 3; j++) {
+            quadrics[g[j]] += face;
+
+            const uint32_t a = g[j], b = g[(j + 1) % 3];
+
+            if (adjacency.IsBorderEdge(a, b)) {
+                // perpendicular to the face, through the edge
+                Vector3 border_normal = positions[b] - positions[a];
+                border_normal.Cross(normal);
+
+                if (border_normal.LengthSquared() > 0.0f) {
+                    border_normal.Normalize();
+
+                    const Quadric border = Quadric::Plane(border_normal.x, border_normal.y, border_normal.z,
+                        -border_normal.Dot(positions[a]), MESH_SIMPLIFIER_BORDER_WEIGHT);
+
+                    quadrics[a] += border;
+                    quadrics[b] += border;
+                }
+            }
+        }
+    }
+
+    std::vector<MeshIndex> remap(num_vertices);
+    std::vector<uint8_t> locked(num_groups);
+    std::vector<uint8_t> is_border(num_groups);
+    std::vector<double> best_cost(num_groups);
+    std::vector<uint32_t> best_target(num_groups);
+    std::vector<Collapse> collapses;
+    std::vector<uint32_t> from_neighbours, to_neighbours;
+    double max_collapse_cost = 0.0;
+
+    // whether every wedge of from that is in use has a neighbouring wedge in to,
+    // which it can be merged with without changing any attribute
+    auto map_wedges = [&](uint32_t from, uint32_t to, bool apply) -> bool {
+        bool any = false;
+
+        for (uint32_t w = wedge_offsets[from]; w < wedge_offsets[from + 1]; w++) {
+            const uint32_t wedge = wedges[w];
+
+            if (adjacency.offsets[wedge] == adjacency.offsets[wedge + 1]) {
+                continue;
+            }
+
+            int64_t target = -1;
+
+            for (uint32_t t = adjacency.offsets[wedge]; t < adjacency.offsets[wedge + 1] && target < 0; t++) {
+                const size_t triangle = adjacency.triangles[t];
+
+                for (int j = 0; j < 3; j++) {
+                    if (group[result[triangle * 3 + j]] == to) {
+                        target = result[triangle * 3 + j];
+                        break;
+                    }
+                }
+            }
+
+            if (target < 0) {
+                return false;
+            }
+
+            if (apply) {
+                remap[wedge] = MeshIndex(target);
+            }
+
+            any = true;
+        }
+
+        return any;
+    };
+
+    auto collect_neighbours = [&](uint32_t g, std::vector<uint32_t> &out) {
+        out.clear();
+
+        for (uint32_t w = wedge_offsets[g]; w < wedge_offsets[g + 1]; w++) {
+            const uint32_t wedge = wedges[w];
+
+            for (uint32_t t = adjacency.offsets[wedge]; t < adjacency.offsets[wedge + 1]; t++) {
+                for (int j = 0; j < 3; j++) {
+                    const uint32_t other = group[result[adjacency.triangles[t] * 3 + j]];
+
+                    if (other != g) {
+                        out.push_back(other);
+                    }
+                }
+            }
+        }
+
+        std::sort(out.begin(), out.end());
+        out.erase(std::unique(out.begin(), out.end()), out.end());
+    };
+
+    // returns the number of triangles the collapse removes, or -1 if it would flip
+    // a triangle or join the surface to itself
+    auto check_collapse = [&](uint32_t from, uint32_t to) -> int64_t {
+        int64_t shared = 0;
+
+        for (uint32_t w = wedge_offsets[from]; w < wedge_offsets[from + 1]; w++) {
+            const uint32_t wedge = wedges[w];
+
+            for (uint32_t t = adjacency.offsets[wedge]; t < adjacency.offsets[wedge + 1]; t++) {
+                const size_t triangle = adjacency.triangles[t];
+                const uint32_t g[3] = {
+                    group[result[triangle * 3]],
+                    group[result[triangle * 3 + 1]],
+                    group[result[triangle * 3 + 2]]
+                };
+
+                if (g[0] == to || g[1] == to || g[2] == to) {
+                    shared++;
+                    continue;
+                }
+
+                Vector3 p[3] = { positions[g[0]], positions[g[1]], positions[g[2]] };
+                const Vector3 before = FaceNormal(p[0], p[1], p[2]);
+
+                for (int j = 0; j < 3; j++) {
+                    if (g[j] == from) {
+                        p[j] = positions[to];
+                    }
+                }
+
+                const Vector3 after = FaceNormal(p[0], p[1], p[2]);
+
+                if (before.Dot(after) <= 0.0f) {
+                    return -1;
+                }
+            }
+        }
+
+        // link condition: the groups may only share the neighbours of their shared triangles
+        collect_neighbours(from, from_neighbours);
+        collect_neighbours(to, to_neighbours);
+
+        size_t common = 0;
+
+        for (size_t i = 0, j = 0; i < from_neighbours.size() && j < to_neighbours.size();) {
+            if (from_neighbours[i] < to_neighbours[j]) {
+                i++;
+            } else if (from_neighbours[i] > to_neighbours[j]) {
+                j++;
+            } else {
+                common++;
+                i++;
+                j++;
+            }
+        }
+
+        if (shared == 0 || int64_t(common) > shared) {
+            return -1;
+        }
+
+        return shared;
+    };
+
+    while (result.size() > target_index_count) {
+        std::fill(is_border.begin(), is_border.end(), 0);
+
+        for (uint64_t edge : adjacency.edges) {
+            const uint32_t a = uint32_t(edge >> 32), b = uint32_t(edge);
+
+            if (adjacency.edges.count(EdgeKey(b, a)) == 0) {
+                is_border[a] = is_border[b] = 1;
+            }
+        }
+
+        // cheapest valid collapse out of each group
+        std::fill(best_cost.begin(), best_cost.end(), max_cost + 1.0);
+
+        for (uint64_t edge : adjacency.edges) {
+            const uint32_t a = uint32_t(edge >> 32), b = uint32_t(edge);
+            const uint32_t pairs[2][2] = { { a, b }, { b, a } };
+
+            for (const auto &pair : pairs) {
+                const uint32_t from = pair[0], to = pair[1];
+
+                // borders only move along themselves
+                if (is_border[from] && !adjacency.IsBorderEdge(from, to)) {
+                    continue;
+                }
+
+                Quadric q = quadrics[from];
+                q += quadrics[to];
+
+                const double cost = q.Evaluate(positions[to]);
+
+                if (cost < best_cost[from] && map_wedges(from, to, false)) {
+                    best_cost[from] = cost;
+                    best_target[from] = to;
+                }
+            }
+        }
+
+        collapses.clear();
+
+        for (uint32_t g = 0; g < num_groups; g++) {
+            if (best_cost[g] <= max_cost) {
+                collapses.push_back({ g, best_target[g], best_cost[g] });
+            }
+        }
+
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse &a, const Collapse &b) {
+            return a.cost < b.cost;
+        });
+
+        for (size_t i = 0; i < num_vertices; i++) {
+            remap[i] = MeshIndex(i);
+        }
+
+        std::fill(locked.begin(), locked.end(), 0);
+
+        const size_t triangles_to_remove = (result.size() - target_index_count + 2) / 3;
+        size_t removed = 0;
+
+        // collapses in one pass never share a triangle, as the neighbours of each are locked
+        for (const Collapse &collapse : collapses) {
+            if (removed >= triangles_to_remove) {
+                break;
+            }
+
+            if (locked[collapse.from] || locked[collapse.to]) {
+                continue;
+            }
+
+            const int64_t shared = check_collapse(collapse.from, collapse.to);
+
+            if (shared < 0) {
+                continue;
+            }
+
+            map_wedges(collapse.from, collapse.to, true);
+            quadrics[collapse.to] += quadrics[collapse.from];
+
+            // from_neighbours was filled by check_collapse
+            for (uint32_t neighbour : from_neighbours) {
+                locked[neighbour] = 1;
+            }
+
+            locked[collapse.from] = 1;
+            locked[collapse.to] = 1;
+
+            removed += size_t(shared);
+            max_collapse_cost = std::max(max_collapse_cost, collapse.cost);
+        }
+
+        if (removed == 0) {
+            break;
+        }
+
+        // drop the triangles that lost their area
+        size_t write = 0;
+
+        for (size_t i = 0; i < result.size(); i += 3) {
+            const MeshIndex a = remap[result[i]], b = remap[result[i + 1]], c = remap[result[i + 2]];
+
+            if (group[a] == group[b] || group[b] == group[c] || group[c] == group[a]) {
+                continue;
+            }
+
+            result[write++] = a;
+            result[write++] = b;
+            result[write++] = c;
+        }
+
+        result.resize(write);
+
+        adjacency.Build(result, group, num_vertices);
+    }
+
+    if (out_error != nullptr) {
+        *out_error = float(std::sqrt(max_collapse_cost) / extent);
+    }
+
+    return result;
+}
+
+std::shared_ptr<Mesh> MeshSimplifier::CreateLod(const std::shared_ptr<Mesh> &mesh,
+    float triangle_ratio, float max_error)
+{
+    std::vector<Vertex> vertices = mesh->GetVertices();
+
+    const size_t target_index_count = size_t(float(mesh->GetIndices().size() / 3) * triangle_ratio) * 3;
+    std::vector<MeshIndex> indices = Simplify(vertices, mesh->GetIndices(), target_index_count, max_error);
+
+    MeshOptimizer::OptimizeVertexCache(indices, vertices.size());
+    MeshOptimizer::OptimizeVertexFetch(vertices, indices);
+
+    auto lod = std::make_shared<Mesh>();
+
+    for (auto &&attr : mesh->GetAttributes()) {
+        lod->SetAttribute(attr.first, attr.second);
+    }
+
+    lod->SetVertices(vertices, indices);
+    lod->SetPrimitiveType(mesh->GetPrimitiveType());
+    lod->SetVertexPacking(mesh->GetVertexPacking());
+    lod->SetResidency(mesh->GetResidency());
+    lod->SetShader(mesh->GetShader());
+
+    return lod;
+}
+
+void MeshSimplifier::GenerateLods(const std::shared_ptr<Mesh> &mesh, const LodSettings &settings)
+{
+    std::vector<Renderable::Lod> lods;
+
+    if (mesh == nullptr || mesh->GetPrimitiveType() != Mesh::PRIM_TRIANGLES || !mesh->HasVertexData()) {
+        return;
+    }
+
+    if (mesh->GetIndices().size() / 3 < MESH_LOD_MIN_TRIANGLES) {
+        return;
+    }
+
+    std::shared_ptr<Mesh> previous = mesh;
+    float screen_size = settings.screen_size;
+
+    for (size_t i = 0; i < settings.num_levels; i++) {
+        std::shared_ptr<Mesh> lod = CreateLod(previous, settings.triangle_ratio, settings.max_error);
+
+        // the error limit was reached, further levels would look no different
+        if (lod->GetIndices().size() > previous->GetIndices().size() * 3 / 4) {
+            break;
+        }
+
+        lods.push_back({ lod, screen_size });
+
+        previous = lod;
+        screen_size *= 0.5f;
+    }
+
+    mesh->SetLods(lods);
+}
+
+void MeshSimplifier::GenerateLods(const std::shared_ptr<Mesh> &mesh)
+{
+    GenerateLods(mesh, LodSettings());
+}
+
+} // namespace apex
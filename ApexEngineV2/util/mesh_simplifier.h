@@ -0,0 +1,55 @@
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include "../rendering/mesh.h"
+
+#include <memory>
+#include <vector>
+#include <cstddef>
+
+// set to 0 to not generate levels of detail for imported meshes
+#define MESH_LOD_ENABLED 1
+// meshes with fewer triangles than this get no levels of detail
+#define MESH_LOD_MIN_TRIANGLES 256
+
+namespace apex {
+
+// Quadric error metric simplification (Garland & Heckbert 1997) by edge collapse.
+// Vertices only ever collapse onto a neighbouring vertex, so no new attributes
+// are made up. Vertices that share a position but not their other attributes
+// (UV and normal seams) collapse together, and only along the seam, so seams
+// stay where they are. Open borders only collapse along the border.
+class MeshSimplifier {
+public:
+    struct LodSettings {
+        // levels after the full resolution mesh
+        size_t num_levels = 3;
+        // fraction of the triangles of the previous level that each level keeps
+        float triangle_ratio = 0.3f;
+        // projected size, as a fraction of the viewport height, under which the first
+        // level is drawn. each following level halves it.
+        float screen_size = 0.3f;
+        // largest error allowed, as a fraction of the size of the mesh
+        float max_error = 0.05f;
+    };
+
+    // returns indices into vertices for at most target_index_count indices, or as few as
+    // max_error (relative to the size of the mesh) allows. out_error is set to the
+    // relative error reached.
+    static std::vector<MeshIndex> Simplify(const std::vector<Vertex> &vertices, const std::vector<MeshIndex> &indices,
+        size_t target_index_count, float max_error, float *out_error = nullptr);
+
+    // a mesh with the simplified triangles and only the vertices they use,
+    // sharing the attributes, shader and settings of mesh
+    static std::shared_ptr<Mesh> CreateLod(const std::shared_ptr<Mesh> &mesh,
+        float triangle_ratio, float max_error);
+
+    // sets the levels of detail of a triangle mesh that still has its vertex data.
+    // stops early once a level does not remove enough triangles.
+    static void GenerateLods(const std::shared_ptr<Mesh> &mesh, const LodSettings &settings);
+    static void GenerateLods(const std::shared_ptr<Mesh> &mesh);
+};
+
+} // namespace apex
+
+#endif
@@ -0,0 +1,266 @@
+#include "meshlet_builder.h"
+#include "mesh_optimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace apex {
+
+namespace {
+
+Meshlet CreateMeshlet(const std::vector<Vertex> &vertices, const std::vector<MeshIndex> &indices,
+    const std::vector<Vector3> &normals, size_t begin, size_t end)
+{
+    Meshlet meshlet;
+    meshlet.index_offset = uint32_t(begin);
+    meshlet.index_count = uint32_t(end - begin);
+
+    BoundingBox bounds;
+
+    for (size_t i = begin; i < end; i++) {
+        bounds.Extend(vertices[indices[i]].GetPosition());
+    }
+
+    meshlet.center = bounds.GetCenter();
+    meshlet.radius = 0.0f;
+
+    for (size_t i = begin; i < end; i++) {
+        meshlet.radius = std::max(meshlet.radius, vertices[indices[i]].GetPosition().Distance(meshlet.center));
+    }
+
+    // the average normal is the axis, the normal furthest from it sets the angle
+    Vector3 axis;
+
+    for (size_t i = begin; i < end; i += 3) {
+        axis += normals[i / 3];
+    }
+
+    meshlet.cone_axis = axis;
+    meshlet.cone_cutoff = 1.0f;
+
+    if (axis.LengthSquared() == 0.0f) {
+        return meshlet;
+    }
+
+    meshlet.cone_axis.Normalize();
+
+    float min_dot = 1.0f;
+
+    for (size_t i = begin; i < end; i += 3) {
+        const Vector3 &normal = normals[i / 3];
+
+        // degenerate triangles are never drawn, so do not widen the cone
+        if (normal.LengthSquared() != 0.0f) {
+            min_dot = std::min(min_dot, normal.Dot(meshlet.cone_axis));
+        }
+    }
+
+    // the cone is wider than a hemisphere, some triangle always faces the viewer
+    if (min_dot <= 0.0f) {
+        return meshlet;
+    }
+
+    meshlet.cone_cutoff = std::sqrt(1.0f - min_dot * min_dot);
+
+    return meshlet;
+}
+
+} // namespace
+
+std::vector<Meshlet> MeshletBuilder::Build(const std::vector<Vertex> &vertices, std::vector<MeshIndex> &indices,
+    size_t max_triangles)
+{
+    std::vector<Meshlet> meshlets;
+
+    const size_t num_triangles = indices.size() / 3;
+    const size_t num_vertices = vertices.size();
+
+    if (num_triangles == 0 || max_triangles == 0) {
+        return meshlets;
+    }
+
+    std::vector<Vector3> normals(num_triangles);
+
+    for (size_t t = 0; t < num_triangles; t++) {
+        const Vector3 &p0 = vertices[indices[t * 3]].GetPosition();
+
+        Vector3 normal = vertices[indices[t * 3 + 1]].GetPosition() - p0;
+        normal.Cross(vertices[indices[t * 3 + 2]].GetPosition() - p0);
+
+        if (normal.LengthSquared() != 0.0f) {
+            normal.Normalize();
+        }
+
+        normals[t] = normal;
+    }
+
+    // triangles of each vertex
+    std::vector<uint32_t> offsets(num_vertices + 1, 0);
+    std::vector<uint32_t> adjacent(indices.size());
+
+    for (MeshIndex index : indices) {
+        offsets[index + 1]++;
+    }
+
+    for (size_t i = 0; i < num_vertices; i++) {
+        offsets[i + 1] += offsets[i];
+    }
+
+    {
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+
+        for (size_t i = 0; i < indices.size(); i++) {
+            adjacent[fill[indices[i]]++] = uint32_t(i / 3);
+        }
+    }
+
+    std::vector<MeshIndex> result;
+    std::vector<Vector3> result_normals;
+    result.reserve(num_triangles * 3);
+    result_normals.reserve(num_triangles);
+
+    std::vector<uint8_t> emitted(num_triangles, 0);
+    // meshlet number + 1 of the last meshlet to use a vertex, or to consider a triangle
+    std::vector<uint32_t> vertex_meshlet(num_vertices, 0);
+    std::vector<uint32_t> candidate_meshlet(num_triangles, 0);
+    std::vector<uint32_t> candidates;
+    size_t seed_cursor = 0;
+
+    while (result.size() < num_triangles * 3) {
+        const uint32_t stamp = uint32_t(meshlets.size() + 1);
+        const size_t begin = result.size();
+
+        // continue next to the previous meshlet, so neighbouring meshlets are near in the buffer
+        int64_t seed = -1;
+
+        for (uint32_t candidate : candidates) {
+            if (!emitted[candidate]) {
+                seed = candidate;
+                break;
+            }
+        }
+
+        if (seed < 0) {
+            while (emitted[seed_cursor]) {
+                seed_cursor++;
+            }
+
+            seed = int64_t(seed_cursor);
+        }
+
+        candidates.clear();
+
+        Vector3 normal_sum;
+        uint32_t next = uint32_t(seed);
+
+        for (size_t count = 0; count < max_triangles; count++) {
+            emitted[next] = 1;
+            normal_sum += normals[next];
+            result_normals.push_back(normals[next]);
+
+            for (int j = 0; j < 3; j++) {
+                const MeshIndex index = indices[next * 3 + j];
+
+                result.push_back(index);
+
+                if (vertex_meshlet[index] == stamp) {
+                    continue;
+                }
+
+                vertex_meshlet[index] = stamp;
+
+                for (uint32_t a = offsets[index]; a < offsets[index + 1]; a++) {
+                    const uint32_t triangle = adjacent[a];
+
+                    if (!emitted[triangle] && candidate_meshlet[triangle] != stamp) {
+                        candidate_meshlet[triangle] = stamp;
+                        candidates.push_back(triangle);
+                    }
+                }
+            }
+
+            // the candidate sharing the most vertices, then facing most like the meshlet
+            int64_t best = -1;
+            float best_score = 0.0f;
+
+            for (size_t c = 0; c < candidates.size();) {
+                const uint32_t triangle = candidates[c];
+
+                if (emitted[triangle]) {
+                    candidates[c] = candidates.back();
+                    candidates.pop_back();
+                    continue;
+                }
+
+                int shared = 0;
+
+                for (int j = 0; j < 3; j++) {
+                    shared += vertex_meshlet[indices[triangle * 3 + j]] == stamp ? 1 : 0;
+                }
+
+                const float score = float(shared) * 2.0f + normals[triangle].Dot(normal_sum) / float(count + 1);
+
+                if (best < 0 || score > best_score) {
+                    best = triangle;
+                    best_score = score;
+                }
+
+                c++;
+            }
+
+            if (best < 0) {
+                break;
+            }
+
+            next = uint32_t(best);
+        }
+
+        meshlets.push_back(CreateMeshlet(vertices, result, result_normals, begin, result.size()));
+    }
+
+    indices.swap(result);
+
+    return meshlets;
+}
+
+size_t MeshletBuilder::Build(const std::shared_ptr<Mesh> &mesh)
+{
+    if (mesh == nullptr || mesh->GetPrimitiveType() != Mesh::PRIM_TRIANGLES || !mesh->HasVertexData()) {
+        return 0;
+    }
+
+    if (mesh->GetIndices().size() / 3 < MESHLET_MIN_TRIANGLES) {
+        return 0;
+    }
+
+    // skinned vertices move away from the bind pose the bounds would be built from
+    const auto &attributes = mesh->GetAttributes();
+
+    if (attributes.find(Mesh::ATTR_BONEWEIGHTS) != attributes.end() ||
+        attributes.find(Mesh::ATTR_BONEINDICES) != attributes.end()) {
+        return 0;
+    }
+
+    if (mesh->GetShader() != nullptr && mesh->GetShader()->GetProperties().GetValue("SKINNING").IsTruthy()) {
+        return 0;
+    }
+
+    std::vector<Vertex> vertices = mesh->GetVertices();
+    std::vector<MeshIndex> indices = mesh->GetIndices();
+
+    std::vector<Meshlet> meshlets = Build(vertices, indices);
+    // the same triangles, so the levels of detail still match
+    std::vector<Renderable::Lod> lods = mesh->GetLods();
+
+    // only renumbers vertices, the triangle order and so the meshlets stay the same
+    MeshOptimizer::OptimizeVertexFetch(vertices, indices);
+
+    mesh->SetVertices(vertices, indices);
+    mesh->SetMeshlets(meshlets);
+    mesh->SetLods(lods);
+
+    return meshlets.size();
+}
+
+} // namespace apex
@@ -0,0 +1,39 @@
+#ifndef MESHLET_BUILDER_H
+#define MESHLET_BUILDER_H
+
+#include "../rendering/mesh.h"
+#include "../rendering/meshlet.h"
+
+#include <memory>
+#include <vector>
+#include <cstddef>
+
+// set to 0 to not split imported meshes into meshlets
+#define MESHLET_BUILDER_ENABLED 1
+// triangles per meshlet
+#define MESHLET_MAX_TRIANGLES 128
+// meshes with fewer triangles than this are only culled as a whole
+#define MESHLET_MIN_TRIANGLES 1024
+
+namespace apex {
+
+// Splits a triangle mesh into meshlets of up to MESHLET_MAX_TRIANGLES triangles,
+// grown from a seed triangle over shared vertices, preferring triangles facing
+// the same way so the normal cones stay narrow. The triangles of each meshlet
+// are made consecutive in the index buffer, so a meshlet is an index range.
+// Meant to run at import or bake time, after MeshOptimizer, whose triangle order
+// it keeps within each meshlet as far as the growth allows.
+class MeshletBuilder {
+public:
+    // reorders indices so each meshlet is one range, and returns the meshlets
+    static std::vector<Meshlet> Build(const std::vector<Vertex> &vertices, std::vector<MeshIndex> &indices,
+        size_t max_triangles = MESHLET_MAX_TRIANGLES);
+
+    // splits a triangle mesh that still has its vertex data, if it has at least
+    // MESHLET_MIN_TRIANGLES triangles and is not skinned. returns the number of meshlets.
+    static size_t Build(const std::shared_ptr<Mesh> &mesh);
+};
+
+} // namespace apex
+
+#endif
@@ -4,56 +4,251 @@
 #include "../asset/text_loader.h"
 #include "string_util.h"
 
-#include <iostream>
+#include <map>
+#include <unordered_map>
+#include <mutex>
+#include <cstdio>
+#include <cctype>
 
 namespace apex {
 
-std::string ShaderPreprocessor::ProcessShader(const std::string &code, 
-    const ShaderProperties &shader_properties, 
-    const std::string &path,
-    int *line_num_ptr)
+// resolves `.` and `..` components, so that one file reached through
+// different relative paths is recognized as already included
+static std::string NormalizePath(const std::string &path)
 {
-    std::istringstream ss(code);
-    std::ostringstream os;
-    std::streampos pos;
-    std::string line;
+    std::vector<std::string> components;
+    std::string component;
+
+    for (size_t i = 0; i <= path.length(); i++) {
+        if (i == path.length() || path[i] == '/' || path[i] == '\\') {
+            if (component == "..") {
+                if (!components.empty() && components.back() != "..") {
+                    components.pop_back();
+                } else {
+                    components.push_back(component);
+                }
+            } else if (!component.empty() && component != ".") {
+                components.push_back(component);
+            }
+
+            component.clear();
+        } else {
+            component += path[i];
+        }
+    }
+
+    std::string result;
+
+    for (size_t i = 0; i < components.size(); i++) {
+        if (i != 0) {
+            result += '/';
+        }
+
+        result += components[i];
+    }
+
+    return result;
+}
+
+struct ShaderPreprocessor::Node {
+    enum NodeType {
+        NODE_TEXT,
+        NODE_DEFINE,
+        NODE_IF,
+        NODE_INCLUDE
+    } type;
+
+    struct Reference {
+        size_t offset; // into text
+        std::string name;
+        int define_index; // last `#define $` of the name in the same scope, or -1
+    };
+
+    // TEXT: the line with its `$NAME` references cut out.
+    // DEFINE / IF: the name. INCLUDE: the path, as passed to AssetManager
+    std::string text;
+    std::vector<Reference> references; // TEXT
+    ShaderProperties::ShaderProperty value; // DEFINE
+    std::string normalized_path; // INCLUDE
+    bool is_negated; // IF
+    bool has_endif; // IF
+    size_t end; // IF: index of the first node after the body
+
+    Node(NodeType type)
+        : type(type),
+          is_negated(false),
+          has_endif(false),
+          end(0)
+    {
+        value.type = ShaderProperties::ShaderProperty::SHADER_PROPERTY_UNSET;
+        value.value.int_value = 0;
+    }
+};
+
+struct ShaderPreprocessor::ParsedFile {
+    std::string code;
+    std::string path;
+    std::string local_path; // directory includes are relative to
+    std::vector<Node> nodes; // the body of an #if directly follows it
+    bool has_endif; // ended by a stray #endif, which still counts as a line
+};
+
+struct ShaderPreprocessor::Context {
+    const ShaderProperties &properties;
+    std::string &out;
+    int *line_num_ptr;
+    std::set<std::string> &included_paths;
+    // paths added by the current branch, removed again if the branch is discarded
+    std::vector<std::set<std::string>::iterator> added_paths;
+    // `#define $` nodes of the enclosing scopes, innermost last
+    std::vector<const Node*> defines;
+    // keeps included files alive while their nodes are referenced
+    std::vector<std::shared_ptr<const ParsedFile>> files;
+
+    Context(const ShaderProperties &properties, std::string &out,
+        int *line_num_ptr, std::set<std::string> &included_paths)
+        : properties(properties),
+          out(out),
+          line_num_ptr(line_num_ptr),
+          included_paths(included_paths)
+    {
+    }
 
-    std::string local_path(path.substr(0, path.find_last_of("\\/")));
+    const ShaderProperties::ShaderProperty *Find(const std::string &name) const
+    {
+        for (auto it = defines.rbegin(); it != defines.rend(); ++it) {
+            if ((*it)->text == name) {
+                return &(*it)->value;
+            }
+        }
+
+        auto it = properties.GetValues().find(name);
+
+        if (it != properties.GetValues().end()) {
+            return &it->second;
+        }
 
-    if (!(StringUtil::Contains(local_path, "/") ||
-        StringUtil::Contains(local_path, "\\"))) {
-        local_path.clear();
+        return nullptr;
     }
+};
+
+static void AppendLineNumber(std::string &out, int line_num)
+{
+    char buffer[24];
+    const int length = std::snprintf(buffer, sizeof(buffer), "/* %d */ ", line_num);
+
+    out.append(buffer, length);
+}
 
+std::string ShaderPreprocessor::ProcessShader(const std::string &code,
+    const ShaderProperties &shader_properties,
+    const std::string &path,
+    int *line_num_ptr,
+    std::vector<std::string> *include_paths)
+{
     int line_num = 0;
 
     if (line_num_ptr == nullptr) {
         line_num_ptr = &line_num;
     }
 
-    return FileHeader(path) + ProcessInner(ss, pos, shader_properties, local_path, line_num_ptr);
+    std::set<std::string> included_paths;
+
+    const std::shared_ptr<const ParsedFile> file = GetSourceFile(code, path);
+
+    // includes usually at least double the size, with the line number comments
+    std::string result;
+    result.reserve(code.size() * 3);
+    result += FileHeader(path);
+
+    Context context(shader_properties, result, line_num_ptr, included_paths);
+    ProcessFile(*file, context, true);
+
+    if (include_paths != nullptr) {
+        include_paths->insert(include_paths->end(), included_paths.begin(), included_paths.end());
+    }
+
+    return result;
 }
 
-std::string ShaderPreprocessor::ProcessInner(std::istringstream &ss, 
-    std::streampos &pos,
-    const ShaderProperties &shader_properties,
-    const std::string &local_path,
-    int *line_num_ptr)
+std::shared_ptr<const ShaderPreprocessor::ParsedFile> ShaderPreprocessor::Parse(const std::string &code, const std::string &path)
 {
-    ShaderProperties defines(shader_properties);
+    auto file = std::make_shared<ParsedFile>();
+    file->code = code;
+    file->path = path;
+    file->local_path = path.substr(0, path.find_last_of("\\/"));
+    file->has_endif = false;
+
+    if (!(StringUtil::Contains(file->local_path, "/") ||
+        StringUtil::Contains(file->local_path, "\\"))) {
+        file->local_path.clear();
+    }
+
+    std::vector<Node> &nodes = file->nodes;
+
+    // for each open scope: the last `#define $` of every name, and the text nodes to resolve against them
+    struct Scope {
+        size_t if_index;
+        std::map<std::string, int> defines;
+        std::vector<size_t> text_nodes;
+    };
+
+    std::vector<Scope> scopes(1);
+    scopes.back().if_index = size_t(-1);
+
+    const auto close_scope = [&nodes, &scopes]() {
+        const Scope &scope = scopes.back();
+
+        for (size_t index : scope.text_nodes) {
+            for (Node::Reference &reference : nodes[index].references) {
+                auto it = scope.defines.find(reference.name);
+                reference.define_index = (it != scope.defines.end()) ? it->second : -1;
+            }
+        }
 
-    std::string res;
+        if (scope.if_index != size_t(-1)) {
+            nodes[scope.if_index].end = nodes.size();
+        }
+
+        scopes.pop_back();
+    };
+
+    const auto add_text = [&nodes, &scopes](const std::string &line) {
+        Node node(Node::NODE_TEXT);
+        node.text.reserve(line.size());
+
+        for (size_t i = 0; i < line.size(); i++) {
+            if (line[i] != '$') {
+                node.text += line[i];
+                continue;
+            }
 
-    std::string line;
+            Node::Reference reference;
+            reference.offset = node.text.size();
+            reference.define_index = -1;
+
+            while (i + 1 < line.size() && (std::isalnum(static_cast<unsigned char>(line[i + 1])) || line[i + 1] == '_')) {
+                reference.name += line[++i];
+            }
+
+            node.references.push_back(std::move(reference));
+        }
 
-    while (std::getline(ss, line)) {
-        (*line_num_ptr)++;
+        scopes.back().text_nodes.push_back(nodes.size());
+        nodes.push_back(std::move(node));
+    };
 
-        line = StringUtil::Trim(line);
+    size_t line_start = 0;
 
-        std::string new_line = "/* ";
-        new_line += std::to_string(*line_num_ptr);
-        new_line += " */ ";
+    while (line_start < code.size()) {
+        size_t line_end = code.find('\n', line_start);
+
+        if (line_end == std::string::npos) {
+            line_end = code.size();
+        }
+
+        const std::string line = StringUtil::Trim(code.substr(line_start, line_end - line_start));
+        line_start = line_end + 1;
 
         if (StringUtil::StartsWith(line, "#define $")) {
             std::string sub = line.substr(9);
@@ -75,110 +270,270 @@ std::string ShaderPreprocessor::ProcessInner(std::istringstream &ss,
                 std::string key = new_components[0];
                 std::string value = line.substr(9 + key.size());
 
+                ShaderProperties defined;
                 ShaderProperties::ShaderProperty::Value result;
 
                 if (new_components.size() == 2) {
                     if (StringUtil::ParseNumber<float>(value, &result.float_value)) {
                         if (MathUtil::Round(result.float_value) == result.float_value) {
-                            defines.Define(key, int(result.float_value));
+                            defined.Define(key, int(result.float_value));
                         } else {
-                            defines.Define(key, result.float_value);
+                            defined.Define(key, result.float_value);
                         }
                     } else if (StringUtil::ParseNumber<int>(value, &result.int_value)) {
-                        defines.Define(key, result.int_value);
+                        defined.Define(key, result.int_value);
                     } else if (StringUtil::ParseNumber<bool>(value, &result.bool_value)) {
-                        defines.Define(key, result.bool_value);
+                        defined.Define(key, result.bool_value);
                     } else {
-                        defines.Define(key, value);
+                        defined.Define(key, value);
                     }
                 } else {
-                    defines.Define(key, value);
+                    defined.Define(key, value);
                 }
-            } else {
-                new_line += "#error \"The `#define $` directive must be defined in the format: `#define $NAME value`\"";
-            }
-        } else if (StringUtil::StartsWith(line, "#if !")) {
-            std::string key = line.substr(5);
-            std::string inner = ProcessInner(ss, pos, defines, local_path, line_num_ptr);
 
-            if (!defines.GetValue(key).IsTruthy()) {
-                new_line += inner;
-            }
-        } else if (StringUtil::StartsWith(line, "#if ")) {
-            std::string key = line.substr(4);
-            std::string inner = ProcessInner(ss, pos, defines, local_path, line_num_ptr);
+                Node node(Node::NODE_DEFINE);
+                node.text = key;
+                node.value = defined.GetValues().begin()->second;
 
-            if (defines.GetValue(key).IsTruthy()) {
-                new_line += inner;
+                scopes.back().defines[key] = int(nodes.size());
+                nodes.push_back(std::move(node));
+            } else {
+                add_text("#error \"The `#define $` directive must be defined in the format: `#define $NAME value`\"");
             }
+        } else if (StringUtil::StartsWith(line, "#if !") || StringUtil::StartsWith(line, "#if ")) {
+            Node node(Node::NODE_IF);
+            node.is_negated = StringUtil::StartsWith(line, "#if !");
+            node.text = line.substr(node.is_negated ? 5 : 4);
+
+            scopes.push_back(Scope());
+            scopes.back().if_index = nodes.size();
+            nodes.push_back(std::move(node));
         } else if (StringUtil::StartsWith(line, "#endif")) {
-            break; // exit current recursion
+            if (scopes.size() == 1) {
+                // as before, a stray #endif ends the file
+                file->has_endif = true;
+                break;
+            }
+
+            nodes[scopes.back().if_index].has_endif = true;
+            close_scope();
         } else if (StringUtil::StartsWith(line, "#include ")) {
             std::string val = line.substr(9);
-            std::string path;
+            std::string include;
 
             if (val[0] == '\"') {
-                int idx = 1;
+                size_t idx = 1;
                 while (idx < val.size() && val[idx] != '\"') {
-                    path += val[idx];
+                    include += val[idx];
                     ++idx;
                 }
             }
 
-            const std::string include_path = local_path + "/" + path;
+            Node node(Node::NODE_INCLUDE);
+            node.text = file->local_path + "/" + include;
+            node.normalized_path = NormalizePath(node.text);
 
-            if (auto loaded = AssetManager::GetInstance()->
-                LoadFromFile<TextLoader::LoadedText>(include_path)) {
+            nodes.push_back(std::move(node));
+        } else {
+            add_text(line);
+        }
+    }
 
-                std::string relative_path(loaded->GetFilePath().substr(0,
-                    loaded->GetFilePath().find_last_of("\\/")));
+    // an #if without #endif runs to the end of the file
+    while (!scopes.empty()) {
+        close_scope();
+    }
 
-                if (!(StringUtil::Contains(relative_path, "/") ||
-                    StringUtil::Contains(relative_path, "\\"))) {
-                    relative_path.clear();
-                }
+    return file;
+}
 
-                new_line += ProcessShader(loaded->GetText(), defines, relative_path, line_num_ptr) + "\n";
-                new_line += "\n";
-                new_line += FileHeader(local_path);
-            } else {
-                new_line += "#error \"The include could not be found at: ";
-                new_line += include_path;
-                new_line += "\"";
-            }
-        } else {
-            new_line += line;
+std::shared_ptr<const ShaderPreprocessor::ParsedFile> ShaderPreprocessor::GetSourceFile(const std::string &code, const std::string &path)
+{
+    static std::mutex parsed_sources_mutex;
+    static std::unordered_map<std::string, std::shared_ptr<const ParsedFile>> parsed_sources;
+
+    std::string key(path);
+    key += '#';
+    key += std::to_string(std::hash<std::string>()(code));
+
+    {
+        std::lock_guard<std::mutex> lock(parsed_sources_mutex);
+
+        auto it = parsed_sources.find(key);
+
+        if (it != parsed_sources.end() && it->second->code == code) {
+            return it->second;
         }
+    }
+
+    // parsed without the lock, so warm-up threads do not wait on each other
+    std::shared_ptr<const ParsedFile> file = Parse(code, path);
+
+    std::lock_guard<std::mutex> lock(parsed_sources_mutex);
+    parsed_sources[key] = file;
 
-        res += new_line + "\n";
+    return file;
+}
+
+std::shared_ptr<const ShaderPreprocessor::ParsedFile> ShaderPreprocessor::GetIncludeFile(const std::string &include_path)
+{
+    static std::mutex parsed_includes_mutex;
+    static std::unordered_map<std::string, std::shared_ptr<const ParsedFile>> parsed_includes;
+
+    {
+        std::lock_guard<std::mutex> lock(parsed_includes_mutex);
+
+        auto it = parsed_includes.find(include_path);
+
+        if (it != parsed_includes.end()) {
+            return it->second;
+        }
     }
 
-    std::string res_processed;
-    res_processed.reserve(res.length());
+    auto loaded = AssetManager::GetInstance()->LoadFromFile<TextLoader::LoadedText>(include_path);
+
+    if (loaded == nullptr) {
+        return nullptr;
+    }
+
+    // nested includes are relative to the directory of the included file
+    std::shared_ptr<const ParsedFile> file = Parse(loaded->GetText(), loaded->GetFilePath());
+
+    std::lock_guard<std::mutex> lock(parsed_includes_mutex);
+    parsed_includes[include_path] = file;
+
+    return file;
+}
+
+void ShaderPreprocessor::ProcessFile(const ParsedFile &file, Context &context, bool emit)
+{
+    ProcessRange(file, 0, file.nodes.size(), context, emit);
+
+    if (file.has_endif) {
+        (*context.line_num_ptr)++;
+    }
+}
+
+void ShaderPreprocessor::ProcessRange(const ParsedFile &file, size_t begin, size_t end, Context &context, bool emit)
+{
+    // `#define $` only applies until the end of its scope
+    const size_t num_defines = context.defines.size();
+
+    std::string &out = context.out;
+
+    for (size_t i = begin; i < end;) {
+        const Node &node = file.nodes[i];
+
+        (*context.line_num_ptr)++;
+
+        if (emit) {
+            AppendLineNumber(out, *context.line_num_ptr);
+        }
+
+        switch (node.type) {
+        case Node::NODE_TEXT:
+            if (emit) {
+                size_t offset = 0;
 
-    for (size_t i = 0; i < res.length(); i++) {
-        char ch = res[i];
-        if (ch == '$') {
-            size_t start_pos = i;
-            std::string str = "";
+                for (const Node::Reference &reference : node.references) {
+                    out.append(node.text, offset, reference.offset - offset);
+                    offset = reference.offset;
 
-            while (i + 1 < res.length() && (std::isalnum(res[i + 1]) || res[i + 1] == '_')) {
-                ch = res[++i];
-                str += ch;
+                    // a reference uses the last value defined in its scope, even if defined below it
+                    const ShaderProperties::ShaderProperty *value = (reference.define_index != -1)
+                        ? &file.nodes[reference.define_index].value
+                        : context.Find(reference.name);
+
+                    if (value != nullptr) {
+                        out += value->raw_value;
+                    } else {
+                        out += "__UNDEFINED__";
+                    }
+                }
+
+                out.append(node.text, offset, std::string::npos);
             }
 
-            if (defines.HasValue(str)) {
-                auto value = defines.GetValue(str);
-                res_processed += value.raw_value;
-            } else {
-                res_processed += "__UNDEFINED__";
+            break;
+        case Node::NODE_DEFINE:
+            context.defines.push_back(&node);
+
+            break;
+        case Node::NODE_IF: {
+            const ShaderProperties::ShaderProperty *value = context.Find(node.text);
+            const bool is_taken = (value != nullptr && value->IsTruthy()) != node.is_negated;
+            const size_t num_added_paths = context.added_paths.size();
+
+            // a discarded body is still walked, to count its lines
+            ProcessRange(file, i + 1, node.end, context, emit && is_taken);
+
+            if (node.has_endif) {
+                (*context.line_num_ptr)++;
             }
-        } else {
-            res_processed += ch;
+
+            // includes in a discarded branch must not count as included
+            if (!is_taken) {
+                for (size_t j = num_added_paths; j < context.added_paths.size(); j++) {
+                    context.included_paths.erase(context.added_paths[j]);
+                }
+
+                context.added_paths.resize(num_added_paths);
+            }
+
+            if (emit) {
+                out += '\n';
+            }
+
+            i = node.end;
+
+            continue;
         }
+        case Node::NODE_INCLUDE: {
+            auto inserted = context.included_paths.insert(node.normalized_path);
+
+            if (!inserted.second) {
+                if (emit) {
+                    out += "/* already included: ";
+                    out += node.text;
+                    out += " */";
+                }
+
+                break;
+            }
+
+            context.added_paths.push_back(inserted.first);
+
+            if (auto included = GetIncludeFile(node.text)) {
+                context.files.push_back(included);
+
+                if (emit) {
+                    out += FileHeader(included->path);
+                }
+
+                ProcessFile(*included, context, emit);
+
+                if (emit) {
+                    out += "\n\n";
+                    out += FileHeader(file.local_path);
+                }
+            } else if (emit) {
+                out += "#error \"The include could not be found at: ";
+                out += node.text;
+                out += "\"";
+            }
+
+            break;
+        }
+        }
+
+        if (emit) {
+            out += '\n';
+        }
+
+        i++;
     }
 
-    return res_processed;
+    context.defines.resize(num_defines);
 }
 
 std::string ShaderPreprocessor::FileHeader(const std::string &path)
@@ -2,24 +2,42 @@
 #define SHADER_PREPROCESSOR_H
 
 #include <string>
-#include <sstream>
+#include <set>
+#include <vector>
+#include <memory>
 
 namespace apex {
 class ShaderProperties;
 
+// Expands `#include`, `#define $NAME`, `#if` / `#if !` and `$NAME` substitutions.
+// Each file is included at most once per shader, so shared declarations
+// (e.g include/uniform_blocks.inc) can be included by every file that needs them.
+// Every source and include is parsed once into a list of directives, which are
+// cached and shared between threads, so each variant only evaluates its branches.
 class ShaderPreprocessor {
 public:
-    static std::string ProcessShader(const std::string &code, 
+    // if include_paths is given, the normalized path of every file that was
+    // included into the result is added to it
+    static std::string ProcessShader(const std::string &code,
         const ShaderProperties &shader_properties,
         const std::string &path = "",
-        int *line_num_ptr = nullptr);
+        int *line_num_ptr = nullptr,
+        std::vector<std::string> *include_paths = nullptr);
 
 private:
-    static std::string ProcessInner(std::istringstream &is, 
-        std::streampos &pos, 
-        const ShaderProperties &shader_properties,
-        const std::string &local_path,
-        int *line_num_ptr);
+    struct Node;
+    struct ParsedFile;
+    struct Context;
+
+    static std::shared_ptr<const ParsedFile> Parse(const std::string &code, const std::string &path);
+    // parsed files are cached by path and content for sources, and by path for includes
+    static std::shared_ptr<const ParsedFile> GetSourceFile(const std::string &code, const std::string &path);
+    static std::shared_ptr<const ParsedFile> GetIncludeFile(const std::string &include_path);
+
+    // appends the output of the nodes in [begin, end) when emit is set,
+    // otherwise only counts their lines and includes
+    static void ProcessRange(const ParsedFile &file, size_t begin, size_t end, Context &context, bool emit);
+    static void ProcessFile(const ParsedFile &file, Context &context, bool emit);
 
     static std::string FileHeader(const std::string &path);
 };
@@ -0,0 +1,144 @@
+#include "worker_pool.h"
+#include "profiler.h"
+
+#include <algorithm>
+
+namespace apex {
+
+static thread_local bool in_job = false;
+
+WorkerPool *WorkerPool::instance = nullptr;
+
+WorkerPool *WorkerPool::GetInstance()
+{
+    if (instance == nullptr) {
+        const size_t num_threads = std::thread::hardware_concurrency();
+
+        instance = new WorkerPool(num_threads > 1 ? num_threads - 1 : 0);
+    }
+
+    return instance;
+}
+
+WorkerPool::WorkerPool(size_t num_workers)
+    : m_job(nullptr),
+      m_job_id(0),
+      m_active_workers(0),
+      m_stopping(false)
+{
+    m_workers.reserve(num_workers);
+
+    for (size_t i = 0; i < num_workers; i++) {
+        m_workers.emplace_back(&WorkerPool::WorkerLoop, this);
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+
+    m_job_available.notify_all();
+
+    for (auto &worker : m_workers) {
+        worker.join();
+    }
+}
+
+void WorkerPool::ParallelFor(size_t count, const std::function<void(size_t)> &fn)
+{
+    if (count == 0) {
+        return;
+    }
+
+    if (m_workers.empty() || count == 1 || in_job) {
+        for (size_t i = 0; i < count; i++) {
+            fn(i);
+        }
+
+        return;
+    }
+
+    std::lock_guard<std::mutex> submit_lock(m_submit_mutex);
+
+    Job job(&fn, count);
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_job = &job;
+        ++m_job_id;
+    }
+
+    m_job_available.notify_all();
+
+    RunJob(job);
+
+    {
+        // every index has been claimed; wait for workers still running theirs.
+        // workers that have not picked the job up yet will no longer see it.
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_job = nullptr;
+        m_job_finished.wait(lock, [this]() { return m_active_workers == 0; });
+    }
+
+    if (job.error != nullptr) {
+        std::rethrow_exception(job.error);
+    }
+}
+
+void WorkerPool::WorkerLoop()
+{
+    size_t last_job_id = 0;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (true) {
+        m_job_available.wait(lock, [this, &last_job_id]() {
+            return m_stopping || (m_job != nullptr && m_job_id != last_job_id);
+        });
+
+        if (m_stopping) {
+            return;
+        }
+
+        last_job_id = m_job_id;
+
+        Job *job = m_job;
+        ++m_active_workers;
+
+        lock.unlock();
+        RunJob(*job);
+        lock.lock();
+
+        if (--m_active_workers == 0) {
+            m_job_finished.notify_all();
+        }
+    }
+}
+
+void WorkerPool::RunJob(Job &job)
+{
+    APEX_PROFILE_SCOPE("WorkerPool::RunJob");
+
+    in_job = true;
+
+    size_t index;
+
+    while ((index = job.next++) < job.count) {
+        try {
+            (*job.fn)(index);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(job.error_mutex);
+
+            if (job.error == nullptr) {
+                job.error = std::current_exception();
+            }
+        }
+    }
+
+    in_job = false;
+}
+
+} // namespace apex
@@ -0,0 +1,64 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <exception>
+#include <cstddef>
+
+namespace apex {
+
+// A fixed set of worker threads used to split per-frame work across cores.
+// Only one ParallelFor() runs at a time; calling it from inside a job runs the
+// nested loop inline on the calling thread.
+class WorkerPool {
+public:
+    static WorkerPool *instance;
+    static WorkerPool *GetInstance();
+
+    // num_workers does not include the calling thread, which also takes part in every job
+    WorkerPool(size_t num_workers);
+    WorkerPool(const WorkerPool &other) = delete;
+    ~WorkerPool();
+
+    inline size_t NumWorkers() const { return m_workers.size(); }
+
+    // calls fn(i) for every i in [0, count) and returns once all calls have finished.
+    // the first exception thrown by fn is rethrown on the calling thread.
+    void ParallelFor(size_t count, const std::function<void(size_t)> &fn);
+
+private:
+    struct Job {
+        const std::function<void(size_t)> *fn;
+        size_t count;
+        std::atomic<size_t> next;
+        std::exception_ptr error;
+        std::mutex error_mutex;
+
+        Job(const std::function<void(size_t)> *fn, size_t count)
+            : fn(fn), count(count), next(0)
+        {
+        }
+    };
+
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::mutex m_submit_mutex;
+    std::condition_variable m_job_available;
+    std::condition_variable m_job_finished;
+    Job *m_job;
+    size_t m_job_id;
+    size_t m_active_workers;
+    bool m_stopping;
+
+    void WorkerLoop();
+    static void RunJob(Job &job);
+};
+
+} // namespace apex
+
+#endif
@@ -11,9 +11,15 @@ in vec3 v_tangent;
 in vec3 v_bitangent;
 in mat3 v_tbn;
 
-uniform vec3 u_camerapos;
 
 #include "include/matrices.inc"
+
+#if INSTANCING
+// instanced draws do not set u_modelMatrix, the vertex stage passes the instance's
+flat in mat4 v_instanceModelMatrix;
+#define u_modelMatrix v_instanceModelMatrix
+#endif
+
 #include "include/frag_output.inc"
 #include "include/depth.inc"
 #include "include/lighting.inc"
@@ -36,7 +42,7 @@ void main()
 
   vec3 lightDir = normalize(env_DirectionalLight.direction);
   vec3 n = normalize(v_normal.xyz);
-  vec3 viewVector = normalize(u_camerapos-v_position.xyz);
+  vec3 viewVector = normalize(u_cameraPosition-v_position.xyz);
 
   vec3 tangentViewPos = v_tbn * viewVector;
   vec3 tangentLightPos = v_tbn * lightDir;
@@ -51,7 +57,7 @@ void main()
   vec4 diffuseTexture = vec4(1.0, 1.0, 1.0, 1.0);
 
   if (HasDiffuseMap == 1) {
-    diffuseTexture = texture(DiffuseMap, texCoords);
+    diffuseTexture = SampleMaterialTexture(DiffuseMap, DiffuseMapArray, DiffuseMapLayer, texCoords);
   }
 
   vec4 albedo = u_diffuseColor * diffuseTexture;
@@ -62,20 +68,20 @@ void main()
 
 #if ROUGHNESS_MAPPING
   if (HasRoughnessMap == 1) {
-    roughness = texture(RoughnessMap, texCoords).r;
+    roughness = SampleMaterialTexture(RoughnessMap, RoughnessMapArray, RoughnessMapLayer, texCoords).r;
   }
 #endif
 
 #if METALNESS_MAPPING
   if (HasMetalnessMap == 1) {
-    metallic = texture(MetalnessMap, texCoords).r;
+    metallic = SampleMaterialTexture(MetalnessMap, MetalnessMapArray, MetalnessMapLayer, texCoords).r;
   }
 #endif
 
 
 #if NORMAL_MAPPING
   if (HasNormalMap == 1) {
-    vec4 normalsTexture = texture(NormalMap, texCoords);
+    vec4 normalsTexture = SampleMaterialTexture(NormalMap, NormalMapArray, NormalMapLayer, texCoords);
     normalsTexture.xy = (2.0 * (vec2(1.0) - normalsTexture.rg) - 1.0);
     normalsTexture.z = sqrt(1.0 - dot(normalsTexture.xy, normalsTexture.xy));
     n = normalize((v_tangent * normalsTexture.x) + (v_bitangent * normalsTexture.y) + (n * normalsTexture.z));
@@ -94,7 +100,7 @@ void main()
 
 #if SHADOWS
   float shadowness = 0.0;
-  int shadowSplit = getShadowMapSplit(u_camerapos, v_position.xyz);
+  int shadowSplit = getShadowMapSplit(u_cameraPosition, v_position.xyz);
 
   for (int x = 0; x < 4; x++) {
     for (int y = 0; y < 4; y++) {
@@ -106,7 +112,7 @@ void main()
   shadowness /= 16.0;
   shadowness *= 1.0 - NdotL;
   vec4 shadowColor = vec4(vec3(shadowness), 1.0);
-  shadowColor = CalculateFogLinear(shadowColor, vec4(1.0), v_position.xyz, u_camerapos, u_shadowSplit[int($NUM_SPLITS) - 2], u_shadowSplit[int($NUM_SPLITS) - 1]);
+  shadowColor = CalculateFogLinear(shadowColor, vec4(1.0), v_position.xyz, u_cameraPosition, u_shadowSplit[int($NUM_SPLITS) - 2], u_shadowSplit[int($NUM_SPLITS) - 1]);
 #endif
 
 #if !SHADOWS
@@ -116,11 +122,11 @@ void main()
 
 
 #if PROBE_ENABLED
-    vec3 reflectionVector = EnvProbeVector(n, v_position.xyz, u_camerapos, u_modelMatrix);
+    vec3 reflectionVector = EnvProbeVector(n, v_position.xyz, u_cameraPosition, u_modelMatrix);
 #endif
 
 #if !PROBE_ENABLED
-    vec3 reflectionVector = ReflectionVector(n, v_position.xyz, u_camerapos);
+    vec3 reflectionVector = ReflectionVector(n, v_position.xyz, u_cameraPosition);
 #endif
 
   vec3 blurredSpecularCubemap = texture(env_GlobalIrradianceCubemap, reflectionVector).rgb;
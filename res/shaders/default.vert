@@ -15,6 +15,13 @@ out mat3 v_tbn;
 #endif
 #include "include/matrices.inc"
 
+#if INSTANCING
+#define u_modelMatrix a_instanceModelMatrix
+
+// the fragment stage has no u_modelMatrix to read either
+flat out mat4 v_instanceModelMatrix;
+#endif
+
 uniform int FlipUV_X;
 uniform int FlipUV_Y;
 
@@ -44,5 +51,9 @@ void main() {
 	v_bitangent = v_bitangent - v_tangent * dot( v_bitangent, v_tangent ); // orthonormalization of the binormal vectors to the tangent vector
 	v_tbn = mat3( normalize(v_tangent), normalize(v_bitangent), a_normal );
 
+#if INSTANCING
+  v_instanceModelMatrix = a_instanceModelMatrix;
+#endif
+
   gl_Position = u_projMatrix * u_viewMatrix * v_position;
 }
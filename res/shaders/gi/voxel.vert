@@ -4,9 +4,7 @@
 
 #define $SCALE 5.0
 
-uniform mat4 u_modelMatrix;
-uniform mat4 u_projMatrix;
-uniform mat4 u_viewMatrix;
+#include "../include/matrices.inc"
 
 out vec4 v_position;
 out vec4 v_normal;
@@ -11,7 +11,6 @@ in vec3 v_tangent;
 in vec3 v_bitangent;
 in mat3 v_tbn;
 
-uniform vec3 u_camerapos;
 
 uniform sampler2D BaseTerrainColorMap;
 uniform sampler2D BaseTerrainNormalMap;
@@ -35,6 +34,13 @@ uniform sampler2D SlopeNormalMap;
 uniform float SlopeScale;
 
 #include "include/matrices.inc"
+
+#if INSTANCING
+// instanced draws do not set u_modelMatrix, the vertex stage passes the instance's
+flat in mat4 v_instanceModelMatrix;
+#define u_modelMatrix v_instanceModelMatrix
+#endif
+
 #include "include/frag_output.inc"
 #include "include/depth.inc"
 #include "include/lighting.inc"
@@ -62,7 +68,7 @@ void main()
 
   vec3 lightDir = normalize(env_DirectionalLight.direction);
   vec3 n = normalize(v_normal.xyz);
-  vec3 viewVector = normalize(u_camerapos-v_position.xyz);
+  vec3 viewVector = normalize(u_cameraPosition-v_position.xyz);
 
   vec3 tangentViewPos = v_tbn * viewVector;
   vec3 tangentLightPos = v_tbn * lightDir;
@@ -153,7 +159,7 @@ void main()
 #if SHADOWS
   float shadowness = 0.0;
   const float radius = 0.075;
-  int shadowSplit = getShadowMapSplit(u_camerapos, v_position.xyz);
+  int shadowSplit = getShadowMapSplit(u_cameraPosition, v_position.xyz);
 
   for (int x = 0; x < 4; x++) {
     for (int y = 0; y < 4; y++) {
@@ -165,7 +171,7 @@ void main()
   shadowness /= 16.0;
   shadowness *= 1.0 - NdotL;
   vec4 shadowColor = vec4(vec3(shadowness), 1.0);
-  shadowColor = CalculateFogLinear(shadowColor, vec4(1.0), v_position.xyz, u_camerapos, u_shadowSplit[int($NUM_SPLITS) - 2], u_shadowSplit[int($NUM_SPLITS) - 1]);
+  shadowColor = CalculateFogLinear(shadowColor, vec4(1.0), v_position.xyz, u_cameraPosition, u_shadowSplit[int($NUM_SPLITS) - 2], u_shadowSplit[int($NUM_SPLITS) - 1]);
 #endif
 
 #if !SHADOWS
@@ -175,11 +181,11 @@ void main()
 
 
 #if PROBE_ENABLED
-    vec3 reflectionVector = EnvProbeVector(n, v_position.xyz, u_camerapos, u_modelMatrix);
+    vec3 reflectionVector = EnvProbeVector(n, v_position.xyz, u_cameraPosition, u_modelMatrix);
 #endif
 
 #if !PROBE_ENABLED
-    vec3 reflectionVector = ReflectionVector(n, v_position.xyz, u_camerapos);
+    vec3 reflectionVector = ReflectionVector(n, v_position.xyz, u_cameraPosition);
 #endif
 
   vec3 blurredSpecularCubemap = texture(env_GlobalIrradianceCubemap, reflectionVector).rgb;